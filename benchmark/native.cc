@@ -0,0 +1,225 @@
+// Native part of benchmark suite: cost of syscalls and page faults without JS and V8 overhead
+// Built and run by benchmark/suite.js, prints one JSON object per line:
+//  {"bench":"attach","impl":"native-sysv","size":4096,"metric":"create+detach","value":12.345,"unit":"us"}
+// Usage: shm_bench_native <iterations> <size> [<size>...]
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static double nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void printResult(const char* bench, const char* impl, size_t size, const char* metric,
+	double value, const char* unit) {
+	printf("{\"bench\":\"%s\",\"impl\":\"%s\",\"size\":%zu,\"metric\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n",
+		bench, impl, size, metric, value, unit);
+}
+
+static void printError(const char* bench, const char* impl, size_t size, int err) {
+	fprintf(stderr, "%s %s size=%zu: %s\n", bench, impl, size, strerror(err));
+}
+
+// Write one byte to every page, returns ns per page
+static double touchPages(char* addr, size_t size) {
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	double start = nowNs();
+	for (size_t off = 0; off < size; off += pageSize)
+		addr[off] = 1;
+	return (nowNs() - start) / ((size + pageSize - 1) / pageSize);
+}
+
+static void benchSysv(int iterations, size_t size) {
+	const char* impl = "native-sysv";
+	// shmget + shmat + shmdt + IPC_RMID
+	double start = nowNs();
+	for (int i = 0; i < iterations; i++) {
+		int id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+		if (id == -1)
+			return printError("attach", impl, size, errno);
+		void* addr = shmat(id, NULL, 0);
+		if (addr != (void*) -1)
+			shmdt(addr);
+		shmctl(id, IPC_RMID, NULL);
+	}
+	printResult("attach", impl, size, "create+detach", (nowNs() - start) / iterations / 1e3, "us");
+
+	int id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+	if (id == -1)
+		return printError("attach", impl, size, errno);
+	start = nowNs();
+	for (int i = 0; i < iterations; i++) {
+		void* addr = shmat(id, NULL, 0);
+		if (addr != (void*) -1)
+			shmdt(addr);
+	}
+	printResult("attach", impl, size, "attach+detach", (nowNs() - start) / iterations / 1e3, "us");
+
+	void* addr = shmat(id, NULL, 0);
+	if (addr != (void*) -1) {
+		printResult("fault", impl, size, "first-touch", touchPages((char*) addr, size), "ns/page");
+		printResult("fault", impl, size, "touch", touchPages((char*) addr, size), "ns/page");
+		shmdt(addr);
+	}
+	shmctl(id, IPC_RMID, NULL);
+}
+
+static void benchPosix(int iterations, size_t size) {
+	const char* impl = "native-posix";
+	std::string name = "/shm_bench_native_" + std::to_string(getpid());
+	// shm_open + ftruncate + mmap + munmap + shm_unlink
+	double start = nowNs();
+	for (int i = 0; i < iterations; i++) {
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd == -1)
+			return printError("attach", impl, size, errno);
+		if (ftruncate(fd, size) == 0) {
+			void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (addr != MAP_FAILED)
+				munmap(addr, size);
+		}
+		close(fd);
+		shm_unlink(name.c_str());
+	}
+	printResult("attach", impl, size, "create+detach", (nowNs() - start) / iterations / 1e3, "us");
+
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd == -1)
+		return printError("attach", impl, size, errno);
+	int res = ftruncate(fd, size);
+	close(fd);
+	if (res == -1) {
+		printError("attach", impl, size, errno);
+		shm_unlink(name.c_str());
+		return;
+	}
+	// shm_open + fstat + mmap + munmap, like getPosix()
+	start = nowNs();
+	for (int i = 0; i < iterations; i++) {
+		fd = shm_open(name.c_str(), O_RDWR, 0);
+		struct stat sb;
+		if (fd == -1 || fstat(fd, &sb) == -1)
+			break;
+		void* addr = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (addr != MAP_FAILED)
+			munmap(addr, sb.st_size);
+	}
+	printResult("attach", impl, size, "attach+detach", (nowNs() - start) / iterations / 1e3, "us");
+
+	fd = shm_open(name.c_str(), O_RDWR, 0);
+	void* addr = fd == -1 ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (fd != -1)
+		close(fd);
+	if (addr != MAP_FAILED) {
+		printResult("fault", impl, size, "first-touch", touchPages((char*) addr, size), "ns/page");
+		printResult("fault", impl, size, "touch", touchPages((char*) addr, size), "ns/page");
+		munmap(addr, size);
+	}
+	shm_unlink(name.c_str());
+}
+
+// Words of ping and pong are in different cache lines
+struct alignas(64) PingPongWord {
+	std::atomic<int> value;
+};
+
+static void futexWait(std::atomic<int>* word, int expected) {
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAIT, expected, NULL, NULL, 0);
+#endif
+}
+
+static void futexWake(std::atomic<int>* word) {
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+}
+
+// Wait until word is equal to value, spinning or sleeping on futex
+static void waitFor(std::atomic<int>* word, int value, bool useFutex) {
+	int cur;
+	while ((cur = word->load(std::memory_order_acquire)) != value) {
+		if (useFutex)
+			futexWait(word, cur);
+	}
+}
+
+// Round trip between processes over shared memory, in us
+static void benchPingPong(int iterations, bool useFutex) {
+	const char* metric = useFutex ? "futex" : "spin";
+	PingPongWord* words = static_cast<PingPongWord*>(mmap(NULL, sizeof(PingPongWord) * 2,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+	if (words == MAP_FAILED)
+		return printError("pingpong", "native", 0, errno);
+	std::atomic<int>* ping = &words[0].value;
+	std::atomic<int>* pong = &words[1].value;
+	ping->store(0);
+	pong->store(0);
+	pid_t child = fork();
+	if (child == -1) {
+		printError("pingpong", "native", 0, errno);
+		munmap(words, sizeof(PingPongWord) * 2);
+		return;
+	}
+	if (child == 0) {
+		for (int i = 1; i <= iterations; i++) {
+			waitFor(ping, i, useFutex);
+			pong->store(i, std::memory_order_release);
+			if (useFutex)
+				futexWake(pong);
+		}
+		_exit(0);
+	}
+	double start = nowNs();
+	for (int i = 1; i <= iterations; i++) {
+		ping->store(i, std::memory_order_release);
+		if (useFutex)
+			futexWake(ping);
+		waitFor(pong, i, useFutex);
+	}
+	double elapsed = nowNs() - start;
+	waitpid(child, NULL, 0);
+	munmap(words, sizeof(PingPongWord) * 2);
+	printResult("pingpong", "native", 0, metric, elapsed / iterations / 1e3, "us");
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <iterations> <size> [<size>...]\n", argv[0]);
+		return 2;
+	}
+	int iterations = std::max(1, atoi(argv[1]));
+	for (int i = 2; i < argc; i++) {
+		size_t size = strtoull(argv[i], NULL, 10);
+		benchSysv(iterations, size);
+		benchPosix(iterations, size);
+	}
+	// Spinning needs 2 CPUs, otherwise every round trip waits for time slice
+	if (sysconf(_SC_NPROCESSORS_ONLN) > 1)
+		benchPingPong(iterations * 10, false);
+#ifdef __linux__
+	benchPingPong(iterations * 10, true);
+#endif
+	return 0;
+}
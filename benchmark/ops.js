@@ -0,0 +1,78 @@
+// Bulk operations of shm.ops and shm.copyIn() compared with plain JS loops and TypedArray.set()
+// Usage: node benchmark/ops.js [count=10000000] [repeat=5]
+const shm = require('../index.js');
+
+const count = parseInt(process.argv[2] || 10000000, 10);
+const repeat = parseInt(process.argv[3] || 5, 10);
+const name = '/shm_bench_ops_' + process.pid;
+
+// Plain JS, sync and async native version of every operation
+const cases = {
+	sum: [(a) => { let s = 0; for (let i = 0; i < a.length; i++) s += a[i]; return s; },
+		(a) => shm.ops.sum(a), (a) => shm.ops.sumAsync(a)],
+	min: [(a) => { let m = Infinity; for (let i = 0; i < a.length; i++) if (a[i] < m) m = a[i]; return m; },
+		(a) => shm.ops.min(a), (a) => shm.ops.minAsync(a)],
+	dot: [(a, b) => { let s = 0; for (let i = 0; i < a.length; i++) s += a[i] * b[i]; return s; },
+		(a, b) => shm.ops.dot(a, b), (a, b) => shm.ops.dotAsync(a, b)],
+	argmax: [(a) => { let m = -Infinity, r = -1; for (let i = 0; i < a.length; i++) if (a[i] > m) { m = a[i]; r = i; } return r; },
+		(a) => shm.ops.argmax(a), (a) => shm.ops.argmaxAsync(a)],
+	scale: [(a) => { for (let i = 0; i < a.length; i++) a[i] *= 1.0001; },
+		(a) => shm.ops.scale(a, 1.0001), (a) => shm.ops.scaleAsync(a, 1.0001)],
+	// JS column is TypedArray.prototype.set()
+	copyIn: [(a, b) => a.set(b), (a, b) => shm.copyIn(a, 0, b), (a, b) => shm.copyInAsync(a, 0, b)],
+};
+
+function bestMs(fn) {
+	let best = Infinity;
+	for (let i = 0; i < repeat; i++) {
+		const start = process.hrtime.bigint();
+		fn();
+		best = Math.min(best, Number(process.hrtime.bigint() - start) / 1e6);
+	}
+	return best;
+}
+
+function bestMsAsync(fn) {
+	let best = Infinity;
+	let chain = Promise.resolve();
+	for (let i = 0; i < repeat; i++) {
+		chain = chain.then(() => {
+			const start = process.hrtime.bigint();
+			return fn().then(() => {
+				best = Math.min(best, Number(process.hrtime.bigint() - start) / 1e6);
+			});
+		});
+	}
+	return chain.then(() => best);
+}
+
+async function main() {
+	const config = shm.ops.configure();
+	const rows = [];
+	for (const typeKey of ['Float32Array', 'Float64Array']) {
+		const a = shm.create(count, typeKey, name + '_a');
+		const b = shm.create(count, typeKey, name + '_b');
+		for (let i = 0; i < count; i++) {
+			a[i] = Math.random();
+			b[i] = Math.random();
+		}
+		for (const op of Object.keys(cases)) {
+			const [js, native, nativeAsync] = cases[op].map((fn) => () => fn(a, b));
+			const row = { type: typeKey, op: op, 'JS ms': bestMs(js).toFixed(1) };
+			for (const isa of config.supportedIsa) {
+				shm.ops.configure({ isa: isa, threads: 1 });
+				row[isa + ' ms'] = bestMs(native).toFixed(1);
+			}
+			shm.ops.configure({ isa: 'auto', threads: config.threads });
+			row['auto x' + config.threads + ' threads ms'] = bestMs(native).toFixed(1);
+			row['async ms'] = (await bestMsAsync(nativeAsync)).toFixed(1);
+			rows.push(row);
+		}
+		shm.destroy(name + '_a');
+		shm.destroy(name + '_b');
+	}
+	console.log('count=' + count + ', best of ' + repeat + ', isa=' + config.isa);
+	console.table(rows);
+}
+
+main();
@@ -0,0 +1,72 @@
+// Attach/detach cost of shared memory registry as count of live segments grows
+// Usage: node benchmark/registry.js [total=100000] [batch=10000]
+// Segments stay attached until the end, so every batch is measured with all previous ones live.
+// Every attached segment is separate mapping, total is limited by vm.max_map_count.
+const fs = require('fs');
+const shm = require('../index.js');
+
+let total = parseInt(process.argv[2] || 100000, 10);
+const batch = parseInt(process.argv[3] || 10000, 10);
+const prefix = '/shm_bench_registry_' + process.pid + '_';
+
+try {
+	// Keep room for mappings of node itself
+	const maxMaps = parseInt(fs.readFileSync('/proc/sys/vm/max_map_count', 'utf8'), 10) - 5000;
+	if (total > maxMaps) {
+		console.warn('vm.max_map_count allows ~' + maxMaps + ' live segments, total is reduced');
+		total = Math.floor(maxMaps / batch) * batch || maxMaps;
+	}
+} catch (e) {
+	// Not Linux
+}
+
+function usPerOp(start, ops) {
+	const ns = process.hrtime.bigint() - start;
+	return (Number(ns) / 1000 / ops).toFixed(2);
+}
+
+const keys = [];
+const rows = [];
+try {
+	while (keys.length < total) {
+		const from = keys.length;
+		const cnt = Math.min(batch, total - from);
+		for (let i = 0; i < cnt; i++)
+			keys.push(prefix + (from + i));
+
+		let start = process.hrtime.bigint();
+		for (let i = from; i < keys.length; i++)
+			shm.createPosix(keys[i], 1, 'Uint8Array');
+		const createUs = usPerOp(start, cnt);
+
+		// Attach and detach again segments of new batch, and same count of random live ones
+		start = process.hrtime.bigint();
+		for (let i = from; i < keys.length; i++) {
+			shm.getPosix(keys[i], 'Uint8Array');
+			shm.detachPosix(keys[i]);
+		}
+		const attachUs = usPerOp(start, cnt);
+
+		start = process.hrtime.bigint();
+		for (let i = 0; i < cnt; i++) {
+			const key = keys[Math.floor(Math.random() * keys.length)];
+			shm.getPosix(key, 'Uint8Array');
+			shm.detachPosix(key);
+		}
+		const attachRandomUs = usPerOp(start, cnt);
+
+		rows.push({
+			'live segments': keys.length,
+			'create µs/op': createUs,
+			'attach+detach µs/op': attachUs,
+			'random attach+detach µs/op': attachRandomUs,
+		});
+	}
+} finally {
+	const start = process.hrtime.bigint();
+	for (const key of keys)
+		shm.detachPosix(key, true);
+	if (keys.length)
+		rows.push({ 'live segments': 0, 'destroy µs/op': usPerOp(start, keys.length) });
+}
+console.table(rows);
@@ -0,0 +1,290 @@
+// Benchmark suite: create/attach/detach latency vs size for System V and POSIX, first-touch fault cost,
+//  sequential and random bandwidth through every element type, and cross-process round trip.
+// Syscall costs without JS overhead are measured by native harness benchmark/native.cc,
+//  it's compiled with $CXX (default c++) on every run and skipped if there is no compiler.
+// Usage: node benchmark/suite.js [--json] [--quick] [--no-native] [--compare baseline.json] [--tolerance 0.2]
+//  --json - print { meta, results } instead of table, eg. to save baseline: node benchmark/suite.js --json > baseline.json
+//  --compare - compare with saved results, exit with code 1 if any result is worse by more than tolerance
+const shm = require('../index.js');
+const childProcess = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const argv = process.argv.slice(2);
+const hasFlag = (flag) => argv.indexOf(flag) !== -1;
+const flagValue = (flag) => argv.indexOf(flag) !== -1 ? argv[argv.indexOf(flag) + 1] : undefined;
+
+const quick = hasFlag('--quick');
+const sizes = quick ? [4096, 1 << 20] : [4096, 64 << 10, 1 << 20, 16 << 20, 64 << 20];
+const iterations = quick ? 200 : 2000;
+const bandwidthBytes = quick ? 8 << 20 : 64 << 20;
+const repeat = 3;
+const pageSize = 4096;
+const name = '/shm_bench_suite_' + process.pid;
+
+const results = [];
+
+function addResult(bench, impl, typeKey, size, metric, value, unit) {
+	results.push({ bench: bench, impl: impl, type: typeKey, size: size, metric: metric, value: +value.toFixed(3), unit: unit });
+}
+
+function elapsedNs(start) {
+	return Number(process.hrtime.bigint() - start);
+}
+
+// Best time of repeat runs in ns
+function bestNs(fn) {
+	let best = Infinity;
+	for (let i = 0; i < repeat; i++) {
+		const start = process.hrtime.bigint();
+		fn();
+		best = Math.min(best, elapsedNs(start));
+	}
+	return best;
+}
+
+// System V segments by key, POSIX objects by name
+const impls = {
+	sysv: {
+		create: (size) => shm.create(size, 'Buffer').key,
+		get: (key) => shm.get(key, 'Buffer'),
+		detach: (key) => shm.detach(key),
+		destroy: (key) => shm.destroy(key),
+	},
+	posix: {
+		create: (size) => (shm.create(size, 'Buffer', name), name),
+		get: (key) => shm.get(key, 'Buffer'),
+		detach: (key) => shm.detach(key),
+		destroy: (key) => shm.destroy(key),
+	},
+};
+
+function benchAttach() {
+	for (const size of sizes) {
+		for (const impl of Object.keys(impls)) {
+			const api = impls[impl];
+			let start = process.hrtime.bigint();
+			for (let i = 0; i < iterations; i++)
+				api.destroy(api.create(size));
+			addResult('attach', impl, 'Buffer', size, 'create+detach', elapsedNs(start) / iterations / 1e3, 'us');
+
+			// Creator stays attached, so detach doesn't destroy System V segment
+			const key = api.create(size);
+			start = process.hrtime.bigint();
+			for (let i = 0; i < iterations; i++) {
+				api.get(key);
+				api.detach(key);
+			}
+			addResult('attach', impl, 'Buffer', size, 'attach+detach', elapsedNs(start) / iterations / 1e3, 'us');
+			api.destroy(key);
+		}
+	}
+}
+
+// Write one byte to every page, returns ns per page
+function touchPages(buf) {
+	const start = process.hrtime.bigint();
+	for (let off = 0; off < buf.length; off += pageSize)
+		buf[off] = 1;
+	return elapsedNs(start) / Math.ceil(buf.length / pageSize);
+}
+
+async function benchFault() {
+	for (const size of sizes.filter((size) => size >= 1 << 20)) {
+		for (const impl of Object.keys(impls)) {
+			const api = impls[impl];
+			let key = api.create(size);
+			let buf = api.get(key);
+			addResult('fault', impl, 'Buffer', size, 'first-touch', touchPages(buf), 'ns/page');
+			addResult('fault', impl, 'Buffer', size, 'touch', touchPages(buf), 'ns/page');
+			api.destroy(key);
+
+			key = api.create(size);
+			buf = api.get(key);
+			const start = process.hrtime.bigint();
+			await shm.prefault(buf, { populate: true });
+			addResult('fault', impl, 'Buffer', size, 'prefault', elapsedNs(start) / Math.ceil(size / pageSize), 'ns/page');
+			api.destroy(key);
+		}
+	}
+}
+
+// Keeps results of read loops, so they are not optimized out
+let sink;
+
+function benchBandwidth() {
+	const typeKeys = Object.keys(shm.BufferType).filter((typeKey) => typeof globalThis[typeKey] === 'function');
+	for (const typeKey of typeKeys) {
+		// Counts are powers of 2, so random indexes are generated by LCG with full period
+		const count = bandwidthBytes / globalThis[typeKey].BYTES_PER_ELEMENT;
+		const mask = count - 1;
+		const arr = shm.create(count, typeKey, name);
+		const one = typeKey.startsWith('Big') ? BigInt(1) : 1;
+		const zero = typeKey.startsWith('Big') ? BigInt(0) : 0;
+		arr.fill(one);
+		const cases = {
+			'seq-read': () => { let s = zero; for (let i = 0; i < count; i++) s += arr[i]; sink = s; },
+			'seq-write': () => { for (let i = 0; i < count; i++) arr[i] = one; },
+			'random-read': () => {
+				let s = zero, j = 0;
+				for (let i = 0; i < count; i++) {
+					j = (Math.imul(j, 1664525) + 1013904223) & mask;
+					s += arr[j];
+				}
+				sink = s;
+			},
+			'random-write': () => {
+				let j = 0;
+				for (let i = 0; i < count; i++) {
+					j = (Math.imul(j, 1664525) + 1013904223) & mask;
+					arr[j] = one;
+				}
+			},
+		};
+		for (const metric of Object.keys(cases)) {
+			const ns = bestNs(cases[metric]);
+			addResult('bandwidth', 'posix', typeKey, bandwidthBytes, metric, bandwidthBytes / (ns / 1e9) / (1 << 20), 'MB/s');
+		}
+		shm.destroy(name);
+	}
+}
+
+// Wait until element is equal to value with shm.wait() (futex in threadpool)
+async function waitFor(arr, index, value) {
+	let cur;
+	while ((cur = Atomics.load(arr, index)) !== value)
+		await shm.wait(arr, index, cur, 1000);
+}
+
+// Other side of round trip, runs in child process: answers every ping with pong of same value
+async function pingPongChild(objName, mode, count) {
+	const arr = shm.get(objName, 'Int32Array');
+	process.send('ready');
+	for (let i = 1; i <= count; i++) {
+		if (mode === 'spin') {
+			while (Atomics.load(arr, 0) !== i);
+		} else {
+			await waitFor(arr, 0, i);
+		}
+		Atomics.store(arr, 16, i);
+		if (mode === 'futex')
+			shm.notify(arr, 16);
+	}
+	shm.detach(objName);
+	process.disconnect();
+}
+
+async function benchPingPong() {
+	// Spinning needs 2 CPUs, otherwise every round trip waits for time slice
+	const modes = os.cpus().length > 1 ? ['spin', 'futex'] : ['futex'];
+	const count = iterations * 5;
+	for (const mode of modes) {
+		// Ping in element 0 and pong in element 16, in different cache lines
+		const arr = shm.create(32, 'Int32Array', name);
+		const child = childProcess.fork(__filename, ['--pingpong-child', name, mode, String(count)]);
+		await new Promise((resolve) => child.once('message', resolve));
+		const start = process.hrtime.bigint();
+		for (let i = 1; i <= count; i++) {
+			Atomics.store(arr, 0, i);
+			if (mode === 'spin') {
+				while (Atomics.load(arr, 16) !== i);
+			} else {
+				shm.notify(arr, 0);
+				await waitFor(arr, 16, i);
+			}
+		}
+		addResult('pingpong', 'posix', 'Int32Array', 0, mode, elapsedNs(start) / count / 1e3, 'us');
+		await new Promise((resolve) => child.once('exit', resolve));
+		shm.destroy(name);
+	}
+}
+
+// Compile and run benchmark/native.cc, its results are added as is
+function benchNative() {
+	const bin = path.join(os.tmpdir(), 'shm_bench_native_' + process.pid);
+	const cxx = process.env.CXX || 'c++';
+	const build = childProcess.spawnSync(cxx, ['-O2', '-std=c++11', '-o', bin, path.join(__dirname, 'native.cc'), '-lrt'],
+		{ stdio: ['ignore', 'ignore', 'inherit'] });
+	if (build.status !== 0) {
+		console.error('Native harness is skipped: failed to compile with ' + cxx);
+		return;
+	}
+	try {
+		const out = childProcess.execFileSync(bin, [String(iterations)].concat(sizes.map(String)),
+			{ stdio: ['ignore', 'pipe', 'inherit'] });
+		for (const line of out.toString().split('\n').filter(Boolean)) {
+			const res = JSON.parse(line);
+			addResult(res.bench, res.impl, null, res.size, res.metric, res.value, res.unit);
+		}
+	} finally {
+		fs.unlinkSync(bin);
+	}
+}
+
+// Results are matched with baseline by id
+function resultId(res) {
+	return [res.bench, res.impl, res.type, res.size, res.metric].join('/');
+}
+
+// Returns results worse than baseline, lower is better for latency and higher for bandwidth
+function compare(baselinePath, tolerance) {
+	const baseline = new Map(JSON.parse(fs.readFileSync(baselinePath, 'utf8')).results
+		.map((res) => [resultId(res), res.value]));
+	const rows = [];
+	for (const res of results) {
+		const base = baseline.get(resultId(res));
+		if (base === undefined || base === 0)
+			continue;
+		const ratio = res.value / base;
+		const worse = res.unit === 'MB/s' ? ratio < 1 - tolerance : ratio > 1 + tolerance;
+		if (worse)
+			rows.push({ id: resultId(res), baseline: base, value: res.value, unit: res.unit, ratio: +ratio.toFixed(2) });
+	}
+	return rows;
+}
+
+async function main() {
+	benchAttach();
+	await benchFault();
+	benchBandwidth();
+	await benchPingPong();
+	if (!hasFlag('--no-native'))
+		benchNative();
+
+	if (hasFlag('--json')) {
+		const meta = {
+			version: require('../package.json').version,
+			node: process.version,
+			platform: os.platform(),
+			arch: os.arch(),
+			cpus: os.cpus().length,
+			cpuModel: os.cpus().length ? os.cpus()[0].model : null,
+			quick: quick,
+			date: new Date().toISOString(),
+		};
+		console.log(JSON.stringify({ meta: meta, results: results }, null, 2));
+	} else {
+		console.table(results);
+	}
+
+	const baselinePath = flagValue('--compare');
+	if (baselinePath) {
+		const regressions = compare(baselinePath, Number(flagValue('--tolerance') || 0.2));
+		if (regressions.length) {
+			console.error('Regressions against ' + baselinePath + ':');
+			console.table(regressions);
+			process.exitCode = 1;
+		}
+	}
+}
+
+if (argv[0] === '--pingpong-child') {
+	pingPongChild(argv[1], argv[2], Number(argv[3]));
+} else {
+	main().catch(function (err) {
+		console.error(err);
+		shm.detachAll();
+		process.exit(1);
+	});
+}
@@ -7,7 +7,20 @@
 		],
 		"sources": [
 			"src/node_shm.h",
-			"src/node_shm.cc"
+			"src/node_shm.cc",
+			"src/node_shm_queue.cc",
+			"src/node_shm_futex.cc",
+			"src/node_shm_prefault.cc",
+			"src/node_shm_slab.cc",
+			"src/node_shm_hashtable.cc",
+			"src/node_shm_seqlock.cc",
+			"src/node_shm_lock.cc",
+			"src/node_shm_numa.cc",
+			"src/node_shm_ops.cc",
+			"src/node_shm_memfd.cc",
+			"src/node_shm_file.cc",
+			"src/node_shm_stats.cc",
+			"src/node_shm_window.cc"
 		],
 		"conditions": [
 			["OS!='mac'", {
@@ -3,6 +3,9 @@
 
 type Shm<T> = (T & { key?: number });
 
+// Float16Array is not declared in older TypeScript libs
+type Float16ArrayType = typeof globalThis extends { Float16Array: { prototype: infer T } } ? T : never;
+
 type ShmMap = {
     Buffer: Shm<Buffer>;
     Int8Array: Shm<Int8Array>;
@@ -14,24 +17,199 @@ type ShmMap = {
     Uint32Array: Shm<Uint32Array>;
     Float32Array: Shm<Float32Array>;
     Float64Array: Shm<Float64Array>;
+    BigInt64Array: Shm<BigInt64Array>;
+    BigUint64Array: Shm<BigUint64Array>;
+    Float16Array: Shm<Float16ArrayType>;
+}
+
+type AttachOptions = {
+    /**
+     * Detach memory when returned object (all chunks) is collected by GC.
+     */
+    autoDetach?: boolean;
+}
+
+type CreateOptions = AttachOptions & {
+    /**
+     * Use huge pages, size is rounded up to huge page size.
+     * 'auto' tries huge pages of default size and falls back to transparent huge pages.
+     */
+    hugePages?: '2MB' | '1GB' | 'auto';
+    /**
+     * NUMA placement, applied before memory is touched.
+     * Ignored if kernel does not support NUMA.
+     */
+    numa?: 'interleave' | { interleave: number[] } | { bind: number[] } | { preferred: number | null };
+}
+
+type PrefaultOptions = {
+    /**
+     * Fault in pages for write.
+     */
+    populate?: boolean;
+    /**
+     * Lock pages in memory with mlock().
+     */
+    lock?: boolean;
+    /**
+     * madvise(MADV_WILLNEED).
+     */
+    willNeed?: boolean;
+}
+
+type NoPrefaultOptions = {
+    populate?: false;
+    lock?: false;
+    willNeed?: false;
+}
+
+type ChunkedOptions = {
+    /**
+     * Return ChunkedArray, allows count > LengthMax.
+     */
+    chunked: true;
+    /**
+     * Max count of elements in chunk, default is max power of 2 <= LengthMax.
+     */
+    chunkLength?: number;
+}
+
+type NoChunkedOptions = {
+    chunked?: false;
+}
+
+type PageInfo = {
+    pageSize: number;
+    hugetlb: boolean;
+    transparentHugeBytes: number;
+}
+
+type SegmentStats = {
+    type: 'sysv' | 'posix' | 'anonymous' | 'file';
+    /** System V only */
+    key?: number;
+    /** System V only */
+    id?: number;
+    /** POSIX object and file only */
+    name?: string;
+    /** Anonymous memory only */
+    fd?: number;
+    size: number | null;
+    mappedBytes: number;
+    attaches: number;
+    isOwner: boolean;
+    nattch: number | null;
+    creatorPid: number | null;
+    createdAt: Date | null;
+    pageSize: number;
+    hugetlb: boolean;
+    transparentHugeBytes: number;
+    residentPages: number | null;
+    residentBytes: number | null;
+    pages: number;
+}
+
+type ListEntry = {
+    type: 'sysv' | 'posix';
+    /** System V only */
+    key?: number;
+    /** System V only */
+    id?: number;
+    /** POSIX only */
+    name?: string;
+    size: number;
+    nattch: number | null;
+    uid: number;
+    mode: number;
+    creatorPid: number | null;
+    ownerPid: number | null;
+    ownerAlive: boolean | null;
+    lease: boolean;
+    createdAt: Date | null;
+    activeAt: Date | null;
+    attached: boolean;
+}
+
+type ReapOptions = {
+    /** Min time since last activity in ms, default 0 */
+    olderThan?: number;
+    /** Also reap POSIX objects whose lease was not renewed for this time, even if owner is alive */
+    leaseTimeout?: number;
+    /** Only return orphans */
+    dryRun?: boolean;
+    /** Default is ['posix'], System V segments are reaped only if 'sysv' is passed */
+    types?: Array<'sysv' | 'posix'>;
+    /** Reap only POSIX objects with names starting with prefix */
+    prefix?: string;
+}
+
+type Counters = {
+    attaches: number;
+    attachErrors: number;
+    attachNs: number;
+    mappingReuses: number;
+    detaches: number;
+    destroys: number;
+    detachNs: number;
+    prefaults: number;
+    prefaultBytes: number;
+    prefaultNs: number;
+    flushes: number;
+    flushNs: number;
+}
+
+type PrometheusOptions = {
+    /** Prefix of metric names, default 'shm' */
+    prefix?: string;
+    /** Include per-segment metrics, default true */
+    segments?: boolean;
+}
+
+type NumaInfo = {
+    nodes: number[];
+    policy: 'default' | 'interleave' | 'bind' | 'preferred' | 'local' | 'unknown' | null;
+    policyNodes: number[];
+    pageSize: number;
+    residentPages: { [node: number]: number } | null;
 }
 
 /**
 * Create shared memory segment/object.
 * Returns null if shm already exists.
 */
-export function create<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey?: K, key?: number | string, perm?: string): ShmMap[K] | null;
+export function create<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey?: K, key?: number | string, perm?: string, options?: CreateOptions & NoPrefaultOptions & NoChunkedOptions): ShmMap[K] | null;
+/**
+* Create shared memory segment/object and prefault it in threadpool.
+* Returns promise resolved when memory is resident.
+*/
+export function create<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey: K | undefined, key: number | string | undefined | null, perm: string | undefined, options: CreateOptions & PrefaultOptions & NoChunkedOptions): Promise<ShmMap[K] | null>;
+/**
+* Create shared memory segment/object as sequence of views.
+*/
+export function create<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey: K | undefined, key: number | string | undefined | null, perm: string | undefined, options: CreateOptions & NoPrefaultOptions & ChunkedOptions): ShmChunked<ShmMap[K]> | null;
+export function create<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey: K | undefined, key: number | string | undefined | null, perm: string | undefined, options: CreateOptions & PrefaultOptions & ChunkedOptions): Promise<ShmChunked<ShmMap[K]> | null>;
 
 /**
  * Get shared memory segment/object.
  * Returns null if shm not exists.
  */
-export function get<K extends keyof ShmMap = 'Buffer'>(key: number | string, typeKey?: K): ShmMap[K] | null;
+export function get<K extends keyof ShmMap = 'Buffer'>(key: number | string, typeKey?: K, options?: AttachOptions & NoPrefaultOptions & NoChunkedOptions): ShmMap[K] | null;
+/**
+ * Get shared memory segment/object and prefault it in threadpool.
+ * Returns promise resolved when memory is resident.
+ */
+export function get<K extends keyof ShmMap = 'Buffer'>(key: number | string, typeKey: K | undefined, options: AttachOptions & PrefaultOptions & NoChunkedOptions): Promise<ShmMap[K] | null>;
+/**
+ * Get shared memory segment/object as sequence of views.
+ */
+export function get<K extends keyof ShmMap = 'Buffer'>(key: number | string, typeKey: K | undefined, options: AttachOptions & NoPrefaultOptions & ChunkedOptions): ShmChunked<ShmMap[K]> | null;
+export function get<K extends keyof ShmMap = 'Buffer'>(key: number | string, typeKey: K | undefined, options: AttachOptions & PrefaultOptions & ChunkedOptions): Promise<ShmChunked<ShmMap[K]> | null>;
 
 /**
  * Detach shared memory segment/object.
  * For System V: If there are no other attaches for this segment, it will be destroyed.
- * Returns 0 on destroy, 1 on detach, -1 on error
+ * Returns 0 on destroy, count of left attaches of System V segment (in this and other processes)
+ *  or 1 for POSIX object on detach, -1 if not exists.
  */
 export function detach(key: number | string, forceDestoy?: boolean): number;
 
@@ -41,11 +219,669 @@ export function detach(key: number | string, forceDestoy?: boolean): number;
 export function destroy(key: number | string): boolean;
 
 /**
- * Detach all created and getted shared memory segments/objects.
- * Will be automatically called on process exit/termination.
+ * Resize POSIX shared memory object attached by this process.
+ * Previous views of this attach should not be used after resize.
+ */
+export function resize<K extends keyof ShmMap = 'Buffer'>(name: string, count: number, typeKey?: K, options?: AttachOptions & NoChunkedOptions): ShmMap[K];
+export function resize<K extends keyof ShmMap = 'Buffer'>(name: string, count: number, typeKey: K | undefined, options: AttachOptions & ChunkedOptions): ShmChunked<ShmMap[K]>;
+
+/**
+ * Remap POSIX shared memory object if it was resized by other process.
+ * Returns null if not resized since last map.
+ */
+export function refresh<K extends keyof ShmMap = 'Buffer'>(name: string, typeKey?: K, options?: AttachOptions & NoChunkedOptions): ShmMap[K] | null;
+export function refresh<K extends keyof ShmMap = 'Buffer'>(name: string, typeKey: K | undefined, options: AttachOptions & ChunkedOptions): ShmChunked<ShmMap[K]> | null;
+
+/**
+ * Info from header of POSIX shared memory object.
+ */
+type ObjectInfo = {
+    typeKey: keyof ShmMap | null;
+    count: number;
+    size: number;
+    /**
+     * 0 for objects created by older versions.
+     */
+    layoutVersion: number;
+    createdAt: Date | null;
+    dataOffset: number;
+}
+
+/**
+ * Get info from header of POSIX shared memory object attached by this process.
+ */
+export function objectInfo(name: string): ObjectInfo;
+
+/**
+ * Window of POSIX shared memory object, objectLength is count of elements of whole object.
+ */
+type Window<T> = T & { objectLength: number };
+
+type WindowOptions = {
+    /**
+     * Name is path of file created by createFile().
+     */
+    file?: boolean;
+    /**
+     * Fault in pages of window on mapping with MAP_POPULATE (Linux only).
+     */
+    populate?: boolean;
+    /**
+     * madvise(MADV_WILLNEED), kernel starts to read in window in background.
+     */
+    willNeed?: boolean;
+}
+
+type WindowsOptions<K extends keyof ShmMap> = Omit<WindowOptions, 'willNeed'> & {
+    /**
+     * Count of elements in window, default is 16M.
+     */
+    windowLength?: number;
+    offset?: number;
+    /**
+     * Count of elements to iterate, default is up to end of object.
+     */
+    length?: number;
+    typeKey?: K;
+}
+
+/**
+ * Map page-aligned part of POSIX shared memory object without mapping whole object.
+ * Window is unmapped when view is collected by GC, or by unmapWindow().
+ * Returns null if not exists.
+ */
+export function mapWindow<K extends keyof ShmMap = 'Buffer'>(name: string, offset: number, length: number, typeKey?: K, options?: WindowOptions): Window<ShmMap[K]> | null;
+
+/**
+ * Unmap window returned by mapWindow(), view should not be used after it.
+ * Returns false if array is not mapped window.
+ */
+export function unmapWindow(array: ArrayBufferView): boolean;
+
+/**
+ * Drop pages of window from memory of this process, view stays valid.
+ * Returns false if array is not mapped window.
+ */
+export function discardWindow(array: ArrayBufferView): boolean;
+
+/**
+ * Iterate over POSIX shared memory object by windows, next window is mapped ahead of reader
+ * and windows behind reader are discarded.
+ */
+export function windows<K extends keyof ShmMap = 'Buffer'>(name: string, options?: WindowsOptions<K>): Generator<{ offset: number, array: Window<ShmMap[K]> }, void, undefined>;
+
+/**
+ * Anonymous shared memory, fd can be passed to other process with sendFd().
+ */
+type Anonymous<T> = T & { fd: number };
+
+type SealName = 'seal' | 'shrink' | 'grow' | 'write';
+
+/**
+ * Create anonymous shared memory with memfd_create() (Linux only).
+ * It's freed by kernel when last fd and mapping are closed.
+ */
+export function createAnonymous<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey?: K, options?: CreateOptions & NoPrefaultOptions & NoChunkedOptions): Anonymous<ShmMap[K]>;
+export function createAnonymous<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey: K | undefined, options: CreateOptions & PrefaultOptions & NoChunkedOptions): Promise<Anonymous<ShmMap[K]>>;
+export function createAnonymous<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey: K | undefined, options: CreateOptions & NoPrefaultOptions & ChunkedOptions): Anonymous<ShmChunked<ShmMap[K]>>;
+
+/**
+ * Map anonymous shared memory received with recvFd(), attach takes ownership of fd.
+ * Memory sealed against writes is mapped copy-on-write.
+ */
+export function getAnonymous<K extends keyof ShmMap = 'Buffer'>(fd: number, typeKey?: K, options?: AttachOptions & NoPrefaultOptions & NoChunkedOptions): Anonymous<ShmMap[K]>;
+export function getAnonymous<K extends keyof ShmMap = 'Buffer'>(fd: number, typeKey: K | undefined, options: AttachOptions & NoPrefaultOptions & ChunkedOptions): Anonymous<ShmChunked<ShmMap[K]>>;
+
+/**
+ * Detach anonymous shared memory and close its fd.
+ * Returns 0 on detach, -1 if not attached
+ */
+export function detachAnonymous(fd: number | { fd: number }): number;
+
+/**
+ * Seal anonymous shared memory, default is all seals. Returns all seals of memory.
+ * Views of this process stay valid, but are copy-on-write after 'write' seal.
+ */
+export function seal(fd: number | { fd: number }, seals?: SealName[]): SealName[];
+
+/**
+ * Get seals of anonymous shared memory.
+ */
+export function getSeals(fd: number | { fd: number }): SealName[];
+
+/**
+ * Send fd over Unix domain socket (SCM_RIGHTS).
+ * Doesn't wait, throws if send buffer of socket is full or net.Socket has pending writes.
+ */
+export function sendFd(socket: number | import('net').Socket, fd: number | { fd: number }): void;
+
+/**
+ * Receive fd sent by sendFd(), waits in threadpool.
+ */
+export function recvFd(socket: number | import('net').Socket, timeoutMs?: number): Promise<number>;
+
+/**
+ * Files are not created in huge pages.
+ */
+type FileOptions = Omit<CreateOptions, 'hugePages'>;
+
+/**
+ * Create shared memory backed by regular file, contents survive restart.
+ * Returns null if file already exists.
+ */
+export function createFile<K extends keyof ShmMap = 'Buffer'>(path: string, count: number, typeKey?: K, perm?: string, options?: FileOptions & NoPrefaultOptions & NoChunkedOptions): ShmMap[K] | null;
+export function createFile<K extends keyof ShmMap = 'Buffer'>(path: string, count: number, typeKey: K | undefined, perm: string | undefined, options: FileOptions & PrefaultOptions & NoChunkedOptions): Promise<ShmMap[K] | null>;
+export function createFile<K extends keyof ShmMap = 'Buffer'>(path: string, count: number, typeKey: K | undefined, perm: string | undefined, options: FileOptions & NoPrefaultOptions & ChunkedOptions): ShmChunked<ShmMap[K]> | null;
+
+/**
+ * Open file created by createFile(), eg. after restart.
+ * Returns null if file not exists.
+ */
+export function openFile<K extends keyof ShmMap = 'Buffer'>(path: string, typeKey?: K, options?: AttachOptions & NoPrefaultOptions & NoChunkedOptions): ShmMap[K] | null;
+export function openFile<K extends keyof ShmMap = 'Buffer'>(path: string, typeKey: K | undefined, options: AttachOptions & PrefaultOptions & NoChunkedOptions): Promise<ShmMap[K] | null>;
+export function openFile<K extends keyof ShmMap = 'Buffer'>(path: string, typeKey: K | undefined, options: AttachOptions & NoPrefaultOptions & ChunkedOptions): ShmChunked<ShmMap[K]> | null;
+
+/**
+ * Unmap file, optionally remove it.
+ * Returns 0 on remove, 1 on detach, -1 if not exists
+ */
+export function closeFile(path: string, remove?: boolean): number;
+
+/**
+ * Write range of file-backed array to disk with msync() in threadpool.
+ * Resolves with count of written bytes.
+ */
+export function flush(array: ArrayBufferView | ChunkedArray<ArrayBufferView>, start?: number, end?: number): Promise<number>;
+
+/**
+ * Mark range of file-backed array as changed, so it's written by next checkpoint().
+ */
+export function markDirty(array: ArrayBufferView | ChunkedArray<ArrayBufferView>, start?: number, end?: number): void;
+
+/**
+ * Write ranges marked by markDirty() since last checkpoint to disk in threadpool.
+ * Resolves with count of written bytes.
+ */
+export function checkpoint(path: string): Promise<number>;
+
+/**
+ * Same as create(), but syscalls are done in threadpool.
+ */
+export function createAsync<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey?: K, key?: number | string | null, perm?: string, options?: CreateOptions & NoChunkedOptions): Promise<ShmMap[K] | null>;
+export function createAsync<K extends keyof ShmMap = 'Buffer'>(count: number, typeKey: K | undefined, key: number | string | undefined | null, perm: string | undefined, options: CreateOptions & ChunkedOptions): Promise<ShmChunked<ShmMap[K]> | null>;
+
+/**
+ * Same as get(), but syscalls are done in threadpool.
+ */
+export function getAsync<K extends keyof ShmMap = 'Buffer'>(key: number | string, typeKey?: K, options?: AttachOptions & NoChunkedOptions): Promise<ShmMap[K] | null>;
+export function getAsync<K extends keyof ShmMap = 'Buffer'>(key: number | string, typeKey: K | undefined, options: AttachOptions & ChunkedOptions): Promise<ShmChunked<ShmMap[K]> | null>;
+
+/**
+ * Same as detach(), but unmapping is done in threadpool.
+ */
+export function detachAsync(key: number | string, forceDestoy?: boolean): Promise<number>;
+
+/**
+ * Same as destroy(), but done in threadpool.
+ */
+export function destroyAsync(key: number | string): Promise<boolean>;
+
+/**
+ * Detach all created and getted shared memory segments/objects of current thread.
+ * Will be automatically called on process exit/termination, and on exit of worker thread.
  */
 export function detachAll(): number;
 
+/**
+ * Make shared memory resident in threadpool, so first access does not cause page faults.
+ * Default options are { populate: true }.
+ */
+export function prefault<T extends ArrayBufferView | ChunkedArray<ArrayBufferView>>(array: T, options?: PrefaultOptions): Promise<T>;
+
+/**
+ * Get info about pages used for mapping of attached shared memory segment/object.
+ * Returns null if not attached.
+ */
+export function pageInfo(key: number | string): PageInfo | null;
+
+/**
+ * Get NUMA placement of attached shared memory segment/object.
+ * Returns null if not attached.
+ */
+export function numaInfo(key: number | string): NumaInfo | null;
+
+/**
+ * Get runtime stats of every shared memory segment/object attached by this process.
+ */
+export function stats(): SegmentStats[];
+
+/**
+ * Get counters of attaches, detaches, prefaults and flushes done by this process, and time spent in their syscalls.
+ */
+export function counters(): Counters;
+
+/**
+ * Export counters, totals and per-segment stats in Prometheus text format.
+ */
+export function prometheus(options?: PrometheusOptions): string;
+
+/**
+ * List System V segments and POSIX objects of all processes (Linux only).
+ */
+export function list(): ListEntry[];
+
+/**
+ * Destroy System V segments and POSIX objects whose owners are dead (Linux only).
+ * Returns destroyed segments/objects.
+ */
+export function reap(options?: ReapOptions): ListEntry[];
+
+/**
+ * Renew leases of this process, or take over lease of attached POSIX object.
+ * Returns count of renewed leases.
+ */
+export function heartbeat(name?: string): number;
+
+/**
+ * Wait until element of shared memory array is notified by another thread or process.
+ * Waiting is done with futex in libuv threadpool (Linux only).
+ */
+export function wait(array: Int32Array | Uint32Array, index: number, expected: number, timeoutMs?: number): Promise<'ok' | 'not-equal' | 'timed-out'>;
+
+/**
+ * Wake waiters of element of shared memory array.
+ * Returns count of woken waiters.
+ */
+export function notify(array: Int32Array | Uint32Array, index: number, count?: number): number;
+
+type OpsArray = Buffer | Int8Array | Uint8Array | Uint8ClampedArray | Int16Array | Uint16Array
+    | Int32Array | Uint32Array | Float32Array | Float64Array;
+type BigIntOpsArray = BigInt64Array | BigUint64Array;
+
+type CopySource = ArrayBuffer | SharedArrayBuffer | ArrayBufferView;
+
+/**
+ * Copy bytes of src into shared memory array at element dstOffset, returns count of copied bytes.
+ * Large copies use non-temporal stores and several threads.
+ */
+export function copyIn(dstArray: ArrayBufferView | ChunkedArray<ArrayBufferView>, dstOffset: number, src: CopySource): number;
+/**
+ * Copy bytes of shared memory array from element srcOffset to dst (whole dst is filled).
+ */
+export function copyOut(srcArray: ArrayBufferView | ChunkedArray<ArrayBufferView>, srcOffset: number, dst: CopySource): number;
+export function copyInAsync(dstArray: ArrayBufferView | ChunkedArray<ArrayBufferView>, dstOffset: number, src: CopySource): Promise<number>;
+export function copyOutAsync(srcArray: ArrayBufferView | ChunkedArray<ArrayBufferView>, srcOffset: number, dst: CopySource): Promise<number>;
+
+type OpsConfig = {
+    isa: 'generic' | 'sse2' | 'avx2' | 'avx512';
+    supportedIsa: Array<'generic' | 'sse2' | 'avx2' | 'avx512'>;
+    threads: number;
+}
+
+/**
+ * Bulk operations over shared memory arrays with SIMD kernels chosen at runtime.
+ * Large ranges are split between threads of native pool.
+ * NaN elements are ignored by min, max and argmax.
+ * For BigInt64Array/BigUint64Array results are bigint (min/max of empty range are +-Infinity),
+ *  sum, dot and scale wrap modulo 2^64. Float16Array is not supported.
+ */
+export namespace ops {
+    function sum(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): bigint;
+    function min(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): bigint | number;
+    function max(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): bigint | number;
+    function argmax(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): number;
+    function dot<T extends BigIntOpsArray | ChunkedArray<BigIntOpsArray>>(array: T, array2: T, start?: number, end?: number): bigint;
+    function scale<T extends BigIntOpsArray | ChunkedArray<BigIntOpsArray>>(array: T, factor: bigint, start?: number, end?: number): T;
+    function fill<T extends BigIntOpsArray | ChunkedArray<BigIntOpsArray>>(array: T, value: bigint, start?: number, end?: number): T;
+    function sumAsync(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): Promise<bigint>;
+    function minAsync(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): Promise<bigint | number>;
+    function maxAsync(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): Promise<bigint | number>;
+    function argmaxAsync(array: BigIntOpsArray | ChunkedArray<BigIntOpsArray>, start?: number, end?: number): Promise<number>;
+    function dotAsync<T extends BigIntOpsArray | ChunkedArray<BigIntOpsArray>>(array: T, array2: T, start?: number, end?: number): Promise<bigint>;
+    function scaleAsync<T extends BigIntOpsArray | ChunkedArray<BigIntOpsArray>>(array: T, factor: bigint, start?: number, end?: number): Promise<T>;
+    function fillAsync<T extends BigIntOpsArray | ChunkedArray<BigIntOpsArray>>(array: T, value: bigint, start?: number, end?: number): Promise<T>;
+    function sum(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): number;
+    function min(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): number;
+    function max(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): number;
+    function argmax(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): number;
+    function dot<T extends OpsArray | ChunkedArray<OpsArray>>(array: T, array2: T, start?: number, end?: number): number;
+    function scale<T extends OpsArray | ChunkedArray<OpsArray>>(array: T, factor: number, start?: number, end?: number): T;
+    function fill<T extends OpsArray | ChunkedArray<OpsArray>>(array: T, value: number, start?: number, end?: number): T;
+    function sumAsync(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): Promise<number>;
+    function minAsync(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): Promise<number>;
+    function maxAsync(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): Promise<number>;
+    function argmaxAsync(array: OpsArray | ChunkedArray<OpsArray>, start?: number, end?: number): Promise<number>;
+    function dotAsync<T extends OpsArray | ChunkedArray<OpsArray>>(array: T, array2: T, start?: number, end?: number): Promise<number>;
+    function scaleAsync<T extends OpsArray | ChunkedArray<OpsArray>>(array: T, factor: number, start?: number, end?: number): Promise<T>;
+    function fillAsync<T extends OpsArray | ChunkedArray<OpsArray>>(array: T, value: number, start?: number, end?: number): Promise<T>;
+    /**
+     * Configure instruction set and max count of threads for one operation.
+     */
+    function configure(options?: { isa?: 'auto' | 'generic' | 'sse2' | 'avx2' | 'avx512', threads?: number }): OpsConfig;
+}
+
+/**
+ * Shared memory segment/object mapped once and exposed as sequence of views (chunks).
+ */
+export class ChunkedArray<T extends ArrayBufferView> {
+    readonly chunks: T[];
+    /**
+     * Count of elements in chunk (last chunk can be shorter).
+     */
+    readonly chunkLength: number;
+    /**
+     * Total count of elements.
+     */
+    readonly length: number;
+    readonly byteLength: number;
+    /**
+     * Get chunk containing element, index of element in chunk is `index % chunkLength`.
+     */
+    chunkFor(index: number): T;
+    get(index: number): T extends BigInt64Array | BigUint64Array ? bigint : number;
+    set(index: number, value: T extends BigInt64Array | BigUint64Array ? bigint : number): void;
+}
+
+type ShmChunked<T extends ArrayBufferView> = ChunkedArray<T> & { key?: number };
+
+/**
+ * Multi-producer/multi-consumer queue of messages living inside POSIX shared memory object.
+ */
+export class Queue {
+    readonly name: string;
+    readonly buffer: Buffer;
+    readonly slotSize: number;
+    readonly slotCount: number;
+    /**
+     * Approximate count of messages in queue.
+     */
+    readonly length: number;
+    /**
+     * Copy message to queue.
+     * Returns false if queue is full.
+     */
+    push(src: ArrayBufferView): boolean;
+    /**
+     * Copy message from queue.
+     * Returns count of bytes written to dst, or -1 if queue is empty.
+     */
+    pop(dst: ArrayBufferView): number;
+    /**
+     * Copy messages to queue.
+     * Returns count of pushed messages.
+     */
+    pushBatch(srcs: ArrayBufferView[]): number;
+    /**
+     * Copy messages from queue to dst as records: uint32 length, then message bytes.
+     * Returns count of popped messages.
+     */
+    popBatch(dst: ArrayBufferView, maxCount?: number): number;
+    /**
+     * Detach queue, see detach().
+     */
+    detach(forceDestroy?: boolean): number;
+}
+
+/**
+ * Create MPMC queue in POSIX shared memory object.
+ * Returns null if shm already exists.
+ */
+export function createQueue(name: string, slotSize: number, slotCount: number, perm?: string): Queue | null;
+
+/**
+ * Open MPMC queue created by createQueue().
+ * Returns null if shm not exists.
+ */
+export function openQueue(name: string): Queue | null;
+
+/**
+ * Slab allocator of variable-sized blocks living inside POSIX shared memory object.
+ * Blocks are identified by offsets, which are valid in all processes.
+ */
+export class Slab {
+    readonly name: string;
+    readonly buffer: Buffer;
+    readonly slabSize: number;
+    readonly slabCount: number;
+    /**
+     * Max size of block in bytes, equal to slab size.
+     */
+    readonly maxSize: number;
+    /**
+     * Count of slabs bound to size classes.
+     */
+    readonly usedSlabs: number;
+    /**
+     * Allocate block, size is rounded up to power of 2 (min 16 bytes).
+     * Returns offset of block, or null if out of memory.
+     */
+    alloc(size: number): number | null;
+    /**
+     * Free block.
+     */
+    free(offset: number): void;
+    /**
+     * Get view of block, whole block by default.
+     */
+    view<K extends keyof ShmMap = 'Buffer'>(offset: number, typeKey?: K, length?: number): ShmMap[K];
+    /**
+     * Release slabs claimed by processes crashed during allocation (not ones claimed from other PID namespace).
+     * Returns count of recovered slabs.
+     */
+    recover(): number;
+    /**
+     * Detach allocator, see detach().
+     */
+    detach(forceDestroy?: boolean): number;
+}
+
+type SlabOptions = {
+    /**
+     * Size of slab in bytes, power of 2, default is 64KB. It's max size of block.
+     */
+    slabSize?: number;
+}
+
+/**
+ * Create slab allocator in POSIX shared memory object.
+ * Returns null if shm already exists.
+ */
+export function createSlab(name: string, size: number, options?: SlabOptions, perm?: string): Slab | null;
+
+/**
+ * Open slab allocator created by createSlab().
+ * Returns null if shm not exists.
+ */
+export function openSlab(name: string): Slab | null;
+
+/**
+ * Key of hash table: keySize bytes, or number/BigInt if keySize is 8.
+ */
+type HashTableKey = ArrayBufferView | number | bigint;
+
+/**
+ * Fixed-capacity hash table with fixed-width keys and values living inside POSIX shared memory object.
+ */
+export class HashTable {
+    readonly name: string;
+    readonly buffer: Buffer;
+    readonly capacity: number;
+    readonly keySize: number;
+    readonly valueSize: number;
+    /**
+     * Count of keys.
+     */
+    readonly size: number;
+    /**
+     * Copy value of key to dst.
+     * Returns true if found.
+     */
+    get(key: HashTableKey, dst: ArrayBufferView): boolean;
+    /**
+     * Copy value of key to new Buffer.
+     * Returns null if not found.
+     */
+    get(key: HashTableKey): Buffer | null;
+    /**
+     * Get offset of value in buffer to read it without copy (not protected from concurrent writes).
+     * Returns -1 if not found.
+     */
+    offsetOf(key: HashTableKey): number;
+    /**
+     * Insert or update key.
+     * Returns false if hash table is full (all buckets hold live keys).
+     */
+    put(key: HashTableKey, value: ArrayBufferView): boolean;
+    /**
+     * Delete key, its bucket is left as tombstone reused by later put().
+     * Tombstones make probe chains of missing keys longer, keep capacity well above count of live keys.
+     * Returns true if key was deleted.
+     */
+    delete(key: HashTableKey): boolean;
+    /**
+     * Copy values of keys (keySize bytes each) to dst (valueSize bytes each).
+     * Returns count of found keys.
+     */
+    getMany(keys: ArrayBufferView, dst: ArrayBufferView, found?: Uint8Array): number;
+    /**
+     * Detach hash table, see detach().
+     */
+    detach(forceDestroy?: boolean): number;
+}
+
+/**
+ * Create hash table in POSIX shared memory object.
+ * Capacity is rounded up to power of 2.
+ * Returns null if shm already exists.
+ */
+export function createHashTable(name: string, capacity: number, keySize: number, valueSize: number, perm?: string): HashTable | null;
+
+/**
+ * Open hash table created by createHashTable().
+ * Returns null if shm not exists.
+ */
+export function openHashTable(name: string): HashTable | null;
+
+/**
+ * Seqlock-protected region of data living inside POSIX shared memory object.
+ */
+export class Seqlock {
+    readonly name: string;
+    readonly buffer: Buffer;
+    readonly size: number;
+    /**
+     * Count of publishes.
+     */
+    readonly version: number;
+    /**
+     * Copy data to region, writer which died during publish is taken over.
+     * Returns version of published data.
+     */
+    publish(src: ArrayBufferView): number;
+    /**
+     * Copy consistent snapshot of data from region.
+     * Throws if writer died during publish, until next publish.
+     * Returns version of copied data.
+     */
+    read(dst: ArrayBufferView): number;
+    /**
+     * Detach seqlock region, see detach().
+     */
+    detach(forceDestroy?: boolean): number;
+}
+
+/**
+ * Create seqlock region in POSIX shared memory object.
+ * Returns null if shm already exists.
+ */
+export function createSeqlock(name: string, size: number, perm?: string): Seqlock | null;
+
+/**
+ * Open seqlock region created by createSeqlock().
+ * Returns null if shm not exists.
+ */
+export function openSeqlock(name: string): Seqlock | null;
+
+/**
+ * Robust mutex living inside POSIX shared memory object.
+ * Lock is owned by process, lock of dead owner is taken over with result 'owner-died'.
+ */
+export class Mutex {
+    readonly name: string;
+    readonly buffer: Buffer;
+    /**
+     * Pid of process holding lock, or 0.
+     */
+    readonly owner: number;
+    /**
+     * Acquire lock, only busy lock is waited in threadpool.
+     */
+    lock(timeoutMs?: number): Promise<'ok' | 'owner-died' | 'timed-out'>;
+    /**
+     * Acquire lock without waiting.
+     */
+    tryLock(): 'ok' | 'owner-died' | 'busy';
+    /**
+     * Release lock, throws if lock is not held by this process.
+     */
+    unlock(): void;
+    /**
+     * Detach mutex, see detach().
+     */
+    detach(forceDestroy?: boolean): number;
+}
+
+/**
+ * Create mutex in POSIX shared memory object.
+ * Returns null if shm already exists.
+ */
+export function createMutex(name: string, perm?: string): Mutex | null;
+
+/**
+ * Open mutex created by createMutex().
+ * Returns null if shm not exists.
+ */
+export function openMutex(name: string): Mutex | null;
+
+/**
+ * Robust reader-writer lock living inside POSIX shared memory object, prefers writers.
+ */
+export class RwLock {
+    readonly name: string;
+    readonly buffer: Buffer;
+    readonly maxReaders: number;
+    /**
+     * Pid of process holding write lock, or 0.
+     */
+    readonly owner: number;
+    /**
+     * Count of processes holding read lock.
+     */
+    readonly readers: number;
+    readLock(timeoutMs?: number): Promise<'ok' | 'owner-died' | 'timed-out'>;
+    tryReadLock(): 'ok' | 'owner-died' | 'busy';
+    readUnlock(): void;
+    writeLock(timeoutMs?: number): Promise<'ok' | 'owner-died' | 'timed-out'>;
+    tryWriteLock(): 'ok' | 'owner-died' | 'busy';
+    writeUnlock(): void;
+    /**
+     * Detach reader-writer lock, see detach().
+     */
+    detach(forceDestroy?: boolean): number;
+}
+
+/**
+ * Create reader-writer lock in POSIX shared memory object.
+ * Returns null if shm already exists.
+ */
+export function createRwLock(name: string, maxReaders?: number, perm?: string): RwLock | null;
+
+/**
+ * Open reader-writer lock created by createRwLock().
+ * Returns null if shm not exists.
+ */
+export function openRwLock(name: string): RwLock | null;
+
 /**
  * Get total size of all *used* shared memory in bytes.
  */
@@ -1,4 +1,6 @@
 'use strict';
+const os = require('os');
+const path = require('path');
 const buildDir = process.env.DEBUG_SHM == 1 ? 'Debug' : 'Release';
 const shm = require('./build/' + buildDir + '/shm.node');
 
@@ -10,6 +12,24 @@ const lengthMin = 1;
  * Max length of shared memory segment (count of elements, not bytes)
  */
 const lengthMax = shm.NODE_BUFFER_MAX_LENGTH;
+/**
+ * Default max length of chunk of ChunkedArray (count of elements) - max power of 2 <= lengthMax
+ */
+const chunkLengthDefault = Math.pow(2, Math.floor(Math.log2(lengthMax)));
+/**
+ * Chunks of memory prefaulted in parallel are aligned to 2MB (huge page)
+ */
+const prefaultChunkAlign = 2 * 1024 * 1024;
+// Default count of elements in window of windows()
+const windowLengthDefault = 16 * 1024 * 1024;
+// Default size of slab of slab allocator
+const slabSizeDefault = 64 * 1024;
+// Kinds of locks for shm.lock() and shm.unlock()
+const LockKind = {
+	mutex: 0,
+	read: 1,
+	write: 2,
+};
 
 const cleanup = function () {
 	try {
@@ -47,6 +67,111 @@ const BufferTypeSizeof = {
 	'Float32Array': 4, 
 	'Float64Array': 8,
 };
+if (shm.SHMBT_BIGINT64 !== undefined) {
+	BufferType['BigInt64Array'] = shm.SHMBT_BIGINT64;
+	BufferType['BigUint64Array'] = shm.SHMBT_BIGUINT64;
+	BufferTypeSizeof['BigInt64Array'] = 8;
+	BufferTypeSizeof['BigUint64Array'] = 8;
+}
+// Float16Array can be disabled in runtime (eg. needs --js-float16array flag in Node.js 22)
+if (shm.SHMBT_FLOAT16 !== undefined && typeof Float16Array === 'function') {
+	BufferType['Float16Array'] = shm.SHMBT_FLOAT16;
+	BufferTypeSizeof['Float16Array'] = 2;
+}
+
+/**
+ * Huge pages options for creation
+ */
+const HugePages = {
+	'2MB': shm.SHMHP_2MB,
+	'1GB': shm.SHMHP_1GB,
+	'auto': shm.SHMHP_AUTO,
+};
+
+function _getHugePages(options) {
+	if (!options || !options.hugePages)
+		return shm.SHMHP_NONE;
+	if (HugePages[options.hugePages] === undefined)
+		throw new Error("Unknown huge pages option " + options.hugePages);
+	return HugePages[options.hugePages];
+}
+
+/**
+ * NUMA policies for creation
+ */
+const NumaPolicy = {
+	'interleave': shm.SHMNUMA_INTERLEAVE,
+	'bind': shm.SHMNUMA_BIND,
+	'preferred': shm.SHMNUMA_PREFERRED,
+};
+
+/**
+ * Seals of anonymous shared memory, see seal()
+ */
+const Seals = {
+	'seal': shm.F_SEAL_SEAL,
+	'shrink': shm.F_SEAL_SHRINK,
+	'grow': shm.F_SEAL_GROW,
+	'write': shm.F_SEAL_WRITE,
+};
+
+// Returns [policy, nodes] for native get()/getPosix()
+function _getNuma(options) {
+	const numa = options && options.numa;
+	if (!numa)
+		return [shm.SHMNUMA_DEFAULT, null];
+	const online = shm.numaNodes();
+	if (numa === 'interleave')
+		return [shm.SHMNUMA_INTERLEAVE, online];
+	const keys = typeof numa === 'object' ? Object.keys(numa) : [];
+	if (keys.length !== 1 || NumaPolicy[keys[0]] === undefined)
+		throw new Error("Unknown NUMA option " + JSON.stringify(numa));
+	const policy = keys[0];
+	let nodes = numa[policy];
+	if (nodes === undefined || nodes === null)
+		nodes = policy === 'interleave' ? online : [];
+	if (!Array.isArray(nodes))
+		nodes = [nodes];
+	if (policy === 'bind' && !nodes.length)
+		throw new RangeError("NUMA bind needs at least one node");
+	if (policy === 'preferred' && nodes.length > 1)
+		throw new RangeError("NUMA preferred needs single node");
+	for (const node of nodes) {
+		if (online.indexOf(node) === -1)
+			throw new RangeError("NUMA node " + node + " is not online");
+	}
+	return [NumaPolicy[policy], nodes];
+}
+
+function _getChunkLength(options) {
+	if (!options || !options.chunked)
+		return 0;
+	const chunkLength = options.chunkLength === undefined ? chunkLengthDefault : options.chunkLength;
+	if (!(Number.isSafeInteger(chunkLength) && chunkLength >= lengthMin && chunkLength <= lengthMax))
+		throw new RangeError('Chunk length should be ' + lengthMin + ' .. ' + lengthMax);
+	return chunkLength;
+}
+
+function _getAutoDetach(options) {
+	return !!(options && options.autoDetach);
+}
+
+function _getPrefaultFlags(options) {
+	if (!options)
+		return 0;
+	return (options.populate ? shm.SHMPF_POPULATE : 0)
+		| (options.lock ? shm.SHMPF_LOCK : 0)
+		| (options.willNeed ? shm.SHMPF_WILLNEED : 0);
+}
+
+// Returns Promise if prefault is requested in options
+function _withPrefault(res, options) {
+	if (_getPrefaultFlags(options) === 0)
+		return res;
+	if (!res)
+		return Promise.resolve(res);
+	return prefault(res, options);
+}
 
 /**
  * Create System V or POSIX shared memory
@@ -55,47 +180,40 @@ const BufferTypeSizeof = {
  * @param {int/string/null} key - integer key for System V shared memory segment, or null to autogenerate,
  *  or string name for POSIX shared memory object, should start with '/'.
  * @param {string} permStr - permissions, default is 660
+ * @param {object} options - optional:
+ *  hugePages - '2MB', '1GB' or 'auto' to use huge pages, size is rounded up to huge page size.
+ *   'auto' tries huge pages of default size and falls back to transparent huge pages
+ *  populate, lock, willNeed - see prefault()
+ *  chunked - true to return ChunkedArray, allows count > LengthMax
+ *  chunkLength - max count of elements in chunk of ChunkedArray, default is max power of 2 <= LengthMax
+ *  autoDetach - true to detach memory when returned object (all chunks) is collected by GC.
+ *   Without it only Buffer is detached by GC, typed arrays stay attached until detach()
+ *  numa - NUMA placement, applied before memory is touched (so before populate):
+ *   'interleave' or { interleave: [nodes] } - spread pages over all online nodes or given ones,
+ *   { bind: [nodes] } - allocate only on given nodes,
+ *   { preferred: node } - allocate on node if possible, { preferred: null } for local node.
+ *   Ignored if kernel does not support NUMA
  * @return {mixed/null} shared memory buffer/array object, or null if already exists with provided key
- *  Class depends on param typeKey: Buffer or descendant of TypedArray.
+ *  Class depends on param typeKey: Buffer or descendant of TypedArray (or ChunkedArray of them).
  *  For System V: returned object has property 'key' - integer key of created shared memory segment
+ *  If populate, lock or willNeed is set, returns Promise resolved when memory is resident
  */
-function create(count, typeKey /*= 'Buffer'*/, key /*= null*/, permStr /*= '660'*/) {
+function create(count, typeKey /*= 'Buffer'*/, key /*= null*/, permStr /*= '660'*/, options /*= {}*/) {
 	if (typeof key === 'string') {
-		return createPosix(key, count, typeKey, permStr);
+		return createPosix(key, count, typeKey, permStr, options);
 	}
 
-	if (typeKey === undefined)
-		typeKey = 'Buffer';
-	if (key === undefined)
-		key = null;
-	if (BufferType[typeKey] === undefined)
-		throw new Error("Unknown type key " + typeKey);
-	if (key !== null) {
-		if (!(Number.isSafeInteger(key) && key >= keyMin && key <= keyMax))
-			throw new RangeError('Shm key should be ' + keyMin + ' .. ' + keyMax);
-	}
-	if (permStr === undefined || isNaN( Number.parseInt(permStr, 8)))
-		permStr = '660';
-	const perm = Number.parseInt(permStr, 8);
-
-	var type = BufferType[typeKey];
-	//var size1 = BufferTypeSizeof[typeKey];
-	//var size = size1 * count;
-	if (!(Number.isSafeInteger(count) && count >= lengthMin && count <= lengthMax))
-		throw new RangeError('Count should be ' + lengthMin + ' .. ' + lengthMax);
+	const args = _createArgs(count, typeKey, key, permStr, options);
 	let res;
-	if (key) {
-		res = shm.get(key, count, shm.IPC_CREAT|shm.IPC_EXCL|perm, 0, type);
+	if (args[0]) {
+		res = shm.get.apply(shm, args);
 	} else {
 		do {
-			key = _keyGen();
-			res = shm.get(key, count, shm.IPC_CREAT|shm.IPC_EXCL|perm, 0, type);
+			args[0] = _keyGen();
+			res = shm.get.apply(shm, args);
 		} while(!res);
 	}
-	if (res) {
-		res.key = key;
-	}
-	return res;
+	return _withPrefault(_withKey(_wrapChunks(res, args[6]), args[0]), options);
 }
 
 /**
@@ -105,70 +223,43 @@ function create(count, typeKey /*= 'Buffer'*/, key /*= null*/, permStr /*= '660'
  * @param {int} count - number of elements
  * @param {string} typeKey - see keys of BufferType
  * @param {string} permStr - permissions, default is 660
+ * @param {object} options - optional, see create().
+ *  With hugePages object is created in hugetlbfs mount instead of /dev/shm
  * @return {mixed/null} shared memory buffer/array object, or null if already exists with provided name
  *  Class depends on param typeKey: Buffer or descendant of TypedArray
  */
-function createPosix(name, count, typeKey /*= 'Buffer'*/, permStr /*= '660'*/) {
-	if (typeKey === undefined)
-		typeKey = 'Buffer';
-	if (BufferType[typeKey] === undefined)
-		throw new Error("Unknown type key " + typeKey);
-	if (permStr === undefined || isNaN( Number.parseInt(permStr, 8)))
-		permStr = '660';
-	const perm = Number.parseInt(permStr, 8);
-
-	const type = BufferType[typeKey];
-	//var size1 = BufferTypeSizeof[typeKey];
-	//var size = size1 * count;
-	if (!(Number.isSafeInteger(count) && count >= lengthMin && count <= lengthMax))
-		throw new RangeError('Count should be ' + lengthMin + ' .. ' + lengthMax);
-	const oflag = shm.O_CREAT | shm.O_RDWR | shm.O_EXCL;
-	const mmap_flags = shm.MAP_SHARED;
-	const res = shm.getPosix(name, count, oflag, perm, mmap_flags, type);
-
-	return res;
+function createPosix(name, count, typeKey /*= 'Buffer'*/, permStr /*= '660'*/, options /*= {}*/) {
+	const args = _createPosixArgs(name, count, typeKey, permStr, options);
+	return _withPrefault(_wrapChunks(shm.getPosix.apply(shm, args), args[7]), options);
 }
 
 /**
  * Get System V/POSIX shared memory
  * @param {int/string} key - integer key of System V shared memory segment, or string name of POSIX shared memory object
- * @param {string} typeKey - see keys of BufferType
+ * @param {string} typeKey - see keys of BufferType. For POSIX default is type used on creation, for System V - 'Buffer'
+ * @param {object} options - optional: populate, lock, willNeed, chunked, chunkLength, autoDetach - see create()
  * @return {mixed/null} shared memory buffer/array object, see create(), or null if not exists
+ *  If populate, lock or willNeed is set, returns Promise resolved when memory is resident
  */
-function get(key, typeKey /*= 'Buffer'*/) {
+function get(key, typeKey /*= stored type or 'Buffer'*/, options /*= {}*/) {
 	if (typeof key === 'string') {
-		return getPosix(key, typeKey);
-	}
-	if (typeKey === undefined)
-		typeKey = 'Buffer';
-	if (BufferType[typeKey] === undefined)
-		throw new Error("Unknown type key " + typeKey);
-	var type = BufferType[typeKey];
-	if (!(Number.isSafeInteger(key) && key >= keyMin && key <= keyMax))
-		throw new RangeError('Shm key should be ' + keyMin + ' .. ' + keyMax);
-	let res = shm.get(key, 0, 0, 0, type);
-	if (res) {
-		res.key = key;
+		return getPosix(key, typeKey, options);
 	}
-	return res;
+	const args = _getArgs(key, typeKey, options);
+	return _withPrefault(_withKey(_wrapChunks(shm.get.apply(shm, args), args[6]), key), options);
 }
 
 /**
  * Get POSIX shared memory object
  * @param {string} name - string name of shared memory object
- * @param {string} typeKey - see keys of BufferType
+ * @param {string} typeKey - see keys of BufferType, default is type used on creation ('Buffer' for objects created by older versions).
+ *  Typed array of other element type than used on creation is not allowed, Buffer is allowed for any object
+ * @param {object} options - optional, see get()
  * @return {mixed/null} shared memory buffer/array object, see createPosix(), or null if not exists
  */
-function getPosix(name, typeKey /*= 'Buffer'*/) {
-	if (typeKey === undefined)
-		typeKey = 'Buffer';
-	if (BufferType[typeKey] === undefined)
-		throw new Error("Unknown type key " + typeKey);
-	var type = BufferType[typeKey];
-	const oflag = shm.O_RDWR;
-	const mmap_flags = shm.MAP_SHARED;
-	let res = shm.getPosix(name, 0, oflag, 0, mmap_flags, type);
-	return res;
+function getPosix(name, typeKey /*= stored type*/, options /*= {}*/) {
+	const args = _getPosixArgs(name, typeKey, options);
+	return _withPrefault(_wrapChunks(shm.getPosix.apply(shm, args), args[7]), options);
 }
 
 /**
@@ -177,7 +268,8 @@ function getPosix(name, typeKey /*= 'Buffer'*/) {
  * For POSIX: It will be destroyed only if `forceDestroy` is true
  * @param {int/string} key - integer key of System V shared memory segment, or string name of POSIX shared memory object
  * @param {bool} forceDestroy - true to destroy even there are other attaches
- * @return {int} 0 on destroy, or count of left attaches, or -1 if not exists
+ * @return {int} 0 on destroy, or count of left attaches (of this process and other processes) for System V,
+ *  1 for POSIX, or -1 if not exists
  */
 function detach(key, forceDestroy /*= false*/) {
 	if (typeof key === 'string') {
@@ -200,6 +292,428 @@ function detachPosix(name, forceDestroy /*= false*/) {
 	return shm.detachPosix(name, forceDestroy);
 }
 
+/**
+ * Resize POSIX shared memory object attached by this process (last attach)
+ * Other processes can remap it with refresh(). Resizes should be serialized (eg. with Mutex)
+ * Mapping can be moved, so previous views of this attach should not be used after resize
+ * @param {string} name - string name of shared memory object
+ * @param {int} count - new number of elements
+ * @param {string} typeKey - see keys of BufferType, default is type used on creation
+ * @param {object} options - optional: chunked, chunkLength, autoDetach - see create()
+ * @return {mixed} new shared memory buffer/array object
+ */
+function resize(name, count, typeKey /*= stored type*/, options /*= {}*/) {
+	const type = _getPosixType(typeKey);
+	const chunkLength = _getChunkLength(options);
+	_checkCount(count, typeKey === undefined ? 'Buffer' : typeKey, chunkLength);
+	return _wrapChunks(shm.resizePosix(name, count, type, chunkLength, _getAutoDetach(options)), chunkLength);
+}
+
+/**
+ * Remap POSIX shared memory object attached by this process (last attach) if it was resized by other process
+ * Cheap if object was not resized: reads header of object
+ * @param {string} name - string name of shared memory object
+ * @param {string} typeKey - see keys of BufferType, default is type used on creation
+ * @param {object} options - optional: chunked, chunkLength, autoDetach - see create()
+ * @return {mixed/null} new shared memory buffer/array object, or null if not resized since last map
+ */
+function refresh(name, typeKey /*= stored type*/, options /*= {}*/) {
+	const type = _getPosixType(typeKey);
+	const chunkLength = _getChunkLength(options);
+	return _wrapChunks(shm.refreshPosix(name, type, chunkLength, _getAutoDetach(options)), chunkLength);
+}
+
+/**
+ * Get info from header of POSIX shared memory object attached by this process
+ * @param {string} name - string name of shared memory object
+ * @return {object} { typeKey, count, size, layoutVersion, createdAt, dataOffset }
+ *  typeKey - type used on creation, see keys of BufferType
+ *  size - size of data in bytes
+ *  layoutVersion - 0 for objects created by older versions (without type and creation time)
+ *  createdAt - Date of creation, or null
+ *  dataOffset - offset of data from start of object (64, or 8 for older versions)
+ */
+function objectInfo(name) {
+	const info = shm.objectInfo(name);
+	return {
+		typeKey: Object.keys(BufferType).find((key) => BufferType[key] === info.type) || null,
+		count: info.count,
+		size: info.size,
+		layoutVersion: info.layoutVersion,
+		createdAt: info.createdAt === null ? null : new Date(info.createdAt),
+		dataOffset: info.dataOffset,
+	};
+}
+
+/**
+ * Map part of POSIX shared memory object (or file created by createFile()) without mapping whole object,
+ *  eg. to read object larger than address space or RAM. Offset of mapping is aligned down to page,
+ *  returned view starts at requested element.
+ * Window is not attach (see detach(), stats()): it's unmapped when view is collected by GC
+ *  (typed arrays only since Node.js 17), or by unmapWindow()
+ * @param {string} name - string name of shared memory object, or path of file if options.file is set
+ * @param {int} offset - index of first element, should be less than count of elements of object
+ * @param {int} length - count of elements, clamped to end of object
+ * @param {string} typeKey - see keys of BufferType, default is type used on creation
+ * @param {object} options - optional:
+ *  file - name is path of file
+ *  populate - fault in pages of window on mapping with MAP_POPULATE (Linux only)
+ *  willNeed - madvise(MADV_WILLNEED), kernel starts to read in window in background
+ * @return {mixed/null} buffer/array of window with property objectLength (count of elements of object),
+ *  or null if not exists
+ */
+function mapWindow(name, offset, length, typeKey /*= stored type*/, options /*= {}*/) {
+	options = options || {};
+	const type = _getPosixType(typeKey);
+	if (!(Number.isSafeInteger(offset) && offset >= 0))
+		throw new RangeError('offset should be non-negative integer');
+	if (!(Number.isSafeInteger(length) && length >= lengthMin))
+		throw new RangeError('length should be positive integer');
+	const mmap_flags = shm.MAP_SHARED | (options.populate && shm.MAP_POPULATE ? shm.MAP_POPULATE : 0);
+	return shm.mapWindow(options.file ? path.resolve(name) : name, !!options.file, offset, length, type,
+		mmap_flags, !!options.willNeed);
+}
+
+/**
+ * Unmap window returned by mapWindow() without waiting for GC
+ * View (and its subarrays) should not be used after unmap
+ * @param {Buffer/TypedArray} array - view returned by mapWindow()
+ * @return {bool} false if array is not mapped window
+ */
+function unmapWindow(array) {
+	return shm.unmapWindow(array);
+}
+
+/**
+ * Drop pages of window from memory of this process with madvise(MADV_DONTNEED)
+ * Unlike unmapWindow(), view stays valid: data stays in object and is read again on access
+ * @param {Buffer/TypedArray} array - view returned by mapWindow()
+ * @return {bool} false if array is not mapped window
+ */
+function discardWindow(array) {
+	return shm.discardWindow(array);
+}
+
+/**
+ * Iterate over POSIX shared memory object (or file) by windows, see mapWindow()
+ * Next window is mapped (with willNeed) before current one is yielded, so kernel reads it ahead of reader,
+ *  windows behind reader are discarded with discardWindow(), so resident memory stays bounded
+ *  by about 2 windows while scanning. They are unmapped by GC
+ * @param {string} name - string name of shared memory object, or path of file if options.file is set
+ * @param {object} options - optional:
+ *  windowLength - count of elements in window, default is 16M
+ *  offset - index of first element, default is 0
+ *  length - count of elements to iterate, default is up to end of object
+ *  typeKey, file, populate - see mapWindow()
+ * @return {Generator<object>} yields { offset, array }, offset is index of first element of array in object.
+ *  Nothing is yielded if object not exists
+ */
+function* windows(name, options /*= {}*/) {
+	options = options || {};
+	const windowLength = options.windowLength === undefined ? windowLengthDefault : options.windowLength;
+	let offset = options.offset || 0;
+	const limit = options.length === undefined ? Infinity : options.length;
+	if (limit <= 0)
+		return;
+	const mapOptions = { file: options.file, populate: options.populate, willNeed: true };
+	let array = mapWindow(name, offset, Math.min(windowLength, limit), options.typeKey, mapOptions);
+	if (array === null)
+		return;
+	const end = Math.min(array.objectLength, offset + limit);
+	let next = null;
+	try {
+		for (;;) {
+			const nextOffset = offset + array.length;
+			next = nextOffset < end
+				? mapWindow(name, nextOffset, Math.min(windowLength, end - nextOffset), options.typeKey, mapOptions)
+				: null;
+			yield { offset, array };
+			discardWindow(array);
+			if (next === null)
+				break;
+			offset = nextOffset;
+			array = next;
+			next = null;
+		}
+	} finally {
+		// Reader stopped early: yielded window can still be used, next one was never seen
+		if (next !== null)
+			unmapWindow(next);
+	}
+}
+
+/**
+ * Create anonymous shared memory with memfd_create() (Linux only)
+ * It has no name in /dev/shm and no key, so it can't leak: kernel frees it when last fd
+ *  and mapping are closed, also when processes crash.
+ * To share it pass fd to other process with sendFd() over Unix domain socket
+ * @param {int} count - number of elements
+ * @param {string} typeKey - see keys of BufferType
+ * @param {object} options - optional, see create()
+ * @return {mixed} shared memory buffer/array object (or ChunkedArray of them) with property 'fd'
+ *  If populate, lock or willNeed is set, returns Promise resolved when memory is resident
+ */
+function createAnonymous(count, typeKey /*= 'Buffer'*/, options /*= {}*/) {
+	if (typeKey === undefined)
+		typeKey = 'Buffer';
+	if (BufferType[typeKey] === undefined)
+		throw new Error("Unknown type key " + typeKey);
+	const hugePages = _getHugePages(options);
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	const numa = _getNuma(options);
+	_checkCount(count, typeKey, chunkLength);
+	const res = shm.getMemfd(-1, count, BufferType[typeKey], hugePages, chunkLength, autoDetach, numa[0], numa[1]);
+	return _withPrefault(_wrapAnonymous(res, chunkLength), options);
+}
+
+/**
+ * Map anonymous shared memory received from other process with recvFd()
+ * If memory is sealed against writes (see seal()), it's mapped copy-on-write:
+ *  returned object is writable, but changes are seen only by this process
+ * @param {int} fd - fd of memfd, owned by attach after success: it's closed by detachAnonymous()
+ * @param {string} typeKey - see keys of BufferType, default is type used on creation
+ * @param {object} options - optional, see get()
+ * @return {mixed} shared memory buffer/array object with property 'fd', see createAnonymous()
+ */
+function getAnonymous(fd, typeKey /*= stored type*/, options /*= {}*/) {
+	const type = _getPosixType(typeKey);
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	const res = shm.getMemfd(fd, 0, type, shm.SHMHP_NONE, chunkLength, autoDetach, shm.SHMNUMA_DEFAULT, null);
+	return _withPrefault(_wrapAnonymous(res, chunkLength), options);
+}
+
+/**
+ * Detach anonymous shared memory and close its fd
+ * Memory is freed when other processes close their fds and mappings too
+ * @param {int/object} fd - fd, or object returned by createAnonymous()/getAnonymous()
+ * @return {int} 0 on detach, -1 if not attached
+ */
+function detachAnonymous(fd) {
+	return shm.detachMemfd(_getFd(fd));
+}
+
+/**
+ * Seal anonymous shared memory, so receivers can rely on its contents and size.
+ * Seals can't be removed. Views of this process stay valid, but after 'write' seal
+ *  they are copy-on-write: further changes are not seen by other processes.
+ * @param {int/object} fd - fd, or object returned by createAnonymous()/getAnonymous()
+ * @param {Array<string>} seals - keys of Seals: 'write' - contents can't be changed,
+ *  'grow'/'shrink' - size can't be changed, 'seal' - no more seals can be added.
+ *  Default is all of them
+ * @return {Array<string>} all seals of memory
+ */
+function seal(fd, seals /*= ['seal', 'shrink', 'grow', 'write']*/) {
+	if (seals === undefined)
+		seals = Object.keys(Seals);
+	let flags = 0;
+	for (const name of seals) {
+		if (Seals[name] === undefined)
+			throw new Error("Unknown seal " + name);
+		flags |= Seals[name];
+	}
+	return _sealNames(shm.sealMemfd(_getFd(fd), flags));
+}
+
+/**
+ * Get seals of anonymous shared memory, see seal()
+ * @param {int/object} fd - fd, or object returned by createAnonymous()/getAnonymous()
+ * @return {Array<string>} keys of Seals, empty if fd doesn't support sealing
+ */
+function getSeals(fd) {
+	return _sealNames(shm.memfdSeals(_getFd(fd)));
+}
+
+/**
+ * Send fd to other process over Unix domain socket (SCM_RIGHTS)
+ * Receiver gets own fd of same file, fd stays open in this process
+ * Doesn't block event loop: throws error with message of EAGAIN if send buffer of socket is full,
+ *  and throws if net.Socket has pending writes, because fd would be sent before them
+ * @param {int/net.Socket} socket - fd of Unix domain socket, or net.Socket of it
+ *  (eg. extra 'pipe' of child_process.spawn() stdio or connection to net.Server on path)
+ * @param {int/object} fd - fd to send, or object returned by createAnonymous()/getAnonymous()
+ */
+function sendFd(socket, fd) {
+	if (socket !== null && typeof socket === 'object' && socket.writableLength > 0)
+		throw new Error('Socket has pending writes');
+	shm.sendFd(_socketFd(socket), _getFd(fd));
+}
+
+/**
+ * Receive fd sent by sendFd(), waits in libuv threadpool
+ * Socket should not be read by other code at the same time, eg. paused net.Socket or
+ *  fd of stdio 'pipe' in child process (3 for first extra one)
+ * @param {int/net.Socket} socket - fd of Unix domain socket, or net.Socket of it
+ * @param {number} timeoutMs - default is Infinity
+ * @return {Promise<int>} received fd, eg. to pass to getAnonymous()
+ */
+function recvFd(socket, timeoutMs /*= Infinity*/) {
+	return new Promise(function (resolve) {
+		if (timeoutMs === undefined || timeoutMs === Infinity)
+			timeoutMs = -1;
+		else if (!(Number.isSafeInteger(timeoutMs) && timeoutMs >= 0 && timeoutMs <= 0x7fffffff))
+			throw new RangeError('Timeout should be 0 .. ' + 0x7fffffff + ' or Infinity');
+		resolve(_callAsync(shm.recvFd, [_socketFd(socket), timeoutMs]));
+	});
+}
+
+/**
+ * Create shared memory backed by regular file, eg. on disk or on DAX filesystem of persistent memory.
+ * Contents survive restart of process and host, so new process can open it with openFile() (warm restart).
+ * File has same header as POSIX object. Changes are written to file by kernel in background,
+ *  use flush() or markDirty() + checkpoint() to know when they are on disk.
+ * Disk space is allocated on creation, so lack of space throws here instead of crashing on write.
+ * @param {string} filePath - path of file, directory should exist
+ * @param {int} count - number of elements
+ * @param {string} typeKey - see keys of BufferType
+ * @param {string} permStr - permissions, default is 660
+ * @param {object} options - optional: populate, lock, willNeed, chunked, chunkLength, autoDetach, numa - see create()
+ * @return {mixed/null} shared memory buffer/array object, or null if file already exists
+ *  If populate, lock or willNeed is set, returns Promise resolved when memory is resident
+ */
+function createFile(filePath, count, typeKey /*= 'Buffer'*/, permStr /*= '660'*/, options /*= {}*/) {
+	if (typeKey === undefined)
+		typeKey = 'Buffer';
+	if (BufferType[typeKey] === undefined)
+		throw new Error("Unknown type key " + typeKey);
+	if (permStr === undefined || isNaN( Number.parseInt(permStr, 8)))
+		permStr = '660';
+	if (options && options.hugePages)
+		throw new Error('Huge pages are not supported for files');
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	const numa = _getNuma(options);
+	_checkCount(count, typeKey, chunkLength);
+	const oflag = shm.O_CREAT | shm.O_RDWR | shm.O_EXCL;
+	const res = shm.getFile(path.resolve(filePath), count, oflag, Number.parseInt(permStr, 8), BufferType[typeKey],
+		chunkLength, autoDetach, numa[0], numa[1]);
+	return _withPrefault(_wrapChunks(res, chunkLength), options);
+}
+
+/**
+ * Open file created by createFile(), eg. after restart
+ * @param {string} filePath - path of file
+ * @param {string} typeKey - see keys of BufferType, default is type used on creation
+ * @param {object} options - optional, see get()
+ * @return {mixed/null} shared memory buffer/array object, or null if file not exists
+ */
+function openFile(filePath, typeKey /*= stored type*/, options /*= {}*/) {
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	const res = shm.getFile(path.resolve(filePath), 0, shm.O_RDWR, 0, _getPosixType(typeKey),
+		chunkLength, autoDetach, shm.SHMNUMA_DEFAULT, null);
+	return _withPrefault(_wrapChunks(res, chunkLength), options);
+}
+
+/**
+ * Unmap file opened by createFile()/openFile(), changes are still written to file by kernel
+ * @param {string} filePath - path of file
+ * @param {bool} remove - true to remove file
+ * @return {int} 0 on remove, 1 on detach, -1 if not exists
+ */
+function closeFile(filePath, remove /*= false*/) {
+	return shm.detachFile(path.resolve(filePath), !!remove);
+}
+
+/**
+ * Write range of file-backed array to disk with msync() in libuv threadpool
+ * @param {Buffer/TypedArray/ChunkedArray} array - object returned by createFile()/openFile()
+ * @param {int} start - index of first element, default is 0
+ * @param {int} end - index after last element, default is array.length
+ * @return {Promise<int>} count of written bytes (range is rounded to pages by kernel)
+ */
+function flush(array, start /*= 0*/, end /*= array.length*/) {
+	return new Promise(function (resolve) {
+		const calls = _fileRangeParts(array, start, end).map((args) => _callAsync(shm.flush, args));
+		resolve(Promise.all(calls).then((results) => results.reduce((a, b) => a + b, 0)));
+	});
+}
+
+/**
+ * Mark range of file-backed array as changed, so it's written by next checkpoint().
+ * Marks are kept in 1MB blocks, so it's cheap to call after every write
+ * @param {Buffer/TypedArray/ChunkedArray} array - object returned by createFile()/openFile(), or subarray of it
+ * @param {int} start - index of first element, default is 0
+ * @param {int} end - index after last element, default is array.length
+ */
+function markDirty(array, start /*= 0*/, end /*= array.length*/) {
+	for (const args of _fileRangeParts(array, start, end))
+		shm.fileMarkDirty.apply(shm, args);
+}
+
+/**
+ * Write ranges of file marked by markDirty() since last checkpoint to disk, in libuv threadpool.
+ * Marks are cleared, on error they are restored, so next checkpoint writes them again
+ * @param {string} filePath - path of file opened by this process
+ * @return {Promise<int>} count of written bytes
+ */
+function checkpoint(filePath) {
+	return _callAsync(shm.fileCheckpoint, [path.resolve(filePath)]);
+}
+
+/**
+ * Same as create(), but shmget/shm_open/ftruncate/mmap are done in libuv threadpool
+ * @return {Promise<mixed/null>}
+ */
+function createAsync(count, typeKey /*= 'Buffer'*/, key /*= null*/, permStr /*= '660'*/, options /*= {}*/) {
+	return new Promise(function (resolve) {
+		if (typeof key === 'string') {
+			const args = _createPosixArgs(key, count, typeKey, permStr, options);
+			resolve(_callAsync(shm.getPosix, args).then((res) => _withPrefault(_wrapChunks(res, args[7]), options)));
+			return;
+		}
+		const args = _createArgs(count, typeKey, key, permStr, options);
+		const autoKey = !args[0];
+		const tryCreate = function (key) {
+			args[0] = key;
+			return _callAsync(shm.get, args).then((res) => {
+				if (!res && autoKey)
+					return tryCreate(_keyGen());
+				return _withPrefault(_withKey(_wrapChunks(res, args[6]), key), options);
+			});
+		};
+		resolve(tryCreate(autoKey ? _keyGen() : args[0]));
+	});
+}
+
+/**
+ * Same as get(), but shmget/shm_open/mmap are done in libuv threadpool
+ * @return {Promise<mixed/null>}
+ */
+function getAsync(key, typeKey /*= 'Buffer'*/, options /*= {}*/) {
+	return new Promise(function (resolve) {
+		if (typeof key === 'string') {
+			const args = _getPosixArgs(key, typeKey, options);
+			resolve(_callAsync(shm.getPosix, args).then((res) => _withPrefault(_wrapChunks(res, args[7]), options)));
+			return;
+		}
+		const args = _getArgs(key, typeKey, options);
+		resolve(_callAsync(shm.get, args).then((res) => _withPrefault(_withKey(_wrapChunks(res, args[6]), key), options)));
+	});
+}
+
+/**
+ * Same as detach(), but munmap/shmdt/unlink are done in libuv threadpool.
+ * Attach is forgotten immediately, memory is unmapped when Promise resolves
+ * @return {Promise<int>}
+ */
+function detachAsync(key, forceDestroy /*= false*/) {
+	return new Promise(function (resolve) {
+		if (forceDestroy === undefined)
+			forceDestroy = false;
+		resolve(_callAsync(typeof key === 'string' ? shm.detachPosix : shm.detach, [key, forceDestroy]));
+	});
+}
+
+/**
+ * Same as destroy(), but done in libuv threadpool, see detachAsync()
+ * @return {Promise<boolean>}
+ */
+function destroyAsync(key) {
+	return detachAsync(key, true).then((res) => res == 0);
+}
+
 /**
  * Destroy System V/POSIX shared memory
  * @param {int/string} key - integer key of System V shared memory segment, or string name of POSIX shared memory object
@@ -210,14 +724,1406 @@ function destroy(key) {
 }
 
 /**
- * Detach all created and getted shared memory objects (both System V and POSIX)
- * Will be automatically called on process exit/termination
+ * Detach all created and getted shared memory objects (both System V and POSIX) of current thread
+ * Will be automatically called on process exit/termination, and on exit of worker thread
  * @return {int} count of destroyed System V segments
  */
 function detachAll() {
 	return shm.detachAll();
 }
 
+/**
+ * Get info about pages used for mapping of attached shared memory
+ * @param {int/string} key - integer key of System V shared memory segment, or string name of POSIX shared memory object
+ * @return {object/null} { pageSize, hugetlb, transparentHugeBytes }, or null if not attached
+ *  pageSize - size of page in bytes (eg. 2MB for huge pages)
+ *  hugetlb - true if huge pages are used
+ *  transparentHugeBytes - how many bytes are currently backed by transparent huge pages
+ */
+function pageInfo(key) {
+	return shm.pageInfo(key);
+}
+
+/**
+ * Get NUMA placement of attached shared memory
+ * Works on single-node hosts too: nodes is [0] and all resident pages are on node 0
+ * @param {int/string} key - integer key of System V shared memory segment, or string name of POSIX shared memory object
+ * @return {object/null} { nodes, policy, policyNodes, pageSize, residentPages }, or null if not attached
+ *  nodes - ids of online NUMA nodes
+ *  policy - 'default', 'interleave', 'bind', 'preferred' or 'local', null if kernel does not support NUMA
+ *  policyNodes - nodes of policy
+ *  residentPages - { [node]: count of resident pages of pageSize }, null if unknown.
+ *   Pages which were not touched yet are not counted
+ */
+function numaInfo(key) {
+	return shm.numaInfo(key);
+}
+
+const SegmentTypes = ['sysv', 'posix', 'anonymous', 'file'];
+
+/**
+ * Get runtime stats of every shared memory segment/object attached by this process, eg. for capacity planning
+ * Cost is one pass over /proc/self/smaps and mincore() of every mapping, so don't call it in hot path
+ * @return {Array<object>} [{ type, key, id, name, fd, size, mappedBytes, attaches, isOwner, nattch,
+ *  creatorPid, createdAt, pageSize, hugetlb, transparentHugeBytes, residentPages, residentBytes, pages }]
+ *  type - 'sysv', 'posix', 'anonymous' (memfd) or 'file'
+ *  key, id - key and shmid of System V segment, name - name of POSIX object or path of file, fd - fd of memfd
+ *  size - size of data in bytes, null if System V segment was destroyed by other process
+ *  mappedBytes - size of mappings of this process (attaches sharing mapping are counted once)
+ *  attaches - count of attaches of this process, in all threads
+ *  isOwner - segment/object was created by this process
+ *  nattch - count of attaches by all processes, System V only (null for others)
+ *  creatorPid - pid of creator, null if unknown (POSIX objects created by older versions)
+ *  createdAt - Date of creation (for System V: creation or last IPC_SET), null if unknown
+ *  pageSize, hugetlb, transparentHugeBytes - see pageInfo()
+ *  residentPages, residentBytes - pages of system page size resident in memory and their size, null if unknown
+ *  pages - count of all pages of system page size
+ */
+function stats() {
+	return shm.stats().map((segment) => Object.assign(segment, {
+		type: SegmentTypes[segment.type],
+		createdAt: segment.createdAt === null ? null : new Date(segment.createdAt),
+	}));
+}
+
+/**
+ * Get counters of syscalls done by this process since start, they are cheap enough to be always on
+ * @return {object} { attaches, attachErrors, attachNs, mappingReuses, detaches, destroys, detachNs,
+ *  prefaults, prefaultBytes, prefaultNs, flushes, flushNs }
+ *  mappingReuses - attaches which took existing mapping of this process instead of shmat/mmap
+ *  *Ns - time spent in syscalls of attach (shmget/shmat, shm_open/mmap...), detach and destroy, prefault() or
+ *   flush()/checkpoint() in ns, including time in threadpool for async calls
+ */
+function counters() {
+	return shm.counters();
+}
+
+// [name of counter, metric, help, divisor to base unit]
+const prometheusCounters = [
+	['attaches', 'attaches_total', 'Attaches of shared memory', 1],
+	['attachErrors', 'attach_errors_total', 'Failed attaches of shared memory', 1],
+	['attachNs', 'attach_seconds_total', 'Time spent in syscalls of attach', 1e9],
+	['mappingReuses', 'mapping_reuses_total', 'Attaches which reused mapping of this process', 1],
+	['detaches', 'detaches_total', 'Detaches of shared memory', 1],
+	['destroys', 'destroys_total', 'Destroyed segments and objects', 1],
+	['detachNs', 'detach_seconds_total', 'Time spent in syscalls of detach and destroy', 1e9],
+	['prefaults', 'prefaults_total', 'Prefaulted ranges', 1],
+	['prefaultBytes', 'prefault_bytes_total', 'Prefaulted bytes', 1],
+	['prefaultNs', 'prefault_seconds_total', 'Time spent in prefault', 1e9],
+	['flushes', 'flushes_total', 'Ranges written back with msync', 1],
+	['flushNs', 'flush_seconds_total', 'Time spent in msync', 1e9],
+];
+
+/**
+ * Export counters(), totals and stats() of segments in Prometheus text format
+ * @param {object} options:
+ *  prefix - prefix of metric names, default 'shm'
+ *  segments - include per-segment metrics, default true
+ * @return {string}
+ */
+function prometheus(options /*= {}*/) {
+	options = options || {};
+	const prefix = options.prefix === undefined ? 'shm' : options.prefix;
+	const lines = [];
+	const add = (name, type, help, samples) => {
+		lines.push('# HELP ' + prefix + '_' + name + ' ' + help, '# TYPE ' + prefix + '_' + name + ' ' + type);
+		for (const [labels, value] of samples)
+			lines.push(prefix + '_' + name + labels + ' ' + value);
+	};
+	const values = counters();
+	for (const [counter, name, help, divisor] of prometheusCounters)
+		add(name, 'counter', help, [['', values[counter] / divisor]]);
+	add('mapped_bytes', 'gauge', 'Size of all attaches of this process', [['', shm.getTotalUsedSize()]]);
+	add('created_bytes', 'gauge', 'Size of segments and objects created by this process and not destroyed',
+		[['', shm.getTotalAllocatedSize()]]);
+	if (options.segments === false)
+		return lines.join('\n') + '\n';
+
+	const segments = shm.stats();
+	add('segments', 'gauge', 'Segments and objects attached by this process', [['', segments.length]]);
+	const labels = segments.map((segment) => {
+		const id = segment.type === 0 ? segment.key : segment.type === 2 ? segment.fd : segment.name;
+		return '{type="' + SegmentTypes[segment.type] + '",segment="' + _prometheusLabel(String(id)) + '"}';
+	});
+	const perSegment = (name, help, fn) => {
+		add(name, 'gauge', help, segments.map((segment, i) => [labels[i], fn(segment)])
+			.filter((sample) => sample[1] !== null && sample[1] !== undefined));
+	};
+	perSegment('segment_size_bytes', 'Size of data of segment', (segment) => segment.size);
+	perSegment('segment_mapped_bytes', 'Size of attaches of segment by this process', (segment) => segment.mappedBytes);
+	perSegment('segment_resident_bytes', 'Resident memory of segment', (segment) => segment.residentBytes);
+	perSegment('segment_attaches', 'Attaches of segment by this process', (segment) => segment.attaches);
+	perSegment('segment_nattch', 'Attaches of System V segment by all processes', (segment) => segment.nattch);
+	perSegment('segment_hugetlb', 'Segment is mapped with huge pages', (segment) => segment.hugetlb ? 1 : 0);
+	return lines.join('\n') + '\n';
+}
+
+/**
+ * List System V segments (from /proc/sysvipc/shm) and POSIX objects (in /dev/shm) of all processes, Linux only
+ * POSIX objects are not mapped, only their headers are read
+ * @return {Array<object>} [{ type, key, id, name, size, nattch, uid, mode, creatorPid, ownerPid, ownerAlive,
+ *  lease, createdAt, activeAt, attached }]
+ *  type - 'sysv' or 'posix', key and id - of System V segment, name - name of POSIX object
+ *  size - size of data (size of file for POSIX objects not created by this library)
+ *  nattch - count of attaches of System V segment, null for POSIX objects
+ *  creatorPid - pid of creator, null if unknown
+ *  ownerPid - owner of lease of POSIX object (or creator if it has no lease), creator of System V segment
+ *  ownerAlive - owner process exists and was started before last activity (else its pid was reused),
+ *   null if owner is unknown or is in other PID namespace
+ *  lease - POSIX object has lease, see heartbeat()
+ *  createdAt - Date of creation, null if unknown
+ *  activeAt - Date of last heartbeat of POSIX object (or modification if it was not created by this library),
+ *   of last attach, detach or change of System V segment
+ *  attached - attached by this process
+ */
+function list() {
+	return shm.list().map(_listEntry);
+}
+
+/**
+ * Destroy orphaned System V segments and POSIX objects, eg. left by crashed workers, Linux only
+ * Segment/object is orphaned if its owner is dead and it was not active for olderThan ms:
+ *  System V segment - not attached (nattch is 0) and its creator and last attached process are dead,
+ *  POSIX object - owner of lease is dead (or lease is older than leaseTimeout ms).
+ * Segments/objects of other users, POSIX objects not created by this library (or by older versions)
+ *  and segments/objects attached by this process are never destroyed
+ * Process with pid of owner which was started after last activity reused pid of dead owner.
+ * Lease owner from other PID namespace can't be checked, its objects are destroyed only by leaseTimeout
+ * @param {object} options:
+ *  olderThan - min time since last activity in ms, default 0
+ *  leaseTimeout - also destroy POSIX objects whose lease was not renewed by heartbeat() for this time
+ *   even if owner is alive (eg. its pid was reused), default is not to check
+ *  dryRun - only return orphans, default false
+ *  types - array of 'sysv', 'posix', default ['posix']. System V segments have no lease and can belong
+ *   to other software, so they are reaped only if 'sysv' is passed
+ *  prefix - destroy only POSIX objects with names starting with prefix (eg. '/myapp_'), System V segments are
+ *   skipped if it's set
+ * @return {Array<object>} destroyed segments/objects, see list()
+ */
+function reap(options /*= {}*/) {
+	options = options || {};
+	const prefix = options.prefix === undefined ? '' : String(options.prefix);
+	const types = options.types || ['posix'];
+	const olderThan = options.olderThan === undefined ? 0 : options.olderThan;
+	const leaseTimeout = options.leaseTimeout === undefined ? -1 : options.leaseTimeout;
+	if (!(olderThan >= 0))
+		throw new RangeError('olderThan should be >= 0');
+	if (!(leaseTimeout >= 0 || leaseTimeout === -1))
+		throw new RangeError('leaseTimeout should be >= 0');
+	return shm.reap(olderThan, leaseTimeout, !!options.dryRun, !prefix && types.indexOf('sysv') !== -1,
+		types.indexOf('posix') !== -1, prefix).map(_listEntry);
+}
+
+/**
+ * Renew leases of POSIX objects, files and anonymous memory, so reap() in other processes knows they are used
+ * Object created by this process is leased by it, call heartbeat() periodically if reap() is used with leaseTimeout:
+ *  setInterval(() => shm.heartbeat(), 10000).unref();
+ * @param {string} name - optional, take over lease of attached POSIX object, eg. after death of its creator
+ * @return {int} count of renewed leases
+ */
+function heartbeat(name) {
+	return name === undefined ? shm.heartbeat() : shm.heartbeat(name);
+}
+
+/**
+ * Make shared memory resident in libuv threadpool, so first access does not cause page faults.
+ * Memory is split to chunks which are processed in parallel (count of chunks depends on UV_THREADPOOL_SIZE)
+ * @param {Buffer/TypedArray} array - shared memory buffer/array
+ * @param {object} options:
+ *  populate - fault in pages for write with madvise(MADV_POPULATE_WRITE) or by touching every page
+ *  lock - lock pages in memory with mlock(), see RLIMIT_MEMLOCK
+ *  willNeed - madvise(MADV_WILLNEED), eg. to read in swapped out pages
+ * @return {Promise} resolves with array
+ */
+function prefault(array, options /*= { populate: true }*/) {
+	if (options === undefined)
+		options = { populate: true };
+	if (array instanceof ChunkedArray) {
+		return Promise.all(array.chunks.map((chunk) => prefault(chunk, options))).then(() => array);
+	}
+	const flags = _getPrefaultFlags(options);
+	const byteLength = array.byteLength;
+	const threads = Math.max(1, Math.min(os.cpus().length, Number(process.env.UV_THREADPOOL_SIZE) || 4));
+	const chunkSize = Math.max(1, Math.ceil(byteLength / threads / prefaultChunkAlign)) * prefaultChunkAlign;
+	const chunks = [];
+	for (let offset = 0; offset < byteLength; offset += chunkSize) {
+		const length = Math.min(chunkSize, byteLength - offset);
+		chunks.push(new Promise(function (resolve, reject) {
+			shm.prefault(array, offset, length, flags, function (err) {
+				if (err)
+					reject(err);
+				else
+					resolve();
+			});
+		}));
+	}
+	return Promise.all(chunks).then(() => array);
+}
+
+/**
+ * Wait until element of shared memory array is notified by another thread or process.
+ * Like Atomics.wait(), but works between processes and does not block event loop:
+ *  waiting is done with futex in libuv threadpool (Linux only)
+ * Note: every pending wait occupies one thread of threadpool, see UV_THREADPOOL_SIZE
+ * @param {Int32Array/Uint32Array} array - shared memory array
+ * @param {int} index - index of element
+ * @param {int} expected - wait only if array[index] == expected
+ * @param {number} timeoutMs - timeout in ms, default is Infinity
+ * @return {Promise<string>} resolves with 'ok', 'not-equal' or 'timed-out'
+ */
+function wait(array, index, expected, timeoutMs /*= Infinity*/) {
+	if (timeoutMs === undefined || timeoutMs === null || isNaN(timeoutMs))
+		timeoutMs = Infinity;
+	return new Promise(function (resolve, reject) {
+		shm.wait(array, index, expected|0, +timeoutMs, function (err, res) {
+			if (err)
+				reject(err);
+			else
+				resolve(res);
+		});
+	});
+}
+
+/**
+ * Wake waiters of element of shared memory array, see wait()
+ * @param {Int32Array/Uint32Array} array - shared memory array
+ * @param {int} index - index of element
+ * @param {int} count - max count of waiters to wake, default is all
+ * @return {int} count of woken waiters
+ */
+function notify(array, index, count /*= Infinity*/) {
+	if (count === undefined || !(count < 0x7fffffff))
+		count = -1;
+	return shm.notify(array, index, count);
+}
+
+/**
+ * Bulk operations over shared memory arrays, done natively with SIMD kernels
+ *  (SSE2/AVX2/AVX-512 chosen at runtime) directly on mapped memory.
+ * Large ranges are split between threads of native pool, see ops.configure().
+ * Every operation has async form (eg. sumAsync) returning Promise, it runs in libuv threadpool.
+ * Supported arrays: Buffer, typed arrays except Float16Array, and ChunkedArray of them.
+ * For BigInt64Array/BigUint64Array results and value of scale/fill are BigInt,
+ *  sum, dot and scale wrap modulo 2^64 like BigInt.asIntN(64, ...).
+ * Optional start/end are indexes of range like in TypedArray.subarray(), default is whole array.
+ * NaN elements are ignored by min, max and argmax.
+ */
+const ops = {
+	/** @return {number/BigInt} sum of elements */
+	sum: (array, start, end) => _opsRun(shm.SHMOPS_SUM, array, null, start, end),
+	/** @return {number/BigInt} min element, Infinity for empty range */
+	min: (array, start, end) => _opsRun(shm.SHMOPS_MIN, array, null, start, end),
+	/** @return {number/BigInt} max element, -Infinity for empty range */
+	max: (array, start, end) => _opsRun(shm.SHMOPS_MAX, array, null, start, end),
+	/** @return {int} index of first max element, -1 for empty range */
+	argmax: (array, start, end) => _opsRun(shm.SHMOPS_ARGMAX, array, null, start, end),
+	/** @return {number/BigInt} dot product of arrays of same type */
+	dot: (array, array2, start, end) => _opsRun(shm.SHMOPS_DOT, array, array2, start, end),
+	/** Multiply elements by factor in place, values are converted like on assignment to array. @return {mixed} array */
+	scale: (array, factor, start, end) => _opsRun(shm.SHMOPS_SCALE, array, factor, start, end),
+	/** Set elements to value. @return {mixed} array */
+	fill: (array, value, start, end) => _opsRun(shm.SHMOPS_FILL, array, value, start, end),
+
+	sumAsync: (array, start, end) => _opsRunAsync(shm.SHMOPS_SUM, array, null, start, end),
+	minAsync: (array, start, end) => _opsRunAsync(shm.SHMOPS_MIN, array, null, start, end),
+	maxAsync: (array, start, end) => _opsRunAsync(shm.SHMOPS_MAX, array, null, start, end),
+	argmaxAsync: (array, start, end) => _opsRunAsync(shm.SHMOPS_ARGMAX, array, null, start, end),
+	dotAsync: (array, array2, start, end) => _opsRunAsync(shm.SHMOPS_DOT, array, array2, start, end),
+	scaleAsync: (array, factor, start, end) => _opsRunAsync(shm.SHMOPS_SCALE, array, factor, start, end),
+	fillAsync: (array, value, start, end) => _opsRunAsync(shm.SHMOPS_FILL, array, value, start, end),
+
+	/**
+	 * Configure bulk operations, applies to all following operations of process
+	 * @param {object} options - optional:
+	 *  isa - instruction set: 'auto' (best supported, default), 'avx512', 'avx2', 'sse2' or 'generic' (non-x86)
+	 *  threads - max count of threads used for one operation, default is count of CPUs
+	 * @return {object} current config { isa, supportedIsa, threads }
+	 */
+	configure: (options) => shm.opsConfigure(options && options.isa, options && options.threads),
+};
+
+/**
+ * Copy bytes of src into shared memory array.
+ * Large copies (4MB+) use non-temporal stores, so they don't evict data of other processes
+ *  from CPU cache, and are split between threads like ops, see ops.configure().
+ * @param {Buffer/TypedArray/ChunkedArray} dstArray - shared memory array
+ * @param {int} dstOffset - index of element of dstArray to copy to
+ * @param {ArrayBuffer/SharedArrayBuffer/Buffer/TypedArray/DataView} src - bytes to copy, eg. other shm view
+ * @return {int} count of copied bytes
+ */
+function copyIn(dstArray, dstOffset, src) {
+	return _copyCalls(dstArray, dstOffset, src, true).reduce((sum, args) => sum + shm.copyBytes.apply(shm, args), 0);
+}
+
+/**
+ * Copy bytes of shared memory array to dst, see copyIn()
+ * @param {Buffer/TypedArray/ChunkedArray} srcArray - shared memory array
+ * @param {int} srcOffset - index of element of srcArray to copy from
+ * @param {ArrayBuffer/SharedArrayBuffer/Buffer/TypedArray/DataView} dst - destination, its whole length is filled
+ * @return {int} count of copied bytes
+ */
+function copyOut(srcArray, srcOffset, dst) {
+	return _copyCalls(srcArray, srcOffset, dst, false).reduce((sum, args) => sum + shm.copyBytes.apply(shm, args), 0);
+}
+
+/**
+ * Async copyIn(), copy is done in libuv threadpool
+ * @return {Promise} resolves with count of copied bytes
+ */
+function copyInAsync(dstArray, dstOffset, src) {
+	return new Promise(function (resolve) {
+		const calls = _copyCalls(dstArray, dstOffset, src, true);
+		resolve(Promise.all(calls.map((args) => _callAsync(shm.copyBytes, args)))
+			.then((res) => res.reduce((sum, bytes) => sum + bytes, 0)));
+	});
+}
+
+/**
+ * Async copyOut(), copy is done in libuv threadpool
+ * @return {Promise} resolves with count of copied bytes
+ */
+function copyOutAsync(srcArray, srcOffset, dst) {
+	return new Promise(function (resolve) {
+		const calls = _copyCalls(srcArray, srcOffset, dst, false);
+		resolve(Promise.all(calls.map((args) => _callAsync(shm.copyBytes, args)))
+			.then((res) => res.reduce((sum, bytes) => sum + bytes, 0)));
+	});
+}
+
+// Args of shm.copyBytes() for every chunk of shared memory array touched by copy
+function _copyCalls(array, offset, other, isIn) {
+	if (other instanceof ArrayBuffer || (typeof SharedArrayBuffer === 'function' && other instanceof SharedArrayBuffer))
+		other = new Uint8Array(other);
+	else if (other instanceof DataView)
+		other = new Uint8Array(other.buffer, other.byteOffset, other.byteLength);
+	if (!ArrayBuffer.isView(other))
+		throw new TypeError('Argument ' + (isIn ? 'src' : 'dst') + ' must be an ArrayBuffer, Buffer or TypedArray');
+	const views = array instanceof ChunkedArray ? array.chunks : [array];
+	if (!views.every((view) => ArrayBuffer.isView(view)))
+		throw new TypeError('Argument array must be a Buffer, TypedArray or ChunkedArray');
+	const bytesPerElement = views.length ? (views[0].BYTES_PER_ELEMENT || 1) : 1;
+	const byteOffset = offset * bytesPerElement;
+	const byteLength = views.reduce((length, view) => length + view.byteLength, 0);
+	if (!(Number.isSafeInteger(offset) && offset >= 0 && byteOffset + other.byteLength <= byteLength))
+		throw new RangeError('Range is out of bounds');
+	const calls = [];
+	let viewStart = 0, done = 0;
+	for (const view of views) {
+		const viewEnd = viewStart + view.byteLength;
+		const from = Math.max(byteOffset + done, viewStart);
+		const length = Math.min(byteOffset + other.byteLength, viewEnd) - from;
+		if (length > 0) {
+			calls.push(isIn
+				? [view, from - viewStart, other, done, length]
+				: [other, done, view, from - viewStart, length]);
+			done += length;
+		}
+		viewStart = viewEnd;
+	}
+	return calls;
+}
+
+// Parts of range of array: [view, start, end, offset of view]
+function _opsParts(array, start, end) {
+	if (!(array instanceof ChunkedArray))
+		return [[array, start, end, 0]];
+	const parts = [];
+	const chunkLength = array.chunkLength;
+	for (let i = Math.floor(start / chunkLength); i < array.chunks.length && i * chunkLength < end; i++) {
+		const offset = i * chunkLength;
+		parts.push([array.chunks[i], Math.max(start - offset, 0), Math.min(end - offset, array.chunks[i].length), offset]);
+	}
+	return parts;
+}
+
+// Calls of shm.opsRun() for every part of range: { args, offset }
+function _opsCalls(kind, array, arg, start, end) {
+	if (!(array instanceof ChunkedArray || ArrayBuffer.isView(array)))
+		throw new TypeError('Argument array must be a Buffer, TypedArray or ChunkedArray');
+	if (start === undefined)
+		start = 0;
+	if (end === undefined)
+		end = array.length;
+	if (!(start >= 0 && start <= end && end <= array.length))
+		throw new RangeError('Range is out of bounds');
+	const chunked = kind === shm.SHMOPS_DOT && array instanceof ChunkedArray;
+	if (chunked && !(arg instanceof ChunkedArray && arg.chunkLength === array.chunkLength))
+		throw new TypeError('Arrays should be ChunkedArray with same chunk length');
+	return _opsParts(array, start, end).map((part) => ({
+		args: [kind, part[0], chunked ? arg.chunks[part[3] / array.chunkLength] : arg, part[1], part[2]],
+		offset: part[3],
+	}));
+}
+
+// Combine results of parts
+function _opsResult(kind, array, calls, results) {
+	switch (kind) {
+		case shm.SHMOPS_SUM:
+		case shm.SHMOPS_DOT:
+			if (typeof results[0] === 'bigint') {
+				// Sums of chunks wrap like sum of one array
+				const chunk = array instanceof ChunkedArray ? array.chunks[0] : array;
+				const wrap = chunk instanceof BigUint64Array ? BigInt.asUintN : BigInt.asIntN;
+				return results.reduce((a, b) => wrap(64, a + b));
+			}
+			return results.reduce((a, b) => a + b, 0);
+		case shm.SHMOPS_MIN:
+			// BigInt results can't be passed to Math.min(), empty ranges give Infinity
+			return results.reduce((a, b) => typeof a === 'bigint' || typeof b === 'bigint' ? (b < a ? b : a) : Math.min(a, b), Infinity);
+		case shm.SHMOPS_MAX:
+			return results.reduce((a, b) => typeof a === 'bigint' || typeof b === 'bigint' ? (b > a ? b : a) : Math.max(a, b), -Infinity);
+		case shm.SHMOPS_ARGMAX: {
+			// Parts are ordered, so first max wins
+			let best = -1, bestValue;
+			results.forEach((index, i) => {
+				const value = index === -1 ? undefined : calls[i].args[1][index];
+				if (index !== -1 && (best === -1 || value > bestValue)) {
+					best = calls[i].offset + index;
+					bestValue = value;
+				}
+			});
+			return best;
+		}
+		default:
+			return array;
+	}
+}
+
+function _opsRun(kind, array, arg, start, end) {
+	const calls = _opsCalls(kind, array, arg, start, end);
+	return _opsResult(kind, array, calls, calls.map((call) => shm.opsRun.apply(shm, call.args)));
+}
+
+function _opsRunAsync(kind, array, arg, start, end) {
+	return new Promise(function (resolve) {
+		const calls = _opsCalls(kind, array, arg, start, end);
+		resolve(Promise.all(calls.map((call) => _callAsync(shm.opsRun, call.args)))
+			.then((results) => _opsResult(kind, array, calls, results)));
+	});
+}
+
+/**
+ * Shared memory segment/object larger than LengthMax, mapped once and exposed as
+ *  sequence of Buffer/TypedArray views (chunks) of chunkLength elements (last one can be shorter)
+ * Use create() or get() with option `chunked` to construct
+ */
+class ChunkedArray {
+	/**
+	 * @param {Array} chunks - array of Buffer/TypedArray views
+	 * @param {int} chunkLength - count of elements in chunk
+	 */
+	constructor(chunks, chunkLength) {
+		this.chunks = chunks;
+		this.chunkLength = chunkLength;
+		this.length = chunks.reduce((length, chunk) => length + chunk.length, 0);
+		this.byteLength = chunks.reduce((length, chunk) => length + chunk.byteLength, 0);
+	}
+
+	/**
+	 * Get chunk containing element, index of element in chunk is `index % chunkLength`
+	 * @param {int} index - index of element
+	 * @return {Buffer/TypedArray} chunk
+	 */
+	chunkFor(index) {
+		return this.chunks[Math.floor(index / this.chunkLength)];
+	}
+
+	/**
+	 * @param {int} index - index of element
+	 * @return {mixed} value of element
+	 */
+	get(index) {
+		return this.chunks[Math.floor(index / this.chunkLength)][index % this.chunkLength];
+	}
+
+	/**
+	 * @param {int} index - index of element
+	 * @param {mixed} value - new value of element
+	 */
+	set(index, value) {
+		this.chunks[Math.floor(index / this.chunkLength)][index % this.chunkLength] = value;
+	}
+}
+
+/**
+ * Multi-producer/multi-consumer queue of messages living inside POSIX shared memory object
+ * Use createQueue() or openQueue() to construct
+ */
+class Queue {
+	/**
+	 * @param {string} name - name of POSIX shared memory object
+	 * @param {Buffer} buffer - shared memory buffer with queue
+	 */
+	constructor(name, buffer) {
+		const info = shm.queueInfo(buffer);
+		this.name = name;
+		this.buffer = buffer;
+		this.slotSize = info.slotSize;
+		this.slotCount = info.slotCount;
+	}
+
+	/**
+	 * Approximate count of messages in queue
+	 * @return {int}
+	 */
+	get length() {
+		return shm.queueInfo(this.buffer).length;
+	}
+
+	/**
+	 * Copy message to queue
+	 * @param {Buffer/TypedArray} src - message, should be not larger than slotSize
+	 * @return {boolean} false if queue is full
+	 */
+	push(src) {
+		return shm.queuePush(this.buffer, src);
+	}
+
+	/**
+	 * Copy message from queue
+	 * @param {Buffer/TypedArray} dst - should be not smaller than message, use slotSize to be sure
+	 * @return {int} count of bytes written to dst, or -1 if queue is empty
+	 */
+	pop(dst) {
+		return shm.queuePop(this.buffer, dst);
+	}
+
+	/**
+	 * Copy messages to queue
+	 * @param {Array} srcs - array of Buffer/TypedArray
+	 * @return {int} count of pushed messages, less than srcs.length if queue is full
+	 */
+	pushBatch(srcs) {
+		return shm.queuePushBatch(this.buffer, srcs);
+	}
+
+	/**
+	 * Copy messages from queue
+	 * Messages are written to dst one by one as records: uint32 length (native byte order), then message bytes
+	 * @param {Buffer/TypedArray} dst
+	 * @param {int} maxCount - max count of messages to pop, default is unlimited
+	 * @return {int} count of popped messages
+	 */
+	popBatch(dst, maxCount /*= uint32Max*/) {
+		if (maxCount === undefined)
+			maxCount = uint32Max;
+		return shm.queuePopBatch(this.buffer, dst, maxCount);
+	}
+
+	/**
+	 * Detach queue
+	 * @param {bool} forceDestroy - true to unlink POSIX shared memory object
+	 * @return {int} see detachPosix()
+	 */
+	detach(forceDestroy /*= false*/) {
+		this.buffer = null;
+		return detachPosix(this.name, forceDestroy);
+	}
+}
+
+/**
+ * Create MPMC queue in POSIX shared memory object
+ * @param {string} name - string name of shared memory object, should start with '/'
+ * @param {int} slotSize - max size of message in bytes
+ * @param {int} slotCount - max count of messages in queue, should be power of 2
+ * @param {string} permStr - permissions, default is 660
+ * @return {Queue/null} queue, or null if already exists with provided name
+ */
+function createQueue(name, slotSize, slotCount, permStr /*= '660'*/) {
+	if (!(Number.isSafeInteger(slotSize) && slotSize >= 1 && slotSize <= uint32Max))
+		throw new RangeError('Slot size should be 1 .. ' + uint32Max);
+	if (!(Number.isSafeInteger(slotCount) && slotCount >= 1 && slotCount <= uint32Max
+		&& (slotCount & (slotCount - 1)) === 0))
+		throw new RangeError('Count of slots should be power of 2');
+	const size = shm.queueSizeOf(slotSize, slotCount);
+	const buf = createPosix(name, size, 'Buffer', permStr);
+	if (!buf)
+		return null;
+	shm.queueInit(buf, slotSize, slotCount);
+	return new Queue(name, buf);
+}
+
+/**
+ * Open MPMC queue created by createQueue()
+ * @param {string} name - string name of shared memory object
+ * @return {Queue/null} queue, or null if not exists
+ */
+function openQueue(name) {
+	const buf = getPosix(name, 'Buffer');
+	if (!buf)
+		return null;
+	if (shm.queueInfo(buf) === null) {
+		detachPosix(name);
+		throw new Error('Shared memory object ' + name + ' does not contain a queue');
+	}
+	return new Queue(name, buf);
+}
+
+/**
+ * Slab allocator of variable-sized blocks living inside POSIX shared memory object
+ * Blocks are identified by offsets, which are valid in all processes
+ * Use createSlab() or openSlab() to construct
+ */
+class Slab {
+	/**
+	 * @param {string} name - name of POSIX shared memory object
+	 * @param {Buffer} buffer - shared memory buffer with allocator
+	 */
+	constructor(name, buffer) {
+		const info = shm.slabInfo(buffer);
+		this.name = name;
+		this.buffer = buffer;
+		this.slabSize = info.slabSize;
+		this.slabCount = info.slabCount;
+		this.maxSize = info.maxSize;
+	}
+
+	/**
+	 * Count of slabs bound to size classes
+	 * @return {int}
+	 */
+	get usedSlabs() {
+		return shm.slabInfo(this.buffer).usedSlabs;
+	}
+
+	/**
+	 * Allocate block, size is rounded up to power of 2 (min 16 bytes)
+	 * @param {int} size - size in bytes, should be not larger than maxSize
+	 * @return {int/null} offset of block, or null if out of memory
+	 */
+	alloc(size) {
+		const offset = shm.slabAlloc(this.buffer, size);
+		return offset === -1 ? null : offset;
+	}
+
+	/**
+	 * Free block
+	 * @param {int} offset - offset returned by alloc()
+	 */
+	free(offset) {
+		shm.slabFree(this.buffer, offset);
+	}
+
+	/**
+	 * Get view of block
+	 * @param {int} offset - offset returned by alloc()
+	 * @param {string} typeKey - see keys of BufferType, default is 'Buffer'
+	 * @param {int} length - count of elements, default is whole block
+	 * @return {Buffer/TypedArray}
+	 */
+	view(offset, typeKey /*= 'Buffer'*/, length /*= undefined*/) {
+		if (typeKey === undefined)
+			typeKey = 'Buffer';
+		if (BufferType[typeKey] === undefined)
+			throw new Error("Unknown type key " + typeKey);
+		const size1 = BufferTypeSizeof[typeKey];
+		const blockSize = shm.slabBlockSize(this.buffer, offset);
+		if (length === undefined)
+			length = Math.floor(blockSize / size1);
+		if (!(Number.isSafeInteger(length) && length >= 0 && length * size1 <= blockSize))
+			throw new RangeError('Length should be 0 .. ' + Math.floor(blockSize / size1));
+		const byteOffset = this.buffer.byteOffset + offset;
+		if (typeKey === 'Buffer')
+			return Buffer.from(this.buffer.buffer, byteOffset, length);
+		return new global[typeKey](this.buffer.buffer, byteOffset, length);
+	}
+
+	/**
+	 * Release slabs claimed by processes crashed during allocation
+	 * @return {int} count of recovered slabs
+	 */
+	recover() {
+		return shm.slabRecover(this.buffer);
+	}
+
+	/**
+	 * Detach allocator
+	 * @param {bool} forceDestroy - true to unlink POSIX shared memory object
+	 * @return {int} see detachPosix()
+	 */
+	detach(forceDestroy /*= false*/) {
+		this.buffer = null;
+		return detachPosix(this.name, forceDestroy);
+	}
+}
+
+/**
+ * Create slab allocator in POSIX shared memory object
+ * @param {string} name - string name of shared memory object, should start with '/'
+ * @param {int} size - size of memory for blocks in bytes, rounded up to slab size
+ * @param {object} options - optional:
+ *  slabSize - size of slab in bytes, power of 2, default is 64KB. It's max size of block
+ * @param {string} permStr - permissions, default is 660
+ * @return {Slab/null} allocator, or null if already exists with provided name
+ */
+function createSlab(name, size, options /*= {}*/, permStr /*= '660'*/) {
+	const slabSize = options && options.slabSize !== undefined ? options.slabSize : slabSizeDefault;
+	if (!(Number.isSafeInteger(slabSize) && slabSize >= 16 && slabSize <= Math.pow(2,31) && (slabSize & (slabSize - 1)) === 0))
+		throw new RangeError('Slab size should be power of 2 >= 16');
+	if (!(Number.isSafeInteger(size) && size >= 1))
+		throw new RangeError('Size should be positive integer');
+	const slabCount = Math.ceil(size / slabSize);
+	if (slabCount > uint32Max)
+		throw new RangeError('Size is too large');
+	const buf = createPosix(name, shm.slabSizeOf(slabSize, slabCount), 'Buffer', permStr);
+	if (!buf)
+		return null;
+	shm.slabInit(buf, slabSize, slabCount);
+	return new Slab(name, buf);
+}
+
+/**
+ * Open slab allocator created by createSlab()
+ * @param {string} name - string name of shared memory object
+ * @return {Slab/null} allocator, or null if not exists
+ */
+function openSlab(name) {
+	const buf = getPosix(name, 'Buffer');
+	if (!buf)
+		return null;
+	if (shm.slabInfo(buf) === null) {
+		detachPosix(name);
+		throw new Error('Shared memory object ' + name + ' does not contain a slab allocator');
+	}
+	return new Slab(name, buf);
+}
+
+/**
+ * Fixed-capacity hash table with fixed-width keys and values living inside POSIX shared memory object
+ * Keys are Buffer/TypedArray of keySize bytes, or number/BigInt if keySize is 8
+ * Use createHashTable() or openHashTable() to construct
+ */
+class HashTable {
+	/**
+	 * @param {string} name - name of POSIX shared memory object
+	 * @param {Buffer} buffer - shared memory buffer with hash table
+	 */
+	constructor(name, buffer) {
+		const info = shm.hashTableInfo(buffer);
+		this.name = name;
+		this.buffer = buffer;
+		this.capacity = info.capacity;
+		this.keySize = info.keySize;
+		this.valueSize = info.valueSize;
+	}
+
+	/**
+	 * Count of keys
+	 * @return {int}
+	 */
+	get size() {
+		return shm.hashTableInfo(this.buffer).size;
+	}
+
+	/**
+	 * Copy value of key
+	 * @param {Buffer/TypedArray/number/BigInt} key
+	 * @param {Buffer/TypedArray} dst - optional, should be not smaller than valueSize
+	 * @return {boolean/Buffer/null} if dst is provided: true if found,
+	 *  otherwise new Buffer with value, or null if not found
+	 */
+	get(key, dst /*= undefined*/) {
+		if (dst !== undefined)
+			return shm.hashTableGet(this.buffer, key, dst);
+		const value = Buffer.allocUnsafe(this.valueSize);
+		return shm.hashTableGet(this.buffer, key, value) ? value : null;
+	}
+
+	/**
+	 * Get offset of value of key in buffer, to read value without copy
+	 * Value read by offset is not protected from concurrent writes, unlike get()
+	 * @param {Buffer/TypedArray/number/BigInt} key
+	 * @return {int} offset, or -1 if not found
+	 */
+	offsetOf(key) {
+		return shm.hashTableOffsetOf(this.buffer, key);
+	}
+
+	/**
+	 * Insert or update key
+	 * New key takes first deleted bucket on its probe chain, or empty bucket at its end
+	 * @param {Buffer/TypedArray/number/BigInt} key
+	 * @param {Buffer/TypedArray} value - valueSize bytes
+	 * @return {boolean} false if hash table is full (all buckets hold live keys)
+	 */
+	put(key, value) {
+		return shm.hashTablePut(this.buffer, key, value);
+	}
+
+	/**
+	 * Delete key
+	 * Bucket is not freed, it's left as tombstone which is reused by later put(),
+	 *  so lookups of missing keys still probe through it. Probe chains get longer as tombstones pile up,
+	 *  keep capacity well above max count of live keys if keys are deleted often
+	 * @param {Buffer/TypedArray/number/BigInt} key
+	 * @return {boolean} true if key was deleted
+	 */
+	delete(key) {
+		return shm.hashTableDelete(this.buffer, key);
+	}
+
+	/**
+	 * Copy values of keys
+	 * @param {Buffer/TypedArray} keys - keys one by one, keySize bytes each
+	 * @param {Buffer/TypedArray} dst - values are written one by one, valueSize bytes each
+	 * @param {Buffer/Uint8Array} found - optional, 1 is written for found keys, 0 for not found
+	 * @return {int} count of found keys
+	 */
+	getMany(keys, dst, found /*= undefined*/) {
+		return shm.hashTableGetMany(this.buffer, keys, dst, found);
+	}
+
+	/**
+	 * Detach hash table
+	 * @param {bool} forceDestroy - true to unlink POSIX shared memory object
+	 * @return {int} see detachPosix()
+	 */
+	detach(forceDestroy /*= false*/) {
+		this.buffer = null;
+		return detachPosix(this.name, forceDestroy);
+	}
+}
+
+/**
+ * Create hash table in POSIX shared memory object
+ * @param {string} name - string name of shared memory object, should start with '/'
+ * @param {int} capacity - max count of keys, rounded up to power of 2
+ * @param {int} keySize - size of key in bytes
+ * @param {int} valueSize - size of value in bytes
+ * @param {string} permStr - permissions, default is 660
+ * @return {HashTable/null} hash table, or null if already exists with provided name
+ */
+function createHashTable(name, capacity, keySize, valueSize, permStr /*= '660'*/) {
+	if (!(Number.isSafeInteger(capacity) && capacity >= 1))
+		throw new RangeError('Capacity should be positive integer');
+	if (!(Number.isSafeInteger(keySize) && keySize >= 1 && keySize <= uint32Max))
+		throw new RangeError('Key size should be 1 .. ' + uint32Max);
+	if (!(Number.isSafeInteger(valueSize) && valueSize >= 0 && valueSize <= uint32Max))
+		throw new RangeError('Value size should be 0 .. ' + uint32Max);
+	capacity = Math.pow(2, Math.ceil(Math.log2(capacity)));
+	const size = shm.hashTableSizeOf(capacity, keySize, valueSize);
+	const buf = createPosix(name, size, 'Buffer', permStr);
+	if (!buf)
+		return null;
+	shm.hashTableInit(buf, capacity, keySize, valueSize);
+	return new HashTable(name, buf);
+}
+
+/**
+ * Open hash table created by createHashTable()
+ * @param {string} name - string name of shared memory object
+ * @return {HashTable/null} hash table, or null if not exists
+ */
+function openHashTable(name) {
+	const buf = getPosix(name, 'Buffer');
+	if (!buf)
+		return null;
+	if (shm.hashTableInfo(buf) === null) {
+		detachPosix(name);
+		throw new Error('Shared memory object ' + name + ' does not contain a hash table');
+	}
+	return new HashTable(name, buf);
+}
+
+/**
+ * Seqlock-protected region of data living inside POSIX shared memory object
+ * Readers get consistent snapshot of data and never block writer
+ * Use createSeqlock() or openSeqlock() to construct
+ */
+class Seqlock {
+	/**
+	 * @param {string} name - name of POSIX shared memory object
+	 * @param {Buffer} buffer - shared memory buffer with seqlock region
+	 */
+	constructor(name, buffer) {
+		const info = shm.seqlockInfo(buffer);
+		this.name = name;
+		this.buffer = buffer;
+		this.size = info.size;
+	}
+
+	/**
+	 * Count of publishes
+	 * @return {int}
+	 */
+	get version() {
+		return shm.seqlockInfo(this.buffer).version;
+	}
+
+	/**
+	 * Copy data to region, writer which died during publish is taken over
+	 * @param {Buffer/TypedArray} src - should be not larger than size
+	 * @return {int} version of published data
+	 */
+	publish(src) {
+		return shm.seqlockPublish(this.buffer, src);
+	}
+
+	/**
+	 * Copy consistent snapshot of data from region
+	 * Throws if writer died during publish (data is torn), until next publish
+	 * @param {Buffer/TypedArray} dst - min(dst.byteLength, size) bytes are copied
+	 * @return {int} version of copied data
+	 */
+	read(dst) {
+		return shm.seqlockRead(this.buffer, dst);
+	}
+
+	/**
+	 * Detach seqlock region
+	 * @param {bool} forceDestroy - true to unlink POSIX shared memory object
+	 * @return {int} see detachPosix()
+	 */
+	detach(forceDestroy /*= false*/) {
+		this.buffer = null;
+		return detachPosix(this.name, forceDestroy);
+	}
+}
+
+/**
+ * Create seqlock region in POSIX shared memory object
+ * @param {string} name - string name of shared memory object, should start with '/'
+ * @param {int} size - size of data in bytes
+ * @param {string} permStr - permissions, default is 660
+ * @return {Seqlock/null} seqlock region, or null if already exists with provided name
+ */
+function createSeqlock(name, size, permStr /*= '660'*/) {
+	if (!(Number.isSafeInteger(size) && size >= 1))
+		throw new RangeError('Size should be positive integer');
+	const buf = createPosix(name, shm.seqlockSizeOf(size), 'Buffer', permStr);
+	if (!buf)
+		return null;
+	shm.seqlockInit(buf, size);
+	return new Seqlock(name, buf);
+}
+
+/**
+ * Open seqlock region created by createSeqlock()
+ * @param {string} name - string name of shared memory object
+ * @return {Seqlock/null} seqlock region, or null if not exists
+ */
+function openSeqlock(name) {
+	const buf = getPosix(name, 'Buffer');
+	if (!buf)
+		return null;
+	if (shm.seqlockInfo(buf) === null) {
+		detachPosix(name);
+		throw new Error('Shared memory object ' + name + ' does not contain a seqlock region');
+	}
+	return new Seqlock(name, buf);
+}
+
+/**
+ * Robust mutex living inside POSIX shared memory object
+ * Lock is owned by process (not thread), if owner process dies lock is taken over
+ *  by next locker with result 'owner-died'
+ * Use createMutex() or openMutex() to construct
+ */
+class Mutex {
+	/**
+	 * @param {string} name - name of POSIX shared memory object
+	 * @param {Buffer} buffer - shared memory buffer with mutex
+	 */
+	constructor(name, buffer) {
+		this.name = name;
+		this.buffer = buffer;
+	}
+
+	/**
+	 * Pid of process holding lock, or 0
+	 * @return {int}
+	 */
+	get owner() {
+		return shm.lockInfo(this.buffer).owner;
+	}
+
+	/**
+	 * Acquire lock, uncontended lock is taken at once in user space, busy lock is waited in threadpool
+	 * @param {number} timeoutMs - default is Infinity
+	 * @return {Promise<string>} 'ok', 'owner-died' or 'timed-out'
+	 */
+	lock(timeoutMs /*= Infinity*/) {
+		return _lockAsync(this.buffer, LockKind.mutex, timeoutMs);
+	}
+
+	/**
+	 * Acquire lock without waiting
+	 * @return {string} 'ok', 'owner-died' or 'busy'
+	 */
+	tryLock() {
+		return shm.lock(this.buffer, LockKind.mutex, 0);
+	}
+
+	/**
+	 * Release lock, throws if lock is not held by this process
+	 */
+	unlock() {
+		shm.unlock(this.buffer, LockKind.mutex);
+	}
+
+	/**
+	 * Detach mutex
+	 * @param {bool} forceDestroy - true to unlink POSIX shared memory object
+	 * @return {int} see detachPosix()
+	 */
+	detach(forceDestroy /*= false*/) {
+		this.buffer = null;
+		return detachPosix(this.name, forceDestroy);
+	}
+}
+
+/**
+ * Create mutex in POSIX shared memory object
+ * @param {string} name - string name of shared memory object, should start with '/'
+ * @param {string} permStr - permissions, default is 660
+ * @return {Mutex/null} mutex, or null if already exists with provided name
+ */
+function createMutex(name, permStr /*= '660'*/) {
+	const buf = createPosix(name, shm.mutexSizeOf(), 'Buffer', permStr);
+	if (!buf)
+		return null;
+	shm.mutexInit(buf);
+	return new Mutex(name, buf);
+}
+
+/**
+ * Open mutex created by createMutex()
+ * @param {string} name - string name of shared memory object
+ * @return {Mutex/null} mutex, or null if not exists
+ */
+function openMutex(name) {
+	const buf = getPosix(name, 'Buffer');
+	if (!buf)
+		return null;
+	const info = shm.lockInfo(buf);
+	if (info === null || info.type !== 'mutex') {
+		detachPosix(name);
+		throw new Error('Shared memory object ' + name + ' does not contain a mutex');
+	}
+	return new Mutex(name, buf);
+}
+
+/**
+ * Robust reader-writer lock living inside POSIX shared memory object, prefers writers
+ * Locks are owned by process (not thread), locks of dead processes are released
+ *  by other lockers with result 'owner-died' (for write lock)
+ * Use createRwLock() or openRwLock() to construct
+ */
+class RwLock {
+	/**
+	 * @param {string} name - name of POSIX shared memory object
+	 * @param {Buffer} buffer - shared memory buffer with reader-writer lock
+	 */
+	constructor(name, buffer) {
+		const info = shm.lockInfo(buffer);
+		this.name = name;
+		this.buffer = buffer;
+		this.maxReaders = info.maxReaders;
+	}
+
+	/**
+	 * Pid of process holding write lock, or 0
+	 * @return {int}
+	 */
+	get owner() {
+		return shm.lockInfo(this.buffer).owner;
+	}
+
+	/**
+	 * Count of processes holding read lock
+	 * @return {int}
+	 */
+	get readers() {
+		return shm.lockInfo(this.buffer).readers;
+	}
+
+	/**
+	 * Acquire read lock, busy lock is waited in threadpool
+	 * @param {number} timeoutMs - default is Infinity
+	 * @return {Promise<string>} 'ok', 'owner-died' or 'timed-out'
+	 */
+	readLock(timeoutMs /*= Infinity*/) {
+		return _lockAsync(this.buffer, LockKind.read, timeoutMs);
+	}
+
+	/**
+	 * Acquire read lock without waiting
+	 * @return {string} 'ok', 'owner-died' or 'busy'
+	 */
+	tryReadLock() {
+		return shm.lock(this.buffer, LockKind.read, 0);
+	}
+
+	/**
+	 * Release read lock, throws if read lock is not held by this process
+	 */
+	readUnlock() {
+		shm.unlock(this.buffer, LockKind.read);
+	}
+
+	/**
+	 * Acquire write lock, busy lock is waited in threadpool
+	 * @param {number} timeoutMs - default is Infinity
+	 * @return {Promise<string>} 'ok', 'owner-died' or 'timed-out'
+	 */
+	writeLock(timeoutMs /*= Infinity*/) {
+		return _lockAsync(this.buffer, LockKind.write, timeoutMs);
+	}
+
+	/**
+	 * Acquire write lock without waiting
+	 * @return {string} 'ok', 'owner-died' or 'busy'
+	 */
+	tryWriteLock() {
+		return shm.lock(this.buffer, LockKind.write, 0);
+	}
+
+	/**
+	 * Release write lock, throws if write lock is not held by this process
+	 */
+	writeUnlock() {
+		shm.unlock(this.buffer, LockKind.write);
+	}
+
+	/**
+	 * Detach reader-writer lock
+	 * @param {bool} forceDestroy - true to unlink POSIX shared memory object
+	 * @return {int} see detachPosix()
+	 */
+	detach(forceDestroy /*= false*/) {
+		this.buffer = null;
+		return detachPosix(this.name, forceDestroy);
+	}
+}
+
+/**
+ * Create reader-writer lock in POSIX shared memory object
+ * @param {string} name - string name of shared memory object, should start with '/'
+ * @param {int} maxReaders - max count of processes holding read lock at once, default is 128
+ * @param {string} permStr - permissions, default is 660
+ * @return {RwLock/null} reader-writer lock, or null if already exists with provided name
+ */
+function createRwLock(name, maxReaders /*= 128*/, permStr /*= '660'*/) {
+	if (maxReaders === undefined)
+		maxReaders = 128;
+	if (!(Number.isSafeInteger(maxReaders) && maxReaders >= 1 && maxReaders <= 0xffff))
+		throw new RangeError('Max count of readers should be 1 .. 65535');
+	const buf = createPosix(name, shm.rwLockSizeOf(maxReaders), 'Buffer', permStr);
+	if (!buf)
+		return null;
+	shm.rwLockInit(buf, maxReaders);
+	return new RwLock(name, buf);
+}
+
+/**
+ * Open reader-writer lock created by createRwLock()
+ * @param {string} name - string name of shared memory object
+ * @return {RwLock/null} reader-writer lock, or null if not exists
+ */
+function openRwLock(name) {
+	const buf = getPosix(name, 'Buffer');
+	if (!buf)
+		return null;
+	const info = shm.lockInfo(buf);
+	if (info === null || info.type !== 'rwlock') {
+		detachPosix(name);
+		throw new Error('Shared memory object ' + name + ' does not contain a reader-writer lock');
+	}
+	return new RwLock(name, buf);
+}
+
+// Uncontended lock is taken in JS thread, only wait for busy lock is queued to threadpool
+function _lockAsync(buffer, kind, timeoutMs) {
+	if (timeoutMs === undefined || timeoutMs === null || isNaN(timeoutMs))
+		timeoutMs = Infinity;
+	let res;
+	try {
+		res = shm.lock(buffer, kind, 0);
+	} catch (err) {
+		return Promise.reject(err);
+	}
+	if (res !== 'busy' || !(+timeoutMs > 0))
+		return Promise.resolve(res);
+	return new Promise(function (resolve, reject) {
+		shm.lock(buffer, kind, +timeoutMs, function (err, res) {
+			if (err)
+				reject(err);
+			else
+				resolve(res);
+		});
+	});
+}
+
+// Args of shm.get() to create System V segment, key can be null to autogenerate
+function _createArgs(count, typeKey, key, permStr, options) {
+	if (typeKey === undefined)
+		typeKey = 'Buffer';
+	if (key === undefined)
+		key = null;
+	if (BufferType[typeKey] === undefined)
+		throw new Error("Unknown type key " + typeKey);
+	if (key !== null) {
+		if (!(Number.isSafeInteger(key) && key >= keyMin && key <= keyMax))
+			throw new RangeError('Shm key should be ' + keyMin + ' .. ' + keyMax);
+	}
+	if (permStr === undefined || isNaN( Number.parseInt(permStr, 8)))
+		permStr = '660';
+	const perm = Number.parseInt(permStr, 8);
+	const hugePages = _getHugePages(options);
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	const numa = _getNuma(options);
+
+	var type = BufferType[typeKey];
+	//var size1 = BufferTypeSizeof[typeKey];
+	//var size = size1 * count;
+	_checkCount(count, typeKey, chunkLength);
+	return [key, count, shm.IPC_CREAT|shm.IPC_EXCL|perm, 0, type, hugePages, chunkLength, autoDetach, numa[0], numa[1]];
+}
+
+// Args of shm.getPosix() to create POSIX object
+function _createPosixArgs(name, count, typeKey, permStr, options) {
+	if (typeKey === undefined)
+		typeKey = 'Buffer';
+	if (BufferType[typeKey] === undefined)
+		throw new Error("Unknown type key " + typeKey);
+	if (permStr === undefined || isNaN( Number.parseInt(permStr, 8)))
+		permStr = '660';
+	const perm = Number.parseInt(permStr, 8);
+	const hugePages = _getHugePages(options);
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	const numa = _getNuma(options);
+
+	const type = BufferType[typeKey];
+	//var size1 = BufferTypeSizeof[typeKey];
+	//var size = size1 * count;
+	_checkCount(count, typeKey, chunkLength);
+	const oflag = shm.O_CREAT | shm.O_RDWR | shm.O_EXCL;
+	const mmap_flags = shm.MAP_SHARED;
+	return [name, count, oflag, perm, mmap_flags, type, hugePages, chunkLength, autoDetach, numa[0], numa[1]];
+}
+
+// Args of shm.get() to get System V segment
+function _getArgs(key, typeKey, options) {
+	if (typeKey === undefined)
+		typeKey = 'Buffer';
+	if (BufferType[typeKey] === undefined)
+		throw new Error("Unknown type key " + typeKey);
+	var type = BufferType[typeKey];
+	if (!(Number.isSafeInteger(key) && key >= keyMin && key <= keyMax))
+		throw new RangeError('Shm key should be ' + keyMin + ' .. ' + keyMax);
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	return [key, 0, 0, 0, type, shm.SHMHP_NONE, chunkLength, autoDetach, shm.SHMNUMA_DEFAULT, null];
+}
+
+// Args of shm.getPosix() to get POSIX object
+function _getPosixArgs(name, typeKey, options) {
+	const type = _getPosixType(typeKey);
+	const oflag = shm.O_RDWR;
+	const mmap_flags = shm.MAP_SHARED;
+	const chunkLength = _getChunkLength(options);
+	const autoDetach = _getAutoDetach(options);
+	return [name, 0, oflag, 0, mmap_flags, type, shm.SHMHP_NONE, chunkLength, autoDetach, shm.SHMNUMA_DEFAULT, null];
+}
+
+// Type of views of POSIX object, by default type stored in header of object
+function _getPosixType(typeKey) {
+	if (typeKey === undefined)
+		return shm.SHMBT_STORED;
+	if (BufferType[typeKey] === undefined)
+		throw new Error("Unknown type key " + typeKey);
+	return BufferType[typeKey];
+}
+
+function _withKey(res, key) {
+	if (res) {
+		res.key = key;
+	}
+	return res;
+}
+
+// Views of memfd have property fd, keep it on ChunkedArray
+function _wrapAnonymous(res, chunkLength) {
+	const wrapped = _wrapChunks(res, chunkLength);
+	wrapped.fd = res.fd;
+	return wrapped;
+}
+
+// fd from number or object returned by createAnonymous()/getAnonymous()
+function _getFd(fd) {
+	if (fd !== null && typeof fd === 'object')
+		fd = fd.fd;
+	if (!(Number.isSafeInteger(fd) && fd >= 0))
+		throw new TypeError('File descriptor should be integer >= 0');
+	return fd;
+}
+
+// fd of Unix domain socket from number or net.Socket
+function _socketFd(socket) {
+	if (socket !== null && typeof socket === 'object')
+		socket = socket._handle ? socket._handle.fd : undefined;
+	if (!(Number.isSafeInteger(socket) && socket >= 0))
+		throw new TypeError('Socket should be fd or net.Socket of Unix domain socket');
+	return socket;
+}
+
+function _sealNames(flags) {
+	return Object.keys(Seals).filter((name) => flags & Seals[name]);
+}
+
+// Call native method with callback as last arg
+// Args of shm.flush()/shm.fileMarkDirty() for every part of range: [view, byteOffset, byteLength]
+function _fileRangeParts(array, start, end) {
+	if (!(array instanceof ChunkedArray || ArrayBuffer.isView(array)))
+		throw new TypeError('Argument array must be a Buffer, TypedArray or ChunkedArray');
+	if (start === undefined)
+		start = 0;
+	if (end === undefined)
+		end = array.length;
+	if (!(start >= 0 && start <= end && end <= array.length))
+		throw new RangeError('Range is out of bounds');
+	return _opsParts(array, start, end).map((part) => {
+		const size = part[0].BYTES_PER_ELEMENT;
+		return [part[0], part[1] * size, (part[2] - part[1]) * size];
+	});
+}
+
+function _listEntry(entry) {
+	return Object.assign(entry, {
+		type: SegmentTypes[entry.type],
+		createdAt: entry.createdAt === null ? null : new Date(entry.createdAt),
+		activeAt: entry.activeAt === null ? null : new Date(entry.activeAt),
+	});
+}
+
+// Escape label value for Prometheus text format
+function _prometheusLabel(value) {
+	return value.replace(/[\\"\n]/g, (c) => c === '\n' ? '\\n' : '\\' + c);
+}
+
+function _callAsync(fn, args) {
+	return new Promise(function (resolve, reject) {
+		fn.apply(shm, args.concat(function (err, res) {
+			if (err)
+				reject(err);
+			else
+				resolve(res);
+		}));
+	});
+}
+
+function _checkCount(count, typeKey, chunkLength) {
+	const countMax = chunkLength ? Math.floor(Number.MAX_SAFE_INTEGER / BufferTypeSizeof[typeKey]) : lengthMax;
+	if (!(Number.isSafeInteger(count) && count >= lengthMin && count <= countMax))
+		throw new RangeError('Count should be ' + lengthMin + ' .. ' + countMax);
+}
+
+function _wrapChunks(res, chunkLength) {
+	return res && chunkLength ? new ChunkedArray(res, chunkLength) : res;
+}
+
 function _keyGen() {
 	return keyMin + Math.floor(Math.random() * keyMax);
 }
@@ -231,7 +2137,69 @@ module.exports.detach = detach;
 module.exports.detachPosix = detachPosix;
 module.exports.destroy = destroy;
 module.exports.detachAll = detachAll;
+module.exports.resize = resize;
+module.exports.refresh = refresh;
+module.exports.objectInfo = objectInfo;
+module.exports.mapWindow = mapWindow;
+module.exports.unmapWindow = unmapWindow;
+module.exports.discardWindow = discardWindow;
+module.exports.windows = windows;
+module.exports.createAnonymous = createAnonymous;
+module.exports.getAnonymous = getAnonymous;
+module.exports.detachAnonymous = detachAnonymous;
+module.exports.seal = seal;
+module.exports.getSeals = getSeals;
+module.exports.sendFd = sendFd;
+module.exports.recvFd = recvFd;
+module.exports.createFile = createFile;
+module.exports.openFile = openFile;
+module.exports.closeFile = closeFile;
+module.exports.flush = flush;
+module.exports.markDirty = markDirty;
+module.exports.checkpoint = checkpoint;
+module.exports.createAsync = createAsync;
+module.exports.getAsync = getAsync;
+module.exports.detachAsync = detachAsync;
+module.exports.destroyAsync = destroyAsync;
+module.exports.pageInfo = pageInfo;
+module.exports.numaInfo = numaInfo;
+module.exports.stats = stats;
+module.exports.counters = counters;
+module.exports.prometheus = prometheus;
+module.exports.list = list;
+module.exports.reap = reap;
+module.exports.heartbeat = heartbeat;
+module.exports.prefault = prefault;
+module.exports.wait = wait;
+module.exports.notify = notify;
+module.exports.ops = ops;
+module.exports.copyIn = copyIn;
+module.exports.copyOut = copyOut;
+module.exports.copyInAsync = copyInAsync;
+module.exports.copyOutAsync = copyOutAsync;
+module.exports.createQueue = createQueue;
+module.exports.openQueue = openQueue;
+module.exports.Queue = Queue;
+module.exports.createSlab = createSlab;
+module.exports.openSlab = openSlab;
+module.exports.Slab = Slab;
+module.exports.createHashTable = createHashTable;
+module.exports.openHashTable = openHashTable;
+module.exports.HashTable = HashTable;
+module.exports.createSeqlock = createSeqlock;
+module.exports.openSeqlock = openSeqlock;
+module.exports.Seqlock = Seqlock;
+module.exports.createMutex = createMutex;
+module.exports.openMutex = openMutex;
+module.exports.Mutex = Mutex;
+module.exports.createRwLock = createRwLock;
+module.exports.openRwLock = openRwLock;
+module.exports.RwLock = RwLock;
+module.exports.ChunkedArray = ChunkedArray;
 module.exports.getTotalSize = shm.getTotalUsedSize;
 module.exports.getTotalCreatedSize = shm.getTotalAllocatedSize;
 module.exports.BufferType = BufferType;
+module.exports.HugePages = HugePages;
+module.exports.NumaPolicy = NumaPolicy;
+module.exports.Seals = Seals;
 module.exports.LengthMax = lengthMax;
@@ -1,14 +1,42 @@
 #include "node_shm.h"
 #include "node.h"
 
+#include <dirent.h>
+#include <signal.h>
+#include <stdio.h>
+#include <uv.h>
+#include <atomic>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <set>
+
 //-------------------------------
 
 #if NODE_MODULE_VERSION > NODE_16_0_MODULE_VERSION
 namespace {
 void emptyBackingStoreDeleter(void*, size_t, void*) {}
+
+// Callback to call when backing store of typed array is freed
+struct BackingStoreCallback {
+	node::Buffer::FreeCallback callback;
+	void* hint;
+};
+
+// Can be called from any thread
+void callbackBackingStoreDeleter(void* data, size_t, void* deleterData) {
+	BackingStoreCallback* cb = static_cast<BackingStoreCallback*>(deleterData);
+	cb->callback(static_cast<char*>(data), cb->hint);
+	delete cb;
+}
 }
 #endif
 
+namespace {
+// Chunks of memory are not freed by GC, like typed arrays
+void emptyFreeCallback(char*, void*) {}
+}
+
 namespace node {
 namespace Buffer {
 
@@ -32,6 +60,13 @@ namespace Buffer {
 	using v8::Uint32Array;
 	using v8::Float32Array;
 	using v8::Float64Array;
+	#if SHM_HAS_BIGINT64_ARRAY
+	using v8::BigInt64Array;
+	using v8::BigUint64Array;
+	#endif
+	#if SHM_HAS_FLOAT16_ARRAY
+	using v8::Float16Array;
+	#endif
 
 
 	MaybeLocal<Object> NewTyped(
@@ -59,8 +94,14 @@ namespace Buffer {
 		*/
 
 		#if NODE_MODULE_VERSION > NODE_16_0_MODULE_VERSION
-		Local<ArrayBuffer> ab = ArrayBuffer::New(isolate,
-			ArrayBuffer::NewBackingStore(data, length, &emptyBackingStoreDeleter, nullptr));
+		std::unique_ptr<BackingStore> bs;
+		if (callback == NULL || callback == emptyFreeCallback) {
+			bs = ArrayBuffer::NewBackingStore(data, length, &emptyBackingStoreDeleter, nullptr);
+		} else {
+			bs = ArrayBuffer::NewBackingStore(data, length, &callbackBackingStoreDeleter,
+				new BackingStoreCallback{callback, hint});
+		}
+		Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(bs));
 		#else
 		Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, data, length,
 			ArrayBufferCreationMode::kExternalized);
@@ -92,6 +133,19 @@ namespace Buffer {
 			case SHMBT_FLOAT32:
 				ui = Float32Array::New(ab, 0, count);
 			break;
+			#if SHM_HAS_BIGINT64_ARRAY
+			case SHMBT_BIGINT64:
+				ui = BigInt64Array::New(ab, 0, count);
+			break;
+			case SHMBT_BIGUINT64:
+				ui = BigUint64Array::New(ab, 0, count);
+			break;
+			#endif
+			#if SHM_HAS_FLOAT16_ARRAY
+			case SHMBT_FLOAT16:
+				ui = Float16Array::New(ab, 0, count);
+			break;
+			#endif
 			default:
 			case SHMBT_FLOAT64:
 				ui = Float64Array::New(ab, 0, count);
@@ -143,6 +197,33 @@ namespace Nan {
 
 	}
 
+	inline MaybeLocal<v8::Array> NewTypedBufferChunks(
+		char *data
+		, size_t count
+		, size_t chunkLength
+	#if NODE_MODULE_VERSION > IOJS_2_0_MODULE_VERSION
+		, node::Buffer::FreeCallback callback
+	#else
+		, node::smalloc::FreeCallback callback
+	#endif
+		, void *hint
+		, ShmBufferType type
+	) {
+		Nan::EscapableHandleScope scope;
+		size_t size1 = getSizeForShmBufferType(type);
+		size_t chunksCnt = (count + chunkLength - 1) / chunkLength;
+		v8::Local<v8::Array> chunks = Nan::New<v8::Array>(chunksCnt);
+		for (size_t i = 0; i < chunksCnt; i++) {
+			size_t chunkCount = std::min(chunkLength, count - i * chunkLength);
+			MaybeLocal<Object> chunk = NewTypedBuffer(
+				data + i * chunkLength * size1, chunkCount, callback, hint, type);
+			if (chunk.IsEmpty())
+				return MaybeLocal<v8::Array>();
+			Nan::Set(chunks, i, chunk.ToLocalChecked());
+		}
+		return scope.Escape(chunks);
+	}
+
 }
 
 //-------------------------------
@@ -151,6 +232,7 @@ namespace node {
 namespace node_shm {
 
 	using node::AtExit;
+	using v8::Function;
 	using v8::Local;
 	using v8::Number;
 	using v8::Object;
@@ -161,6 +243,8 @@ namespace node_shm {
 		SHM_DELETED = -1,
 		SHM_TYPE_SYSTEMV = 0,
 		SHM_TYPE_POSIX = 1,
+		SHM_TYPE_MEMFD = 2, // id is fd of memfd, owned by attach
+		SHM_TYPE_FILE = 3, // name is absolute path of regular file
 	};
 
 	struct ShmMeta {
@@ -170,73 +254,394 @@ namespace node_shm {
 		size_t memSize;
 		std::string name;
 		bool isOwner;
+		std::string hugetlbPath; // path of POSIX object created in hugetlbfs instead of shm_open()
+		std::string indexKey; // key in shmMetaIndex, empty for free slot
+		size_t prevInd; // previous attach of same segment/object in this process
+		uintptr_t generation; // incremented on every reuse of slot
+		size_t posixHeader; // size word of POSIX object seen at last map, see POSIX_HEADER_SIZE_MASK
+		size_t dataOffset; // offset of data in POSIX object
+		std::vector<uint64_t> dirtyBlocks; // bitmap of blocks of file changed since last checkpoint
+		struct ShmEnv* env; // environment which made attach
 	};
 
 	#define NOT_FOUND_IND ULONG_MAX
 	#define NO_SHMID INT_MIN
+	// Handle passed as hint to FreeCallback: index in meta array + generation of slot
+	#define META_HANDLE_IND_BITS (sizeof(uintptr_t) * 4)
+	#define META_HANDLE_IND_MASK ((((uintptr_t) 1) << META_HANDLE_IND_BITS) - 1)
+	// Size word in header of POSIX object: size of data in low bits,
+	//  and generation incremented on every resize in high bits (64-bit only)
+	#define POSIX_HEADER_GEN_BITS (sizeof(size_t) >= 8 ? 16 : 0)
+	#define POSIX_HEADER_SIZE_MASK (SIZE_MAX >> POSIX_HEADER_GEN_BITS)
+	// Low 48 bits are larger than any real size, so header can't be confused with legacy size word
+	#define POSIX_HEADER_MAGIC 0x3156c541544d4853ULL // "SHMTA\xc5V1"
+	#define POSIX_LAYOUT_VERSION 1
+	#define POSIX_DATA_ALIGN 64
+	// Granularity of dirty tracking of file-backed memory, checkpoint writes whole blocks
+	#define SHM_FILE_DIRTY_BLOCK (1 << 20)
+
+	// Header at start of POSIX object, data starts at next cache line
+	// Objects created by older versions have only size word (size_t) before data
+	struct alignas(POSIX_DATA_ALIGN) ShmPosixHeader {
+		uint64_t magic;
+		uint32_t layoutVersion;
+		int32_t type; // ShmBufferType used on creation
+		std::atomic<size_t> sizeGen; // size of data in bytes and resize generation
+		uint64_t count; // count of elements of type
+		int64_t createdAt; // ms since epoch
+		uint32_t dataOffset;
+		int32_t creatorPid; // 0 for objects created by older versions
+		std::atomic<int32_t> leasePid; // owner of lease, 0 if object has no lease
+		std::atomic<uint32_t> leaseNs; // low bits of PID namespace inode of lease owner, 0 if unknown
+		std::atomic<int64_t> heartbeatAt; // last heartbeat of lease owner, ms since epoch
+	};
+	static_assert(sizeof(ShmPosixHeader) == POSIX_DATA_ALIGN, "Header of POSIX object should take one cache line");
+	#define POSIX_LEGACY_DATA_OFFSET sizeof(size_t)
+	// Directory of POSIX objects, scanned by list() and reap()
+	#define POSIX_SHM_DIR "/dev/shm"
+	// Max error of start time of process compared with time of activity of owner of segment/object
+	#define PROCESS_START_SLACK_MS 2000
+
+	// Get size word of POSIX object
+	static inline std::atomic<size_t>* getPosixSizeWord(void* memAddr, size_t dataOffset) {
+		if (dataOffset == POSIX_LEGACY_DATA_OFFSET)
+			return reinterpret_cast<std::atomic<size_t>*>(memAddr);
+		return &reinterpret_cast<ShmPosixHeader*>(memAddr)->sizeGen;
+	}
+
+	// Get header of POSIX object, or NULL for object in legacy layout
+	static inline ShmPosixHeader* getPosixHeader(void* memAddr, size_t dataOffset) {
+		if (dataOffset == POSIX_LEGACY_DATA_OFFSET)
+			return NULL;
+		return reinterpret_cast<ShmPosixHeader*>(memAddr);
+	}
+
+	// Resolve requested type of views of POSIX object with stored type
+	// Typed arrays of other element type are not allowed, Buffer (raw bytes) is allowed for any object
+	static inline bool resolvePosixType(ShmBufferType& type, ShmBufferType storedType) {
+		if (type == SHMBT_STORED) {
+			type = storedType;
+			return true;
+		}
+		return type == SHMBT_BUFFER || storedType == SHMBT_BUFFER || type == storedType;
+	}
+
+	// State of Node.js environment (main thread or worker thread) which loaded addon
+	// Attaches are owned by environment which made them, and detached on its exit
+	struct ShmEnv {
+		// Handles of attaches to detach on thread of environment,
+		//  because backing stores of typed arrays can be freed on any thread
+		std::mutex releasedMutex;
+		std::vector<void*> releasedHandles;
+		uv_async_t* releasedAsync; // NULL after exit of environment
+	};
+
+	// Environment of current thread, set on load of addon
+	thread_local std::shared_ptr<ShmEnv> shmCurrentEnv;
+	// All environments which loaded addon
+	std::vector<ShmEnv*> shmEnvs;
+
+	// Guards meta array, index, counters of sizes and list of environments,
+	//  because they are shared by all environments
+	// Recursive, because FreeCallback can be called by GC inside of method
+	std::recursive_mutex shmMetaMutex;
 
 	// Array to keep info about created segments, call it "meta array"
+	// Index in array is stable while segment is attached, slots are reused after detach
 	std::vector<ShmMeta> shmMeta;
+	std::vector<size_t> shmMetaFreeSlots;
+	// Index of meta array by (type, id/name, environment) -> last attach
+	std::unordered_map<std::string, size_t> shmMetaIndex;
 	size_t shmAllocatedBytes = 0;
+	// Size of segments/objects created by this process by key of segment, until destroyed
+	// Creator can be detached before segment is destroyed by other attach or by name
+	std::unordered_map<std::string, size_t> shmCreatedBytes;
+
+	// Shared by all views (buffer, typed array or chunks) of attach with autoDetach,
+	//  attach is detached after last view is collected by GC
+	struct ShmViewsRef {
+		std::atomic<size_t> refs;
+		void* handle; // handle of meta, see getShmSegmentHandle()
+		std::shared_ptr<ShmEnv> env; // environment of views, it detaches attach
+	};
+
 	size_t shmMappedBytes = 0;
 
+	// Mapping of System V segment or POSIX object (or file), shared by attaches of all environments
+	// Attach of segment/object already mapped by this process takes reference to mapping instead of
+	//  shmat()/mmap(), so pages are mapped and faulted in once per process, not once per worker thread
+	// Every mapping of attach is in table, but only reusable ones are in cache,
+	//  memfd and mappings with NUMA policy or MAP_PRIVATE are not
+	struct ShmMapping {
+		size_t memSize;
+		size_t refs; // attaches and pins
+		size_t pins; // references of async work, see pinShmMapping()
+		std::string cacheKey; // key in shmMappingsCache, empty if mapping is not reusable or was replaced by newer one
+		std::string segmentKey; // key of segment/object, see getShmSegmentKey()
+		ShmType type; // System V mapping is unmapped by shmdt()
+		dev_t dev; // file of POSIX object, to check that name still refers to same object
+		ino_t ino; // or id of System V segment
+	};
+
+	// Mappings are used in threadpool too, lock is held only inside of functions working with table
+	std::mutex shmMappingsMutex;
+	std::map<void*, ShmMapping> shmMappings; // by address, ordered to find mapping containing range
+	std::unordered_map<std::string, void*> shmMappingsCache; // by key of segment and map flags -> newest mapping
+
 	// Declare private methods
-	static int detachAllShm();
+	static int detachAllShm(ShmEnv* env);
 	static int detachShmSegmentOrObject(ShmMeta& meta, bool force = false, bool onExit = false);
 	static int detachShmSegment(ShmMeta& meta, bool force = false, bool onExit = false);
 	static int detachPosixShmObject(ShmMeta& meta, bool force = false, bool onExit = false);
+	static int detachMemfdObject(ShmMeta& meta, bool onExit = false);
 	static size_t addShmSegmentInfo(ShmMeta& meta);
 	static bool removeShmSegmentInfo(size_t ind);
 
 	static void FreeCallback(char* data, void* hint);
-	#if NODE_MODULE_VERSION < NODE_16_0_MODULE_VERSION
+	static void ReleaseViewCallback(char* data, void* hint);
+	static void processReleasedViews();
 	static void Init(Local<Object> target);
-	#else
-	static void Init(Local<Object> target, Local<Value> module, void* priv);
+	static void AtNodeExit(void* arg);
+
+	static size_t getDefaultHugePageSize();
+	static size_t getHugePageSize(ShmHugePages hugePages);
+	static std::vector<std::pair<std::string, size_t>> getHugetlbfsMounts();
+	static int openHugetlbfsObject(const std::string& name, int oflag, mode_t mode, size_t hugePageSize, std::string& path);
+	static void* createHugetlbfsObject(const std::string& name, int oflag, mode_t mode, int mmap_flags,
+		size_t hugePageSize, size_t& realSize, std::string& path);
+
+	static inline size_t roundUpToPageSize(size_t size, size_t pageSize) {
+		return (size + pageSize - 1) / pageSize * pageSize;
+	}
+
+	// Parse size like "2048 kB" (/proc/meminfo) or "2M" (hugetlbfs mount option)
+	static size_t parseMemSize(const char* str) {
+		char* end;
+		size_t size = strtoull(str, &end, 10);
+		while (*end == ' ')
+			end++;
+		switch(*end) {
+			case 'k': case 'K': return size << 10;
+			case 'm': case 'M': return size << 20;
+			case 'g': case 'G': return size << 30;
+			default: return size;
+		}
+	}
+
+	// Get default size of huge page, 0 if huge pages are not supported
+	static size_t getDefaultHugePageSize() {
+		size_t size = 0;
+	#ifdef __linux__
+		FILE* f = fopen("/proc/meminfo", "r");
+		if (f == NULL)
+			return 0;
+		char line[256];
+		while (fgets(line, sizeof(line), f)) {
+			if (strncmp(line, "Hugepagesize:", 13) == 0) {
+				size = parseMemSize(line + 13);
+				break;
+			}
+		}
+		fclose(f);
+	#endif
+		return size;
+	}
+
+	// Get size of huge page to use, 0 for SHMHP_NONE or if not supported
+	static size_t getHugePageSize(ShmHugePages hugePages) {
+		switch(hugePages) {
+			case SHMHP_2MB:
+				return 2 << 20;
+			case SHMHP_1GB:
+				return 1 << 30;
+			case SHMHP_AUTO:
+				return getDefaultHugePageSize();
+			default:
+				return 0;
+		}
+	}
+
+	// Get mount points of hugetlbfs and their page sizes
+	static std::vector<std::pair<std::string, size_t>> getHugetlbfsMounts() {
+		std::vector<std::pair<std::string, size_t>> mounts;
+	#ifdef __linux__
+		FILE* f = fopen("/proc/mounts", "r");
+		if (f == NULL)
+			return mounts;
+		char line[4096], dir[4096], fstype[256], opts[2048];
+		while (fgets(line, sizeof(line), f)) {
+			if (sscanf(line, "%*s %4095s %255s %2047s", dir, fstype, opts) != 3
+				|| strcmp(fstype, "hugetlbfs") != 0)
+				continue;
+			const char* pagesizeOpt = strstr(opts, "pagesize=");
+			size_t pageSize = pagesizeOpt ? parseMemSize(pagesizeOpt + 9) : getDefaultHugePageSize();
+			mounts.push_back(std::make_pair(std::string(dir), pageSize));
+		}
+		fclose(f);
 	#endif
-	static void AtNodeExit(void*);
+		return mounts;
+	}
+
+	// Open file with POSIX object name in hugetlbfs mount with given page size (or any if 0)
+	// Returns fd or -1 (see errno, ENOSYS if there is no such hugetlbfs mount)
+	static int openHugetlbfsObject(const std::string& name, int oflag, mode_t mode, size_t hugePageSize, std::string& path) {
+		int fd = -1;
+		errno = ENOSYS;
+		for (const auto& mount : getHugetlbfsMounts()) {
+			if (hugePageSize != 0 && mount.second != hugePageSize)
+				continue;
+			path = mount.first + (name[0] == '/' ? "" : "/") + name;
+			fd = open(path.c_str(), oflag, mode);
+			if (fd != -1 || errno != ENOENT)
+				break;
+		}
+		if (fd == -1)
+			path.clear();
+		return fd;
+	}
+
+	// Create POSIX object as file in hugetlbfs mount and map it
+	// realSize is rounded up to huge page size
+	// Returns address or MAP_FAILED (see errno), file is removed on failure
+	static void* createHugetlbfsObject(const std::string& name, int oflag, mode_t mode, int mmap_flags,
+		size_t hugePageSize, size_t& realSize, std::string& path) {
+		int fd = openHugetlbfsObject(name, oflag, mode, hugePageSize, path);
+		if (fd == -1)
+			return MAP_FAILED;
+		size_t hugeRealSize = roundUpToPageSize(realSize, hugePageSize);
+		void* res = MAP_FAILED;
+		if (ftruncate(fd, hugeRealSize) == 0) {
+			res = mmap(NULL, hugeRealSize, PROT_READ | PROT_WRITE, mmap_flags, fd, 0);
+		}
+		int err = errno;
+		close(fd);
+		if (res == MAP_FAILED) {
+			unlink(path.c_str());
+			path.clear();
+			errno = err;
+		} else {
+			realSize = hugeRealSize;
+		}
+		return res;
+	}
 
 
-	// Detach all System V segments and POSIX objects (don't force destroy)
+	// Detach all System V segments and POSIX objects of environment (don't force destroy)
 	// Returns count of destroyed System V segments
-	static int detachAllShm() {
+	static int detachAllShm(ShmEnv* env) {
 		int res = 0;
-		if (shmMeta.size() > 0) {
-			for (std::vector<ShmMeta>::iterator it = shmMeta.begin(); it != shmMeta.end(); ++it) {
-				if (detachShmSegmentOrObject(*it, false, true) == 0)
-					res++;
-			}
+		for (size_t ind = 0; ind < shmMeta.size(); ind++) {
+			if (shmMeta[ind].indexKey.empty() || shmMeta[ind].env != env)
+				continue;
+			if (detachShmSegmentOrObject(shmMeta[ind], false, true) == 0)
+				res++;
+			if (shmMeta[ind].memAddr == NULL)
+				removeShmSegmentInfo(ind);
 		}
 		return res;
 	}
 
-	// Add meta to array
+	// Key of segment/object
+	static std::string getShmSegmentKey(const ShmMeta& meta) {
+		if (meta.type == SHM_TYPE_SYSTEMV)
+			return "sysv:" + std::to_string(meta.id);
+		else if (meta.type == SHM_TYPE_MEMFD)
+			return "memfd:" + std::to_string(meta.id);
+		else if (meta.type == SHM_TYPE_FILE)
+			return "file:" + meta.name;
+		else
+			return "posix:" + meta.name;
+	}
+
+	// Key in index of meta array, attaches of every environment are separate
+	static std::string getShmIndexKey(const std::string& segmentKey, const ShmEnv* env) {
+		return segmentKey + "@" + std::to_string(reinterpret_cast<uintptr_t>(env));
+	}
+
+	static std::string getShmIndexKey(const ShmMeta& meta, const ShmEnv* env) {
+		return getShmIndexKey(getShmSegmentKey(meta), env);
+	}
+
+	// Add meta to array, reusing free slot
+	// Every attach has own slot, index points to last attach of segment/object in environment of attach
 	static size_t addShmSegmentInfo(ShmMeta& meta) {
-		shmMeta.push_back(meta);
-		size_t ind = shmMeta.size() - 1;
+		size_t ind;
+		uintptr_t generation = 0;
+		if (!shmMetaFreeSlots.empty()) {
+			ind = shmMetaFreeSlots.back();
+			shmMetaFreeSlots.pop_back();
+			generation = shmMeta[ind].generation;
+			shmMeta[ind] = meta;
+		} else {
+			ind = shmMeta.size();
+			shmMeta.push_back(meta);
+		}
+		ShmMeta& added = shmMeta[ind];
+		added.generation = generation;
+		added.indexKey = getShmIndexKey(meta, meta.env);
+		const auto found = shmMetaIndex.find(added.indexKey);
+		if (found != shmMetaIndex.end()) {
+			added.prevInd = found->second;
+			found->second = ind;
+		} else {
+			added.prevInd = NOT_FOUND_IND;
+			shmMetaIndex.emplace(added.indexKey, ind);
+		}
 		return ind;
 	}
 
-	// Find in mera array
+	// Find last attach in meta array made by current environment
 	static size_t findShmSegmentInfo(ShmMeta& search) {
-		const auto found = std::find_if(shmMeta.begin(), shmMeta.end(),
-			[&](const auto& el) {
-				return el.type == search.type 
-					&& (search.id == NO_SHMID || el.id == search.id) 
-					&& (search.name.length() == 0 || search.name.compare(el.name) == 0);
-			}
-		);
-		size_t ind = found != shmMeta.end() ? std::distance(shmMeta.begin(), found) : NOT_FOUND_IND;
+		const auto found = shmMetaIndex.find(getShmIndexKey(search, shmCurrentEnv.get()));
+		size_t ind = found != shmMetaIndex.end() ? found->second : NOT_FOUND_IND;
 		return ind;
 	}
 
-	// Remove from meta array
+	// Remove from meta array, slot will be reused
 	static bool removeShmSegmentInfo(size_t ind) {
-		// TODO:
-		// Remove meta data from vector with .erase()
-		// But this requires to have key pairs `meta id` <-> `index in vector`
-		// And pass `meta id` to `hint` in `NewTypedBuffer()` (for `FreeCallback`)
-		return false;
+		if (ind >= shmMeta.size() || shmMeta[ind].indexKey.empty())
+			return false;
+		ShmMeta& meta = shmMeta[ind];
+		const auto found = shmMetaIndex.find(meta.indexKey);
+		if (found != shmMetaIndex.end()) {
+			if (found->second == ind) {
+				if (meta.prevInd != NOT_FOUND_IND)
+					found->second = meta.prevInd;
+				else
+					shmMetaIndex.erase(found);
+			} else {
+				// Unlink from list of attaches
+				size_t next = found->second;
+				while (next != NOT_FOUND_IND && shmMeta[next].prevInd != ind)
+					next = shmMeta[next].prevInd;
+				if (next != NOT_FOUND_IND)
+					shmMeta[next].prevInd = meta.prevInd;
+			}
+		}
+		uintptr_t generation = meta.generation + 1;
+		meta = ShmMeta();
+		meta.type = SHM_DELETED;
+		meta.prevInd = NOT_FOUND_IND;
+		meta.generation = generation;
+		shmMetaFreeSlots.push_back(ind);
+		return true;
+	}
+
+	// Get handle of meta to pass as hint to FreeCallback
+	static inline void* getShmSegmentHandle(size_t ind) {
+		uintptr_t generation = shmMeta[ind].generation;
+		return reinterpret_cast<void*>((generation << META_HANDLE_IND_BITS) | (ind & META_HANDLE_IND_MASK));
+	}
+
+	// Get index in meta array by handle, or NOT_FOUND_IND if slot was reused
+	static inline size_t findShmSegmentInfoByHandle(void* handle) {
+		uintptr_t h = reinterpret_cast<uintptr_t>(handle);
+		size_t ind = h & META_HANDLE_IND_MASK;
+		uintptr_t generation = h >> META_HANDLE_IND_BITS;
+		if (ind >= shmMeta.size() || shmMeta[ind].indexKey.empty()
+			|| (shmMeta[ind].generation & (UINTPTR_MAX >> META_HANDLE_IND_BITS)) != generation)
+			return NOT_FOUND_IND;
+		return ind;
 	}
 
 	// Detach System V segment or POSIX object
@@ -244,424 +649,2596 @@ namespace node_shm {
 	static int detachShmSegmentOrObject(ShmMeta& meta, bool force, bool onExit) {
 		if (meta.type == SHM_TYPE_SYSTEMV) {
 			return detachShmSegment(meta, force, onExit);
-		} else if (meta.type == SHM_TYPE_POSIX) {
+		} else if (meta.type == SHM_TYPE_POSIX || meta.type == SHM_TYPE_FILE) {
 			return detachPosixShmObject(meta, force, onExit);
+		} else if (meta.type == SHM_TYPE_MEMFD) {
+			return detachMemfdObject(meta, onExit);
 		}
 		return -1;
 	}
 
-	// Detach System V segment
-	// Returns 0 if destroyed, or count of left attaches, or -1 if not exists
-	static int detachShmSegment(ShmMeta& meta, bool force, bool onExit) {
-		int err;
-		struct shmid_ds shminf;
-		//detach
-		bool attached = meta.memAddr != NULL;
-		err = attached ? shmdt(meta.memAddr) : 0;
-		if (err == 0) {
-			if (attached) {
-				shmMappedBytes -= meta.memSize;
-			}
-			meta.memAddr = NULL;
-			if (meta.id == NO_SHMID) {
-				// meta is obsolete, should be deleted from meta array
-				return 0;
-			}
-			//get stat
-			err = shmctl(meta.id, IPC_STAT, &shminf);
-			if (err == 0) {
-				//destroy if there are no more attaches or force==true
-				if (force || shminf.shm_nattch == 0) {
-					err = shmctl(meta.id, IPC_RMID, 0);
-					if (err == 0) {
-						shmAllocatedBytes -= meta.memSize; // shminf.shminf.shm_segsz
-						meta.memSize = 0;
-						meta.id = 0;
-						meta.type = SHM_DELETED;
-						return 0; //detached and destroyed
-					} else {
-						if (!onExit)
-							Nan::ThrowError(strerror(errno));
-					}
-				} else {
-					return shminf.shm_nattch; //detached, but not destroyed
-				}
-			} else {
-				switch(errno) {
-					case EIDRM:   // deleted shmid
-					case EINVAL:  // not valid shmid
-						return -1;
-					break;
-					default:
-						if (!onExit)
-							Nan::ThrowError(strerror(errno));
-					break;
-				}
-
-				if (!onExit)
-					Nan::ThrowError(strerror(errno));
-			}
-		} else {
-			switch(errno) {
-				case EINVAL: // wrong addr
-				default:
-					if (!onExit)
-						Nan::ThrowError(strerror(errno));
-				break;
+	// Update counters after releaseShmSegment()/releasePosixShmObject()
+	// key is key in index of meta before release
+	static void updateReleasedShmCounters(const std::string& key, ShmMeta& meta, bool wasAttached, size_t memSize) {
+		if (wasAttached && meta.memAddr == NULL) {
+			shmMappedBytes -= memSize;
+		}
+		if (meta.type == SHM_DELETED) {
+			const auto found = shmCreatedBytes.find(key);
+			if (found != shmCreatedBytes.end()) {
+				shmAllocatedBytes -= found->second;
+				shmCreatedBytes.erase(found);
 			}
+			meta.memSize = 0;
 		}
-		return -1;
 	}
 
-	// Detach POSIX object
-	// Returns 0 if deleted, 1 if detached, -1 if not exists
-	static int detachPosixShmObject(ShmMeta& meta, bool force, bool onExit) {
-		int err;
-		//detach
-		bool attached = meta.memAddr != NULL;
-		err = attached ? munmap(meta.memAddr, meta.memSize) : 0;
-		if (err == 0) {
-			if (attached) {
-				shmMappedBytes -= meta.memSize;
-			}
-			meta.memAddr = NULL;
-			if (meta.name.empty()) {
-				// meta is obsolete, should be deleted from meta array
-				return 0;
-			}
-			//unlink
-			if (force) {
-				err = shm_unlink(meta.name.c_str());
-				if (err == 0) {
-					shmAllocatedBytes -= meta.memSize;
-					meta.memSize = 0;
-					meta.name.clear();
-					meta.type = SHM_DELETED;
-					return 0; //detached and destroyed
-				} else {
-					switch(errno) {
-						case ENOENT: // not exists
-							return -1;
-						break;
-						default:
-							if (!onExit)
-								Nan::ThrowError(strerror(errno));
-						break;
-					}
-				}
+	// Take reference to reusable mapping of segment/object, if it's mapping of same file (or segment id)
+	//  and covers at least minSize bytes
+	// Returns address (memSize is set to size of mapping) or MAP_FAILED if there is no such mapping
+	static void* acquireMapping(const std::string& cacheKey, dev_t dev, ino_t ino, size_t minSize, size_t& memSize) {
+		if (cacheKey.empty())
+			return MAP_FAILED;
+		std::lock_guard<std::mutex> lock(shmMappingsMutex);
+		const auto found = shmMappingsCache.find(cacheKey);
+		if (found == shmMappingsCache.end())
+			return MAP_FAILED;
+		ShmMapping& mapping = shmMappings[found->second];
+		if (mapping.dev != dev || mapping.ino != ino || mapping.memSize < minSize)
+			return MAP_FAILED;
+		mapping.refs++;
+		memSize = mapping.memSize;
+		addShmCounter(SHMC_MAPPING_REUSES, 1);
+		return found->second;
+	}
+
+	// Add mapping made by attach, with one reference
+	// Reusable one (cacheKey is not empty) replaces older mapping of same segment/object in cache,
+	//  older is left to its attaches
+	static void addMapping(void* addr, size_t memSize, const std::string& cacheKey, const std::string& segmentKey,
+		ShmType type, dev_t dev, ino_t ino) {
+		std::lock_guard<std::mutex> lock(shmMappingsMutex);
+		if (!cacheKey.empty()) {
+			const auto found = shmMappingsCache.find(cacheKey);
+			if (found != shmMappingsCache.end()) {
+				shmMappings[found->second].cacheKey.clear();
+				found->second = addr;
 			} else {
-				return 1; //detached, but not destroyed
-			}
-		} else {
-			switch(errno) {
-				case EINVAL: // wrong addr
-				default:
-					if (!onExit)
-						Nan::ThrowError(strerror(errno));
-				break;
+				shmMappingsCache.emplace(cacheKey, addr);
 			}
 		}
-		return -1;
+		shmMappings[addr] = ShmMapping{ memSize, 1, 0, cacheKey, segmentKey, type, dev, ino };
 	}
 
-	// Used only when creating byte-array (Buffer), not typed array
-	// Because impl of CallbackInfo::New() is not public (see https://github.com/nodejs/node/blob/v6.x/src/node_buffer.cc)
-	// Developer can detach shared memory segments manually by shm.detach()
-	// Also shm.detachAll() will be called on process termination
-	static void FreeCallback(char* data, void* hint) {
-		size_t metaInd = reinterpret_cast<size_t>(hint);
-		ShmMeta meta = shmMeta[metaInd];
-		//void* addr = (void*) data;
-		//assert(meta->memAddr == addr);
-
-		detachShmSegmentOrObject(meta, false, true);
-		removeShmSegmentInfo(metaInd);
+	// Remove reference to mapping, should be called with lock of table
+	// Returns true if memory should be unmapped, false if mapping is still used by other attaches or pins
+	static bool dropMappingRef(std::map<void*, ShmMapping>::iterator found) {
+		if (--found->second.refs > 0)
+			return false;
+		if (!found->second.cacheKey.empty())
+			shmMappingsCache.erase(found->second.cacheKey);
+		shmMappings.erase(found);
+		return true;
 	}
 
-	NAN_METHOD(get) {
-		Nan::HandleScope scope;
-		int err;
-		struct shmid_ds shminf;
-		key_t key = Nan::To<uint32_t>(info[0]).FromJust();
-		size_t count = Nan::To<uint32_t>(info[1]).FromJust();
-		int shmflg = Nan::To<uint32_t>(info[2]).FromJust();
-		int at_shmflg = Nan::To<uint32_t>(info[3]).FromJust();
-		ShmBufferType type = (ShmBufferType) Nan::To<int32_t>(info[4]).FromJust();
-		size_t size = count * getSizeForShmBufferType(type);
-		bool isCreate = (size > 0);
+	// Remove reference to mapping of attach
+	// Returns true if memory should be unmapped (memSize is set to size of mapping),
+	//  false if mapping is still used by other attaches or pins
+	static bool releaseMapping(void* addr, size_t& memSize) {
+		std::lock_guard<std::mutex> lock(shmMappingsMutex);
+		const auto found = shmMappings.find(addr);
+		if (found == shmMappings.end())
+			return true; // not in table
+		memSize = found->second.memSize;
+		return dropMappingRef(found);
+	}
 
-		int shmid = shmget(key, size, shmflg);
-		if (shmid == -1) {
-			switch(errno) {
-				case EEXIST: // already exists
-				case EIDRM:  // scheduled for deletion
-				case ENOENT: // not exists
-					info.GetReturnValue().SetNull();
-					return;
-				case EINVAL: // should be SHMMIN <= size <= SHMMAX
-					return Nan::ThrowRangeError(strerror(errno));
-				default:
-					return Nan::ThrowError(strerror(errno));
-			}
-		} else {
-			if (!isCreate) {
-				err = shmctl(shmid, IPC_STAT, &shminf);
-				if (err == 0) {
-					size = shminf.shm_segsz;
-					count = size / getSizeForShmBufferType(type);
-				} else {
-					return Nan::ThrowError(strerror(errno));
-				}
-			}
+	// Find mapping containing range, should be called with lock of table
+	static std::map<void*, ShmMapping>::iterator findMapping(const char* data, size_t length) {
+		auto found = shmMappings.upper_bound(const_cast<char*>(data));
+		if (found == shmMappings.begin())
+			return shmMappings.end();
+		--found;
+		const char* memAddr = static_cast<const char*>(found->first);
+		if (data + length > memAddr + found->second.memSize)
+			return shmMappings.end();
+		return found;
+	}
 
-			void* res = shmat(shmid, NULL, at_shmflg);
-			if (res == (void *)-1) {
-				return Nan::ThrowError(strerror(errno));
-			}
+	void* pinShmMapping(char* data, size_t length) {
+		std::lock_guard<std::mutex> lock(shmMappingsMutex);
+		const auto found = findMapping(data, length);
+		if (found == shmMappings.end())
+			return NULL;
+		found->second.refs++;
+		found->second.pins++;
+		return found->first;
+	}
 
-			ShmMeta meta = {
-				.type=SHM_TYPE_SYSTEMV, .id=shmid, .memAddr=res, .memSize=size, .name="", .isOwner=isCreate
-			};
-			size_t metaInd = findShmSegmentInfo(meta);
-			if (metaInd == NOT_FOUND_IND) {
-				metaInd = addShmSegmentInfo(meta);
-			}
-			if (isCreate) {
-				shmAllocatedBytes += size;
-				shmMappedBytes += size;
-			} else {
-				shmMappedBytes += size;
-			}
+	void unpinShmMapping(void* addr) {
+		if (addr == NULL)
+			return;
+		ShmMapping mapping;
+		{
+			std::lock_guard<std::mutex> lock(shmMappingsMutex);
+			const auto found = shmMappings.find(addr);
+			if (found == shmMappings.end())
+				return;
+			found->second.pins--;
+			mapping = found->second;
+			if (!dropMappingRef(found))
+				return;
+		}
+		// Attach was detached while mapping was pinned
+		if (mapping.type == SHM_TYPE_SYSTEMV)
+			shmdt(addr);
+		else
+			munmap(addr, mapping.memSize);
+	}
 
-			info.GetReturnValue().Set(Nan::NewTypedBuffer(
-				reinterpret_cast<char*>(res),
-				count,
-				FreeCallback,
-				reinterpret_cast<void*>(static_cast<intptr_t>(metaInd)),
-				type
-			).ToLocalChecked());
+	// Count of attaches of this process to mappings of System V segment minus count of these mappings
+	// shm_nattch counts mapping once (also mapping which is only pinned), this is added to it to get count of attaches
+	static int countSharedMappingAttaches(int shmid) {
+		std::lock_guard<std::mutex> lock(shmMappingsMutex);
+		int res = 0;
+		for (const auto& it : shmMappings) {
+			if (it.second.type == SHM_TYPE_SYSTEMV && it.second.ino == (ino_t) shmid)
+				res += (int) (it.second.refs - it.second.pins) - 1;
 		}
+		return res;
 	}
 
-	NAN_METHOD(getPosix) {
-		Nan::HandleScope scope;
-		if (!info[0]->IsString()) {
-			return Nan::ThrowTypeError("Argument name must be a string");
+	// Detach and optionally destroy System V segment
+	// Doesn't touch meta array, counters and V8, so can be called in threadpool
+	// Returns 0 if destroyed, or count of left attaches (of this process and other processes),
+	//  or -1 if not exists or on error (err is set)
+	static int releaseShmSegment(ShmMeta& meta, bool force, int& err) {
+		ShmCounterTimer timer(SHMC_DETACH_NS);
+		struct shmid_ds shminf;
+		err = 0;
+		//detach, segment stays attached while other attaches of this process use its mapping
+		size_t mapSize = meta.memSize;
+		if (meta.memAddr != NULL) {
+			if (releaseMapping(meta.memAddr, mapSize) && shmdt(meta.memAddr) != 0) {
+				err = errno; // EINVAL: wrong addr
+				return -1;
+			}
+			meta.memAddr = NULL;
+			addShmCounter(SHMC_DETACHES, 1);
 		}
-		std::string name = (*Nan::Utf8String(info[0]));
-		size_t count = Nan::To<uint32_t>(info[1]).FromJust();
-		int oflag = Nan::To<uint32_t>(info[2]).FromJust();
-		mode_t mode = Nan::To<uint32_t>(info[3]).FromJust();
-		int mmap_flags = Nan::To<uint32_t>(info[4]).FromJust();
-		ShmBufferType type = (ShmBufferType) Nan::To<int32_t>(info[5]).FromJust();
-		size_t size = count * getSizeForShmBufferType(type);
-		bool isCreate = (size > 0);
-		size_t realSize = isCreate ? size + sizeof(size) : 0;
-
-		// Create or get shared memory object
-		int fd = shm_open(name.c_str(), oflag, mode);
-		if (fd == -1) {
+		if (meta.id == NO_SHMID) {
+			// meta is obsolete, should be deleted from meta array
+			return 0;
+		}
+		//get stat
+		if (shmctl(meta.id, IPC_STAT, &shminf) != 0) {
 			switch(errno) {
-				case EEXIST: // already exists
-				case ENOENT: // not exists
-					info.GetReturnValue().SetNull();
-					return;
-				case ENAMETOOLONG: // length of name exceeds PATH_MAX
-					return Nan::ThrowRangeError(strerror(errno));
+				case EIDRM:   // deleted shmid
+				case EINVAL:  // not valid shmid
+					return -1;
 				default:
-					return Nan::ThrowError(strerror(errno));
+					err = errno;
+					return -1;
 			}
 		}
-
-		// Truncate
-		int resTrunc;
-		if (isCreate) {
-			resTrunc = ftruncate(fd, realSize);
-			if (resTrunc == -1) {
-				switch(errno) {
-					case EFBIG: // length exceeds max file size
-					case EINVAL: // length exceeds max file size or < 0
-						return Nan::ThrowRangeError(strerror(errno));
-					default:
-						return Nan::ThrowError(strerror(errno));
-				}
-			}
+		//destroy if there are no more attaches or force==true
+		int attaches = shminf.shm_nattch + countSharedMappingAttaches(meta.id);
+		if (!force && attaches > 0) {
+			return attaches; //detached, but not destroyed
 		}
+		if (shmctl(meta.id, IPC_RMID, 0) != 0) {
+			err = errno;
+			return -1;
+		}
+		addShmCounter(SHMC_DESTROYS, 1);
+		meta.id = 0;
+		meta.type = SHM_DELETED;
+		return 0; //detached and destroyed
+	}
 
-		// Get size (not accurate, multiple of PAGE_SIZE = 4096)
-		struct stat sb;
-		int resStat;
-		if (!isCreate) {
-			resStat = fstat(fd, &sb);
-			if (resStat == -1) {
-				switch(errno) {
-					default:
-						return Nan::ThrowError(strerror(errno));
-				}
+	// Detach and optionally unlink POSIX object or file
+	// Doesn't touch meta array, counters and V8, so can be called in threadpool
+	// Returns 0 if deleted, 1 if detached, -1 if not exists or on error (err is set)
+	static int releasePosixShmObject(ShmMeta& meta, bool force, int& err) {
+		ShmCounterTimer timer(SHMC_DETACH_NS);
+		err = 0;
+		//detach, object stays mapped while other attaches of this process use its mapping
+		size_t mapSize = meta.memSize;
+		if (meta.memAddr != NULL) {
+			if (releaseMapping(meta.memAddr, mapSize) && munmap(meta.memAddr, mapSize) != 0) {
+				err = errno; // EINVAL: wrong addr
+				return -1;
 			}
-			realSize = sb.st_size;
+			meta.memAddr = NULL;
+			addShmCounter(SHMC_DETACHES, 1);
 		}
-		
-		// Map shared memory object
-		off_t offset = 0;
-		int prot = PROT_READ | PROT_WRITE;
-		void* res = mmap(NULL, realSize, prot, mmap_flags, fd, offset);
-		if (res == MAP_FAILED) {
-			switch(errno) {
-				// case EBADF: // not valid fd
-				// 	info.GetReturnValue().SetNull();
-				// 	return;
-				case EINVAL: // length is bad, or flags does not comtain MAP_SHARED / MAP_PRIVATE / MAP_SHARED_VALIDATE
-					return Nan::ThrowRangeError(strerror(errno));
-				default:
-					return Nan::ThrowError(strerror(errno));
-			}
+		if (meta.name.empty()) {
+			// meta is obsolete, should be deleted from meta array
+			return 0;
 		}
-
-		// Read/write actual buffer size at start of shared memory
-		size_t* sizePtr = (size_t*) res;
-		char* buf = (char*) res;
-		buf += sizeof(size);
-		if (isCreate) {
-			*sizePtr = size;
-		} else {
-			size = *sizePtr;
-			count = size / getSizeForShmBufferType(type);
+		if (!force) {
+			return 1; //detached, but not destroyed
 		}
+		//unlink
+		int res;
+		if (meta.type == SHM_TYPE_FILE)
+			res = unlink(meta.name.c_str());
+		else
+			res = meta.hugetlbPath.empty() ? shm_unlink(meta.name.c_str()) : unlink(meta.hugetlbPath.c_str());
+		if (res != 0) {
+			if (errno != ENOENT) // not exists
+				err = errno;
+			return -1;
+		}
+		addShmCounter(SHMC_DESTROYS, 1);
+		meta.name.clear();
+		meta.hugetlbPath.clear();
+		meta.type = SHM_DELETED;
+		return 0; //detached and destroyed
+	}
 
-		// Write meta
-		ShmMeta meta = {
-			.type=SHM_TYPE_POSIX, .id=NO_SHMID, .memAddr=res, .memSize=realSize, .name=name, .isOwner=isCreate
-		};
-		size_t metaInd = findShmSegmentInfo(meta);
-		if (metaInd == NOT_FOUND_IND) {
-			metaInd = addShmSegmentInfo(meta);
+	// Unmap memfd and close its fd, memory is freed by kernel after last fd/mapping in all processes
+	// Doesn't touch meta array, counters and V8
+	// Returns 0 if detached, -1 on error (err is set)
+	static int releaseMemfdObject(ShmMeta& meta, int& err) {
+		ShmCounterTimer timer(SHMC_DETACH_NS);
+		err = 0;
+		//detach, memory stays mapped while async work uses it
+		size_t mapSize = meta.memSize;
+		if (meta.memAddr != NULL) {
+			if (releaseMapping(meta.memAddr, mapSize) && munmap(meta.memAddr, mapSize) != 0) {
+				err = errno;
+				return -1;
+			}
+			meta.memAddr = NULL;
+			addShmCounter(SHMC_DETACHES, 1);
 		}
-		if (isCreate) {
-			shmAllocatedBytes += realSize;
-			shmMappedBytes += realSize;
-		} else {
-			shmMappedBytes += realSize;
+		if (meta.id != NO_SHMID) {
+			close(meta.id);
+			meta.id = NO_SHMID;
 		}
+		meta.type = SHM_DELETED;
+		return 0;
+	}
 
-		// Don't save to meta
-		close(fd);
-		fd = 0;
+	// Unlink POSIX object or file not attached by this process, can be called in threadpool
+	// Returns 0 if deleted, -1 if not exists or on error (err is set)
+	static int unlinkPosixShmObject(ShmMeta& meta, int& err) {
+		int res = releasePosixShmObject(meta, true, err);
+		if (res == -1 && err == 0 && meta.type == SHM_TYPE_POSIX) {
+			// Can be created in hugetlbfs
+			int fd = openHugetlbfsObject(meta.name, O_RDONLY, 0, 0, meta.hugetlbPath);
+			if (fd != -1) {
+				close(fd);
+				res = releasePosixShmObject(meta, true, err);
+			}
+		}
+		return res;
+	}
 
-		// Build and return buffer
-		info.GetReturnValue().Set(Nan::NewTypedBuffer(
-			buf,
-			count,
-			FreeCallback,
-			reinterpret_cast<void*>(static_cast<intptr_t>(metaInd)),
-			type
-		).ToLocalChecked());
+	// Detach System V segment
+	// Returns 0 if destroyed, or count of left attaches, or -1 if not exists
+	static int detachShmSegment(ShmMeta& meta, bool force, bool onExit) {
+		int err;
+		std::string key = getShmSegmentKey(meta);
+		bool attached = meta.memAddr != NULL;
+		size_t memSize = meta.memSize;
+		int res = releaseShmSegment(meta, force, err);
+		updateReleasedShmCounters(key, meta, attached, memSize);
+		if (err != 0 && !onExit)
+			Nan::ThrowError(strerror(err));
+		return res;
 	}
 
-	NAN_METHOD(detach) {
-		Nan::HandleScope scope;
-		key_t key = Nan::To<uint32_t>(info[0]).FromJust();
-		bool forceDestroy = Nan::To<bool>(info[1]).FromJust();
+	// Detach POSIX object
+	// Returns 0 if deleted, 1 if detached, -1 if not exists
+	static int detachPosixShmObject(ShmMeta& meta, bool force, bool onExit) {
+		int err;
+		std::string key = getShmSegmentKey(meta);
+		bool attached = meta.memAddr != NULL;
+		size_t memSize = meta.memSize;
+		int res = releasePosixShmObject(meta, force, err);
+		updateReleasedShmCounters(key, meta, attached, memSize);
+		if (err != 0 && !onExit)
+			Nan::ThrowError(strerror(err));
+		return res;
+	}
 
-		int shmid = shmget(key, 0, 0);
-		if (shmid == -1) {
-			switch(errno) {
-				case ENOENT: // not exists
+	// Detach memfd
+	// Returns 0 if detached, -1 on error
+	static int detachMemfdObject(ShmMeta& meta, bool onExit) {
+		int err;
+		std::string key = getShmSegmentKey(meta);
+		bool attached = meta.memAddr != NULL;
+		size_t memSize = meta.memSize;
+		int res = releaseMemfdObject(meta, err);
+		updateReleasedShmCounters(key, meta, attached, memSize);
+		if (err != 0 && !onExit)
+			Nan::ThrowError(strerror(err));
+		return res;
+	}
+
+	// Used only when creating byte-array (Buffer), not typed array
+	// Because impl of CallbackInfo::New() is not public (see https://github.com/nodejs/node/blob/v6.x/src/node_buffer.cc)
+	// Developer can detach shared memory segments manually by shm.detach()
+	// Also shm.detachAll() will be called on process termination
+	static void FreeCallback(char* data, void* hint) {
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		size_t metaInd = findShmSegmentInfoByHandle(hint);
+		if (metaInd == NOT_FOUND_IND) {
+			// Already detached
+			return;
+		}
+
+		detachShmSegmentOrObject(shmMeta[metaInd], false, true);
+		removeShmSegmentInfo(metaInd);
+	}
+
+	// Called when view of attach with autoDetach is collected by GC
+	// Can be called from any thread
+	static void ReleaseViewCallback(char* /*data*/, void* hint) {
+		ShmViewsRef* ref = static_cast<ShmViewsRef*>(hint);
+		if (ref->refs.fetch_sub(1) != 1)
+			return;
+		void* handle = ref->handle;
+		std::shared_ptr<ShmEnv> env = ref->env;
+		delete ref;
+
+		std::lock_guard<std::mutex> lock(env->releasedMutex);
+		if (env->releasedAsync == NULL)
+			return; // environment is exiting, its attaches are detached on exit
+		env->releasedHandles.push_back(handle);
+		uv_async_send(env->releasedAsync);
+	}
+
+	// Detach attaches of current environment which views were collected by GC
+	static void processReleasedViews() {
+		ShmEnv* env = shmCurrentEnv.get();
+		if (env == NULL)
+			return;
+		std::vector<void*> handles;
+		{
+			std::lock_guard<std::mutex> lock(env->releasedMutex);
+			handles.swap(env->releasedHandles);
+		}
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		for (void* handle : handles) {
+			FreeCallback(NULL, handle);
+		}
+	}
+
+	static void onReleasedViews(uv_async_t*) {
+		processReleasedViews();
+	}
+
+	// Build buffer/typed array (or chunks) for attached memory
+	static Local<Value> newShmViews(char* buf, size_t count, size_t chunkLength, ShmBufferType type,
+		size_t metaInd, bool autoDetach) {
+		Nan::EscapableHandleScope scope;
+		size_t viewsCnt = chunkLength > 0 ? (count + chunkLength - 1) / chunkLength : 1;
+	#if NODE_MODULE_VERSION <= NODE_16_0_MODULE_VERSION
+		// Externalized array buffers have no deleter
+		if (type != SHMBT_BUFFER)
+			autoDetach = false;
+	#endif
+		ShmViewsRef* ref = NULL;
+		if (autoDetach && viewsCnt > 0) {
+			ref = new ShmViewsRef();
+			ref->refs = viewsCnt;
+			ref->handle = getShmSegmentHandle(metaInd);
+			ref->env = shmCurrentEnv;
+		}
+
+		Local<Value> res;
+		if (chunkLength > 0) {
+			res = Nan::NewTypedBufferChunks(
+				buf,
+				count,
+				chunkLength,
+				ref ? ReleaseViewCallback : emptyFreeCallback,
+				ref,
+				type
+			).ToLocalChecked();
+		} else if (ref) {
+			res = Nan::NewTypedBuffer(buf, count, ReleaseViewCallback, ref, type).ToLocalChecked();
+		} else if (type == SHMBT_BUFFER) {
+			res = Nan::NewTypedBuffer(buf, count, FreeCallback, getShmSegmentHandle(metaInd), type).ToLocalChecked();
+		} else {
+			// Typed arrays are not freed by GC without autoDetach
+			res = Nan::NewTypedBuffer(buf, count, emptyFreeCallback, NULL, type).ToLocalChecked();
+		}
+		return scope.Escape(res);
+	}
+
+	enum ShmAttachStatus {
+		SHM_ATTACH_OK = 0,
+		SHM_ATTACH_NULL, // already exists (on create) or not exists (on get)
+		SHM_ATTACH_ERROR,
+		SHM_ATTACH_RANGE_ERROR,
+		SHM_ATTACH_TYPE_ERROR,
+	};
+
+	// Params and result of attach to System V segment or POSIX object
+	struct ShmAttachRequest {
+		ShmType type;
+		key_t key;
+		std::string name;
+		int fd; // memfd to map
+		size_t count; // 0 to get existing
+		int flags; // shmflg for System V, oflag for POSIX
+		int mapFlags; // at_shmflg for System V, mmap_flags for POSIX
+		mode_t mode;
+		ShmBufferType bufType;
+		ShmHugePages hugePages;
+		size_t chunkLength;
+		bool autoDetach;
+		ShmNumaPolicy numaPolicy;
+		std::vector<int> numaNodes;
+		// Result
+		ShmAttachStatus status;
+		int errnum;
+		const char* errMessage; // or strerror(errnum) if NULL
+		int shmid;
+		void* memAddr;
+		size_t memSize;
+		char* buf;
+		bool isCreate;
+		std::string hugetlbPath;
+		size_t posixHeader;
+		size_t dataOffset;
+	};
+
+	static inline void setAttachError(ShmAttachRequest& req, ShmAttachStatus status, int errnum,
+		const char* message = NULL) {
+		req.status = status;
+		req.errnum = errnum;
+		req.errMessage = message;
+	}
+
+	// Check params of attach, throws on error
+	static bool checkAttachRequest(ShmAttachRequest& req) {
+		if (req.chunkLength > node::Buffer::kMaxLength) {
+			Nan::ThrowRangeError("Chunk length exceeds max length of buffer");
+			return false;
+		}
+		if (req.chunkLength == 0 && req.count > node::Buffer::kMaxLength) {
+			Nan::ThrowRangeError("Count exceeds max length of buffer, use chunks");
+			return false;
+		}
+		return true;
+	}
+
+	// Key of segment/object of attach, shmid is id of System V segment or fd of memfd
+	static std::string getAttachSegmentKey(const ShmAttachRequest& req, int shmid) {
+		ShmMeta meta = {};
+		meta.type = req.type;
+		meta.id = shmid;
+		meta.name = req.name;
+		return getShmSegmentKey(meta);
+	}
+
+	// Key of reusable mapping in shmMappingsCache, attaches with other map flags don't share mapping
+	// Empty for mappings which can't be shared: private copy or own NUMA policy is requested
+	static std::string getMappingCacheKey(const ShmAttachRequest& req, int shmid) {
+		if (req.numaPolicy != SHMNUMA_DEFAULT || req.type == SHM_TYPE_MEMFD)
+			return "";
+		if (req.type != SHM_TYPE_SYSTEMV && (req.mapFlags & MAP_PRIVATE))
+			return "";
+		return getAttachSegmentKey(req, shmid) + "/" + std::to_string(req.mapFlags);
+	}
+
+	// Undo mapping of failed attach of POSIX object, reused mapping is only released
+	static void unmapFailedAttach(void* addr, size_t memSize, bool reused) {
+		if (!reused || releaseMapping(addr, memSize))
+			munmap(addr, memSize);
+	}
+
+	// Create or get and attach System V segment
+	// Segment already attached by this process is not attached again, its mapping is reused
+	// Doesn't touch meta array, counters and V8, so can be called in threadpool
+	static void attachShmSegment(ShmAttachRequest& req) {
+		int err;
+		if (req.bufType == SHMBT_STORED) {
+			// System V segments have no header
+			req.bufType = SHMBT_BUFFER;
+		}
+		struct shmid_ds shminf;
+		size_t size = req.count * getSizeForShmBufferType(req.bufType);
+		req.isCreate = (size > 0);
+		size_t hugePageSize = req.isCreate ? getHugePageSize(req.hugePages) : 0;
+		size_t realSize = size;
+
+		int shmid = -1;
+		if (hugePageSize > 0) {
+		#ifdef __linux__
+			// Kernel rounds up segment size to huge page size, but shm_segsz will be equal to size
+			int hugeShmflg = req.flags | SHM_HUGETLB;
+			if (req.hugePages == SHMHP_2MB)
+				hugeShmflg |= SHM_HUGE_2MB;
+			else if (req.hugePages == SHMHP_1GB)
+				hugeShmflg |= SHM_HUGE_1GB;
+			shmid = shmget(req.key, size, hugeShmflg);
+			if (shmid != -1) {
+				realSize = roundUpToPageSize(size, hugePageSize);
+			} else if (req.hugePages == SHMHP_AUTO && errno != EEXIST) {
+				// No free huge pages or no permission, fallback to transparent huge pages
+				hugePageSize = 0;
+			}
+		#else
+			if (req.hugePages != SHMHP_AUTO)
+				return setAttachError(req, SHM_ATTACH_ERROR, 0, "Huge pages are not supported on this platform");
+			hugePageSize = 0;
+		#endif
+		}
+		if (hugePageSize == 0) {
+			shmid = shmget(req.key, size, req.flags);
+		}
+		if (shmid == -1) {
+			switch(errno) {
+				case EEXIST: // already exists
 				case EIDRM:  // scheduled for deletion
-					info.GetReturnValue().Set(Nan::New<Number>(-1));
+				case ENOENT: // not exists
+					req.status = SHM_ATTACH_NULL;
 					return;
+				case EINVAL: // should be SHMMIN <= size <= SHMMAX
+					return setAttachError(req, SHM_ATTACH_RANGE_ERROR, errno);
+				default:
+					return setAttachError(req, SHM_ATTACH_ERROR, errno);
+			}
+		}
+
+		if (!req.isCreate) {
+			err = shmctl(shmid, IPC_STAT, &shminf);
+			if (err == 0) {
+				size = realSize = shminf.shm_segsz;
+				req.count = size / getSizeForShmBufferType(req.bufType);
+			} else {
+				return setAttachError(req, SHM_ATTACH_ERROR, errno);
+			}
+			if (req.chunkLength == 0 && req.count > node::Buffer::kMaxLength) {
+				return setAttachError(req, SHM_ATTACH_RANGE_ERROR, 0, "Segment exceeds max length of buffer, use chunks");
+			}
+		}
+
+		std::string cacheKey = getMappingCacheKey(req, shmid);
+		size_t mapSize;
+		void* res = req.isCreate ? MAP_FAILED : acquireMapping(cacheKey, 0, shmid, realSize, mapSize);
+		if (res != MAP_FAILED) {
+			req.status = SHM_ATTACH_OK;
+			req.shmid = shmid;
+			req.memAddr = res;
+			req.memSize = realSize;
+			req.buf = reinterpret_cast<char*>(res);
+			return;
+		}
+
+		res = shmat(shmid, NULL, req.mapFlags);
+		if (res == (void *)-1) {
+			return setAttachError(req, SHM_ATTACH_ERROR, errno);
+		}
+
+		// Before any page is touched
+		err = applyNumaPolicy(res, realSize, req.numaPolicy, req.numaNodes);
+		if (err != 0) {
+			shmdt(res);
+			if (req.isCreate)
+				shmctl(shmid, IPC_RMID, NULL);
+			return setAttachError(req, SHM_ATTACH_ERROR, err);
+		}
+
+	#ifdef MADV_HUGEPAGE
+		if (req.hugePages == SHMHP_AUTO && hugePageSize == 0) {
+			// Ignore error, transparent huge pages can be disabled
+			madvise(res, size, MADV_HUGEPAGE);
+		}
+	#endif
+
+		addMapping(res, realSize, cacheKey, getAttachSegmentKey(req, shmid), req.type, 0, shmid);
+		req.status = SHM_ATTACH_OK;
+		req.shmid = shmid;
+		req.memAddr = res;
+		req.memSize = realSize;
+		req.buf = reinterpret_cast<char*>(res);
+	}
+
+	// Write header of created POSIX object or memfd, size is size of data in bytes
+	static void writePosixHeader(ShmAttachRequest& req, void* addr, size_t size) {
+		ShmPosixHeader* header = reinterpret_cast<ShmPosixHeader*>(addr);
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		header->layoutVersion = POSIX_LAYOUT_VERSION;
+		header->type = req.bufType;
+		header->count = req.count;
+		header->createdAt = (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+		header->dataOffset = sizeof(ShmPosixHeader);
+		header->creatorPid = getpid();
+		header->leasePid.store(getpid(), std::memory_order_relaxed);
+		header->leaseNs.store((uint32_t) getPidNamespaceId(), std::memory_order_relaxed);
+		header->heartbeatAt.store(header->createdAt, std::memory_order_relaxed);
+		header->sizeGen.store(size, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		header->magic = POSIX_HEADER_MAGIC;
+		req.posixHeader = size;
+		req.dataOffset = sizeof(ShmPosixHeader);
+	}
+
+	// Read header of mapped POSIX object or memfd, resolve type and count of views
+	// Returns false on error (set in req), mapping should be unmapped by caller
+	static bool readPosixHeader(ShmAttachRequest& req, void* addr, size_t realSize) {
+		ShmPosixHeader* header = reinterpret_cast<ShmPosixHeader*>(addr);
+		ShmBufferType storedType = SHMBT_BUFFER;
+		req.dataOffset = POSIX_LEGACY_DATA_OFFSET;
+		if (realSize >= sizeof(ShmPosixHeader) && header->magic == POSIX_HEADER_MAGIC) {
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (header->layoutVersion > POSIX_LAYOUT_VERSION || header->dataOffset < sizeof(ShmPosixHeader)) {
+				setAttachError(req, SHM_ATTACH_ERROR, 0, "Unsupported layout of shared memory object");
+				return false;
+			}
+			storedType = (ShmBufferType) header->type;
+			req.dataOffset = header->dataOffset;
+		}
+		if (!resolvePosixType(req.bufType, storedType)) {
+			setAttachError(req, SHM_ATTACH_TYPE_ERROR, 0, "Shared memory object has other element type");
+			return false;
+		}
+		const char* truncated = req.type == SHM_TYPE_FILE ? "File is truncated" : "Shared memory object is truncated";
+		if (req.dataOffset > realSize) {
+			setAttachError(req, SHM_ATTACH_ERROR, 0, truncated);
+			return false;
+		}
+		req.posixHeader = getPosixSizeWord(addr, req.dataOffset)->load(std::memory_order_acquire);
+		size_t size = req.posixHeader & POSIX_HEADER_SIZE_MASK;
+		// Corrupted header, or object truncated by other process after it was mapped
+		if (size > realSize - req.dataOffset) {
+			setAttachError(req, SHM_ATTACH_ERROR, 0, truncated);
+			return false;
+		}
+		req.count = size / getSizeForShmBufferType(req.bufType);
+		if (req.chunkLength == 0 && req.count > node::Buffer::kMaxLength) {
+			setAttachError(req, SHM_ATTACH_RANGE_ERROR, 0, "Object exceeds max length of buffer, use chunks");
+			return false;
+		}
+		return true;
+	}
+
+	// Remove POSIX object or file created by failed attach
+	static void unlinkCreatedObject(const ShmAttachRequest& req) {
+		if (req.type == SHM_TYPE_FILE)
+			unlink(req.name.c_str());
+		else if (!req.hugetlbPath.empty())
+			unlink(req.hugetlbPath.c_str());
+		else
+			shm_unlink(req.name.c_str());
+	}
+
+	// Set size of created file and allocate its blocks, so lack of disk space is reported now
+	//  instead of SIGBUS on first write to mapping
+	// Returns 0 or -1 (see errno)
+	static int allocateFile(int fd, size_t size) {
+	#ifdef __linux__
+		if (fallocate(fd, 0, 0, size) == 0)
+			return 0;
+		if (errno != EOPNOTSUPP) // not supported by filesystem
+			return -1;
+	#endif
+		return ftruncate(fd, size);
+	}
+
+	// Create or get and map POSIX object, or regular file (SHM_TYPE_FILE) with same layout
+	// Object already mapped by this process is not mapped again, if mapping covers whole object
+	// Doesn't touch meta array, counters and V8, so can be called in threadpool
+	static void attachPosixShmObject(ShmAttachRequest& req) {
+		size_t size = req.count * getSizeForShmBufferType(req.bufType);
+		req.isCreate = (size > 0);
+		size_t realSize = req.isCreate ? size + sizeof(ShmPosixHeader) : 0;
+		size_t hugePageSize = req.isCreate ? getHugePageSize(req.hugePages) : 0;
+		void* res = MAP_FAILED;
+		bool reused = false;
+		std::string cacheKey;
+		struct stat sb = {};
+
+		// Create object in hugetlbfs
+		if (hugePageSize > 0) {
+			res = createHugetlbfsObject(req.name, req.flags, req.mode, req.mapFlags, hugePageSize, realSize, req.hugetlbPath);
+			if (res == MAP_FAILED) {
+				switch(errno) {
+					case EEXIST: // already exists
+						req.status = SHM_ATTACH_NULL;
+						return;
+					default:
+						if (req.hugePages == SHMHP_AUTO)
+							break; // fallback to shm_open() and transparent huge pages
+						if (errno == ENOSYS)
+							return setAttachError(req, SHM_ATTACH_ERROR, 0, "No hugetlbfs mount with required page size");
+						return setAttachError(req, SHM_ATTACH_ERROR, errno);
+				}
+			}
+		}
+
+		if (res == MAP_FAILED) {
+			// Create or get shared memory object
+			int fd;
+			if (req.type == SHM_TYPE_FILE)
+				fd = open(req.name.c_str(), req.flags | O_CLOEXEC, req.mode);
+			else
+				fd = shm_open(req.name.c_str(), req.flags, req.mode);
+			if (fd == -1 && errno == ENOENT && req.isCreate && req.type == SHM_TYPE_FILE) {
+				// Directory of file not exists
+				return setAttachError(req, SHM_ATTACH_ERROR, errno);
+			}
+			if (fd == -1 && errno == ENOENT && !req.isCreate && req.type == SHM_TYPE_POSIX) {
+				// Can be created in hugetlbfs
+				fd = openHugetlbfsObject(req.name, req.flags, req.mode, 0, req.hugetlbPath);
+				if (fd == -1)
+					errno = ENOENT;
+			}
+			if (fd == -1) {
+				switch(errno) {
+					case EEXIST: // already exists
+					case ENOENT: // not exists
+						req.status = SHM_ATTACH_NULL;
+						return;
+					case ENAMETOOLONG: // length of name exceeds PATH_MAX
+						return setAttachError(req, SHM_ATTACH_RANGE_ERROR, errno);
+					default:
+						return setAttachError(req, SHM_ATTACH_ERROR, errno);
+				}
+			}
+
+			// Truncate
+			int resTrunc;
+			if (req.isCreate) {
+				resTrunc = req.type == SHM_TYPE_FILE ? allocateFile(fd, realSize) : ftruncate(fd, realSize);
+				if (resTrunc == -1) {
+					int err = errno;
+					close(fd);
+					if (req.flags & O_EXCL) // created by this call
+						unlinkCreatedObject(req);
+					switch(err) {
+						case EFBIG: // length exceeds max file size
+						case EINVAL: // length exceeds max file size or < 0
+							return setAttachError(req, SHM_ATTACH_RANGE_ERROR, err);
+						default:
+							return setAttachError(req, SHM_ATTACH_ERROR, err);
+					}
+				}
+			}
+
+			// Get size (not accurate, multiple of PAGE_SIZE = 4096), and file to identify mapping
+			int resStat = fstat(fd, &sb);
+			if (resStat == -1 && !req.isCreate) {
+				int err = errno;
+				close(fd);
+				return setAttachError(req, SHM_ATTACH_ERROR, err);
+			}
+			if (resStat == 0)
+				cacheKey = getMappingCacheKey(req, NO_SHMID);
+			if (!req.isCreate) {
+				realSize = sb.st_size;
+				if (req.type == SHM_TYPE_FILE && realSize < sizeof(ShmPosixHeader)) {
+					close(fd);
+					return setAttachError(req, SHM_ATTACH_ERROR, 0, "File is not shared memory file");
+				}
+				res = acquireMapping(cacheKey, sb.st_dev, sb.st_ino, realSize, realSize);
+				reused = res != MAP_FAILED;
+			}
+
+			if (reused) {
+				close(fd);
+			} else {
+				// Map shared memory object
+				off_t offset = 0;
+				int prot = PROT_READ | PROT_WRITE;
+				res = mmap(NULL, realSize, prot, req.mapFlags, fd, offset);
+				int err = errno;
+
+				// Don't save to meta
+				close(fd);
+				fd = 0;
+
+				if (res == MAP_FAILED) {
+					switch(err) {
+						case EINVAL: // length is bad, or flags does not comtain MAP_SHARED / MAP_PRIVATE / MAP_SHARED_VALIDATE
+							return setAttachError(req, SHM_ATTACH_RANGE_ERROR, err);
+						default:
+							return setAttachError(req, SHM_ATTACH_ERROR, err);
+					}
+				}
+
+			#ifdef MADV_HUGEPAGE
+				if (req.hugePages == SHMHP_AUTO) {
+					// Ignore error, transparent huge pages can be disabled
+					madvise(res, realSize, MADV_HUGEPAGE);
+				}
+			#endif
+			}
+		}
+
+		// Before header is written, so first page is also placed by policy
+		int errNuma = applyNumaPolicy(res, realSize, req.numaPolicy, req.numaNodes);
+		if (errNuma != 0) {
+			munmap(res, realSize);
+			if (req.isCreate)
+				unlinkCreatedObject(req);
+			return setAttachError(req, SHM_ATTACH_ERROR, errNuma);
+		}
+
+		// Read/write header at start of shared memory
+		if (req.isCreate) {
+			writePosixHeader(req, res, size);
+		} else if (!readPosixHeader(req, res, realSize)) {
+			unmapFailedAttach(res, realSize, reused);
+			return;
+		} else if (req.type == SHM_TYPE_FILE) {
+			// File is always created with header
+			if (req.dataOffset == POSIX_LEGACY_DATA_OFFSET) {
+				unmapFailedAttach(res, realSize, reused);
+				return setAttachError(req, SHM_ATTACH_ERROR, 0, "File is not shared memory file");
+			}
+		}
+
+		if (!reused)
+			addMapping(res, realSize, cacheKey, getAttachSegmentKey(req, NO_SHMID), req.type, sb.st_dev, sb.st_ino);
+		req.status = SHM_ATTACH_OK;
+		req.shmid = NO_SHMID;
+		req.memAddr = res;
+		req.memSize = realSize;
+		req.buf = reinterpret_cast<char*>(res) + req.dataOffset;
+	}
+
+	// Create memfd (with huge pages if requested) and map it
+	// realSize is rounded up to huge page size
+	// Returns address or MAP_FAILED (error is set in req), fd is set on success
+	static void* createMemfdObject(ShmAttachRequest& req, size_t& realSize, int& fd) {
+		void* res = MAP_FAILED;
+		size_t hugePageSize = getHugePageSize(req.hugePages);
+		if (hugePageSize > 0) {
+			unsigned int hugeFlags = MFD_HUGETLB;
+			if (req.hugePages == SHMHP_2MB)
+				hugeFlags |= MFD_HUGE_2MB;
+			else if (req.hugePages == SHMHP_1GB)
+				hugeFlags |= MFD_HUGE_1GB;
+			size_t hugeRealSize = roundUpToPageSize(realSize, hugePageSize);
+			fd = createMemfd(hugeFlags);
+			if (fd != -1) {
+				// Huge pages are reserved on mmap(), so it fails if there are not enough free ones
+				if (ftruncate(fd, hugeRealSize) == 0)
+					res = mmap(NULL, hugeRealSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				if (res != MAP_FAILED) {
+					realSize = hugeRealSize;
+					return res;
+				}
+				int err = errno;
+				close(fd);
+				errno = err;
+			}
+			if (req.hugePages != SHMHP_AUTO) {
+				setAttachError(req, SHM_ATTACH_ERROR, errno);
+				return MAP_FAILED;
+			}
+			// Fallback to transparent huge pages
+		}
+
+		fd = createMemfd(0);
+		if (fd == -1) {
+			setAttachError(req, SHM_ATTACH_ERROR, errno);
+			return MAP_FAILED;
+		}
+		if (ftruncate(fd, realSize) == 0)
+			res = mmap(NULL, realSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (res == MAP_FAILED) {
+			int err = errno;
+			close(fd);
+			fd = -1;
+			setAttachError(req, err == EFBIG || err == EINVAL ? SHM_ATTACH_RANGE_ERROR : SHM_ATTACH_ERROR, err);
+			return MAP_FAILED;
+		}
+	#ifdef MADV_HUGEPAGE
+		if (req.hugePages == SHMHP_AUTO) {
+			// Ignore error, transparent huge pages can be disabled
+			madvise(res, realSize, MADV_HUGEPAGE);
+		}
+	#endif
+		return res;
+	}
+
+	// Create memfd or map received one
+	// Memfd sealed against writes can't be mapped shared writable, so it's mapped copy-on-write:
+	//  views are writable, but changes are private to this process
+	// Doesn't touch meta array, counters and V8, so can be called in threadpool
+	static void attachMemfdObject(ShmAttachRequest& req) {
+		size_t size = req.count * getSizeForShmBufferType(req.bufType);
+		req.isCreate = (size > 0);
+		size_t realSize = size + sizeof(ShmPosixHeader);
+		int fd = req.fd;
+		void* res;
+		if (req.isCreate) {
+			res = createMemfdObject(req, realSize, fd);
+			if (res == MAP_FAILED)
+				return;
+		} else {
+			struct stat sb;
+			if (fstat(fd, &sb) == -1)
+				return setAttachError(req, errno == EBADF ? SHM_ATTACH_RANGE_ERROR : SHM_ATTACH_ERROR, errno);
+			realSize = sb.st_size;
+			if (realSize < sizeof(ShmPosixHeader))
+				return setAttachError(req, SHM_ATTACH_ERROR, 0, "File is not anonymous shared memory");
+			int seals = getFdSeals(fd);
+			if (seals == -1)
+				return setAttachError(req, SHM_ATTACH_ERROR, errno);
+			int mapFlags = (seals & F_SEAL_WRITE) ? MAP_PRIVATE : MAP_SHARED;
+			res = mmap(NULL, realSize, PROT_READ | PROT_WRITE, mapFlags, fd, 0);
+			if (res == MAP_FAILED)
+				return setAttachError(req, SHM_ATTACH_ERROR, errno);
+		}
+
+		// Before header is written, so first page is also placed by policy
+		int errNuma = applyNumaPolicy(res, realSize, req.numaPolicy, req.numaNodes);
+		if (errNuma != 0) {
+			munmap(res, realSize);
+			if (req.isCreate)
+				close(fd);
+			return setAttachError(req, SHM_ATTACH_ERROR, errNuma);
+		}
+
+		if (req.isCreate) {
+			writePosixHeader(req, res, size);
+		} else if (!readPosixHeader(req, res, realSize)) {
+			munmap(res, realSize);
+			return;
+		} else if (req.dataOffset == POSIX_LEGACY_DATA_OFFSET) {
+			// Memfd is always created with header
+			munmap(res, realSize);
+			return setAttachError(req, SHM_ATTACH_ERROR, 0, "File is not anonymous shared memory");
+		}
+
+		addMapping(res, realSize, "", getAttachSegmentKey(req, fd), req.type, 0, 0);
+		req.status = SHM_ATTACH_OK;
+		req.shmid = fd;
+		req.memAddr = res;
+		req.memSize = realSize;
+		req.buf = reinterpret_cast<char*>(res) + req.dataOffset;
+	}
+
+	static void attachShmSegmentOrObject(ShmAttachRequest& req) {
+		ShmCounterTimer timer(SHMC_ATTACH_NS);
+		if (req.type == SHM_TYPE_SYSTEMV)
+			attachShmSegment(req);
+		else if (req.type == SHM_TYPE_MEMFD)
+			attachMemfdObject(req);
+		else
+			attachPosixShmObject(req);
+		if (req.status == SHM_ATTACH_OK)
+			addShmCounter(SHMC_ATTACHES, 1);
+		else if (req.status != SHM_ATTACH_NULL)
+			addShmCounter(SHMC_ATTACH_ERRORS, 1);
+	}
+
+	// Error of failed attach
+	static Local<Value> newAttachError(const ShmAttachRequest& req) {
+		const char* message = req.errMessage != NULL ? req.errMessage : strerror(req.errnum);
+		if (req.status == SHM_ATTACH_TYPE_ERROR)
+			return Nan::TypeError(message);
+		return req.status == SHM_ATTACH_RANGE_ERROR ? Nan::RangeError(message) : Nan::Error(message);
+	}
+
+	// Mark blocks of file mapping overlapping range as dirty, offset is from start of mapping
+	static void markShmDirty(ShmMeta& meta, size_t offset, size_t length) {
+		if (length == 0)
+			return;
+		size_t blocksCnt = (meta.memSize + SHM_FILE_DIRTY_BLOCK - 1) / SHM_FILE_DIRTY_BLOCK;
+		if (meta.dirtyBlocks.size() < (blocksCnt + 63) / 64)
+			meta.dirtyBlocks.resize((blocksCnt + 63) / 64, 0);
+		size_t last = (offset + length - 1) / SHM_FILE_DIRTY_BLOCK;
+		for (size_t block = offset / SHM_FILE_DIRTY_BLOCK; block <= last && block < blocksCnt; block++)
+			meta.dirtyBlocks[block / 64] |= ((uint64_t) 1) << (block % 64);
+	}
+
+	// Save successful attach to meta array and build views, should be called in thread of environment
+	static Local<Value> registerAttach(const ShmAttachRequest& req) {
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		ShmMeta meta = {};
+		meta.type = req.type;
+		meta.id = req.shmid;
+		meta.memAddr = req.memAddr;
+		meta.memSize = req.memSize;
+		meta.name = req.name;
+		meta.isOwner = req.isCreate;
+		meta.hugetlbPath = req.hugetlbPath;
+		meta.posixHeader = req.posixHeader;
+		meta.dataOffset = req.dataOffset;
+		meta.env = shmCurrentEnv.get();
+		size_t metaInd = addShmSegmentInfo(meta);
+		if (req.isCreate) {
+			shmAllocatedBytes += req.memSize;
+			shmCreatedBytes[getShmSegmentKey(meta)] += req.memSize;
+		}
+		if (req.isCreate && req.type == SHM_TYPE_FILE) {
+			// Data of new file is zeros, only header should be written by first checkpoint
+			markShmDirty(shmMeta[metaInd], 0, req.dataOffset);
+		}
+		shmMappedBytes += req.memSize;
+		Local<Value> views = newShmViews(req.buf, req.count, req.chunkLength, req.bufType, metaInd, req.autoDetach);
+		if (req.type == SHM_TYPE_MEMFD)
+			Nan::Set(views.As<Object>(), Nan::New("fd").ToLocalChecked(), Nan::New<Number>(req.shmid));
+		return views;
+	}
+
+	class AttachWorker : public Nan::AsyncWorker {
+	public:
+		AttachWorker(Nan::Callback* callback, const ShmAttachRequest& req)
+			: Nan::AsyncWorker(callback, "shm:attach"), req(req) {}
+
+		void Execute() {
+			attachShmSegmentOrObject(req);
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			processReleasedViews();
+			Local<Value> argv[] = { Nan::Null(), Nan::Null() };
+			if (req.status == SHM_ATTACH_OK)
+				argv[1] = registerAttach(req);
+			else if (req.status != SHM_ATTACH_NULL)
+				argv[0] = newAttachError(req);
+			callback->Call(2, argv, async_resource);
+		}
+
+	private:
+		ShmAttachRequest req;
+	};
+
+	// Attach synchronously, or in threadpool if callback is passed
+	static void doAttach(const Nan::FunctionCallbackInfo<Value>& info, ShmAttachRequest& req, Local<Value> callback) {
+		if (!checkAttachRequest(req))
+			return;
+		if (callback->IsFunction()) {
+			Nan::AsyncQueueWorker(new AttachWorker(new Nan::Callback(callback.As<Function>()), req));
+			return;
+		}
+		attachShmSegmentOrObject(req);
+		if (req.status == SHM_ATTACH_OK) {
+			info.GetReturnValue().Set(registerAttach(req));
+		} else if (req.status == SHM_ATTACH_NULL) {
+			info.GetReturnValue().SetNull();
+		} else {
+			Nan::ThrowError(newAttachError(req));
+		}
+	}
+
+	// Parse NUMA policy and array of nodes, throws on error
+	static bool getNumaArgs(Local<Value> policyVal, Local<Value> nodesVal, ShmAttachRequest& req) {
+		req.numaPolicy = (ShmNumaPolicy) Nan::To<int32_t>(policyVal).FromMaybe(SHMNUMA_DEFAULT);
+		if (req.numaPolicy == SHMNUMA_DEFAULT)
+			return true;
+		if (!nodesVal->IsArray()) {
+			Nan::ThrowTypeError("Argument numaNodes must be an array");
+			return false;
+		}
+		Local<v8::Array> nodes = nodesVal.As<v8::Array>();
+		for (uint32_t i = 0; i < nodes->Length(); i++) {
+			int32_t node = Nan::To<int32_t>(Nan::Get(nodes, i).ToLocalChecked()).FromMaybe(-1);
+			if (node < 0) {
+				Nan::ThrowRangeError("NUMA node should be >= 0");
+				return false;
+			}
+			req.numaNodes.push_back(node);
+		}
+		return true;
+	}
+
+	NAN_METHOD(get) {
+		Nan::HandleScope scope;
+		ShmAttachRequest req = ShmAttachRequest();
+		req.type = SHM_TYPE_SYSTEMV;
+		req.key = Nan::To<uint32_t>(info[0]).FromJust();
+		req.count = Nan::To<int64_t>(info[1]).FromJust();
+		req.flags = Nan::To<uint32_t>(info[2]).FromJust();
+		req.mapFlags = Nan::To<uint32_t>(info[3]).FromJust();
+		req.bufType = (ShmBufferType) Nan::To<int32_t>(info[4]).FromJust();
+		req.hugePages = (ShmHugePages) Nan::To<int32_t>(info[5]).FromMaybe(SHMHP_NONE);
+		req.chunkLength = Nan::To<int64_t>(info[6]).FromMaybe(0);
+		req.autoDetach = Nan::To<bool>(info[7]).FromMaybe(false);
+		if (!getNumaArgs(info[8], info[9], req))
+			return;
+		doAttach(info, req, info[10]);
+	}
+
+	NAN_METHOD(getPosix) {
+		Nan::HandleScope scope;
+		if (!info[0]->IsString()) {
+			return Nan::ThrowTypeError("Argument name must be a string");
+		}
+		ShmAttachRequest req = ShmAttachRequest();
+		req.type = SHM_TYPE_POSIX;
+		req.name = (*Nan::Utf8String(info[0]));
+		req.count = Nan::To<int64_t>(info[1]).FromJust();
+		req.flags = Nan::To<uint32_t>(info[2]).FromJust();
+		req.mode = Nan::To<uint32_t>(info[3]).FromJust();
+		req.mapFlags = Nan::To<uint32_t>(info[4]).FromJust();
+		req.bufType = (ShmBufferType) Nan::To<int32_t>(info[5]).FromJust();
+		req.hugePages = (ShmHugePages) Nan::To<int32_t>(info[6]).FromMaybe(SHMHP_NONE);
+		req.chunkLength = Nan::To<int64_t>(info[7]).FromMaybe(0);
+		req.autoDetach = Nan::To<bool>(info[8]).FromMaybe(false);
+		if (!getNumaArgs(info[9], info[10], req))
+			return;
+		doAttach(info, req, info[11]);
+	}
+
+	NAN_METHOD(getMemfd) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		ShmAttachRequest req = ShmAttachRequest();
+		req.type = SHM_TYPE_MEMFD;
+		req.fd = Nan::To<int32_t>(info[0]).FromMaybe(-1);
+		req.count = Nan::To<int64_t>(info[1]).FromJust();
+		req.bufType = (ShmBufferType) Nan::To<int32_t>(info[2]).FromJust();
+		req.hugePages = (ShmHugePages) Nan::To<int32_t>(info[3]).FromMaybe(SHMHP_NONE);
+		req.chunkLength = Nan::To<int64_t>(info[4]).FromMaybe(0);
+		req.autoDetach = Nan::To<bool>(info[5]).FromMaybe(false);
+		if (!getNumaArgs(info[6], info[7], req))
+			return;
+		if (req.count == 0) {
+			if (req.fd < 0) {
+				return Nan::ThrowRangeError("Invalid file descriptor");
+			}
+			// Attach owns fd, second attach would close it twice
+			ShmMeta search = {};
+			search.type = SHM_TYPE_MEMFD;
+			search.id = req.fd;
+			if (findShmSegmentInfo(search) != NOT_FOUND_IND) {
+				return Nan::ThrowError("File descriptor is already attached");
+			}
+		}
+		doAttach(info, req, info[8]);
+	}
+
+	NAN_METHOD(getFile) {
+		Nan::HandleScope scope;
+		if (!info[0]->IsString()) {
+			return Nan::ThrowTypeError("Argument path must be a string");
+		}
+		ShmAttachRequest req = ShmAttachRequest();
+		req.type = SHM_TYPE_FILE;
+		req.name = (*Nan::Utf8String(info[0]));
+		req.count = Nan::To<int64_t>(info[1]).FromJust();
+		req.flags = Nan::To<uint32_t>(info[2]).FromJust();
+		req.mode = Nan::To<uint32_t>(info[3]).FromJust();
+		req.mapFlags = MAP_SHARED;
+		req.bufType = (ShmBufferType) Nan::To<int32_t>(info[4]).FromJust();
+		req.hugePages = SHMHP_NONE;
+		req.chunkLength = Nan::To<int64_t>(info[5]).FromMaybe(0);
+		req.autoDetach = Nan::To<bool>(info[6]).FromMaybe(false);
+		if (!getNumaArgs(info[7], info[8], req))
+			return;
+		doAttach(info, req, info[9]);
+	}
+
+	// Detaches copy of meta (already removed from meta array) in threadpool
+	class DetachWorker : public Nan::AsyncWorker {
+	public:
+		DetachWorker(Nan::Callback* callback, const ShmMeta& meta, bool force, bool found)
+			: Nan::AsyncWorker(callback, "shm:detach"), meta(meta), key(getShmSegmentKey(meta)), force(force),
+			found(found), attached(meta.memAddr != NULL), memSize(meta.memSize), result(-1) {}
+
+		void Execute() {
+			int err = 0;
+			if (meta.type == SHM_TYPE_SYSTEMV) {
+				if (found || force)
+					result = releaseShmSegment(meta, force, err);
+			} else {
+				if (found)
+					result = releasePosixShmObject(meta, force, err);
+				else if (force)
+					result = unlinkPosixShmObject(meta, err);
+			}
+			if (err != 0)
+				SetErrorMessage(strerror(err));
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			{
+				std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+				updateReleasedShmCounters(key, meta, attached, memSize);
+			}
+			Local<Value> argv[] = { Nan::Null(), Nan::New<Number>(result) };
+			callback->Call(2, argv, async_resource);
+		}
+
+		void HandleErrorCallback() {
+			{
+				std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+				updateReleasedShmCounters(key, meta, attached, memSize);
+			}
+			Nan::AsyncWorker::HandleErrorCallback();
+		}
+
+	private:
+		ShmMeta meta;
+		std::string key;
+		bool force;
+		bool found;
+		bool attached;
+		size_t memSize;
+		int result;
+	};
+
+	// Detach last attach in threadpool, it's removed from meta array immediately
+	static void queueDetach(ShmMeta& search, bool forceDestroy, Local<Value> callback) {
+		size_t foundInd = findShmSegmentInfo(search);
+		bool found = foundInd != NOT_FOUND_IND;
+		if (found) {
+			search = shmMeta[foundInd];
+			removeShmSegmentInfo(foundInd);
+		}
+		Nan::AsyncQueueWorker(new DetachWorker(
+			new Nan::Callback(callback.As<Function>()), search, forceDestroy, found));
+	}
+
+	NAN_METHOD(detach) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		key_t key = Nan::To<uint32_t>(info[0]).FromJust();
+		bool forceDestroy = Nan::To<bool>(info[1]).FromJust();
+
+		int shmid = shmget(key, 0, 0);
+		if (shmid == -1) {
+			int res;
+			switch(errno) {
+				case ENOENT: // not exists
+				case EIDRM:  // scheduled for deletion
+					res = -1;
+					break;
 				default:
 					return Nan::ThrowError(strerror(errno));
 			}
-		} else {
-			ShmMeta meta = {
-				.type=SHM_TYPE_SYSTEMV, .id=shmid, .memAddr=NULL, .memSize=0, .name=""
-			};
-			size_t foundInd = findShmSegmentInfo(meta);
-			if (foundInd != NOT_FOUND_IND) {
-				int res = detachShmSegment(shmMeta[foundInd], forceDestroy);
-				if (res != -1)
-					removeShmSegmentInfo(foundInd);
-				info.GetReturnValue().Set(Nan::New<Number>(res));
+			if (info[2]->IsFunction()) {
+				// Nothing to detach, but callback should be called asynchronously
+				ShmMeta meta = {};
+				meta.type = SHM_TYPE_SYSTEMV;
+				meta.id = NO_SHMID;
+				Nan::AsyncQueueWorker(new DetachWorker(
+					new Nan::Callback(info[2].As<Function>()), meta, false, false));
+				return;
+			}
+			info.GetReturnValue().Set(Nan::New<Number>(res));
+		} else {
+			ShmMeta meta = {};
+			meta.type = SHM_TYPE_SYSTEMV;
+			meta.id = shmid;
+			if (info[2]->IsFunction()) {
+				return queueDetach(meta, forceDestroy, info[2]);
+			}
+			size_t foundInd = findShmSegmentInfo(meta);
+			if (foundInd != NOT_FOUND_IND) {
+				int res = detachShmSegment(shmMeta[foundInd], forceDestroy);
+				if (shmMeta[foundInd].memAddr == NULL)
+					removeShmSegmentInfo(foundInd);
+				info.GetReturnValue().Set(Nan::New<Number>(res));
+			} else {
+				//not found in meta array, means not created/opened by us
+				int res = -1;
+				if (forceDestroy) {
+					res = detachShmSegment(meta, forceDestroy);
+				}
+				info.GetReturnValue().Set(Nan::New<Number>(res));
+			}
+		}
+	}
+
+	// Detach POSIX object or file by name (info[0]), info[1] is force, info[2] is optional callback
+	static void detachNamedObject(const Nan::FunctionCallbackInfo<Value>& info, ShmType type) {
+		std::string name = (*Nan::Utf8String(info[0]));
+		bool forceDestroy = Nan::To<bool>(info[1]).FromJust();
+
+		ShmMeta meta = {};
+		meta.type = type;
+		meta.id = NO_SHMID;
+		meta.name = name;
+		if (info[2]->IsFunction()) {
+			return queueDetach(meta, forceDestroy, info[2]);
+		}
+		size_t foundInd = findShmSegmentInfo(meta);
+		if (foundInd != NOT_FOUND_IND) {
+			int res = detachPosixShmObject(shmMeta[foundInd], forceDestroy);
+			if (shmMeta[foundInd].memAddr == NULL)
+				removeShmSegmentInfo(foundInd);
+			info.GetReturnValue().Set(Nan::New<Number>(res));
+		} else {
+			//not found in meta array, means not created/opened by us
+			int res = -1;
+			if (forceDestroy) {
+				int err;
+				std::string key = getShmSegmentKey(meta);
+				res = unlinkPosixShmObject(meta, err);
+				updateReleasedShmCounters(key, meta, false, 0);
+				if (err != 0)
+					return Nan::ThrowError(strerror(err));
+			}
+			info.GetReturnValue().Set(Nan::New<Number>(res));
+		}
+	}
+
+	NAN_METHOD(detachPosix) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		if (!info[0]->IsString()) {
+			return Nan::ThrowTypeError("Argument name must be a string");
+		}
+		detachNamedObject(info, SHM_TYPE_POSIX);
+	}
+
+	NAN_METHOD(detachFile) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		if (!info[0]->IsString()) {
+			return Nan::ThrowTypeError("Argument path must be a string");
+		}
+		detachNamedObject(info, SHM_TYPE_FILE);
+	}
+
+	NAN_METHOD(detachMemfd) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		ShmMeta search = {};
+		search.type = SHM_TYPE_MEMFD;
+		search.id = Nan::To<int32_t>(info[0]).FromMaybe(-1);
+		size_t foundInd = findShmSegmentInfo(search);
+		if (foundInd == NOT_FOUND_IND) {
+			info.GetReturnValue().Set(Nan::New<Number>(-1));
+			return;
+		}
+		int res = detachMemfdObject(shmMeta[foundInd]);
+		if (shmMeta[foundInd].memAddr == NULL)
+			removeShmSegmentInfo(foundInd);
+		info.GetReturnValue().Set(Nan::New<Number>(res));
+	}
+
+	NAN_METHOD(sealMemfd) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		int fd = Nan::To<int32_t>(info[0]).FromMaybe(-1);
+		int seals = Nan::To<int32_t>(info[1]).FromMaybe(0);
+		int oldSeals = getFdSeals(fd);
+		if (oldSeals == -1) {
+			return Nan::ThrowError(strerror(errno));
+		}
+		// F_SEAL_WRITE fails with EBUSY while there is writable shared mapping, so replace mappings
+		//  of all attaches of same file (by any fd, in any environment) with private ones,
+		//  contents and addresses are same
+		std::vector<const ShmMeta*> remapped;
+		int err = 0;
+		if ((seals & F_SEAL_WRITE) && !(oldSeals & F_SEAL_WRITE)) {
+			struct stat sb;
+			if (fstat(fd, &sb) == -1) {
+				return Nan::ThrowError(strerror(errno));
+			}
+			for (const ShmMeta& meta : shmMeta) {
+				struct stat metaSb;
+				if (meta.type != SHM_TYPE_MEMFD || meta.memAddr == NULL || fstat(meta.id, &metaSb) == -1
+					|| metaSb.st_dev != sb.st_dev || metaSb.st_ino != sb.st_ino)
+					continue;
+				if (mmap(meta.memAddr, meta.memSize, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_FIXED, meta.id, 0) == MAP_FAILED) {
+					err = errno;
+					break;
+				}
+				remapped.push_back(&meta);
+			}
+		}
+		if (err == 0 && addFdSeals(fd, seals) == -1)
+			err = errno;
+		if (err != 0) {
+			// Restore shared mappings, private ones have no changes yet
+			for (const ShmMeta* meta : remapped) {
+				mmap(meta->memAddr, meta->memSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, meta->id, 0);
+			}
+			return Nan::ThrowError(strerror(err));
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(getFdSeals(fd)));
+	}
+
+	// Range of file mapping to write by checkpoint
+	struct ShmDirtyRange {
+		void* handle; // handle of meta, to restore marks on error
+		size_t offset;
+		size_t length;
+		char* addr;
+	};
+
+	// Move dirty blocks of all attaches of file to ranges, adjacent blocks are merged
+	static void takeDirtyRanges(ShmMeta& search, std::vector<ShmDirtyRange>& ranges) {
+		for (size_t ind = findShmSegmentInfo(search); ind != NOT_FOUND_IND; ind = shmMeta[ind].prevInd) {
+			ShmMeta& meta = shmMeta[ind];
+			if (meta.memAddr == NULL)
+				continue;
+			size_t blocksCnt = std::min(meta.dirtyBlocks.size() * 64,
+				(meta.memSize + SHM_FILE_DIRTY_BLOCK - 1) / SHM_FILE_DIRTY_BLOCK);
+			size_t block = 0;
+			while (block < blocksCnt) {
+				if (!(meta.dirtyBlocks[block / 64] & (((uint64_t) 1) << (block % 64)))) {
+					block++;
+					continue;
+				}
+				size_t first = block;
+				while (block < blocksCnt && (meta.dirtyBlocks[block / 64] & (((uint64_t) 1) << (block % 64))))
+					block++;
+				size_t offset = first * SHM_FILE_DIRTY_BLOCK;
+				size_t length = std::min(block * (size_t) SHM_FILE_DIRTY_BLOCK, meta.memSize) - offset;
+				ranges.push_back({ getShmSegmentHandle(ind), offset, length,
+					reinterpret_cast<char*>(meta.memAddr) + offset });
+			}
+			meta.dirtyBlocks.clear();
+		}
+	}
+
+	// Mark ranges of failed checkpoint as dirty again, if they are still attached
+	static void restoreDirtyRanges(const std::vector<ShmDirtyRange>& ranges) {
+		for (const ShmDirtyRange& range : ranges) {
+			size_t ind = findShmSegmentInfoByHandle(range.handle);
+			if (ind != NOT_FOUND_IND && shmMeta[ind].memAddr != NULL)
+				markShmDirty(shmMeta[ind], range.offset, range.length);
+		}
+	}
+
+	// Write ranges with msync(), returns 0 or errno, can be called in threadpool
+	static int syncDirtyRanges(const std::vector<ShmDirtyRange>& ranges, size_t& bytes) {
+		bytes = 0;
+		for (const ShmDirtyRange& range : ranges) {
+			int err = syncMemoryRange(range.addr, range.length);
+			if (err != 0)
+				return err;
+			bytes += range.length;
+		}
+		return 0;
+	}
+
+	class CheckpointWorker : public Nan::AsyncWorker {
+	public:
+		CheckpointWorker(Nan::Callback* callback, std::vector<ShmDirtyRange>& ranges)
+			: Nan::AsyncWorker(callback, "shm:checkpoint"), bytes(0) {
+			this->ranges.swap(ranges);
+			// File can be closed while ranges are written
+			for (const ShmDirtyRange& range : this->ranges) {
+				mappings.push_back(pinShmMapping(range.addr, range.length));
+			}
+		}
+
+		void Execute() {
+			int err = syncDirtyRanges(ranges, bytes);
+			for (void* mapping : mappings) {
+				unpinShmMapping(mapping);
+			}
+			if (err != 0)
+				SetErrorMessage(strerror(err));
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			Local<Value> argv[] = { Nan::Null(), Nan::New<Number>((double) bytes) };
+			callback->Call(2, argv, async_resource);
+		}
+
+		void HandleErrorCallback() {
+			{
+				std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+				restoreDirtyRanges(ranges);
+			}
+			Nan::AsyncWorker::HandleErrorCallback();
+		}
+
+	private:
+		std::vector<ShmDirtyRange> ranges;
+		std::vector<void*> mappings;
+		size_t bytes;
+	};
+
+	NAN_METHOD(fileMarkDirty) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument array must be a Buffer or TypedArray");
+		}
+		size_t byteOffset = Nan::To<double>(info[1]).FromJust();
+		size_t byteLength = Nan::To<double>(info[2]).FromJust();
+		if (byteOffset > length || byteLength > length - byteOffset) {
+			return Nan::ThrowRangeError("Range is out of bounds");
+		}
+		void* memAddr = NULL;
+		std::string segmentKey;
+		{
+			std::lock_guard<std::mutex> lock(shmMappingsMutex);
+			const auto found = findMapping(data, 1);
+			if (found != shmMappings.end() && found->second.type == SHM_TYPE_FILE) {
+				memAddr = found->first;
+				segmentKey = found->second.segmentKey;
+			}
+		}
+		// Attach of current environment which uses mapping
+		const auto found = memAddr != NULL ? shmMetaIndex.find(getShmIndexKey(segmentKey, shmCurrentEnv.get()))
+			: shmMetaIndex.end();
+		for (size_t ind = found != shmMetaIndex.end() ? found->second : NOT_FOUND_IND; ind != NOT_FOUND_IND;
+			ind = shmMeta[ind].prevInd) {
+			if (shmMeta[ind].memAddr == memAddr) {
+				markShmDirty(shmMeta[ind], data - static_cast<char*>(memAddr) + byteOffset, byteLength);
+				return;
+			}
+		}
+		Nan::ThrowError("Array is not mapped from file");
+	}
+
+	NAN_METHOD(fileCheckpoint) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		if (!info[0]->IsString()) {
+			return Nan::ThrowTypeError("Argument path must be a string");
+		}
+		ShmMeta search = {};
+		search.type = SHM_TYPE_FILE;
+		search.id = NO_SHMID;
+		search.name = (*Nan::Utf8String(info[0]));
+		size_t ind = findShmSegmentInfo(search);
+		if (ind == NOT_FOUND_IND || shmMeta[ind].memAddr == NULL) {
+			return Nan::ThrowError("File is not attached");
+		}
+		std::vector<ShmDirtyRange> ranges;
+		takeDirtyRanges(search, ranges);
+		if (info[1]->IsFunction()) {
+			Nan::AsyncQueueWorker(new CheckpointWorker(new Nan::Callback(info[1].As<Function>()), ranges));
+			return;
+		}
+		size_t bytes;
+		int err = syncDirtyRanges(ranges, bytes);
+		if (err != 0) {
+			restoreDirtyRanges(ranges);
+			return Nan::ThrowError(strerror(err));
+		}
+		info.GetReturnValue().Set(Nan::New<Number>((double) bytes));
+	}
+
+	// Find last attach of POSIX object, throws if not attached
+	static size_t getAttachedPosixShmObject(Local<Value> nameVal) {
+		if (!nameVal->IsString()) {
+			Nan::ThrowTypeError("Argument name must be a string");
+			return NOT_FOUND_IND;
+		}
+		ShmMeta search = {};
+		search.type = SHM_TYPE_POSIX;
+		search.id = NO_SHMID;
+		search.name = (*Nan::Utf8String(nameVal));
+		size_t ind = findShmSegmentInfo(search);
+		if (ind == NOT_FOUND_IND || shmMeta[ind].memAddr == NULL) {
+			Nan::ThrowError("POSIX shared memory object is not attached");
+			return NOT_FOUND_IND;
+		}
+		return ind;
+	}
+
+	// Change size of mapping of POSIX object, mapping can be moved
+	// Mapping shared with other attaches of this process is left to them, and object is mapped again
+	// Returns new address or MAP_FAILED (see errno)
+	static void* remapPosixShmObject(const ShmMeta& meta, size_t newRealSize) {
+		// Locked until table is updated, so other thread doesn't take reference to moved mapping
+		std::lock_guard<std::mutex> lock(shmMappingsMutex);
+		const auto found = shmMappings.find(meta.memAddr);
+		bool shared = found != shmMappings.end() && found->second.refs > 1;
+		void* res = MAP_FAILED;
+		struct stat sb = {};
+	#ifdef __linux__
+		if (!shared) {
+			res = mremap(meta.memAddr, meta.memSize, newRealSize, MREMAP_MAYMOVE);
+			if (res == MAP_FAILED)
+				return MAP_FAILED;
+			if (found != shmMappings.end()) {
+				sb.st_dev = found->second.dev;
+				sb.st_ino = found->second.ino;
+			}
+		}
+	#endif
+		if (res == MAP_FAILED) {
+			int fd = meta.hugetlbPath.empty() ? shm_open(meta.name.c_str(), O_RDWR, 0) : open(meta.hugetlbPath.c_str(), O_RDWR);
+			if (fd == -1)
+				return MAP_FAILED;
+			if (fstat(fd, &sb) == 0)
+				res = mmap(NULL, newRealSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			int err = errno;
+			close(fd);
+			if (res == MAP_FAILED) {
+				errno = err;
+				return MAP_FAILED;
+			}
+			if (!shared)
+				munmap(meta.memAddr, meta.memSize);
+		}
+		if (found != shmMappings.end()) {
+			// New mapping becomes reusable one, old one is used only by attaches which have it
+			ShmMapping mapping = found->second;
+			if (shared) {
+				found->second.refs--;
+				found->second.cacheKey.clear();
 			} else {
-				//not found in meta array, means not created/opened by us
-				int res = -1;
-				if (forceDestroy) {
-					res = detachShmSegment(meta, forceDestroy);
-				}
-				info.GetReturnValue().Set(Nan::New<Number>(res));
+				shmMappings.erase(found);
 			}
+			shmMappings[res] = ShmMapping{ newRealSize, 1, 0, mapping.cacheKey, mapping.segmentKey, mapping.type,
+				sb.st_dev, sb.st_ino };
+			if (!mapping.cacheKey.empty())
+				shmMappingsCache[mapping.cacheKey] = res;
 		}
+		return res;
 	}
 
-	NAN_METHOD(detachPosix) {
+	// Save remapped attach under new handle, so GC of old views doesn't detach it, and build new views
+	static Local<Value> registerRemap(size_t ind, void* newAddr, size_t newRealSize, size_t header,
+		ShmBufferType type, size_t chunkLength, bool autoDetach) {
+		ShmMeta meta = shmMeta[ind];
+		removeShmSegmentInfo(ind);
+		shmMappedBytes += newRealSize - meta.memSize;
+		const auto created = shmCreatedBytes.find(getShmSegmentKey(meta));
+		if (created != shmCreatedBytes.end()) {
+			shmAllocatedBytes += newRealSize - meta.memSize;
+			created->second += newRealSize - meta.memSize;
+		}
+		meta.memAddr = newAddr;
+		meta.memSize = newRealSize;
+		meta.posixHeader = header;
+		size_t newInd = addShmSegmentInfo(meta);
+		size_t size = header & POSIX_HEADER_SIZE_MASK;
+		char* buf = reinterpret_cast<char*>(newAddr) + meta.dataOffset;
+		return newShmViews(buf, size / getSizeForShmBufferType(type), chunkLength, type, newInd, autoDetach);
+	}
+
+	// Resolve type of views of attached POSIX object, throws if it's not allowed
+	static bool resolveAttachedPosixType(const ShmMeta& meta, ShmBufferType& type) {
+		ShmPosixHeader* header = getPosixHeader(meta.memAddr, meta.dataOffset);
+		if (!resolvePosixType(type, header ? (ShmBufferType) header->type : SHMBT_BUFFER)) {
+			Nan::ThrowTypeError("Shared memory object has other element type");
+			return false;
+		}
+		return true;
+	}
+
+	static bool checkViewsCount(size_t size, ShmBufferType type, size_t chunkLength) {
+		if (chunkLength > node::Buffer::kMaxLength) {
+			Nan::ThrowRangeError("Chunk length exceeds max length of buffer");
+			return false;
+		}
+		if (chunkLength == 0 && size / getSizeForShmBufferType(type) > node::Buffer::kMaxLength) {
+			Nan::ThrowRangeError("Object exceeds max length of buffer, use chunks");
+			return false;
+		}
+		return true;
+	}
+
+	NAN_METHOD(resizePosix) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		size_t ind = getAttachedPosixShmObject(info[0]);
+		if (ind == NOT_FOUND_IND)
+			return;
+		size_t newCount = Nan::To<int64_t>(info[1]).FromJust();
+		ShmBufferType type = (ShmBufferType) Nan::To<int32_t>(info[2]).FromJust();
+		size_t chunkLength = Nan::To<int64_t>(info[3]).FromMaybe(0);
+		bool autoDetach = Nan::To<bool>(info[4]).FromMaybe(false);
+		ShmMeta& meta = shmMeta[ind];
+		if (!resolveAttachedPosixType(meta, type))
+			return;
+		size_t newSize = newCount * getSizeForShmBufferType(type);
+		if (newSize == 0 || newSize > POSIX_HEADER_SIZE_MASK) {
+			return Nan::ThrowRangeError("Invalid size");
+		}
+		if (!checkViewsCount(newSize, type, chunkLength))
+			return;
+		if (!meta.hugetlbPath.empty()) {
+			return Nan::ThrowError("Resize of POSIX object in hugetlbfs is not supported");
+		}
+
+		std::atomic<size_t>* sizeWord = getPosixSizeWord(meta.memAddr, meta.dataOffset);
+		size_t oldHeader = sizeWord->load(std::memory_order_acquire);
+		// Legacy size word is read as plain size by older versions, so generation is kept only in header
+		size_t gen = POSIX_HEADER_GEN_BITS > 0 && meta.dataOffset != POSIX_LEGACY_DATA_OFFSET
+			? (oldHeader & ~POSIX_HEADER_SIZE_MASK) + POSIX_HEADER_SIZE_MASK + 1 : 0;
+		size_t newHeader = gen | newSize;
+		size_t newRealSize = newSize + meta.dataOffset;
+		bool grow = newRealSize > meta.memSize;
+		ShmPosixHeader* header = getPosixHeader(meta.memAddr, meta.dataOffset);
+		size_t elemSize = header ? getSizeForShmBufferType((ShmBufferType) header->type) : 1;
+		if (!grow) {
+			// Publish new size before truncate, so other processes don't access truncated memory after refresh
+			if (header)
+				header->count = newSize / elemSize;
+			sizeWord->store(newHeader, std::memory_order_release);
+		}
+		int fd = shm_open(meta.name.c_str(), O_RDWR, 0);
+		if (fd == -1) {
+			return Nan::ThrowError(strerror(errno));
+		}
+		int res = ftruncate(fd, newRealSize);
+		int err = errno;
+		close(fd);
+		if (res == -1) {
+			switch(err) {
+				case EFBIG: // length exceeds max file size
+				case EINVAL: // length exceeds max file size or < 0
+					return Nan::ThrowRangeError(strerror(err));
+				default:
+					return Nan::ThrowError(strerror(err));
+			}
+		}
+		void* newAddr = remapPosixShmObject(meta, newRealSize);
+		if (newAddr == MAP_FAILED) {
+			return Nan::ThrowError(strerror(errno));
+		}
+		if (grow) {
+			header = getPosixHeader(newAddr, meta.dataOffset);
+			if (header)
+				header->count = newSize / elemSize;
+			getPosixSizeWord(newAddr, meta.dataOffset)->store(newHeader, std::memory_order_release);
+		}
+		info.GetReturnValue().Set(registerRemap(ind, newAddr, newRealSize, newHeader, type, chunkLength, autoDetach));
+	}
+
+	NAN_METHOD(refreshPosix) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		size_t ind = getAttachedPosixShmObject(info[0]);
+		if (ind == NOT_FOUND_IND)
+			return;
+		ShmBufferType type = (ShmBufferType) Nan::To<int32_t>(info[1]).FromJust();
+		size_t chunkLength = Nan::To<int64_t>(info[2]).FromMaybe(0);
+		bool autoDetach = Nan::To<bool>(info[3]).FromMaybe(false);
+		ShmMeta& meta = shmMeta[ind];
+		if (!resolveAttachedPosixType(meta, type))
+			return;
+		size_t header = getPosixSizeWord(meta.memAddr, meta.dataOffset)->load(std::memory_order_acquire);
+		if (header == meta.posixHeader) {
+			// Not resized
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		size_t newSize = header & POSIX_HEADER_SIZE_MASK;
+		if (!checkViewsCount(newSize, type, chunkLength))
+			return;
+		size_t newRealSize = newSize + meta.dataOffset;
+		void* newAddr = newRealSize == meta.memSize ? meta.memAddr : remapPosixShmObject(meta, newRealSize);
+		if (newAddr == MAP_FAILED) {
+			return Nan::ThrowError(strerror(errno));
+		}
+		info.GetReturnValue().Set(registerRemap(ind, newAddr, newRealSize, header, type, chunkLength, autoDetach));
+	}
+
+	NAN_METHOD(objectInfo) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		size_t ind = getAttachedPosixShmObject(info[0]);
+		if (ind == NOT_FOUND_IND)
+			return;
+		const ShmMeta& meta = shmMeta[ind];
+		ShmPosixHeader* header = getPosixHeader(meta.memAddr, meta.dataOffset);
+		size_t size = getPosixSizeWord(meta.memAddr, meta.dataOffset)->load(std::memory_order_acquire)
+			& POSIX_HEADER_SIZE_MASK;
+		Local<Object> res = Nan::New<Object>();
+		Nan::Set(res, Nan::New("layoutVersion").ToLocalChecked(), Nan::New<Number>(header ? header->layoutVersion : 0));
+		Nan::Set(res, Nan::New("type").ToLocalChecked(), Nan::New<Number>(header ? header->type : SHMBT_BUFFER));
+		Nan::Set(res, Nan::New("count").ToLocalChecked(), Nan::New<Number>(header ? (double) header->count : (double) size));
+		Nan::Set(res, Nan::New("size").ToLocalChecked(), Nan::New<Number>((double) size));
+		Nan::Set(res, Nan::New("dataOffset").ToLocalChecked(), Nan::New<Number>((double) meta.dataOffset));
+		if (header)
+			Nan::Set(res, Nan::New("createdAt").ToLocalChecked(), Nan::New<Number>((double) header->createdAt));
+		else
+			Nan::Set(res, Nan::New("createdAt").ToLocalChecked(), Nan::Null());
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(mapWindow) {
 		Nan::HandleScope scope;
+		bool isFile = Nan::To<bool>(info[1]).FromJust();
 		if (!info[0]->IsString()) {
-			return Nan::ThrowTypeError("Argument name must be a string");
+			return Nan::ThrowTypeError(isFile ? "Argument path must be a string" : "Argument name must be a string");
 		}
 		std::string name = (*Nan::Utf8String(info[0]));
-		bool forceDestroy = Nan::To<bool>(info[1]).FromJust();
-
-		ShmMeta meta = {
-			.type=SHM_TYPE_POSIX, .id=NO_SHMID, .memAddr=NULL, .memSize=0, .name=name
-		};
-		size_t foundInd = findShmSegmentInfo(meta);
-		if (foundInd != NOT_FOUND_IND) {
-			int res = detachPosixShmObject(shmMeta[foundInd], forceDestroy);
-			if (res != -1)
-				removeShmSegmentInfo(foundInd);
-			info.GetReturnValue().Set(Nan::New<Number>(res));
-		} else {
-			//not found in meta array, means not created/opened by us
-			int res = -1;
-			if (forceDestroy) {
-				res = detachPosixShmObject(meta, forceDestroy);
+		size_t offset = Nan::To<double>(info[2]).FromJust();
+		size_t length = Nan::To<double>(info[3]).FromJust();
+		ShmBufferType type = (ShmBufferType) Nan::To<int32_t>(info[4]).FromJust();
+		int mapFlags = Nan::To<int32_t>(info[5]).FromJust();
+		bool willNeed = Nan::To<bool>(info[6]).FromJust();
+
+		// Open object, header is read with pread(), so object is never mapped whole
+		std::string hugetlbPath;
+		int fd = isFile ? open(name.c_str(), O_RDWR | O_CLOEXEC) : shm_open(name.c_str(), O_RDWR, 0);
+		if (fd == -1 && errno == ENOENT && !isFile) {
+			fd = openHugetlbfsObject(name, O_RDWR, 0, 0, hugetlbPath);
+			if (fd == -1)
+				errno = ENOENT;
+		}
+		if (fd == -1) {
+			if (errno == ENOENT) {
+				info.GetReturnValue().SetNull();
+				return;
 			}
-			info.GetReturnValue().Set(Nan::New<Number>(res));
+			return Nan::ThrowError(strerror(errno));
+		}
+		struct stat sb;
+		ShmPosixHeader header;
+		ssize_t headerSize = fstat(fd, &sb) == 0 ? pread(fd, &header, sizeof(header), 0) : -1;
+		if (headerSize == -1) {
+			int err = errno;
+			close(fd);
+			return Nan::ThrowError(strerror(err));
+		}
+		ShmBufferType storedType = SHMBT_BUFFER;
+		size_t dataOffset = POSIX_LEGACY_DATA_OFFSET;
+		size_t size;
+		if (headerSize == (ssize_t) sizeof(header) && header.magic == POSIX_HEADER_MAGIC) {
+			if (header.layoutVersion > POSIX_LAYOUT_VERSION || header.dataOffset < sizeof(ShmPosixHeader)) {
+				close(fd);
+				return Nan::ThrowError("Unsupported layout of shared memory object");
+			}
+			storedType = (ShmBufferType) header.type;
+			dataOffset = header.dataOffset;
+			size = header.sizeGen.load(std::memory_order_relaxed) & POSIX_HEADER_SIZE_MASK;
+		} else if (!isFile && headerSize >= (ssize_t) POSIX_LEGACY_DATA_OFFSET) {
+			size = *reinterpret_cast<size_t*>(&header) & POSIX_HEADER_SIZE_MASK;
+		} else {
+			close(fd);
+			return Nan::ThrowError(isFile ? "File is not shared memory file" : "Object is not shared memory object");
+		}
+		if (!resolvePosixType(type, storedType)) {
+			close(fd);
+			return Nan::ThrowTypeError("Shared memory object has other element type");
+		}
+		// Don't map past end of file, access to such pages raises SIGBUS
+		size = std::min(size, (size_t) sb.st_size > dataOffset ? (size_t) sb.st_size - dataOffset : 0);
+		size_t elemSize = getSizeForShmBufferType(type);
+		size_t count = size / elemSize;
+		if (offset >= count) {
+			close(fd);
+			return Nan::ThrowRangeError("Window is out of bounds of object");
 		}
+		length = std::min(length, count - offset);
+		if (length > node::Buffer::kMaxLength) {
+			close(fd);
+			return Nan::ThrowRangeError("Window exceeds max length of buffer");
+		}
+
+		// Mapping of hugetlbfs file should be aligned to huge page
+		size_t alignment = hugetlbPath.empty() ? (size_t) sysconf(_SC_PAGESIZE) : (size_t) sb.st_blksize;
+		void* hint;
+		char* data = mapShmWindow(fd, dataOffset + offset * elemSize, length * elemSize, alignment, mapFlags,
+			willNeed, &hint);
+		int err = errno;
+		close(fd);
+		if (data == NULL) {
+			return Nan::ThrowError(strerror(err));
+		}
+		Local<Object> res = Nan::NewTypedBuffer(data, length, releaseShmWindow, hint, type).ToLocalChecked();
+		Nan::Set(res, Nan::New("objectLength").ToLocalChecked(), Nan::New<Number>((double) count));
+		info.GetReturnValue().Set(res);
 	}
 
 	NAN_METHOD(detachAll) {
-		int cnt = detachAllShm();
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		int cnt = detachAllShm(shmCurrentEnv.get());
 		info.GetReturnValue().Set(Nan::New<Number>(cnt));
 	}
 
 	NAN_METHOD(getTotalAllocatedSize) {
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
 		info.GetReturnValue().Set(Nan::New<Number>(shmAllocatedBytes));
 	}
 
 	NAN_METHOD(getTotalUsedSize) {
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
 		info.GetReturnValue().Set(Nan::New<Number>(shmMappedBytes));
 	}
 
-	// node::AtExit
-	static void AtNodeExit(void*) {
-		detachAllShm();
-		shmMeta.clear();
+	// Set stats known from System V segment itself or from header of POSIX object, memfd or file
+	static void setShmOwnerStats(Local<Object> res, const ShmMeta& meta) {
+		Local<Value> size = Nan::Null(), nattch = Nan::Null(), creatorPid = Nan::Null(), createdAt = Nan::Null();
+		if (meta.type == SHM_TYPE_SYSTEMV) {
+			struct shmid_ds shminf;
+			if (shmctl(meta.id, IPC_STAT, &shminf) == 0) {
+			#ifdef __linux__
+				key_t key = shminf.shm_perm.__key;
+			#else
+				key_t key = shminf.shm_perm._key;
+			#endif
+				Nan::Set(res, Nan::New("key").ToLocalChecked(), Nan::New<Number>((uint32_t) key));
+				size = Nan::New<Number>((double) shminf.shm_segsz);
+				nattch = Nan::New<Number>((double) shminf.shm_nattch);
+				creatorPid = Nan::New<Number>(shminf.shm_cpid);
+				// Time of creation or last change with IPC_SET
+				createdAt = Nan::New<Number>((double) shminf.shm_ctime * 1000);
+			}
+			Nan::Set(res, Nan::New("id").ToLocalChecked(), Nan::New<Number>(meta.id));
+		} else {
+			ShmPosixHeader* header = getPosixHeader(meta.memAddr, meta.dataOffset);
+			size = Nan::New<Number>((double) (getPosixSizeWord(meta.memAddr, meta.dataOffset)->load(std::memory_order_acquire)
+				& POSIX_HEADER_SIZE_MASK));
+			if (header) {
+				createdAt = Nan::New<Number>((double) header->createdAt);
+				if (header->creatorPid != 0)
+					creatorPid = Nan::New<Number>(header->creatorPid);
+			}
+			if (meta.type == SHM_TYPE_MEMFD)
+				Nan::Set(res, Nan::New("fd").ToLocalChecked(), Nan::New<Number>(meta.id));
+			else
+				Nan::Set(res, Nan::New("name").ToLocalChecked(), Nan::New(meta.name).ToLocalChecked());
+		}
+		Nan::Set(res, Nan::New("size").ToLocalChecked(), size);
+		Nan::Set(res, Nan::New("nattch").ToLocalChecked(), nattch);
+		Nan::Set(res, Nan::New("creatorPid").ToLocalChecked(), creatorPid);
+		Nan::Set(res, Nan::New("createdAt").ToLocalChecked(), createdAt);
+	}
+
+	NAN_METHOD(stats) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		// Last attach of every segment/object in every environment, grouped by segment/object in order of slots
+		std::vector<size_t> lastInds;
+		std::unordered_map<std::string, std::vector<size_t>> envLastInds;
+		for (const auto& entry : shmMetaIndex) {
+			if (shmMeta[entry.second].memAddr != NULL)
+				envLastInds[getShmSegmentKey(shmMeta[entry.second])].push_back(entry.second);
+		}
+		for (auto& entry : envLastInds) {
+			std::sort(entry.second.begin(), entry.second.end());
+			lastInds.push_back(entry.second.front());
+		}
+		std::sort(lastInds.begin(), lastInds.end());
+		std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+		for (size_t ind : lastInds) {
+			uintptr_t memStart = reinterpret_cast<uintptr_t>(shmMeta[ind].memAddr);
+			ranges.push_back(std::make_pair(memStart, memStart + shmMeta[ind].memSize));
+		}
+		std::vector<ShmPageStats> pageStats;
+		int err = readPageStats(ranges, pageStats);
+		if (err != 0) {
+			return Nan::ThrowError(strerror(err));
+		}
+		size_t sysPageSize = sysconf(_SC_PAGESIZE);
+
+		v8::Local<v8::Array> res = Nan::New<v8::Array>(lastInds.size());
+		for (size_t i = 0; i < lastInds.size(); i++) {
+			const ShmMeta& meta = shmMeta[lastInds[i]];
+			size_t attaches = 0, mappedBytes = 0;
+			bool isOwner = false;
+			// Attaches sharing mapping are counted once in mappedBytes
+			std::set<void*> mappings;
+			for (size_t lastInd : envLastInds[getShmSegmentKey(meta)]) {
+				for (size_t ind = lastInd; ind != NOT_FOUND_IND; ind = shmMeta[ind].prevInd) {
+					attaches++;
+					if (mappings.insert(shmMeta[ind].memAddr).second)
+						mappedBytes += shmMeta[ind].memSize;
+					isOwner = isOwner || shmMeta[ind].isOwner;
+				}
+			}
+			// All attaches map same pages, so residency of last one is residency of segment
+			size_t residentPages;
+			err = countResidentPages(meta.memAddr, meta.memSize, residentPages);
+
+			Local<Object> segment = Nan::New<Object>();
+			Nan::Set(segment, Nan::New("type").ToLocalChecked(), Nan::New<Number>(meta.type));
+			setShmOwnerStats(segment, meta);
+			Nan::Set(segment, Nan::New("mappedBytes").ToLocalChecked(), Nan::New<Number>((double) mappedBytes));
+			Nan::Set(segment, Nan::New("attaches").ToLocalChecked(), Nan::New<Number>((double) attaches));
+			Nan::Set(segment, Nan::New("isOwner").ToLocalChecked(), Nan::New<v8::Boolean>(isOwner));
+			Nan::Set(segment, Nan::New("pageSize").ToLocalChecked(), Nan::New<Number>((double) pageStats[i].pageSize));
+			Nan::Set(segment, Nan::New("hugetlb").ToLocalChecked(), Nan::New<v8::Boolean>(pageStats[i].pageSize > sysPageSize));
+			Nan::Set(segment, Nan::New("transparentHugeBytes").ToLocalChecked(),
+				Nan::New<Number>((double) pageStats[i].transparentHugeBytes));
+			if (err == 0) {
+				Nan::Set(segment, Nan::New("residentPages").ToLocalChecked(), Nan::New<Number>((double) residentPages));
+				Nan::Set(segment, Nan::New("residentBytes").ToLocalChecked(),
+					Nan::New<Number>((double) residentPages * sysPageSize));
+			} else {
+				Nan::Set(segment, Nan::New("residentPages").ToLocalChecked(), Nan::Null());
+				Nan::Set(segment, Nan::New("residentBytes").ToLocalChecked(), Nan::Null());
+			}
+			Nan::Set(segment, Nan::New("pages").ToLocalChecked(),
+				Nan::New<Number>((double) roundUpToPageSize(meta.memSize, sysPageSize) / sysPageSize));
+			Nan::Set(res, i, segment);
+		}
+		info.GetReturnValue().Set(res);
+	}
+
+	// System V segment or POSIX object of any process, found by list()
+	struct ShmListEntry {
+		ShmType type;
+		key_t key;
+		int id;
+		std::string name; // name of POSIX object, with leading slash
+		size_t size; // size of data for POSIX objects with header, size of file otherwise
+		int nattch; // -1 for POSIX objects
+		uid_t uid;
+		mode_t mode;
+		pid_t creatorPid; // 0 if unknown
+		pid_t lastPid; // last shmat()/shmdt() of System V segment, 0 if unknown
+		pid_t ownerPid; // owner of lease, or creator if object has no lease, 0 if unknown
+		uint32_t ownerNs; // PID namespace of owner of lease, 0 if unknown
+		int64_t createdAt; // ms since epoch, 0 if unknown
+		int64_t activeAt; // last heartbeat, attach, detach or change in ms since epoch, 0 if unknown
+		bool isShm; // POSIX object has header of this library
+		bool hasLease;
+	};
+
+	static int64_t getRealtimeMs() {
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
 	}
 
-	// Init module
-	#if NODE_MODULE_VERSION < NODE_16_0_MODULE_VERSION
-	static void Init(Local<Object> target) {
+	uint64_t getProcessStartTime(pid_t pid) {
+	#ifdef __linux__
+		char path[32];
+		snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd == -1)
+			return 0;
+		char buf[1024];
+		ssize_t n = read(fd, buf, sizeof(buf) - 1);
+		close(fd);
+		if (n <= 0)
+			return 0;
+		buf[n] = 0;
+		// Name of command in parens can contain spaces and parens, start time is 20th field after it
+		char* p = strrchr(buf, ')');
+		for (int i = 0; i < 20 && p != NULL; i++) {
+			p = strchr(p + 1, ' ');
+		}
+		return p != NULL ? strtoull(p + 1, NULL, 10) : 0;
 	#else
-	static void Init(Local<Object> target, Local<Value> module, void* priv) {
+		(void) pid;
+		return 0;
+	#endif
+	}
+
+	uint64_t getPidNamespaceId() {
+	#ifdef __linux__
+		struct stat st;
+		if (stat("/proc/self/ns/pid", &st) == 0)
+			return (uint64_t) st.st_ino;
+	#endif
+		return 0;
+	}
+
+	// Time of boot in ms since epoch, 0 if unknown
+	static int64_t getBootTimeMs() {
+		static std::atomic<int64_t> bootTimeMs(-1);
+		int64_t res = bootTimeMs.load(std::memory_order_relaxed);
+		if (res >= 0)
+			return res;
+		res = 0;
+	#ifdef __linux__
+		FILE* f = fopen("/proc/stat", "r");
+		if (f != NULL) {
+			char line[256];
+			long long btime;
+			while (fgets(line, sizeof(line), f)) {
+				if (sscanf(line, "btime %lld", &btime) == 1) {
+					res = btime * 1000;
+					break;
+				}
+			}
+			fclose(f);
+		}
+	#endif
+		bootTimeMs.store(res, std::memory_order_relaxed);
+		return res;
+	}
+
+	// Process exists (maybe owned by other user), and it was started before activeAt (ms since epoch, 0 if unknown)
+	// Process started later reused pid of dead owner
+	static bool isProcessAlive(pid_t pid, int64_t activeAt) {
+		if (kill(pid, 0) != 0 && errno != EPERM)
+			return false;
+		uint64_t startTicks = getProcessStartTime(pid);
+		int64_t bootTimeMs = getBootTimeMs();
+		if (activeAt == 0 || startTicks == 0 || bootTimeMs == 0)
+			return true;
+		int64_t startedAt = bootTimeMs + (int64_t) (startTicks * 1000 / sysconf(_SC_CLK_TCK));
+		// Boot time is in seconds, and realtime clock can be adjusted
+		return startedAt <= activeAt + PROCESS_START_SLACK_MS;
+	}
+
+	// Owner of listed segment/object is alive, false if it's unknown or in other PID namespace
+	static bool isListedOwnerAlive(const ShmListEntry& entry) {
+		// Creator of System V segment started before it was created
+		return isProcessAlive(entry.ownerPid, entry.type == SHM_TYPE_SYSTEMV ? entry.createdAt : entry.activeAt);
+	}
+
+	// Pid of owner can't be checked in PID namespace of this process
+	static inline bool isListedOwnerForeign(const ShmListEntry& entry) {
+		uint32_t ns = (uint32_t) getPidNamespaceId();
+		return entry.ownerNs != 0 && ns != 0 && entry.ownerNs != ns;
+	}
+
+	// Parse /proc/sysvipc/shm, columns are found by names in first line
+	static void readSysvSegments(std::vector<ShmListEntry>& entries) {
+	#ifdef __linux__
+		FILE* f = fopen("/proc/sysvipc/shm", "r");
+		if (f == NULL)
+			return;
+		char line[1024];
+		std::unordered_map<std::string, size_t> columns;
+		if (fgets(line, sizeof(line), f)) {
+			size_t col = 0;
+			for (char* tok = strtok(line, " \t\n"); tok != NULL; tok = strtok(NULL, " \t\n"))
+				columns[tok] = col++;
+		}
+		const char* names[] = { "key", "shmid", "perms", "size", "cpid", "lpid", "nattch", "uid", "atime", "dtime", "ctime" };
+		size_t inds[sizeof(names) / sizeof(names[0])];
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+			auto found = columns.find(names[i]);
+			if (found == columns.end()) {
+				fclose(f);
+				return;
+			}
+			inds[i] = found->second;
+		}
+		std::vector<long long> values(columns.size());
+		while (fgets(line, sizeof(line), f)) {
+			size_t col = 0;
+			for (char* tok = strtok(line, " \t\n"); tok != NULL && col < values.size(); tok = strtok(NULL, " \t\n"), col++)
+				values[col] = strtoll(tok, NULL, col == inds[2] ? 8 : 10);
+			if (col < values.size())
+				continue;
+			ShmListEntry entry = ShmListEntry();
+			entry.type = SHM_TYPE_SYSTEMV;
+			entry.key = (key_t) values[inds[0]];
+			entry.id = (int) values[inds[1]];
+			entry.mode = (mode_t) values[inds[2]] & 0777;
+			entry.size = (size_t) values[inds[3]];
+			entry.creatorPid = (pid_t) values[inds[4]];
+			entry.lastPid = (pid_t) values[inds[5]];
+			entry.ownerPid = entry.creatorPid;
+			entry.nattch = (int) values[inds[6]];
+			entry.uid = (uid_t) values[inds[7]];
+			entry.createdAt = values[inds[10]] * 1000;
+			entry.activeAt = std::max(std::max(values[inds[8]], values[inds[9]]), values[inds[10]]) * 1000;
+			entries.push_back(entry);
+		}
+		fclose(f);
 	#endif
+	}
+
+	// Read header of POSIX object in directory without mapping it
+	// Returns false if file is not regular or can't be opened
+	static bool readPosixObjectEntry(int dirFd, const char* fileName, ShmListEntry& entry) {
+		int fd = openat(dirFd, fileName, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+		struct stat sb;
+		if (fd == -1)
+			return false;
+		if (fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode)) {
+			close(fd);
+			return false;
+		}
+		entry = ShmListEntry();
+		entry.type = SHM_TYPE_POSIX;
+		entry.name = std::string("/") + fileName;
+		entry.nattch = -1;
+		entry.uid = sb.st_uid;
+		entry.mode = sb.st_mode & 0777;
+		entry.size = sb.st_size;
+		entry.activeAt = (int64_t) sb.st_mtime * 1000;
+		ShmPosixHeader header;
+		if (pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header)
+			&& header.magic == POSIX_HEADER_MAGIC && header.dataOffset == sizeof(ShmPosixHeader)) {
+			entry.isShm = true;
+			entry.size = header.sizeGen.load(std::memory_order_relaxed) & POSIX_HEADER_SIZE_MASK;
+			entry.creatorPid = header.creatorPid;
+			entry.createdAt = header.createdAt;
+			entry.ownerPid = header.leasePid.load(std::memory_order_relaxed);
+			entry.hasLease = entry.ownerPid != 0;
+			if (entry.hasLease) {
+				entry.ownerNs = header.leaseNs.load(std::memory_order_relaxed);
+				entry.activeAt = header.heartbeatAt.load(std::memory_order_relaxed);
+			} else {
+				entry.ownerPid = entry.creatorPid;
+				entry.activeAt = entry.createdAt;
+			}
+		}
+		close(fd);
+		return true;
+	}
+
+	// Scan directory of POSIX objects, returns 0 or errno
+	static int readPosixObjects(std::vector<ShmListEntry>& entries) {
+		DIR* dir = opendir(POSIX_SHM_DIR);
+		if (dir == NULL)
+			return errno == ENOENT ? 0 : errno;
+		struct dirent* ent;
+		while ((ent = readdir(dir)) != NULL) {
+			if (ent->d_name[0] == '.')
+				continue;
+			// d_type is DT_UNKNOWN on some file systems, then file is checked by fstat()
+			if (ent->d_type != DT_REG && ent->d_type != DT_UNKNOWN)
+				continue;
+			ShmListEntry entry;
+			if (readPosixObjectEntry(dirfd(dir), ent->d_name, entry))
+				entries.push_back(entry);
+		}
+		closedir(dir);
+		return 0;
+	}
+
+	// Listed segment/object is attached by any environment of this process
+	static bool isListedShmAttached(const ShmListEntry& entry) {
+		ShmMeta search = {};
+		search.type = entry.type;
+		search.id = entry.id;
+		search.name = entry.name;
+		for (ShmEnv* env : shmEnvs) {
+			if (shmMetaIndex.find(getShmIndexKey(search, env)) != shmMetaIndex.end())
+				return true;
+		}
+		return false;
+	}
+
+	static Local<Object> newListEntry(const ShmListEntry& entry) {
+		Local<Object> res = Nan::New<Object>();
+		Nan::Set(res, Nan::New("type").ToLocalChecked(), Nan::New<Number>(entry.type));
+		if (entry.type == SHM_TYPE_SYSTEMV) {
+			Nan::Set(res, Nan::New("key").ToLocalChecked(), Nan::New<Number>((uint32_t) entry.key));
+			Nan::Set(res, Nan::New("id").ToLocalChecked(), Nan::New<Number>(entry.id));
+			Nan::Set(res, Nan::New("nattch").ToLocalChecked(), Nan::New<Number>(entry.nattch));
+		} else {
+			Nan::Set(res, Nan::New("name").ToLocalChecked(), Nan::New(entry.name).ToLocalChecked());
+			Nan::Set(res, Nan::New("nattch").ToLocalChecked(), Nan::Null());
+		}
+		Nan::Set(res, Nan::New("size").ToLocalChecked(), Nan::New<Number>((double) entry.size));
+		Nan::Set(res, Nan::New("uid").ToLocalChecked(), Nan::New<Number>(entry.uid));
+		Nan::Set(res, Nan::New("mode").ToLocalChecked(), Nan::New<Number>(entry.mode));
+		Local<Value> creatorPid = Nan::Null(), ownerPid = Nan::Null(), ownerAlive = Nan::Null();
+		if (entry.creatorPid != 0)
+			creatorPid = Nan::New<Number>(entry.creatorPid);
+		if (entry.ownerPid != 0) {
+			ownerPid = Nan::New<Number>(entry.ownerPid);
+			if (!isListedOwnerForeign(entry))
+				ownerAlive = Nan::New<v8::Boolean>(isListedOwnerAlive(entry));
+		}
+		Nan::Set(res, Nan::New("creatorPid").ToLocalChecked(), creatorPid);
+		Nan::Set(res, Nan::New("ownerPid").ToLocalChecked(), ownerPid);
+		Nan::Set(res, Nan::New("ownerAlive").ToLocalChecked(), ownerAlive);
+		Nan::Set(res, Nan::New("lease").ToLocalChecked(), Nan::New<v8::Boolean>(entry.hasLease));
+		Nan::Set(res, Nan::New("createdAt").ToLocalChecked(),
+			entry.createdAt != 0 ? Nan::New<Number>((double) entry.createdAt).As<Value>() : Nan::Null().As<Value>());
+		Nan::Set(res, Nan::New("activeAt").ToLocalChecked(),
+			entry.activeAt != 0 ? Nan::New<Number>((double) entry.activeAt).As<Value>() : Nan::Null().As<Value>());
+		Nan::Set(res, Nan::New("attached").ToLocalChecked(), Nan::New<v8::Boolean>(isListedShmAttached(entry)));
+		return res;
+	}
+
+	NAN_METHOD(list) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		std::vector<ShmListEntry> entries;
+		readSysvSegments(entries);
+		int err = readPosixObjects(entries);
+		if (err != 0) {
+			return Nan::ThrowError(strerror(err));
+		}
+		v8::Local<v8::Array> res = Nan::New<v8::Array>(entries.size());
+		for (size_t i = 0; i < entries.size(); i++)
+			Nan::Set(res, i, newListEntry(entries[i]));
+		info.GetReturnValue().Set(res);
+	}
+
+	// Segment/object is orphaned: its owner is dead (or lease is expired), and it's inactive for olderThan ms
+	// Segments of other users, attached System V segments and objects of other libraries are never orphaned
+	static bool isOrphanedShm(const ShmListEntry& entry, int64_t now, double olderThan, double leaseTimeout) {
+		if (geteuid() != 0 && entry.uid != geteuid())
+			return false;
+		if (entry.type == SHM_TYPE_SYSTEMV ? entry.nattch != 0 : !entry.isShm)
+			return false;
+		if (entry.ownerPid == 0 || now - entry.activeAt < olderThan)
+			return false;
+		if (entry.hasLease && leaseTimeout >= 0 && now - entry.activeAt >= leaseTimeout)
+			return true;
+		// Otherwise lease of owner from other PID namespace never expires
+		if (isListedOwnerForeign(entry))
+			return false;
+		// Other process can still use System V segment, eg. it was attached after creator's death
+		return !isListedOwnerAlive(entry) && (entry.lastPid == 0 || !isProcessAlive(entry.lastPid, entry.activeAt));
+	}
+
+	NAN_METHOD(reap) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		double olderThan = Nan::To<double>(info[0]).FromJust();
+		double leaseTimeout = Nan::To<double>(info[1]).FromJust();
+		bool dryRun = Nan::To<bool>(info[2]).FromJust();
+		bool sysv = Nan::To<bool>(info[3]).FromJust();
+		bool posix = Nan::To<bool>(info[4]).FromJust();
+		std::string prefix = (*Nan::Utf8String(info[5]));
+
+		std::vector<ShmListEntry> entries;
+		if (sysv)
+			readSysvSegments(entries);
+		if (posix) {
+			int err = readPosixObjects(entries);
+			if (err != 0) {
+				return Nan::ThrowError(strerror(err));
+			}
+		}
+		int64_t now = getRealtimeMs();
+		v8::Local<v8::Array> res = Nan::New<v8::Array>();
+		uint32_t reapedCnt = 0;
+		for (const ShmListEntry& entry : entries) {
+			if (entry.type == SHM_TYPE_POSIX && entry.name.compare(0, prefix.size(), prefix) != 0)
+				continue;
+			if (!isOrphanedShm(entry, now, olderThan, leaseTimeout) || isListedShmAttached(entry))
+				continue;
+			if (!dryRun) {
+				ShmMeta meta = {};
+				meta.type = entry.type;
+				meta.id = entry.id;
+				meta.name = entry.name;
+				int destroyed;
+				if (entry.type == SHM_TYPE_SYSTEMV) {
+					// Destroyed only if nattch is still 0
+					destroyed = detachShmSegment(meta, false, true);
+				} else {
+					// Owner could renew lease after scan
+					ShmListEntry current;
+					int dirFd = open(POSIX_SHM_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+					bool orphaned = dirFd != -1 && readPosixObjectEntry(dirFd, entry.name.c_str() + 1, current)
+						&& isOrphanedShm(current, now, olderThan, leaseTimeout);
+					if (dirFd != -1)
+						close(dirFd);
+					destroyed = orphaned ? detachPosixShmObject(meta, true, true) : -1;
+				}
+				if (destroyed != 0)
+					continue;
+			}
+			Nan::Set(res, reapedCnt++, newListEntry(entry));
+		}
+		info.GetReturnValue().Set(res);
+	}
+
+	// Renew lease of attached POSIX object (or file, memfd), returns false if it has no header
+	static bool renewLease(const ShmMeta& meta, bool take, int64_t now) {
+		ShmPosixHeader* header = getPosixHeader(meta.memAddr, meta.dataOffset);
+		if (header == NULL)
+			return false;
+		if (take) {
+			header->leasePid.store(getpid(), std::memory_order_relaxed);
+			header->leaseNs.store((uint32_t) getPidNamespaceId(), std::memory_order_relaxed);
+		} else if (header->leasePid.load(std::memory_order_relaxed) != getpid())
+			return false;
+		header->heartbeatAt.store(now, std::memory_order_release);
+		return true;
+	}
+
+	NAN_METHOD(heartbeat) {
+		Nan::HandleScope scope;
+		processReleasedViews();
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		int64_t now = getRealtimeMs();
+		if (info[0]->IsString()) {
+			size_t ind = getAttachedPosixShmObject(info[0]);
+			if (ind == NOT_FOUND_IND)
+				return;
+			if (!renewLease(shmMeta[ind], true, now)) {
+				return Nan::ThrowError("Shared memory object has no header, it was created by older version");
+			}
+			info.GetReturnValue().Set(Nan::New<Number>(1));
+			return;
+		}
+		// Leases of this process, every object is renewed once
+		int cnt = 0;
+		for (const auto& entry : shmMetaIndex) {
+			const ShmMeta& meta = shmMeta[entry.second];
+			if (meta.type != SHM_TYPE_SYSTEMV && meta.memAddr != NULL && renewLease(meta, false, now))
+				cnt++;
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(cnt));
+	}
+
+	// Find attached segment by key or object by name, returns NOT_FOUND_IND if not attached
+	static size_t findAttachedShm(Local<Value> keyOrName) {
+		ShmMeta meta = {};
+		meta.type = SHM_TYPE_POSIX;
+		meta.id = NO_SHMID;
+		if (keyOrName->IsString()) {
+			meta.name = (*Nan::Utf8String(keyOrName));
+		} else {
+			key_t key = Nan::To<uint32_t>(keyOrName).FromJust();
+			meta.type = SHM_TYPE_SYSTEMV;
+			meta.id = shmget(key, 0, 0);
+			if (meta.id == -1)
+				return NOT_FOUND_IND;
+		}
+		size_t foundInd = findShmSegmentInfo(meta);
+		if (foundInd == NOT_FOUND_IND || shmMeta[foundInd].memAddr == NULL)
+			return NOT_FOUND_IND;
+		return foundInd;
+	}
+
+	NAN_METHOD(pageInfo) {
+		Nan::HandleScope scope;
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		size_t foundInd = findAttachedShm(info[0]);
+		if (foundInd == NOT_FOUND_IND) {
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		uintptr_t memStart = reinterpret_cast<uintptr_t>(shmMeta[foundInd].memAddr);
+		std::vector<std::pair<uintptr_t, uintptr_t>> ranges(1, std::make_pair(memStart, memStart + shmMeta[foundInd].memSize));
+		std::vector<ShmPageStats> pageStats;
+		int err = readPageStats(ranges, pageStats);
+		if (err != 0) {
+			return Nan::ThrowError(strerror(err));
+		}
+		size_t sysPageSize = sysconf(_SC_PAGESIZE);
+		size_t pageSize = pageStats[0].pageSize;
+		size_t transparentHugeBytes = pageStats[0].transparentHugeBytes;
+
+		Local<Object> res = Nan::New<Object>();
+		Nan::Set(res, Nan::New("pageSize").ToLocalChecked(), Nan::New<Number>(pageSize));
+		Nan::Set(res, Nan::New("hugetlb").ToLocalChecked(), Nan::New<v8::Boolean>(pageSize > sysPageSize));
+		Nan::Set(res, Nan::New("transparentHugeBytes").ToLocalChecked(), Nan::New<Number>(transparentHugeBytes));
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(numaInfo) {
+		Nan::HandleScope scope;
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		size_t foundInd = findAttachedShm(info[0]);
+		if (foundInd == NOT_FOUND_IND) {
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		info.GetReturnValue().Set(newNumaInfo(shmMeta[foundInd].memAddr, shmMeta[foundInd].memSize));
+	}
+
+	static void onReleasedAsyncClosed(uv_handle_t* handle) {
+		delete reinterpret_cast<uv_async_t*>(handle);
+	}
+
+	// node::AtExit or cleanup hook of environment (main thread or worker thread)
+	// Detaches attaches of environment, mappings shared with other environments stay mapped
+	static void AtNodeExit(void* arg) {
+		ShmEnv* env = static_cast<ShmEnv*>(arg);
+		{
+			std::lock_guard<std::mutex> lock(env->releasedMutex);
+			if (env->releasedAsync != NULL) {
+				uv_close(reinterpret_cast<uv_handle_t*>(env->releasedAsync), onReleasedAsyncClosed);
+				env->releasedAsync = NULL;
+			}
+			env->releasedHandles.clear();
+		}
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		detachAllShm(env);
+		// Views of environment can't be used anymore
+		for (size_t ind = 0; ind < shmMeta.size(); ind++) {
+			if (!shmMeta[ind].indexKey.empty() && shmMeta[ind].env == env)
+				removeShmSegmentInfo(ind);
+		}
+		shmEnvs.erase(std::remove(shmEnvs.begin(), shmEnvs.end(), env), shmEnvs.end());
+		if (shmCurrentEnv.get() == env)
+			shmCurrentEnv.reset();
+	}
 
-		detachAllShm();
+	// Init module, called for every environment which loads addon
+	static void Init(Local<Object> target) {
+		std::lock_guard<std::recursive_mutex> metaLock(shmMetaMutex);
+		if (!shmCurrentEnv) {
+			shmCurrentEnv = std::make_shared<ShmEnv>();
+			shmCurrentEnv->releasedAsync = new uv_async_t();
+			uv_async_init(Nan::GetCurrentEventLoop(), shmCurrentEnv->releasedAsync, onReleasedViews);
+			uv_unref(reinterpret_cast<uv_handle_t*>(shmCurrentEnv->releasedAsync));
+			shmEnvs.push_back(shmCurrentEnv.get());
+			#if NODE_MODULE_VERSION < NODE_16_0_MODULE_VERSION
+			node::AtExit(AtNodeExit, shmCurrentEnv.get());
+			#else
+			node::AddEnvironmentCleanupHook(target->GetIsolate(), AtNodeExit, shmCurrentEnv.get());
+			#endif
+		}
+		detachAllShm(shmCurrentEnv.get());
 
 		Nan::SetMethod(target, "get", get);
 		Nan::SetMethod(target, "getPosix", getPosix);
 		Nan::SetMethod(target, "detach", detach);
 		Nan::SetMethod(target, "detachPosix", detachPosix);
+		Nan::SetMethod(target, "resizePosix", resizePosix);
+		Nan::SetMethod(target, "refreshPosix", refreshPosix);
+		Nan::SetMethod(target, "objectInfo", objectInfo);
+		Nan::SetMethod(target, "mapWindow", mapWindow);
+		Nan::SetMethod(target, "unmapWindow", unmapWindow);
+		Nan::SetMethod(target, "discardWindow", discardWindow);
+		Nan::SetMethod(target, "getMemfd", getMemfd);
+		Nan::SetMethod(target, "detachMemfd", detachMemfd);
+		Nan::SetMethod(target, "sealMemfd", sealMemfd);
+		Nan::SetMethod(target, "memfdSeals", memfdSeals);
+		Nan::SetMethod(target, "sendFd", sendFd);
+		Nan::SetMethod(target, "recvFd", recvFd);
+		Nan::SetMethod(target, "getFile", getFile);
+		Nan::SetMethod(target, "detachFile", detachFile);
+		Nan::SetMethod(target, "fileMarkDirty", fileMarkDirty);
+		Nan::SetMethod(target, "fileCheckpoint", fileCheckpoint);
+		Nan::SetMethod(target, "flush", flush);
 		Nan::SetMethod(target, "detachAll", detachAll);
 		Nan::SetMethod(target, "getTotalAllocatedSize", getTotalAllocatedSize);
 		Nan::SetMethod(target, "getTotalUsedSize", getTotalUsedSize);
+		Nan::SetMethod(target, "stats", stats);
+		Nan::SetMethod(target, "counters", counters);
+		Nan::SetMethod(target, "list", list);
+		Nan::SetMethod(target, "reap", reap);
+		Nan::SetMethod(target, "heartbeat", heartbeat);
+		Nan::SetMethod(target, "pageInfo", pageInfo);
+		Nan::SetMethod(target, "numaInfo", numaInfo);
+		Nan::SetMethod(target, "numaNodes", numaNodes);
+		Nan::SetMethod(target, "prefault", prefault);
+		Nan::SetMethod(target, "opsRun", opsRun);
+		Nan::SetMethod(target, "opsConfigure", opsConfigure);
+		Nan::SetMethod(target, "copyBytes", copyBytes);
+		Nan::SetMethod(target, "queueSizeOf", queueSizeOf);
+		Nan::SetMethod(target, "queueInit", queueInit);
+		Nan::SetMethod(target, "queueInfo", queueInfo);
+		Nan::SetMethod(target, "queuePush", queuePush);
+		Nan::SetMethod(target, "queuePop", queuePop);
+		Nan::SetMethod(target, "queuePushBatch", queuePushBatch);
+		Nan::SetMethod(target, "queuePopBatch", queuePopBatch);
+		Nan::SetMethod(target, "slabSizeOf", slabSizeOf);
+		Nan::SetMethod(target, "slabInit", slabInit);
+		Nan::SetMethod(target, "slabInfo", slabInfo);
+		Nan::SetMethod(target, "slabAlloc", slabAlloc);
+		Nan::SetMethod(target, "slabFree", slabFree);
+		Nan::SetMethod(target, "slabBlockSize", slabBlockSize);
+		Nan::SetMethod(target, "slabRecover", slabRecover);
+		Nan::SetMethod(target, "hashTableSizeOf", hashTableSizeOf);
+		Nan::SetMethod(target, "hashTableInit", hashTableInit);
+		Nan::SetMethod(target, "hashTableInfo", hashTableInfo);
+		Nan::SetMethod(target, "hashTableGet", hashTableGet);
+		Nan::SetMethod(target, "hashTableOffsetOf", hashTableOffsetOf);
+		Nan::SetMethod(target, "hashTablePut", hashTablePut);
+		Nan::SetMethod(target, "hashTableDelete", hashTableDelete);
+		Nan::SetMethod(target, "hashTableGetMany", hashTableGetMany);
+		Nan::SetMethod(target, "seqlockSizeOf", seqlockSizeOf);
+		Nan::SetMethod(target, "seqlockInit", seqlockInit);
+		Nan::SetMethod(target, "seqlockInfo", seqlockInfo);
+		Nan::SetMethod(target, "seqlockPublish", seqlockPublish);
+		Nan::SetMethod(target, "seqlockRead", seqlockRead);
+		Nan::SetMethod(target, "mutexSizeOf", mutexSizeOf);
+		Nan::SetMethod(target, "mutexInit", mutexInit);
+		Nan::SetMethod(target, "rwLockSizeOf", rwLockSizeOf);
+		Nan::SetMethod(target, "rwLockInit", rwLockInit);
+		Nan::SetMethod(target, "lockInfo", lockInfo);
+		Nan::SetMethod(target, "lock", lock);
+		Nan::SetMethod(target, "unlock", unlock);
+		Nan::SetMethod(target, "wait", wait);
+		Nan::SetMethod(target, "notify", notify);
 
 		Nan::Set(target, Nan::New("IPC_PRIVATE").ToLocalChecked(), Nan::New<Number>(IPC_PRIVATE));
 		Nan::Set(target, Nan::New("IPC_CREAT").ToLocalChecked(), Nan::New<Number>(IPC_CREAT));
 		Nan::Set(target, Nan::New("IPC_EXCL").ToLocalChecked(), Nan::New<Number>(IPC_EXCL));
 		
 		Nan::Set(target, Nan::New("SHM_RDONLY").ToLocalChecked(), Nan::New<Number>(SHM_RDONLY));
+		#ifdef __linux__
+		Nan::Set(target, Nan::New("SHM_HUGETLB").ToLocalChecked(), Nan::New<Number>(SHM_HUGETLB));
+		Nan::Set(target, Nan::New("SHM_HUGE_2MB").ToLocalChecked(), Nan::New<Number>(SHM_HUGE_2MB));
+		Nan::Set(target, Nan::New("SHM_HUGE_1GB").ToLocalChecked(), Nan::New<Number>(SHM_HUGE_1GB));
+		#endif
 		
 		Nan::Set(target, Nan::New("NODE_BUFFER_MAX_LENGTH").ToLocalChecked(), Nan::New<Number>(node::Buffer::kMaxLength));
 		
@@ -680,17 +3257,28 @@ namespace node_shm {
 		//Nan::Set(target, Nan::New("MAP_32BIT").ToLocalChecked(), Nan::New<Number>(MAP_32BIT));
 		// Nan::Set(target, Nan::New("MAP_DENYWRITE").ToLocalChecked(), Nan::New<Number>(MAP_DENYWRITE));
 		// Nan::Set(target, Nan::New("MAP_GROWSDOWN").ToLocalChecked(), Nan::New<Number>(MAP_GROWSDOWN));
-		// Nan::Set(target, Nan::New("MAP_HUGETLB").ToLocalChecked(), Nan::New<Number>(MAP_HUGETLB));
-		// Nan::Set(target, Nan::New("MAP_HUGE_2MB").ToLocalChecked(), Nan::New<Number>(MAP_HUGE_2MB));
-		// Nan::Set(target, Nan::New("MAP_HUGE_1GB").ToLocalChecked(), Nan::New<Number>(MAP_HUGE_1GB));
-		// Nan::Set(target, Nan::New("MAP_LOCKED").ToLocalChecked(), Nan::New<Number>(MAP_LOCKED));
-		// Nan::Set(target, Nan::New("MAP_NONBLOCK").ToLocalChecked(), Nan::New<Number>(MAP_NONBLOCK));
-		// Nan::Set(target, Nan::New("MAP_POPULATE").ToLocalChecked(), Nan::New<Number>(MAP_POPULATE));
+		#ifdef __linux__
+		Nan::Set(target, Nan::New("MAP_HUGETLB").ToLocalChecked(), Nan::New<Number>(MAP_HUGETLB));
+		Nan::Set(target, Nan::New("MAP_HUGE_2MB").ToLocalChecked(), Nan::New<Number>(MAP_HUGE_2MB));
+		Nan::Set(target, Nan::New("MAP_HUGE_1GB").ToLocalChecked(), Nan::New<Number>(MAP_HUGE_1GB));
+		#endif
+		#ifdef __linux__
+		Nan::Set(target, Nan::New("MAP_LOCKED").ToLocalChecked(), Nan::New<Number>(MAP_LOCKED));
+		Nan::Set(target, Nan::New("MAP_NONBLOCK").ToLocalChecked(), Nan::New<Number>(MAP_NONBLOCK));
+		Nan::Set(target, Nan::New("MAP_POPULATE").ToLocalChecked(), Nan::New<Number>(MAP_POPULATE));
+		#endif
+		#ifdef __linux__
+		Nan::Set(target, Nan::New("F_SEAL_SEAL").ToLocalChecked(), Nan::New<Number>(F_SEAL_SEAL));
+		Nan::Set(target, Nan::New("F_SEAL_SHRINK").ToLocalChecked(), Nan::New<Number>(F_SEAL_SHRINK));
+		Nan::Set(target, Nan::New("F_SEAL_GROW").ToLocalChecked(), Nan::New<Number>(F_SEAL_GROW));
+		Nan::Set(target, Nan::New("F_SEAL_WRITE").ToLocalChecked(), Nan::New<Number>(F_SEAL_WRITE));
+		#endif
 		// Nan::Set(target, Nan::New("MAP_STACK").ToLocalChecked(), Nan::New<Number>(MAP_STACK));
 		// Nan::Set(target, Nan::New("MAP_SYNC").ToLocalChecked(), Nan::New<Number>(MAP_SYNC));
 		// Nan::Set(target, Nan::New("MAP_UNINITIALIZED").ToLocalChecked(), Nan::New<Number>(MAP_UNINITIALIZED));
 
 		//enum ShmBufferType
+		Nan::Set(target, Nan::New("SHMBT_STORED").ToLocalChecked(), Nan::New<Number>(SHMBT_STORED));
 		Nan::Set(target, Nan::New("SHMBT_BUFFER").ToLocalChecked(), Nan::New<Number>(SHMBT_BUFFER));
 		Nan::Set(target, Nan::New("SHMBT_INT8").ToLocalChecked(), Nan::New<Number>(SHMBT_INT8));
 		Nan::Set(target, Nan::New("SHMBT_UINT8").ToLocalChecked(), Nan::New<Number>(SHMBT_UINT8));
@@ -701,12 +3289,39 @@ namespace node_shm {
 		Nan::Set(target, Nan::New("SHMBT_UINT32").ToLocalChecked(), Nan::New<Number>(SHMBT_UINT32));
 		Nan::Set(target, Nan::New("SHMBT_FLOAT32").ToLocalChecked(), Nan::New<Number>(SHMBT_FLOAT32));
 		Nan::Set(target, Nan::New("SHMBT_FLOAT64").ToLocalChecked(), Nan::New<Number>(SHMBT_FLOAT64));
-
-		#if NODE_MODULE_VERSION < NODE_16_0_MODULE_VERSION
-		node::AtExit(AtNodeExit);
-		#else
-		node::AddEnvironmentCleanupHook(target->GetIsolate(), AtNodeExit, nullptr);
+		#if SHM_HAS_BIGINT64_ARRAY
+		Nan::Set(target, Nan::New("SHMBT_BIGINT64").ToLocalChecked(), Nan::New<Number>(SHMBT_BIGINT64));
+		Nan::Set(target, Nan::New("SHMBT_BIGUINT64").ToLocalChecked(), Nan::New<Number>(SHMBT_BIGUINT64));
 		#endif
+		#if SHM_HAS_FLOAT16_ARRAY
+		Nan::Set(target, Nan::New("SHMBT_FLOAT16").ToLocalChecked(), Nan::New<Number>(SHMBT_FLOAT16));
+		#endif
+
+		//enum ShmHugePages
+		Nan::Set(target, Nan::New("SHMHP_NONE").ToLocalChecked(), Nan::New<Number>(SHMHP_NONE));
+		Nan::Set(target, Nan::New("SHMHP_2MB").ToLocalChecked(), Nan::New<Number>(SHMHP_2MB));
+		Nan::Set(target, Nan::New("SHMHP_1GB").ToLocalChecked(), Nan::New<Number>(SHMHP_1GB));
+		Nan::Set(target, Nan::New("SHMHP_AUTO").ToLocalChecked(), Nan::New<Number>(SHMHP_AUTO));
+
+		//enum ShmNumaPolicy
+		Nan::Set(target, Nan::New("SHMNUMA_DEFAULT").ToLocalChecked(), Nan::New<Number>(SHMNUMA_DEFAULT));
+		Nan::Set(target, Nan::New("SHMNUMA_INTERLEAVE").ToLocalChecked(), Nan::New<Number>(SHMNUMA_INTERLEAVE));
+		Nan::Set(target, Nan::New("SHMNUMA_BIND").ToLocalChecked(), Nan::New<Number>(SHMNUMA_BIND));
+		Nan::Set(target, Nan::New("SHMNUMA_PREFERRED").ToLocalChecked(), Nan::New<Number>(SHMNUMA_PREFERRED));
+
+		//enum ShmOpsKind
+		Nan::Set(target, Nan::New("SHMOPS_SUM").ToLocalChecked(), Nan::New<Number>(SHMOPS_SUM));
+		Nan::Set(target, Nan::New("SHMOPS_MIN").ToLocalChecked(), Nan::New<Number>(SHMOPS_MIN));
+		Nan::Set(target, Nan::New("SHMOPS_MAX").ToLocalChecked(), Nan::New<Number>(SHMOPS_MAX));
+		Nan::Set(target, Nan::New("SHMOPS_DOT").ToLocalChecked(), Nan::New<Number>(SHMOPS_DOT));
+		Nan::Set(target, Nan::New("SHMOPS_ARGMAX").ToLocalChecked(), Nan::New<Number>(SHMOPS_ARGMAX));
+		Nan::Set(target, Nan::New("SHMOPS_SCALE").ToLocalChecked(), Nan::New<Number>(SHMOPS_SCALE));
+		Nan::Set(target, Nan::New("SHMOPS_FILL").ToLocalChecked(), Nan::New<Number>(SHMOPS_FILL));
+
+		//enum ShmPrefaultFlags
+		Nan::Set(target, Nan::New("SHMPF_POPULATE").ToLocalChecked(), Nan::New<Number>(SHMPF_POPULATE));
+		Nan::Set(target, Nan::New("SHMPF_LOCK").ToLocalChecked(), Nan::New<Number>(SHMPF_LOCK));
+		Nan::Set(target, Nan::New("SHMPF_WILLNEED").ToLocalChecked(), Nan::New<Number>(SHMPF_WILLNEED));
 	}
 
 }
@@ -714,4 +3329,5 @@ namespace node_shm {
 
 //-------------------------------
 
-NODE_MODULE(shm, node::node_shm::Init);
+// Can be loaded by worker threads, every one gets own environment, see ShmEnv
+NAN_MODULE_WORKER_ENABLED(shm, node::node_shm::Init);
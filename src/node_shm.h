@@ -10,12 +10,61 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <vector>
 #include <string>
+#include <unordered_map>
+
+#ifdef __linux__
+// Not defined by older glibc headers
+#ifndef SHM_HUGE_SHIFT
+#define SHM_HUGE_SHIFT 26
+#endif
+#ifndef SHM_HUGE_2MB
+#define SHM_HUGE_2MB (21 << SHM_HUGE_SHIFT)
+#endif
+#ifndef SHM_HUGE_1GB
+#define SHM_HUGE_1GB (30 << SHM_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+#ifndef MFD_HUGE_SHIFT
+#define MFD_HUGE_SHIFT 26
+#endif
+#ifndef MFD_HUGE_2MB
+#define MFD_HUGE_2MB (21U << MFD_HUGE_SHIFT)
+#endif
+#ifndef MFD_HUGE_1GB
+#define MFD_HUGE_1GB (30U << MFD_HUGE_SHIFT)
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#define F_SEAL_WRITE 0x0008
+#endif
+#endif
 
 using namespace node;
 using namespace v8;
@@ -35,11 +84,17 @@ namespace Buffer {
 }
 */
 
+// BigInt64Array/BigUint64Array are supported since V8 6.7 (Node.js 10.4)
+#define SHM_HAS_BIGINT64_ARRAY (V8_MAJOR_VERSION > 6 || (V8_MAJOR_VERSION == 6 && V8_MINOR_VERSION >= 7))
+// Float16Array is supported since V8 12.4 (Node.js 22), but can be hidden behind --js-float16array flag
+#define SHM_HAS_FLOAT16_ARRAY (V8_MAJOR_VERSION > 12 || (V8_MAJOR_VERSION == 12 && V8_MINOR_VERSION >= 4))
+
 #define SAFE_DELETE(a) if( (a) != NULL ) delete (a); (a) = NULL;
 #define SAFE_DELETE_ARR(a) if( (a) != NULL ) delete [] (a); (a) = NULL;
 
 
 enum ShmBufferType {
+	SHMBT_STORED = -1, //for get of POSIX object: type stored in header of object
 	SHMBT_BUFFER = 0, //for using Buffer instead of TypedArray
 	SHMBT_INT8,
 	SHMBT_UINT8,
@@ -49,7 +104,58 @@ enum ShmBufferType {
 	SHMBT_INT32,
 	SHMBT_UINT32,
 	SHMBT_FLOAT32,
-	SHMBT_FLOAT64
+	SHMBT_FLOAT64,
+	SHMBT_BIGINT64,
+	SHMBT_BIGUINT64,
+	SHMBT_FLOAT16
+};
+
+enum ShmHugePages {
+	SHMHP_NONE = 0,
+	SHMHP_2MB,
+	SHMHP_1GB,
+	SHMHP_AUTO, // try default size huge pages, fallback to transparent huge pages
+};
+
+enum ShmNumaPolicy {
+	SHMNUMA_DEFAULT = 0,
+	SHMNUMA_INTERLEAVE, // spread pages round-robin over nodes
+	SHMNUMA_BIND, // allocate only on nodes
+	SHMNUMA_PREFERRED, // allocate on node, fallback to others
+};
+
+// Counters of syscalls done by this process, see counters()
+enum ShmCounter {
+	SHMC_ATTACHES = 0,
+	SHMC_ATTACH_ERRORS,
+	SHMC_ATTACH_NS, // time spent in attach (shmget/shmat, shm_open/mmap, ...) in ns
+	SHMC_MAPPING_REUSES, // attaches which took mapping of other attach in this process instead of shmat/mmap
+	SHMC_DETACHES,
+	SHMC_DESTROYS,
+	SHMC_DETACH_NS, // time spent in detach and destroy in ns
+	SHMC_PREFAULTS,
+	SHMC_PREFAULT_BYTES,
+	SHMC_PREFAULT_NS,
+	SHMC_FLUSHES,
+	SHMC_FLUSH_NS,
+	SHMC_COUNT
+};
+
+enum ShmOpsKind {
+	SHMOPS_SUM = 0,
+	SHMOPS_MIN,
+	SHMOPS_MAX,
+	SHMOPS_DOT,
+	SHMOPS_ARGMAX,
+	SHMOPS_SCALE,
+	SHMOPS_FILL,
+	SHMOPS_COPY, // used by copyBytes()
+};
+
+enum ShmPrefaultFlags {
+	SHMPF_POPULATE = 1, // fault in pages for write
+	SHMPF_LOCK = 2, // mlock() pages
+	SHMPF_WILLNEED = 4, // madvise(MADV_WILLNEED)
 };
 
 inline int getSizeForShmBufferType(ShmBufferType type) {
@@ -63,6 +169,7 @@ inline int getSizeForShmBufferType(ShmBufferType type) {
 		break;
 		case SHMBT_INT16:
 		case SHMBT_UINT16:
+		case SHMBT_FLOAT16:
 			size1 = 2;
 		break;
 		case SHMBT_INT32:
@@ -72,12 +179,23 @@ inline int getSizeForShmBufferType(ShmBufferType type) {
 		break;
 		default:
 		case SHMBT_FLOAT64:
+		case SHMBT_BIGINT64:
+		case SHMBT_BIGUINT64:
 			size1 = 8;
 		break;
 	}
 	return size1;
 }
 
+// Get data and size in bytes of Buffer/TypedArray passed as argument
+inline bool getBufferData(Local<Value> val, char** data, size_t* length) {
+	if (!node::Buffer::HasInstance(val))
+		return false;
+	*data = node::Buffer::Data(val);
+	*length = node::Buffer::Length(val);
+	return true;
+}
+
 
 namespace node {
 namespace Buffer {
@@ -113,6 +231,22 @@ namespace Nan {
 		, ShmBufferType type = SHMBT_FLOAT64
 	);
 
+	// Returns array of buffers/typed arrays (chunks) for contiguous memory,
+	//  every chunk has chunkLength elements (except last)
+	// Callback is called for every chunk collected by GC
+	inline MaybeLocal<v8::Array> NewTypedBufferChunks(
+		char *data
+		, size_t count
+		, size_t chunkLength
+#if NODE_MODULE_VERSION > IOJS_2_0_MODULE_VERSION
+		, node::Buffer::FreeCallback callback
+#else
+		, node::smalloc::FreeCallback callback
+#endif
+		, void *hint
+		, ShmBufferType type = SHMBT_FLOAT64
+	);
+
 }
 
 
@@ -127,7 +261,15 @@ namespace node_shm {
 	 *  int shmflg - flags for shmget()
 	 *  int at_shmflg - flags for shmat()
 	 *  enum ShmBufferType type
+	 *  enum ShmHugePages hugePages - for creation only
+	 *  size_t chunkLength - max count of elements in chunk, or 0 to return single buffer
+	 *  bool autoDetach - detach when all returned views are collected by GC
+	 *  enum ShmNumaPolicy numaPolicy - applied with mbind() before memory is touched
+	 *  Array numaNodes - node ids for numaPolicy
+	 *  Function callback(err, res) - optional, if passed syscalls are done in threadpool
+	 *   and result is passed to callback
 	 * Returns buffer or typed array, depends on input param type
+	 *  Or array of them (chunks) if chunkLength > 0
 	 * If not exists/alreeady exists, returns null
 	 */
 	NAN_METHOD(get);
@@ -140,8 +282,16 @@ namespace node_shm {
 	 *  int oflag - flag for shm_open()
 	 *  mode_t mode - mode for shm_open()
 	 *  int mmap_flags - flags for mmap()
-	 *  enum ShmBufferType type
+	 *  enum ShmBufferType type - SHMBT_STORED to get with type stored in header of object
+	 *  enum ShmHugePages hugePages - for creation only, uses hugetlbfs mount
+	 *  size_t chunkLength - max count of elements in chunk, or 0 to return single buffer
+	 *  bool autoDetach - detach when all returned views are collected by GC
+	 *  enum ShmNumaPolicy numaPolicy - applied with mbind() before memory is touched
+	 *  Array numaNodes - node ids for numaPolicy
+	 *  Function callback(err, res) - optional, if passed syscalls are done in threadpool
+	 *   and result is passed to callback
 	 * Returns buffer or typed array, depends on input param type
+	 *  Or array of them (chunks) if chunkLength > 0
 	 * If not exists/alreeady exists, returns null
 	 */
 	NAN_METHOD(getPosix);
@@ -151,6 +301,7 @@ namespace node_shm {
 	 * Params:
 	 *  key_t key
 	 *  bool force - true to destroy even there are other processed uses this segment
+	 *  Function callback(err, res) - optional, if passed syscalls are done in threadpool
 	 * Returns 0 if deleted, or count of left attaches, or -1 if not exists
 	 */
 	NAN_METHOD(detach);
@@ -160,10 +311,46 @@ namespace node_shm {
 	 * Params:
 	 *  String name
 	 *  bool force - true to destroy
+	 *  Function callback(err, res) - optional, if passed syscalls are done in threadpool
 	 * Returns 0 if deleted, 1 if detached, -1 if not exists
 	 */
 	NAN_METHOD(detachPosix);
 
+	/**
+	 * Resize last attach of POSIX shared memory object
+	 * Size and generation of resize are stored in header of object, so other processes
+	 *  can remap with refreshPosix()
+	 * Mapping can be moved, previously returned views of this attach become invalid
+	 * Params:
+	 *  String name
+	 *  size_t count - new count of elements
+	 *  enum ShmBufferType type - of returned views, SHMBT_STORED for type stored in header
+	 *  size_t chunkLength - max count of elements in chunk, or 0 to return single buffer
+	 *  bool autoDetach - detach when all returned views are collected by GC
+	 * Returns buffer or typed array (or chunks) of resized object
+	 */
+	NAN_METHOD(resizePosix);
+
+	/**
+	 * Remap last attach of POSIX shared memory object if it was resized by other process
+	 * Params:
+	 *  String name
+	 *  enum ShmBufferType type
+	 *  size_t chunkLength
+	 *  bool autoDetach
+	 * Returns buffer or typed array (or chunks), or null if object was not resized since last map
+	 */
+	NAN_METHOD(refreshPosix);
+
+	/**
+	 * Get info from header of attached POSIX shared memory object
+	 * Params:
+	 *  String name
+	 * Returns object { layoutVersion, type, count, size, dataOffset, createdAt }
+	 *  layoutVersion is 0 and createdAt is null for objects created by older versions
+	 */
+	NAN_METHOD(objectInfo);
+
 	/**
 	 * Detach all created and getted shared memory segments and objects
 	 * Returns count of destroyed System V segments
@@ -180,16 +367,729 @@ namespace node_shm {
 	 */
 	NAN_METHOD(getTotalUsedSize);
 
+	/**
+	 * Get runtime stats of every System V segment, POSIX object, memfd or file attached by this process
+	 * Returns array of objects { type, key, id, name, fd, size, mappedBytes, attaches, isOwner, nattch,
+	 *  creatorPid, createdAt, pageSize, hugetlb, transparentHugeBytes, residentPages, residentBytes, pages }
+	 *  type - 0 for System V, 1 for POSIX, 2 for memfd, 3 for file
+	 *  key, id - key and shmid of System V segment, name - name of POSIX object or path of file, fd - fd of memfd
+	 *  size - size of data in bytes, mappedBytes - size of all attaches of this process
+	 *  nattch - count of attaches by all processes (System V only)
+	 *  creatorPid, createdAt - pid of creator and creation time in ms since epoch, null if unknown
+	 *  residentPages, pages - pages (of system page size) resident in memory and all pages of mapping,
+	 *   null if mincore() failed
+	 */
+	NAN_METHOD(stats);
+
+	/**
+	 * Get counters of attaches, detaches, prefaults and flushes done by this process
+	 * Returns object { attaches, attachErrors, attachNs, detaches, destroys, detachNs,
+	 *  prefaults, prefaultBytes, prefaultNs, flushes, flushNs }, *Ns is time spent in syscalls
+	 */
+	NAN_METHOD(counters);
+
+	/**
+	 * List System V segments from /proc/sysvipc/shm and POSIX objects in /dev/shm of all processes
+	 * Returns array of objects { type, key, id, name, size, nattch, uid, mode, creatorPid, ownerPid, ownerAlive,
+	 *  lease, createdAt, activeAt, attached }
+	 *  ownerPid - owner of lease of POSIX object or creator, null if unknown
+	 *  activeAt - last heartbeat of lease, or last attach/detach/change of System V segment, ms since epoch
+	 *  attached - attached by this process
+	 */
+	NAN_METHOD(list);
+
+	/**
+	 * Destroy orphaned System V segments and POSIX objects, see isOrphanedShm()
+	 * Params:
+	 *  double olderThan - min time since last activity in ms
+	 *  double leaseTimeout - max age of lease in ms, or -1 to check only if owner is alive
+	 *  bool dryRun - don't destroy
+	 *  bool sysv, bool posix - types to reap
+	 *  String prefix - reap only POSIX objects with names starting with prefix
+	 * Returns array of destroyed segments/objects, see list()
+	 */
+	NAN_METHOD(reap);
+
+	/**
+	 * Renew leases of this process in headers of attached POSIX objects, files and memfds
+	 * Params:
+	 *  String name - optional, take over lease of attached POSIX object
+	 * Returns count of renewed leases
+	 */
+	NAN_METHOD(heartbeat);
+
+	extern std::atomic<uint64_t> shmCounters[SHMC_COUNT];
+
+	inline void addShmCounter(ShmCounter counter, uint64_t value) {
+		shmCounters[counter].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	inline uint64_t getMonotonicNs() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+	// Adds time spent in scope to counter
+	struct ShmCounterTimer {
+		ShmCounter counter;
+		uint64_t start;
+
+		explicit ShmCounterTimer(ShmCounter counter) : counter(counter), start(getMonotonicNs()) {}
+		~ShmCounterTimer() {
+			addShmCounter(counter, getMonotonicNs() - start);
+		}
+	};
+
+	// Page size of mapping and bytes mapped with transparent huge pages
+	struct ShmPageStats {
+		size_t pageSize;
+		size_t transparentHugeBytes;
+	};
+
+	// Read page stats of mappings [start, end) from /proc/self/smaps in one pass, returns 0 or errno
+	// pageSize is system page size if not found
+	int readPageStats(const std::vector<std::pair<uintptr_t, uintptr_t>>& ranges, std::vector<ShmPageStats>& stats);
+
+	// Count pages of range resident in memory with mincore(), returns 0 or errno
+	int countResidentPages(void* addr, size_t length, size_t& resident);
+
+	/**
+	 * Get info about pages of attached System V segment or POSIX object
+	 * Params:
+	 *  key_t key / String name
+	 * Returns object { pageSize, hugetlb, transparentHugeBytes }, or null if not attached
+	 *  pageSize - size of kernel page used for mapping
+	 *  transparentHugeBytes - how many bytes are mapped with transparent huge pages
+	 */
+	NAN_METHOD(pageInfo);
+
+	/**
+	 * Get NUMA placement of attached System V segment or POSIX object
+	 * Params:
+	 *  key_t key / String name
+	 * Returns object { nodes, policy, policyNodes, pageSize, residentPages }, or null if not attached
+	 *  nodes - ids of online nodes
+	 *  policy - 'default', 'interleave', 'bind', 'preferred', 'local', or null if unknown
+	 *  residentPages - { node: count of pages }, or null if unknown
+	 */
+	NAN_METHOD(numaInfo);
+
+	/**
+	 * Get ids of online NUMA nodes, [0] on hosts without NUMA
+	 */
+	NAN_METHOD(numaNodes);
+
+	// Set NUMA policy of mapping, returns 0 or errno
+	// Returns 0 if NUMA is not supported by kernel, see node_shm_numa.cc
+	int applyNumaPolicy(void* addr, size_t length, ShmNumaPolicy policy, const std::vector<int>& nodes);
+
+	// Build result of numaInfo() for mapping
+	Local<Object> newNumaInfo(void* addr, size_t length);
+
+	/**
+	 * Create anonymous shared memory with memfd_create(), or map memfd received from other process
+	 * Memory has no name or key, it's freed by kernel when last fd and mapping are closed
+	 * Params:
+	 *  int fd - memfd to map, attach takes ownership of it (ignored on creation)
+	 *  size_t count - count of elements to create, or 0 to map fd
+	 *  enum ShmBufferType type - SHMBT_STORED to map with type stored in header
+	 *  enum ShmHugePages hugePages - for creation only, uses MFD_HUGETLB
+	 *  size_t chunkLength - max count of elements in chunk, or 0 to return single buffer
+	 *  bool autoDetach - detach when all returned views are collected by GC
+	 *  enum ShmNumaPolicy numaPolicy - applied with mbind() before memory is touched
+	 *  Array numaNodes - node ids for numaPolicy
+	 *  Function callback(err, res) - optional, if passed syscalls are done in threadpool
+	 * Returns buffer or typed array (or chunks) with property fd
+	 *  Memfd sealed with F_SEAL_WRITE is mapped copy-on-write, writes are seen only by this process
+	 */
+	NAN_METHOD(getMemfd);
+
+	/**
+	 * Detach anonymous shared memory and close its fd
+	 * Params:
+	 *  int fd
+	 * Returns 0 if detached, -1 if not attached
+	 */
+	NAN_METHOD(detachMemfd);
+
+	/**
+	 * Add seals to memfd with fcntl(F_ADD_SEALS)
+	 * Before F_SEAL_WRITE writable mappings of all attaches of same file in this process are replaced
+	 *  with copy-on-write ones at same addresses, so previously returned views stay valid
+	 * Params:
+	 *  int fd
+	 *  int seals - F_SEAL_* flags
+	 * Returns all seals of memfd
+	 */
+	NAN_METHOD(sealMemfd);
+
+	/**
+	 * Get seals of memfd, 0 for other files
+	 * Params:
+	 *  int fd
+	 */
+	NAN_METHOD(memfdSeals);
+
+	/**
+	 * Send fd over Unix domain socket (SCM_RIGHTS)
+	 * Params:
+	 *  int socket - fd of socket
+	 *  int fd - fd to send, stays open in this process
+	 * Doesn't wait, throws EAGAIN error if send buffer of socket is full
+	 */
+	NAN_METHOD(sendFd);
+
+	/**
+	 * Receive fd sent by sendFd()
+	 * Params:
+	 *  int socket - fd of socket, should not be read by libuv at same time
+	 *  int timeoutMs - -1 to wait infinitely
+	 *  Function callback(err, fd) - optional, if passed waits in threadpool
+	 * Returns received fd (with close-on-exec)
+	 */
+	NAN_METHOD(recvFd);
+
+	// memfd_create() with MFD_CLOEXEC | MFD_ALLOW_SEALING | flags, returns fd or -1 (see errno)
+	int createMemfd(unsigned int flags);
+
+	// Seals of fd, 0 if file doesn't support sealing, -1 on error (see errno)
+	int getFdSeals(int fd);
+
+	// fcntl(F_ADD_SEALS), returns 0 or -1 (see errno)
+	int addFdSeals(int fd, int seals);
+
+	/**
+	 * Create or open regular file and map it shared, with same header as POSIX object
+	 * Memory survives restart of process (and host), see flush() and fileCheckpoint()
+	 * Params:
+	 *  String path - absolute path of file
+	 *  size_t count - count of elements to create, or 0 to open existing file
+	 *  int oflag - flag for open()
+	 *  mode_t mode - mode for open()
+	 *  enum ShmBufferType type - SHMBT_STORED to open with type stored in header
+	 *  size_t chunkLength - max count of elements in chunk, or 0 to return single buffer
+	 *  bool autoDetach - detach when all returned views are collected by GC
+	 *  enum ShmNumaPolicy numaPolicy - applied with mbind() before memory is touched
+	 *  Array numaNodes - node ids for numaPolicy
+	 *  Function callback(err, res) - optional, if passed syscalls are done in threadpool
+	 * Returns buffer or typed array (or chunks)
+	 * If not exists/already exists, returns null
+	 */
+	NAN_METHOD(getFile);
+
+	/**
+	 * Unmap file, dirty pages are written back by kernel
+	 * Params:
+	 *  String path
+	 *  bool remove - true to unlink file
+	 *  Function callback(err, res) - optional, if passed syscalls are done in threadpool
+	 * Returns 0 if removed, 1 if detached, -1 if not exists
+	 */
+	NAN_METHOD(detachFile);
+
+	/**
+	 * Mark range of file-backed array as changed since last checkpoint
+	 * Params:
+	 *  Buffer/TypedArray array - view of mapped file
+	 *  size_t byteOffset
+	 *  size_t byteLength
+	 */
+	NAN_METHOD(fileMarkDirty);
+
+	/**
+	 * Write ranges marked by fileMarkDirty() to disk with msync(), and clear marks
+	 * Marks are restored on error, so next checkpoint retries
+	 * Params:
+	 *  String path
+	 *  Function callback(err, res) - optional, if passed msync() is done in threadpool
+	 * Returns count of written bytes
+	 */
+	NAN_METHOD(fileCheckpoint);
+
+	/**
+	 * Write range of Buffer/TypedArray mapped from file to disk with msync(MS_SYNC)
+	 * Params:
+	 *  Buffer/TypedArray array
+	 *  size_t byteOffset
+	 *  size_t byteLength
+	 *  Function callback(err, res) - optional, if passed msync() is done in threadpool
+	 * Returns count of written bytes
+	 */
+	NAN_METHOD(flush);
+
+	// msync(MS_SYNC) of range, address is aligned down to page, returns 0 or errno
+	int syncMemoryRange(char* addr, size_t length);
+
+	// Take reference to mapping of attach containing [data, data + length),
+	//  so detach in JS thread doesn't unmap it while range is used in threadpool
+	// Returns address of mapping for unpinShmMapping(), or NULL if range is not in mapping of attach
+	void* pinShmMapping(char* data, size_t length);
+	// Release reference taken by pinShmMapping(), unmaps memory if it was detached meanwhile
+	// Can be called in threadpool
+	void unpinShmMapping(void* addr);
+
+	/**
+	 * Map page-aligned range of POSIX shared memory object or file, without mapping whole object
+	 * Window is not attach: it's unmapped when view is collected by GC, or by unmapWindow()
+	 * Params:
+	 *  String name - name of POSIX object, or absolute path of file
+	 *  bool isFile
+	 *  size_t offset - index of first element, should be less than count of elements of object
+	 *  size_t length - count of elements, clamped to end of object
+	 *  enum ShmBufferType type - SHMBT_STORED for type stored in header
+	 *  int mmap_flags - flags for mmap()
+	 *  bool willNeed - madvise(MADV_WILLNEED), so kernel reads window ahead
+	 * Returns buffer or typed array with property objectLength (count of elements of object)
+	 * If not exists, returns null
+	 */
+	NAN_METHOD(mapWindow);
+	/**
+	 * Unmap window, view should not be used after it
+	 * Params:
+	 *  Buffer/TypedArray view - returned by mapWindow()
+	 * Returns true if unmapped, false if view is not mapped window
+	 */
+	NAN_METHOD(unmapWindow);
+	/**
+	 * Drop pages of window from memory of this process with madvise(MADV_DONTNEED)
+	 * View stays valid, pages are faulted in again from object on access
+	 * Params:
+	 *  Buffer/TypedArray view - returned by mapWindow()
+	 * Returns true if discarded, false if view is not mapped window
+	 */
+	NAN_METHOD(discardWindow);
+	// mmap() bytes [fileOffset, fileOffset + length) of fd as window, mapping starts at fileOffset aligned down to alignment
+	// Returns address of byte at fileOffset and hint for releaseShmWindow(), or NULL (see errno)
+	char* mapShmWindow(int fd, size_t fileOffset, size_t length, size_t alignment, int mapFlags, bool willNeed,
+		void** hint);
+	// Free callback of view of window
+	void releaseShmWindow(char* data, void* hint);
+
+	/**
+	 * Prefault/lock range of Buffer/TypedArray in threadpool
+	 * Params:
+	 *  Buffer/TypedArray array - shared memory array
+	 *  size_t byteOffset - offset of range in bytes
+	 *  size_t byteLength - length of range in bytes
+	 *  int flags - enum ShmPrefaultFlags
+	 *  Function callback(err)
+	 */
+	NAN_METHOD(prefault);
+
+	/**
+	 * Run bulk operation over range of elements of Buffer/TypedArray with SIMD kernels,
+	 *  large ranges are split between threads of native pool
+	 * Params:
+	 *  enum ShmOpsKind kind
+	 *  Buffer/TypedArray array - Float16Array is not supported
+	 *  mixed arg - second array of same type for SHMOPS_DOT, number for SHMOPS_SCALE/SHMOPS_FILL
+	 *   (BigInt for BigInt64Array/BigUint64Array)
+	 *  size_t start - index of first element
+	 *  size_t end - index after last element
+	 *  Function callback(err, res) - optional, if passed operation is done in threadpool
+	 * Returns number (index for SHMOPS_ARGMAX, -1 if not found), or undefined for SHMOPS_SCALE/SHMOPS_FILL
+	 *  BigInt is returned for sum, dot, min, max of BigInt64Array/BigUint64Array
+	 */
+	NAN_METHOD(opsRun);
+
+	/**
+	 * Copy bytes between Buffers/TypedArrays, large copies use non-temporal stores
+	 *  and are split between threads of native pool like bulk operations
+	 * Params:
+	 *  Buffer/TypedArray dst
+	 *  size_t dstByteOffset
+	 *  Buffer/TypedArray src
+	 *  size_t srcByteOffset
+	 *  size_t byteLength
+	 *  Function callback(err, res) - optional, if passed copy is done in threadpool
+	 * Returns count of copied bytes
+	 */
+	NAN_METHOD(copyBytes);
+
+	/**
+	 * Configure bulk operations
+	 * Params:
+	 *  String isa - instruction set: 'auto', 'generic', 'sse2', 'avx2', 'avx512', or undefined to keep
+	 *  int threads - max count of threads for one operation, or undefined to keep
+	 * Returns object { isa, supportedIsa, threads }
+	 */
+	NAN_METHOD(opsConfigure);
+
+	/**
+	 * Get size in bytes of shared memory needed for MPMC queue
+	 * Params:
+	 *  uint32_t slotSize - max size of message in bytes
+	 *  uint32_t slotCount - count of slots, power of 2
+	 */
+	NAN_METHOD(queueSizeOf);
+
+	/**
+	 * Init MPMC queue inside shared memory buffer
+	 * Params:
+	 *  Buffer buf - buffer returned by getPosix()
+	 *  uint32_t slotSize
+	 *  uint32_t slotCount
+	 */
+	NAN_METHOD(queueInit);
+
+	/**
+	 * Get info about MPMC queue inside shared memory buffer
+	 * Params:
+	 *  Buffer buf
+	 * Returns object { slotSize, slotCount, length }, or null if buffer has no queue
+	 */
+	NAN_METHOD(queueInfo);
+
+	/**
+	 * Push message to MPMC queue
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray src - message, size should be <= slotSize
+	 * Returns true if pushed, false if queue is full
+	 */
+	NAN_METHOD(queuePush);
+
+	/**
+	 * Pop message from MPMC queue
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray dst - should have size >= size of message
+	 * Returns count of bytes written to dst, or -1 if queue is empty
+	 */
+	NAN_METHOD(queuePop);
+
+	/**
+	 * Push messages to MPMC queue
+	 * Params:
+	 *  Buffer buf
+	 *  Array of Buffer/TypedArray srcs
+	 * Returns count of pushed messages (less than count of srcs if queue is full)
+	 */
+	NAN_METHOD(queuePushBatch);
+
+	/**
+	 * Pop messages from MPMC queue
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray dst - messages are written one by one as records:
+	 *   uint32_t length, then message bytes (without alignment)
+	 *  uint32_t maxCount
+	 * Returns count of popped messages
+	 */
+	NAN_METHOD(queuePopBatch);
+
+	/**
+	 * Get size in bytes of shared memory needed for slab allocator
+	 * Params:
+	 *  uint32_t slabSize - size of slab in bytes, power of 2 >= 16, max size of block
+	 *  uint32_t slabCount - count of slabs
+	 */
+	NAN_METHOD(slabSizeOf);
+
+	/**
+	 * Init slab allocator inside shared memory buffer
+	 * Params:
+	 *  Buffer buf - buffer returned by getPosix()
+	 *  uint32_t slabSize
+	 *  uint32_t slabCount
+	 */
+	NAN_METHOD(slabInit);
+
+	/**
+	 * Get info about slab allocator inside shared memory buffer
+	 * Params:
+	 *  Buffer buf
+	 * Returns object { slabSize, slabCount, usedSlabs, maxSize }, or null if buffer has no allocator
+	 */
+	NAN_METHOD(slabInfo);
+
+	/**
+	 * Allocate block in slab allocator
+	 * Params:
+	 *  Buffer buf
+	 *  size_t size - size in bytes, <= slabSize
+	 * Returns offset of block in buf, or -1 if out of memory
+	 */
+	NAN_METHOD(slabAlloc);
+
+	/**
+	 * Free block of slab allocator
+	 * Params:
+	 *  Buffer buf
+	 *  size_t offset - offset returned by slabAlloc()
+	 */
+	NAN_METHOD(slabFree);
+
+	/**
+	 * Get size of block of slab allocator (size class, power of 2)
+	 * Params:
+	 *  Buffer buf
+	 *  size_t offset - offset returned by slabAlloc()
+	 */
+	NAN_METHOD(slabBlockSize);
+
+	/**
+	 * Release slabs claimed by crashed processes
+	 * Params:
+	 *  Buffer buf
+	 * Returns count of recovered slabs
+	 */
+	NAN_METHOD(slabRecover);
+
+	/**
+	 * Get size in bytes of shared memory needed for hash table
+	 * Params:
+	 *  uint64_t capacity - count of buckets, power of 2
+	 *  uint32_t keySize - size of key in bytes
+	 *  uint32_t valueSize - size of value in bytes
+	 */
+	NAN_METHOD(hashTableSizeOf);
+
+	/**
+	 * Init hash table inside shared memory buffer
+	 * Params:
+	 *  Buffer buf - buffer returned by getPosix()
+	 *  uint64_t capacity
+	 *  uint32_t keySize
+	 *  uint32_t valueSize
+	 */
+	NAN_METHOD(hashTableInit);
+
+	/**
+	 * Get info about hash table inside shared memory buffer
+	 * Params:
+	 *  Buffer buf
+	 * Returns object { capacity, keySize, valueSize, size }, or null if buffer has no hash table
+	 */
+	NAN_METHOD(hashTableInfo);
+
+	/**
+	 * Copy value of key from hash table
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray key - keySize bytes, or number/BigInt if keySize is 8
+	 *  Buffer/TypedArray dst - should have size >= valueSize
+	 * Returns true if found
+	 */
+	NAN_METHOD(hashTableGet);
+
+	/**
+	 * Get offset of value of key in buffer, to read it without copy
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray key
+	 * Returns offset, or -1 if not found
+	 */
+	NAN_METHOD(hashTableOffsetOf);
+
+	/**
+	 * Insert or update key in hash table
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray key
+	 *  Buffer/TypedArray value - valueSize bytes
+	 * Returns false if hash table is full
+	 */
+	NAN_METHOD(hashTablePut);
+
+	/**
+	 * Delete key from hash table
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray key
+	 * Returns true if key was deleted
+	 */
+	NAN_METHOD(hashTableDelete);
+
+	/**
+	 * Copy values of keys from hash table
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray keys - keys one by one, keySize bytes each
+	 *  Buffer/TypedArray dst - values are written one by one, valueSize bytes each
+	 *  Buffer/Uint8Array found - optional, 1 is written for found keys, 0 for not found
+	 * Returns count of found keys
+	 */
+	NAN_METHOD(hashTableGetMany);
+
+	/**
+	 * Get size in bytes of shared memory needed for seqlock region
+	 * Params:
+	 *  size_t size - size of data in bytes
+	 */
+	NAN_METHOD(seqlockSizeOf);
+
+	/**
+	 * Init seqlock region inside shared memory buffer
+	 * Params:
+	 *  Buffer buf - buffer returned by getPosix()
+	 *  size_t size
+	 */
+	NAN_METHOD(seqlockInit);
+
+	/**
+	 * Get info about seqlock region inside shared memory buffer
+	 * Params:
+	 *  Buffer buf
+	 * Returns object { size, dataOffset, version }, or null if buffer has no seqlock region
+	 */
+	NAN_METHOD(seqlockInfo);
+
+	/**
+	 * Copy data to seqlock region
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray src - size should be <= size of region
+	 * Returns version of published data (count of publishes)
+	 */
+	NAN_METHOD(seqlockPublish);
+
+	/**
+	 * Copy consistent snapshot of data from seqlock region, retries while data is being published
+	 * Throws if writer died while publishing
+	 * Params:
+	 *  Buffer buf
+	 *  Buffer/TypedArray dst - min(size of dst, size of region) bytes are copied
+	 * Returns version of copied data
+	 */
+	NAN_METHOD(seqlockRead);
+
+	// Start time of process in clock ticks since boot (field 22 of /proc/<pid>/stat), 0 if unknown
+	// Differs for process which reused pid of dead process
+	uint64_t getProcessStartTime(pid_t pid);
+
+	// Inode of PID namespace of current process, 0 if unknown
+	// Pid stored in shared memory by process of other PID namespace can't be checked with kill()
+	uint64_t getPidNamespaceId();
+
+	enum ShmLockResult {
+		SHM_LOCK_OK = 0,
+		SHM_LOCK_OWNER_DIED,
+		SHM_LOCK_BUSY,
+		SHM_LOCK_TIMED_OUT,
+	};
+
+	// Identity of process holding lock, written after lock word (or other claim with pid) is taken,
+	//  so it's valid only if pid is same as in lock word
+	struct ShmLockOwner {
+		std::atomic<uint32_t> pid; // 0 while being written
+		std::atomic<uint32_t> ns; // low bits of PID namespace inode, 0 if unknown
+		std::atomic<uint64_t> startTime; // 0 if unknown
+	};
+
+	// Record identity of current process after it took lock word or other claim with pid
+	void setShmLockOwner(ShmLockOwner* o, uint32_t pid);
+	// Called before releasing lock word or claim
+	void clearShmLockOwner(ShmLockOwner* o);
+	// Check if process holding lock word or claim is dead
+	// Owner from other PID namespace is never dead, without recorded identity (not written yet) only kill() is checked
+	bool isShmOwnerDead(uint32_t pid, const ShmLockOwner* o);
+
+	// Robust lock word in shared memory with pid of owner, see node_shm_lock.cc
+	// Lock of dead owner is taken over, returns ShmLockResult
+	int lockShmWord(std::atomic<uint32_t>* word, ShmLockOwner* owner, double timeoutMs);
+	// Returns false if word is not locked by current process
+	bool unlockShmWord(std::atomic<uint32_t>* word, ShmLockOwner* owner, int wakeCount);
+	bool isShmWordOwnerDead(const std::atomic<uint32_t>* word, const ShmLockOwner* owner);
+
+	/**
+	 * Get size in bytes of shared memory needed for mutex
+	 */
+	NAN_METHOD(mutexSizeOf);
+
+	/**
+	 * Init robust process-shared mutex inside shared memory buffer
+	 * Params:
+	 *  Buffer buf - buffer returned by getPosix()
+	 */
+	NAN_METHOD(mutexInit);
+
+	/**
+	 * Get size in bytes of shared memory needed for reader-writer lock
+	 * Params:
+	 *  uint32_t maxReaders - max count of processes holding read lock at once
+	 */
+	NAN_METHOD(rwLockSizeOf);
+
+	/**
+	 * Init robust process-shared reader-writer lock inside shared memory buffer
+	 * Params:
+	 *  Buffer buf - buffer returned by getPosix()
+	 *  uint32_t maxReaders
+	 */
+	NAN_METHOD(rwLockInit);
+
+	/**
+	 * Get info about mutex or reader-writer lock inside shared memory buffer
+	 * Params:
+	 *  Buffer buf
+	 * Returns object { type: 'mutex', owner } or { type: 'rwlock', owner, readers, maxReaders },
+	 *  or null if buffer has no lock; owner is pid of process holding (write) lock or 0
+	 */
+	NAN_METHOD(lockInfo);
+
+	/**
+	 * Acquire mutex or reader-writer lock for current process
+	 * Params:
+	 *  Buffer buf
+	 *  int kind - 0 for mutex, 1 for read lock, 2 for write lock
+	 *  double timeoutMs - Infinity to wait forever
+	 *  Function callback(err, res) - optional, if passed lock is acquired in threadpool,
+	 *   res is 'ok', 'owner-died' or 'timed-out'
+	 * Returns 'ok', 'owner-died' or 'busy' if callback is not passed (doesn't wait)
+	 */
+	NAN_METHOD(lock);
+
+	/**
+	 * Release mutex or reader-writer lock held by current process
+	 * Params:
+	 *  Buffer buf
+	 *  int kind - 0 for mutex, 1 for read lock, 2 for write lock
+	 * Throws if lock is not held by current process
+	 */
+	NAN_METHOD(unlock);
+
+	/**
+	 * Wait on futex at element of Int32Array/Uint32Array in threadpool
+	 *  until it's notified by another thread or process
+	 * Params:
+	 *  Int32Array/Uint32Array array - shared memory array
+	 *  uint32_t index
+	 *  int32_t expected - wait only if array[index] == expected
+	 *  double timeoutMs - Infinity to wait forever
+	 *  Function callback(err, res) - res is 'ok', 'not-equal' or 'timed-out'
+	 * Linux only
+	 */
+	NAN_METHOD(wait);
+
+	/**
+	 * Wake waiters on futex at element of Int32Array/Uint32Array
+	 * Params:
+	 *  Int32Array/Uint32Array array - shared memory array
+	 *  uint32_t index
+	 *  int32_t count - max count of waiters to wake, -1 for all
+	 * Returns count of woken waiters
+	 * Linux only
+	 */
+	NAN_METHOD(notify);
+
 	/**
 	 * Constants to be exported:
 	 * IPC_PRIVATE, IPC_CREAT, IPC_EXCL
 	 * SHM_RDONLY
 	 * NODE_BUFFER_MAX_LENGTH (count of elements, not bytes)
 	 * O_CREAT, O_RDWR, O_RDONLY, O_EXCL, O_TRUNC
+	 * SHM_HUGETLB, SHM_HUGE_2MB, SHM_HUGE_1GB, MAP_HUGETLB, MAP_HUGE_2MB, MAP_HUGE_1GB (Linux only)
+	 * MAP_POPULATE, MAP_LOCKED, MAP_NONBLOCK (Linux only)
+	 * enum ShmHugePages: SHMHP_NONE, SHMHP_2MB, SHMHP_1GB, SHMHP_AUTO
+	 * enum ShmPrefaultFlags: SHMPF_POPULATE, SHMPF_LOCK, SHMPF_WILLNEED
 	 * enum ShmBufferType: 
 	 *  SHMBT_BUFFER, SHMBT_INT8, SHMBT_UINT8, SHMBT_UINT8CLAMPED, 
 	 *  SHMBT_INT16, SHMBT_UINT16, SHMBT_INT32, SHMBT_UINT32, 
-	 *  SHMBT_FLOAT32, SHMBT_FLOAT64
+	 *  SHMBT_FLOAT32, SHMBT_FLOAT64,
+	 *  SHMBT_BIGINT64, SHMBT_BIGUINT64 (if supported by V8),
+	 *  SHMBT_FLOAT16 (if supported by V8)
 	 */
 
 }
@@ -0,0 +1,83 @@
+#include "node_shm.h"
+
+//-------------------------------
+
+// Write back of file-backed shared memory with msync() in libuv threadpool.
+// Kernel writes back dirty pages of MAP_SHARED file mapping by itself (see vm.dirty_expire_centisecs),
+//  msync(MS_SYNC) waits until range is on disk, eg. before checkpoint is reported as done.
+
+namespace node {
+namespace node_shm {
+
+	using v8::Function;
+	using v8::Local;
+	using v8::Number;
+	using v8::Value;
+
+	int syncMemoryRange(char* addr, size_t length) {
+		if (length == 0)
+			return 0;
+		ShmCounterTimer timer(SHMC_FLUSH_NS);
+		addShmCounter(SHMC_FLUSHES, 1);
+		size_t pageSize = sysconf(_SC_PAGESIZE);
+		// msync() needs address aligned to page
+		uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(pageSize - 1);
+		length += reinterpret_cast<uintptr_t>(addr) - start;
+		if (msync(reinterpret_cast<void*>(start), length, MS_SYNC) == -1)
+			return errno;
+		return 0;
+	}
+
+	class FlushWorker : public Nan::AsyncWorker {
+	public:
+		FlushWorker(Nan::Callback* callback, char* addr, size_t length)
+			: Nan::AsyncWorker(callback, "shm:flush"), addr(addr), length(length),
+			mapping(pinShmMapping(addr, length)) {}
+
+		void Execute() {
+			int err = syncMemoryRange(addr, length);
+			unpinShmMapping(mapping);
+			if (err != 0)
+				SetErrorMessage(strerror(err));
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			Local<Value> argv[] = { Nan::Null(), Nan::New<Number>((double) length) };
+			callback->Call(2, argv, async_resource);
+		}
+
+	private:
+		char* addr;
+		size_t length;
+		void* mapping; // pinned, so detach doesn't unmap range while it's written
+	};
+
+	NAN_METHOD(flush) {
+		Nan::HandleScope scope;
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument array must be a Buffer or TypedArray");
+		}
+		size_t byteOffset = Nan::To<double>(info[1]).FromJust();
+		size_t byteLength = Nan::To<double>(info[2]).FromJust();
+		if (byteOffset > length || byteLength > length - byteOffset) {
+			return Nan::ThrowRangeError("Range is out of bounds");
+		}
+		if (info[3]->IsFunction()) {
+			// Keep array alive while syncing, mapping is pinned by worker
+			FlushWorker* worker = new FlushWorker(
+				new Nan::Callback(info[3].As<Function>()), data + byteOffset, byteLength);
+			worker->SaveToPersistent("array", info[0]);
+			Nan::AsyncQueueWorker(worker);
+			return;
+		}
+		int err = syncMemoryRange(data + byteOffset, byteLength);
+		if (err != 0)
+			return Nan::ThrowError(strerror(err));
+		info.GetReturnValue().Set(Nan::New<Number>((double) byteLength));
+	}
+
+}
+}
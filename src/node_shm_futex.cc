@@ -0,0 +1,177 @@
+#include "node_shm.h"
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+//-------------------------------
+
+// Wait/notify on 32-bit element of shared memory with futex.
+// Unlike Atomics.wait(), futex is not private (no FUTEX_PRIVATE_FLAG),
+//  so waiter is woken by notify from any process that maps the same memory.
+
+namespace node {
+namespace node_shm {
+
+	using v8::Function;
+	using v8::Local;
+	using v8::Number;
+	using v8::Value;
+
+	enum ShmWaitResult {
+		SHM_WAIT_OK = 0,
+		SHM_WAIT_NOT_EQUAL,
+		SHM_WAIT_TIMED_OUT,
+	};
+
+	static const char* waitResultStr[] = { "ok", "not-equal", "timed-out" };
+
+	// Get address of 32-bit element of Int32Array/Uint32Array passed as argument
+	static int32_t* getWaitAddrArg(Local<Value> arr, Local<Value> index) {
+		if (!arr->IsInt32Array() && !arr->IsUint32Array()) {
+			Nan::ThrowTypeError("Argument array must be an Int32Array or Uint32Array");
+			return NULL;
+		}
+		char* data = NULL;
+		size_t length = 0;
+		getBufferData(arr, &data, &length);
+		uint32_t ind = Nan::To<uint32_t>(index).FromJust();
+		if ((size_t) ind >= length / sizeof(int32_t)) {
+			Nan::ThrowRangeError("Index is out of range");
+			return NULL;
+		}
+		return reinterpret_cast<int32_t*>(data) + ind;
+	}
+
+#ifdef __linux__
+	static long futex(int32_t* addr, int op, int32_t val, const struct timespec* timeout) {
+		return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+	}
+
+	static void addMs(struct timespec* ts, double ms) {
+		time_t sec = (time_t) (ms / 1000);
+		long nsec = (long) ((ms - sec * 1000.0) * 1000000);
+		ts->tv_sec += sec;
+		ts->tv_nsec += nsec;
+		if (ts->tv_nsec >= 1000000000) {
+			ts->tv_sec++;
+			ts->tv_nsec -= 1000000000;
+		}
+	}
+
+	// Returns ShmWaitResult, or -1 on error (see errno)
+	static int futexWait(int32_t* addr, int32_t expected, double timeoutMs) {
+		bool infinite = !(timeoutMs < INFINITY);
+		struct timespec deadline, now, rel;
+		if (!infinite) {
+			clock_gettime(CLOCK_MONOTONIC, &deadline);
+			addMs(&deadline, timeoutMs > 0 ? timeoutMs : 0);
+		}
+		for (;;) {
+			if (!infinite) {
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				rel.tv_sec = deadline.tv_sec - now.tv_sec;
+				rel.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+				if (rel.tv_nsec < 0) {
+					rel.tv_sec--;
+					rel.tv_nsec += 1000000000;
+				}
+				if (rel.tv_sec < 0)
+					return SHM_WAIT_TIMED_OUT;
+			}
+			long res = futex(addr, FUTEX_WAIT, expected, infinite ? NULL : &rel);
+			if (res == 0)
+				return SHM_WAIT_OK;
+			switch(errno) {
+				case EAGAIN: // *addr != expected
+					return SHM_WAIT_NOT_EQUAL;
+				case ETIMEDOUT:
+					return SHM_WAIT_TIMED_OUT;
+				case EINTR: // interrupted by signal, wait for the rest of time
+					continue;
+				default:
+					return -1;
+			}
+		}
+	}
+#endif
+
+	class WaitWorker : public Nan::AsyncWorker {
+	public:
+		WaitWorker(Nan::Callback* callback, int32_t* addr, int32_t expected, double timeoutMs)
+			: Nan::AsyncWorker(callback, "shm:wait"), addr(addr), expected(expected),
+			timeoutMs(timeoutMs), result(SHM_WAIT_OK),
+			mapping(pinShmMapping(reinterpret_cast<char*>(addr), sizeof(int32_t))) {}
+
+		void Execute() {
+		#ifdef __linux__
+			result = futexWait(addr, expected, timeoutMs);
+			if (result == -1)
+				SetErrorMessage(strerror(errno));
+		#endif
+			unpinShmMapping(mapping);
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			Local<Value> argv[] = {
+				Nan::Null(),
+				Nan::New(waitResultStr[result]).ToLocalChecked()
+			};
+			callback->Call(2, argv, async_resource);
+		}
+
+	private:
+		int32_t* addr;
+		int32_t expected;
+		double timeoutMs;
+		int result;
+		void* mapping; // pinned, so detach doesn't unmap futex word while it's waited
+	};
+
+	NAN_METHOD(wait) {
+		Nan::HandleScope scope;
+	#ifdef __linux__
+		int32_t* addr = getWaitAddrArg(info[0], info[1]);
+		if (addr == NULL)
+			return;
+		int32_t expected = Nan::To<int32_t>(info[2]).FromJust();
+		double timeoutMs = Nan::To<double>(info[3]).FromJust();
+		if (!info[4]->IsFunction()) {
+			return Nan::ThrowTypeError("Argument callback must be a function");
+		}
+		// Keep array alive while waiting, mapping is pinned by worker
+		WaitWorker* worker = new WaitWorker(
+			new Nan::Callback(info[4].As<Function>()), addr, expected, timeoutMs);
+		worker->SaveToPersistent("array", info[0]);
+		Nan::AsyncQueueWorker(worker);
+	#else
+		return Nan::ThrowError("Futex is not supported on this platform");
+	#endif
+	}
+
+	NAN_METHOD(notify) {
+		Nan::HandleScope scope;
+	#ifdef __linux__
+		int32_t* addr = getWaitAddrArg(info[0], info[1]);
+		if (addr == NULL)
+			return;
+		int32_t count = Nan::To<int32_t>(info[2]).FromJust();
+		long res = futex(addr, FUTEX_WAKE, count < 0 ? INT_MAX : count, NULL);
+		if (res == -1) {
+			return Nan::ThrowError(strerror(errno));
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(res));
+	#else
+		return Nan::ThrowError("Futex is not supported on this platform");
+	#endif
+	}
+
+}
+}
@@ -0,0 +1,566 @@
+#include "node_shm.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#include <sched.h>
+
+//-------------------------------
+
+// Fixed-capacity hash table with fixed-width keys and values living inside shared memory buffer.
+// Open addressing with linear probing.
+// Every bucket has seqlock: writer takes robust lock word of bucket (see node_shm_lock.cc)
+//  and makes sequence odd while it writes, readers copy bucket and retry if sequence
+//  has changed, so lookup needs no syscall.
+// Lock word contains pid of writer, so bucket of writer which died is taken over
+//  by waiter (live key of bucket left with odd sequence is deleted, because its value can be torn),
+//  and bucket of live writer is never taken over, however long it holds it.
+// Deleted bucket keeps its key (tombstone). New key is inserted to first tombstone
+//  or to empty bucket at the end of probe chain, while holding lock of that empty bucket:
+//  inserts of same key are serialized by it, so key is stored in at most one bucket
+//  even with concurrent writers. When no probe chain ends with empty bucket (all buckets
+//  were used), inserts to tombstones are serialized by insert lock of table instead.
+// Layout:
+//  ShmHashTableHeader (2 cache lines: params, count of keys)
+//  capacity * bucket (seq, tag, lock word, owner identity, key[keySize], value[valueSize]), aligned to 8 bytes
+
+#define SHM_HASHTABLE_MAGIC 0x48534854 // "THSH"
+#define SHM_HASHTABLE_VERSION 3
+#define SHM_CACHE_LINE_SIZE 64
+#define SHM_HASHTABLE_SPINS_BEFORE_YIELD 64
+// Writer holds bucket only for copy of key and value, so bucket locked longer is checked for dead owner
+#define SHM_HASHTABLE_CHECK_OWNER_NS 100000000
+
+// Bucket tag: 2 low bits are state, other bits are high bits of hash
+#define SHM_HASHTABLE_EMPTY 0
+#define SHM_HASHTABLE_LIVE 1
+#define SHM_HASHTABLE_DELETED 2
+#define SHM_HASHTABLE_STATE_MASK 3u
+
+namespace node {
+namespace node_shm {
+
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+		"std::atomic<uint32_t> should have no extra fields to be placed in shared memory");
+	static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+		"std::atomic should be lock-free to be used between processes");
+
+	struct ShmHashTableHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t keySize;
+		uint32_t valueSize;
+		uint64_t capacity;
+		uint64_t bucketStride;
+		std::atomic<uint32_t> insertLock; // pid of owner, 0 if unlocked
+		uint32_t reserved;
+		ShmLockOwner insertOwner;
+		char pad0[SHM_CACHE_LINE_SIZE - 5 * sizeof(uint64_t) - sizeof(ShmLockOwner)];
+		std::atomic<uint64_t> count;
+		char pad1[SHM_CACHE_LINE_SIZE - sizeof(uint64_t)];
+	};
+
+	struct ShmHashTableBucket {
+		std::atomic<uint32_t> seq;
+		std::atomic<uint32_t> tag;
+		std::atomic<uint32_t> owner; // pid of writer holding lock, 0 if unlocked
+		uint32_t reserved;
+		ShmLockOwner ownerId;
+		char data[1]; // key, then value
+	};
+
+	// State of wait for locked bucket
+	struct ShmHashTableSpin {
+		uint32_t spins;
+		uint32_t lockedSeq;
+		uint64_t lockedSince;
+	};
+
+	#define SHM_HASHTABLE_BUCKET_DATA_OFFSET offsetof(ShmHashTableBucket, data)
+
+	static inline uint64_t hashTableBucketStride(uint32_t keySize, uint32_t valueSize) {
+		uint64_t stride = SHM_HASHTABLE_BUCKET_DATA_OFFSET + (uint64_t) keySize + valueSize;
+		return (stride + 7) & ~((uint64_t) 7);
+	}
+
+	static inline uint64_t hashTableSizeOfBytes(uint64_t capacity, uint32_t keySize, uint32_t valueSize) {
+		return sizeof(ShmHashTableHeader) + hashTableBucketStride(keySize, valueSize) * capacity;
+	}
+
+	static inline ShmHashTableBucket* hashTableBucket(ShmHashTableHeader* t, uint64_t ind) {
+		char* buckets = reinterpret_cast<char*>(t) + sizeof(ShmHashTableHeader);
+		return reinterpret_cast<ShmHashTableBucket*>(buckets + (ind & (t->capacity - 1)) * t->bucketStride);
+	}
+
+	// Same in all processes, so no random seed
+	static inline uint64_t hashTableHash(const char* key, uint32_t keySize) {
+		uint64_t h = 0x9e3779b97f4a7c15ull ^ keySize;
+		uint32_t i = 0;
+		for (; i + 8 <= keySize; i += 8) {
+			uint64_t k;
+			memcpy(&k, key + i, 8);
+			h = (h ^ k) * 0xbf58476d1ce4e5b9ull;
+			h ^= h >> 31;
+		}
+		if (i < keySize) {
+			uint64_t k = 0;
+			memcpy(&k, key + i, keySize - i);
+			h = (h ^ k) * 0xbf58476d1ce4e5b9ull;
+			h ^= h >> 31;
+		}
+		// fmix64 from MurmurHash3
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	static inline uint32_t hashTableTagHash(uint64_t h) {
+		return (uint32_t) (h >> 32) & ~SHM_HASHTABLE_STATE_MASK;
+	}
+
+	// Returns odd sequence of locked bucket
+	static uint32_t hashTableLockBucket(ShmHashTableHeader* t, ShmHashTableBucket* b) {
+		lockShmWord(&b->owner, &b->ownerId, INFINITY);
+		uint32_t seq = b->seq.load(std::memory_order_relaxed);
+		if (seq & 1) {
+			// Taken over from writer which died while writing bucket
+			uint32_t tag = b->tag.load(std::memory_order_relaxed);
+			if ((tag & SHM_HASHTABLE_STATE_MASK) == SHM_HASHTABLE_LIVE) {
+				b->tag.store((tag & ~SHM_HASHTABLE_STATE_MASK) | SHM_HASHTABLE_DELETED, std::memory_order_relaxed);
+				// Writer could die before it counted inserted key
+				uint64_t cnt = t->count.load(std::memory_order_relaxed);
+				while (cnt > 0 && !t->count.compare_exchange_weak(cnt, cnt - 1, std::memory_order_relaxed)) {}
+			}
+		} else {
+			seq++;
+			b->seq.store(seq, std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		return seq;
+	}
+
+	static inline void hashTableUnlockBucket(ShmHashTableBucket* b, uint32_t seq) {
+		b->seq.store(seq + 1, std::memory_order_release);
+		unlockShmWord(&b->owner, &b->ownerId, INT_MAX);
+	}
+
+	// Called by reader while bucket is locked with odd seq
+	static void hashTableSpin(ShmHashTableHeader* t, ShmHashTableBucket* b, uint32_t seq, ShmHashTableSpin& spin) {
+		if (seq != spin.lockedSeq) {
+			spin.lockedSeq = seq;
+			spin.lockedSince = 0;
+		}
+		if (++spin.spins % SHM_HASHTABLE_SPINS_BEFORE_YIELD != 0)
+			return;
+		sched_yield();
+		uint64_t now = getMonotonicNs();
+		if (spin.lockedSince == 0) {
+			spin.lockedSince = now;
+		} else if (now - spin.lockedSince > SHM_HASHTABLE_CHECK_OWNER_NS) {
+			// Live writer is waited for, bucket of dead one is taken over and unlocked
+			if (isShmWordOwnerDead(&b->owner, &b->ownerId))
+				hashTableUnlockBucket(b, hashTableLockBucket(t, b));
+			spin.lockedSince = now;
+		}
+	}
+
+	// Find bucket of key
+	// If dst is not NULL, copies consistent value to dst
+	// Returns bucket, or NULL if not found
+	static ShmHashTableBucket* hashTableFind(ShmHashTableHeader* t, const char* key, char* dst) {
+		uint64_t h = hashTableHash(key, t->keySize);
+		uint32_t tagHash = hashTableTagHash(h);
+		for (uint64_t probe = 0; probe < t->capacity; probe++) {
+			ShmHashTableBucket* b = hashTableBucket(t, h + probe);
+			ShmHashTableSpin spin = {};
+			for (;;) {
+				uint32_t seq1 = b->seq.load(std::memory_order_acquire);
+				if (seq1 & 1) {
+					hashTableSpin(t, b, seq1, spin);
+					continue;
+				}
+				uint32_t tag = b->tag.load(std::memory_order_relaxed);
+				bool match = tag != SHM_HASHTABLE_EMPTY && (tag & ~SHM_HASHTABLE_STATE_MASK) == tagHash
+					&& memcmp(b->data, key, t->keySize) == 0;
+				bool live = match && (tag & SHM_HASHTABLE_STATE_MASK) == SHM_HASHTABLE_LIVE;
+				if (live && dst != NULL)
+					memcpy(dst, b->data + t->keySize, t->valueSize);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (b->seq.load(std::memory_order_relaxed) != seq1)
+					continue;
+				if (tag == SHM_HASHTABLE_EMPTY)
+					return NULL; // end of probe chain
+				if (match)
+					return live ? b : NULL;
+				break;
+			}
+		}
+		return NULL;
+	}
+
+	// Write value to locked bucket which has key or is free
+	static void hashTableWriteBucket(ShmHashTableHeader* t, ShmHashTableBucket* b, uint32_t seq, uint32_t tagHash,
+		const char* key, const char* value) {
+		uint32_t tag = b->tag.load(std::memory_order_relaxed);
+		memcpy(b->data, key, t->keySize);
+		memcpy(b->data + t->keySize, value, t->valueSize);
+		b->tag.store(tagHash | SHM_HASHTABLE_LIVE, std::memory_order_relaxed);
+		hashTableUnlockBucket(b, seq);
+		if ((tag & SHM_HASHTABLE_STATE_MASK) != SHM_HASHTABLE_LIVE)
+			t->count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Update bucket of key found on probe chain, scanning up to end probe
+	// Returns false if key is not stored in any bucket
+	static bool hashTableUpdateKey(ShmHashTableHeader* t, uint64_t h, uint64_t end, uint32_t tagHash,
+		const char* key, const char* value, uint64_t* endOut) {
+		for (uint64_t probe = 0; probe < end; probe++) {
+			ShmHashTableBucket* b = hashTableBucket(t, h + probe);
+			uint32_t tag = b->tag.load(std::memory_order_acquire);
+			if (tag == SHM_HASHTABLE_EMPTY) {
+				if (endOut != NULL)
+					*endOut = probe;
+				return false; // end of probe chain
+			}
+			if ((tag & ~SHM_HASHTABLE_STATE_MASK) != tagHash)
+				continue;
+			uint32_t seq = hashTableLockBucket(t, b);
+			tag = b->tag.load(std::memory_order_relaxed);
+			if (tag != SHM_HASHTABLE_EMPTY && memcmp(b->data, key, t->keySize) == 0) {
+				hashTableWriteBucket(t, b, seq, tagHash, key, value);
+				return true;
+			}
+			// Bucket was taken by other key
+			hashTableUnlockBucket(b, seq);
+		}
+		return false;
+	}
+
+	static inline void hashTableLockInserts(ShmHashTableHeader* t) {
+		lockShmWord(&t->insertLock, &t->insertOwner, INFINITY);
+	}
+
+	// Insert to first tombstone on probe chain which has no empty bucket
+	// Returns false if table is full
+	static bool hashTableInsertToTombstone(ShmHashTableHeader* t, uint64_t h, uint32_t tagHash,
+		const char* key, const char* value) {
+		hashTableLockInserts(t);
+		bool res = hashTableUpdateKey(t, h, t->capacity, tagHash, key, value, NULL);
+		for (uint64_t probe = 0; !res && probe < t->capacity; probe++) {
+			ShmHashTableBucket* b = hashTableBucket(t, h + probe);
+			if ((b->tag.load(std::memory_order_acquire) & SHM_HASHTABLE_STATE_MASK) != SHM_HASHTABLE_DELETED)
+				continue;
+			uint32_t seq = hashTableLockBucket(t, b);
+			if ((b->tag.load(std::memory_order_relaxed) & SHM_HASHTABLE_STATE_MASK) == SHM_HASHTABLE_DELETED) {
+				hashTableWriteBucket(t, b, seq, tagHash, key, value);
+				res = true;
+			} else {
+				hashTableUnlockBucket(b, seq);
+			}
+		}
+		unlockShmWord(&t->insertLock, &t->insertOwner, 1);
+		return res;
+	}
+
+	// Returns false if table is full
+	static bool hashTablePutValue(ShmHashTableHeader* t, const char* key, const char* value) {
+		uint64_t h = hashTableHash(key, t->keySize);
+		uint32_t tagHash = hashTableTagHash(h);
+		for (;;) {
+			uint64_t end = t->capacity;
+			if (hashTableUpdateKey(t, h, t->capacity, tagHash, key, value, &end))
+				return true;
+			// Buckets don't become empty again, so all inserts of key go this way from now
+			if (end == t->capacity)
+				return hashTableInsertToTombstone(t, h, tagHash, key, value);
+			ShmHashTableBucket* endBucket = hashTableBucket(t, h + end);
+			uint32_t endSeq = hashTableLockBucket(t, endBucket);
+			if (endBucket->tag.load(std::memory_order_relaxed) != SHM_HASHTABLE_EMPTY) {
+				// Taken by other insert, probe chain is longer now
+				hashTableUnlockBucket(endBucket, endSeq);
+				continue;
+			}
+			// Same key can be inserted only by holder of end bucket, but could be inserted before it was locked
+			if (hashTableUpdateKey(t, h, end, tagHash, key, value, NULL)) {
+				hashTableUnlockBucket(endBucket, endSeq);
+				return true;
+			}
+			for (uint64_t probe = 0; probe < end; probe++) {
+				ShmHashTableBucket* b = hashTableBucket(t, h + probe);
+				if ((b->tag.load(std::memory_order_acquire) & SHM_HASHTABLE_STATE_MASK) != SHM_HASHTABLE_DELETED)
+					continue;
+				uint32_t seq = hashTableLockBucket(t, b);
+				if ((b->tag.load(std::memory_order_relaxed) & SHM_HASHTABLE_STATE_MASK) == SHM_HASHTABLE_DELETED) {
+					hashTableWriteBucket(t, b, seq, tagHash, key, value);
+					hashTableUnlockBucket(endBucket, endSeq);
+					return true;
+				}
+				// Tombstone was reused by other key
+				hashTableUnlockBucket(b, seq);
+			}
+			hashTableWriteBucket(t, endBucket, endSeq, tagHash, key, value);
+			return true;
+		}
+	}
+
+	// Returns false if not found
+	static bool hashTableDeleteKey(ShmHashTableHeader* t, const char* key) {
+		uint64_t h = hashTableHash(key, t->keySize);
+		uint32_t tagHash = hashTableTagHash(h);
+		for (uint64_t probe = 0; probe < t->capacity; probe++) {
+			ShmHashTableBucket* b = hashTableBucket(t, h + probe);
+			uint32_t tag = b->tag.load(std::memory_order_acquire);
+			if (tag == SHM_HASHTABLE_EMPTY)
+				return false;
+			if ((tag & ~SHM_HASHTABLE_STATE_MASK) != tagHash)
+				continue;
+			uint32_t seq = hashTableLockBucket(t, b);
+			tag = b->tag.load(std::memory_order_relaxed);
+			if (memcmp(b->data, key, t->keySize) == 0) {
+				bool live = (tag & SHM_HASHTABLE_STATE_MASK) == SHM_HASHTABLE_LIVE;
+				if (live) {
+					b->tag.store(tagHash | SHM_HASHTABLE_DELETED, std::memory_order_relaxed);
+					t->count.fetch_sub(1, std::memory_order_relaxed);
+				}
+				hashTableUnlockBucket(b, seq);
+				return live;
+			}
+			hashTableUnlockBucket(b, seq);
+		}
+		return false;
+	}
+
+	// Get hash table from buffer passed as argument, throws if it's not a valid hash table
+	static ShmHashTableHeader* getHashTableArg(Local<Value> val) {
+		char* data;
+		size_t length;
+		if (!getBufferData(val, &data, &length)) {
+			Nan::ThrowTypeError("Argument buf must be a Buffer");
+			return NULL;
+		}
+		ShmHashTableHeader* t = reinterpret_cast<ShmHashTableHeader*>(data);
+		if (length < sizeof(ShmHashTableHeader) || t->magic != SHM_HASHTABLE_MAGIC
+			|| t->version != SHM_HASHTABLE_VERSION
+			|| length < hashTableSizeOfBytes(t->capacity, t->keySize, t->valueSize)) {
+			Nan::ThrowError("Buffer does not contain a hash table");
+			return NULL;
+		}
+		return t;
+	}
+
+	// Get key passed as argument: Buffer/TypedArray of keySize bytes,
+	//  or number/BigInt for 8-byte keys (uint64 in native byte order)
+	static bool getHashTableKeyArg(ShmHashTableHeader* t, Local<Value> val, char** key, uint64_t* keyBuf) {
+		size_t length;
+		if (getBufferData(val, key, &length)) {
+			if (length != t->keySize) {
+				Nan::ThrowRangeError("Key size should be equal to key size of hash table");
+				return false;
+			}
+			return true;
+		}
+		if (t->keySize == sizeof(uint64_t)) {
+			if (val->IsNumber()) {
+				*keyBuf = (uint64_t) Nan::To<int64_t>(val).FromJust();
+				*key = reinterpret_cast<char*>(keyBuf);
+				return true;
+			}
+		#if SHM_HAS_BIGINT64_ARRAY
+			if (val->IsBigInt()) {
+				*keyBuf = val.As<v8::BigInt>()->Uint64Value();
+				*key = reinterpret_cast<char*>(keyBuf);
+				return true;
+			}
+		#endif
+		}
+		Nan::ThrowTypeError("Argument key must be a Buffer or TypedArray");
+		return false;
+	}
+
+	NAN_METHOD(hashTableSizeOf) {
+		double capacity = Nan::To<double>(info[0]).FromJust();
+		uint32_t keySize = Nan::To<uint32_t>(info[1]).FromJust();
+		uint32_t valueSize = Nan::To<uint32_t>(info[2]).FromJust();
+		info.GetReturnValue().Set(Nan::New<Number>(
+			(double) hashTableSizeOfBytes((uint64_t) capacity, keySize, valueSize)));
+	}
+
+	NAN_METHOD(hashTableInit) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		uint64_t capacity = Nan::To<int64_t>(info[1]).FromJust();
+		uint32_t keySize = Nan::To<uint32_t>(info[2]).FromJust();
+		uint32_t valueSize = Nan::To<uint32_t>(info[3]).FromJust();
+		if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+			return Nan::ThrowRangeError("Capacity should be power of 2");
+		}
+		if (keySize == 0) {
+			return Nan::ThrowRangeError("Key size should be positive");
+		}
+		if (length < hashTableSizeOfBytes(capacity, keySize, valueSize)) {
+			return Nan::ThrowRangeError("Buffer is too small for hash table");
+		}
+
+		ShmHashTableHeader* t = reinterpret_cast<ShmHashTableHeader*>(data);
+		t->keySize = keySize;
+		t->valueSize = valueSize;
+		t->capacity = capacity;
+		t->bucketStride = hashTableBucketStride(keySize, valueSize);
+		t->insertLock.store(0, std::memory_order_relaxed);
+		t->insertOwner.pid.store(0, std::memory_order_relaxed);
+		t->count.store(0, std::memory_order_relaxed);
+		for (uint64_t i = 0; i < capacity; i++) {
+			ShmHashTableBucket* b = hashTableBucket(t, i);
+			b->seq.store(0, std::memory_order_relaxed);
+			b->tag.store(SHM_HASHTABLE_EMPTY, std::memory_order_relaxed);
+			b->owner.store(0, std::memory_order_relaxed);
+			b->ownerId.pid.store(0, std::memory_order_relaxed);
+		}
+		t->version = SHM_HASHTABLE_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		t->magic = SHM_HASHTABLE_MAGIC;
+	}
+
+	NAN_METHOD(hashTableInfo) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		ShmHashTableHeader* t = reinterpret_cast<ShmHashTableHeader*>(data);
+		if (length < sizeof(ShmHashTableHeader) || t->magic != SHM_HASHTABLE_MAGIC
+			|| t->version != SHM_HASHTABLE_VERSION
+			|| length < hashTableSizeOfBytes(t->capacity, t->keySize, t->valueSize)) {
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		Local<Object> res = Nan::New<Object>();
+		Nan::Set(res, Nan::New("capacity").ToLocalChecked(), Nan::New<Number>((double) t->capacity));
+		Nan::Set(res, Nan::New("keySize").ToLocalChecked(), Nan::New<Number>(t->keySize));
+		Nan::Set(res, Nan::New("valueSize").ToLocalChecked(), Nan::New<Number>(t->valueSize));
+		Nan::Set(res, Nan::New("size").ToLocalChecked(),
+			Nan::New<Number>((double) t->count.load(std::memory_order_relaxed)));
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(hashTableGet) {
+		ShmHashTableHeader* t = getHashTableArg(info[0]);
+		if (t == NULL)
+			return;
+		char* key;
+		uint64_t keyBuf;
+		if (!getHashTableKeyArg(t, info[1], &key, &keyBuf))
+			return;
+		char* dst;
+		size_t dstLength;
+		if (!getBufferData(info[2], &dst, &dstLength)) {
+			return Nan::ThrowTypeError("Argument dst must be a Buffer or TypedArray");
+		}
+		if (dstLength < t->valueSize) {
+			return Nan::ThrowRangeError("Destination is smaller than value");
+		}
+		bool found = hashTableFind(t, key, dst) != NULL;
+		info.GetReturnValue().Set(found);
+	}
+
+	NAN_METHOD(hashTableOffsetOf) {
+		ShmHashTableHeader* t = getHashTableArg(info[0]);
+		if (t == NULL)
+			return;
+		char* key;
+		uint64_t keyBuf;
+		if (!getHashTableKeyArg(t, info[1], &key, &keyBuf))
+			return;
+		ShmHashTableBucket* b = hashTableFind(t, key, NULL);
+		double offset = b == NULL ? -1
+			: (double) (b->data + t->keySize - reinterpret_cast<char*>(t));
+		info.GetReturnValue().Set(Nan::New<Number>(offset));
+	}
+
+	NAN_METHOD(hashTablePut) {
+		ShmHashTableHeader* t = getHashTableArg(info[0]);
+		if (t == NULL)
+			return;
+		char* key;
+		uint64_t keyBuf;
+		if (!getHashTableKeyArg(t, info[1], &key, &keyBuf))
+			return;
+		char* value;
+		size_t valueLength;
+		if (!getBufferData(info[2], &value, &valueLength)) {
+			return Nan::ThrowTypeError("Argument value must be a Buffer or TypedArray");
+		}
+		if (valueLength != t->valueSize) {
+			return Nan::ThrowRangeError("Value size should be equal to value size of hash table");
+		}
+		bool res = hashTablePutValue(t, key, value);
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(hashTableDelete) {
+		ShmHashTableHeader* t = getHashTableArg(info[0]);
+		if (t == NULL)
+			return;
+		char* key;
+		uint64_t keyBuf;
+		if (!getHashTableKeyArg(t, info[1], &key, &keyBuf))
+			return;
+		bool res = hashTableDeleteKey(t, key);
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(hashTableGetMany) {
+		ShmHashTableHeader* t = getHashTableArg(info[0]);
+		if (t == NULL)
+			return;
+		char* keys;
+		size_t keysLength;
+		if (!getBufferData(info[1], &keys, &keysLength)) {
+			return Nan::ThrowTypeError("Argument keys must be a Buffer or TypedArray");
+		}
+		if (keysLength % t->keySize != 0) {
+			return Nan::ThrowRangeError("Size of keys should be multiple of key size");
+		}
+		size_t cnt = keysLength / t->keySize;
+		char* dst;
+		size_t dstLength;
+		if (!getBufferData(info[2], &dst, &dstLength)) {
+			return Nan::ThrowTypeError("Argument dst must be a Buffer or TypedArray");
+		}
+		if (dstLength < cnt * t->valueSize) {
+			return Nan::ThrowRangeError("Destination is smaller than values");
+		}
+		char* found = NULL;
+		size_t foundLength = 0;
+		if (!info[3]->IsUndefined() && !getBufferData(info[3], &found, &foundLength)) {
+			return Nan::ThrowTypeError("Argument found must be a Buffer or Uint8Array");
+		}
+		if (found != NULL && foundLength < cnt) {
+			return Nan::ThrowRangeError("Argument found is smaller than count of keys");
+		}
+		size_t foundCnt = 0;
+		for (size_t i = 0; i < cnt; i++) {
+			bool isFound = hashTableFind(t, keys + i * t->keySize, dst + i * t->valueSize) != NULL;
+			if (found != NULL)
+				found[i] = isFound ? 1 : 0;
+			if (isFound)
+				foundCnt++;
+		}
+		info.GetReturnValue().Set(Nan::New<Number>((double) foundCnt));
+	}
+
+}
+}
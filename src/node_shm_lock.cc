@@ -0,0 +1,578 @@
+#include "node_shm.h"
+
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <signal.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+//-------------------------------
+
+// Robust process-shared mutex and reader-writer lock living inside shared memory buffer.
+// Lock word contains pid of owner process and "has waiters" bit:
+//  uncontended lock/unlock is one CAS in user space, waiters sleep on futex.
+// Ownership is per process (not per thread like pthread mutex), so lock acquired
+//  in libuv threadpool can be released by JS thread.
+// Waiter checks if owner process is alive, lock of dead owner is taken over
+//  with result "owner-died" (like EOWNERDEAD of robust pthread mutex).
+// Next to pid owner records its start time and PID namespace: pid reused by other process
+//  is detected by start time, lock of owner from other PID namespace is never taken over
+//  (its pid can't be checked with kill()).
+// Reader-writer lock prefers writers. Readers register their pid in slots,
+//  so writer can release slots of dead readers.
+// Layout of mutex:
+//  ShmMutexHeader (2 cache lines: params, lock word and owner)
+// Layout of reader-writer lock:
+//  ShmRwLockHeader (3 cache lines: params, writer lock word and owner, readers generation)
+//  maxReaders * ShmRwLockSlot reader slots
+
+#define SHM_MUTEX_MAGIC 0x5854554d // "MUTX"
+#define SHM_RWLOCK_MAGIC 0x4b4c5752 // "RWLK"
+#define SHM_LOCK_VERSION 2
+#define SHM_CACHE_LINE_SIZE 64
+
+#define SHM_LOCK_WAITERS 0x80000000u
+#define SHM_LOCK_PID_MASK 0x7fffffffu
+// Max time to sleep before checking if owner is alive
+#define SHM_LOCK_CHECK_OWNER_MS 100
+
+namespace node {
+namespace node_shm {
+
+	using v8::Function;
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+		"std::atomic<uint32_t> should have no extra fields to be placed in shared memory");
+	static_assert(ATOMIC_INT_LOCK_FREE == 2,
+		"std::atomic<uint32_t> should be lock-free to be used between processes");
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+		"std::atomic<uint64_t> should be lock-free to be used between processes");
+
+	static const char* lockResultStr[] = { "ok", "owner-died", "busy", "timed-out" };
+
+	enum ShmLockKind {
+		SHM_LOCK_MUTEX = 0,
+		SHM_LOCK_READ,
+		SHM_LOCK_WRITE,
+	};
+
+	struct ShmMutexHeader {
+		uint32_t magic;
+		uint32_t version;
+		char pad0[SHM_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+		std::atomic<uint32_t> word;
+		uint32_t reserved;
+		ShmLockOwner owner;
+		char pad1[SHM_CACHE_LINE_SIZE - 2 * sizeof(uint32_t) - sizeof(ShmLockOwner)];
+	};
+
+	struct ShmRwLockHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t maxReaders;
+		char pad0[SHM_CACHE_LINE_SIZE - 3 * sizeof(uint32_t)];
+		std::atomic<uint32_t> writer;
+		uint32_t reserved;
+		ShmLockOwner writerOwner;
+		char pad1[SHM_CACHE_LINE_SIZE - 2 * sizeof(uint32_t) - sizeof(ShmLockOwner)];
+		// Incremented when reader leaves while writer is waiting
+		std::atomic<uint32_t> readersGen;
+		char pad2[SHM_CACHE_LINE_SIZE - sizeof(uint32_t)];
+	};
+
+	struct ShmRwLockSlot {
+		std::atomic<uint32_t> pid; // 0 if slot is free
+		uint32_t reserved;
+		ShmLockOwner owner;
+	};
+
+	static inline ShmRwLockSlot* rwLockSlots(ShmRwLockHeader* l) {
+		return reinterpret_cast<ShmRwLockSlot*>(reinterpret_cast<char*>(l) + sizeof(ShmRwLockHeader));
+	}
+
+	static inline uint64_t rwLockSizeOfBytes(uint32_t maxReaders) {
+		return sizeof(ShmRwLockHeader) + (uint64_t) maxReaders * sizeof(ShmRwLockSlot);
+	}
+
+	// Identity of current process, cached until pid changes (in forked child)
+	static void getOwnIdentity(uint32_t pid, uint32_t* ns, uint64_t* startTime) {
+		static std::atomic<uint32_t> cachedPid(0);
+		static std::atomic<uint32_t> cachedNs(0);
+		static std::atomic<uint64_t> cachedStartTime(0);
+		if (cachedPid.load(std::memory_order_acquire) != pid) {
+			cachedNs.store((uint32_t) getPidNamespaceId(), std::memory_order_relaxed);
+			cachedStartTime.store(getProcessStartTime((pid_t) pid), std::memory_order_relaxed);
+			cachedPid.store(pid, std::memory_order_release);
+		}
+		*ns = cachedNs.load(std::memory_order_relaxed);
+		*startTime = cachedStartTime.load(std::memory_order_relaxed);
+	}
+
+	void setShmLockOwner(ShmLockOwner* o, uint32_t pid) {
+		uint32_t ns;
+		uint64_t startTime;
+		getOwnIdentity(pid, &ns, &startTime);
+		o->pid.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		o->ns.store(ns, std::memory_order_relaxed);
+		o->startTime.store(startTime, std::memory_order_relaxed);
+		o->pid.store(pid, std::memory_order_release);
+	}
+
+	void clearShmLockOwner(ShmLockOwner* o) {
+		o->pid.store(0, std::memory_order_relaxed);
+	}
+
+	bool isShmOwnerDead(uint32_t pid, const ShmLockOwner* o) {
+		if (pid == 0)
+			return false;
+		uint32_t idPid = o->pid.load(std::memory_order_acquire);
+		uint32_t ns = o->ns.load(std::memory_order_relaxed);
+		uint64_t startTime = o->startTime.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		bool known = idPid == pid && o->pid.load(std::memory_order_relaxed) == pid;
+		if (known && ns != 0) {
+			uint32_t myNs;
+			uint64_t myStartTime;
+			getOwnIdentity((uint32_t) getpid(), &myNs, &myStartTime);
+			if (myNs != 0 && ns != myNs)
+				return false;
+		}
+		if (kill((pid_t) pid, 0) == -1 && errno == ESRCH)
+			return true;
+		if (!known || startTime == 0)
+			return false;
+		// Pid is reused by other process, 0 if process has just exited or /proc is hidden
+		uint64_t curStartTime = getProcessStartTime((pid_t) pid);
+		return curStartTime != 0 && curStartTime != startTime;
+	}
+
+	static inline double monotonicMs() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+	}
+
+	// Sleep while *addr == expected, but not longer than ms
+	static void lockSleep(std::atomic<uint32_t>* addr, uint32_t expected, double ms) {
+		struct timespec rel;
+		rel.tv_sec = (time_t) (ms / 1000);
+		rel.tv_nsec = (long) ((ms - rel.tv_sec * 1000.0) * 1000000);
+	#ifdef __linux__
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expected, &rel, NULL, 0);
+	#else
+		(void) addr;
+		(void) expected;
+		if (rel.tv_sec > 0 || rel.tv_nsec > 1000000) {
+			rel.tv_sec = 0;
+			rel.tv_nsec = 1000000;
+		}
+		nanosleep(&rel, NULL);
+	#endif
+	}
+
+	static inline void lockWake(std::atomic<uint32_t>* addr, int count) {
+	#ifdef __linux__
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, count, NULL, NULL, 0);
+	#else
+		(void) addr;
+		(void) count;
+	#endif
+	}
+
+	// Returns remaining time in ms, or -1 if deadline has passed
+	static inline double lockRemainingMs(double deadline) {
+		if (!(deadline < INFINITY))
+			return SHM_LOCK_CHECK_OWNER_MS;
+		double rem = deadline - monotonicMs();
+		return rem > 0 ? std::min(rem, (double) SHM_LOCK_CHECK_OWNER_MS) : -1;
+	}
+
+	int lockShmWord(std::atomic<uint32_t>* word, ShmLockOwner* owner, double timeoutMs) {
+		uint32_t me = (uint32_t) getpid();
+		uint32_t waiters = 0; // set after sleep, to not lose wake of other waiters
+		double deadline = timeoutMs < INFINITY ? monotonicMs() + std::max(timeoutMs, 0.0) : INFINITY;
+		uint32_t cur = word->load(std::memory_order_relaxed);
+		for (;;) {
+			if (cur == 0) {
+				if (word->compare_exchange_weak(cur, me | waiters, std::memory_order_acquire, std::memory_order_relaxed)) {
+					setShmLockOwner(owner, me);
+					return SHM_LOCK_OK;
+				}
+				continue;
+			}
+			if (isShmOwnerDead(cur & SHM_LOCK_PID_MASK, owner)) {
+				if (word->compare_exchange_strong(cur, me | (cur & SHM_LOCK_WAITERS),
+					std::memory_order_acquire, std::memory_order_relaxed)) {
+					setShmLockOwner(owner, me);
+					return SHM_LOCK_OWNER_DIED;
+				}
+				continue;
+			}
+			if (timeoutMs <= 0)
+				return SHM_LOCK_BUSY;
+			double rem = lockRemainingMs(deadline);
+			if (rem < 0)
+				return SHM_LOCK_TIMED_OUT;
+			if (!(cur & SHM_LOCK_WAITERS)) {
+				if (!word->compare_exchange_weak(cur, cur | SHM_LOCK_WAITERS, std::memory_order_relaxed))
+					continue;
+				cur |= SHM_LOCK_WAITERS;
+			}
+			lockSleep(word, cur, rem);
+			waiters = SHM_LOCK_WAITERS;
+			cur = word->load(std::memory_order_relaxed);
+		}
+	}
+
+	bool unlockShmWord(std::atomic<uint32_t>* word, ShmLockOwner* owner, int wakeCount) {
+		uint32_t cur = word->load(std::memory_order_relaxed);
+		if ((cur & SHM_LOCK_PID_MASK) != (uint32_t) getpid())
+			return false;
+		clearShmLockOwner(owner);
+		uint32_t old = word->exchange(0, std::memory_order_release);
+		if (old & SHM_LOCK_WAITERS)
+			lockWake(word, wakeCount);
+		return true;
+	}
+
+	bool isShmWordOwnerDead(const std::atomic<uint32_t>* word, const ShmLockOwner* owner) {
+		return isShmOwnerDead(word->load(std::memory_order_relaxed) & SHM_LOCK_PID_MASK, owner);
+	}
+
+	// Wait until there are no readers, releases slots of dead readers
+	// Returns false on timeout
+	static bool rwLockWaitReaders(ShmRwLockHeader* l, double timeoutMs) {
+		ShmRwLockSlot* slots = rwLockSlots(l);
+		double deadline = timeoutMs < INFINITY ? monotonicMs() + std::max(timeoutMs, 0.0) : INFINITY;
+		for (;;) {
+			uint32_t gen = l->readersGen.load(std::memory_order_seq_cst);
+			bool busy = false;
+			for (uint32_t i = 0; i < l->maxReaders; i++) {
+				uint32_t pid = slots[i].pid.load(std::memory_order_seq_cst);
+				if (pid == 0)
+					continue;
+				if (isShmOwnerDead(pid, &slots[i].owner)) {
+					clearShmLockOwner(&slots[i].owner);
+					slots[i].pid.compare_exchange_strong(pid, 0, std::memory_order_relaxed);
+					continue;
+				}
+				busy = true;
+				break;
+			}
+			if (!busy)
+				return true;
+			if (timeoutMs <= 0)
+				return false;
+			double rem = lockRemainingMs(deadline);
+			if (rem < 0)
+				return false;
+			lockSleep(&l->readersGen, gen, rem);
+		}
+	}
+
+	static int rwLockWrite(ShmRwLockHeader* l, double timeoutMs) {
+		double start = monotonicMs();
+		int res = lockShmWord(&l->writer, &l->writerOwner, timeoutMs);
+		if (res != SHM_LOCK_OK && res != SHM_LOCK_OWNER_DIED)
+			return res;
+		double rem = timeoutMs < INFINITY ? timeoutMs - (monotonicMs() - start) : INFINITY;
+		if (!rwLockWaitReaders(l, rem)) {
+			unlockShmWord(&l->writer, &l->writerOwner, INT_MAX);
+			return timeoutMs <= 0 ? SHM_LOCK_BUSY : SHM_LOCK_TIMED_OUT;
+		}
+		return res;
+	}
+
+	static inline void rwLockReleaseSlot(ShmRwLockHeader* l, ShmRwLockSlot* slot) {
+		clearShmLockOwner(&slot->owner);
+		slot->pid.store(0, std::memory_order_seq_cst);
+		if (l->writer.load(std::memory_order_seq_cst) != 0) {
+			l->readersGen.fetch_add(1, std::memory_order_seq_cst);
+			lockWake(&l->readersGen, INT_MAX);
+		}
+	}
+
+	static int rwLockRead(ShmRwLockHeader* l, double timeoutMs) {
+		uint32_t me = (uint32_t) getpid();
+		ShmRwLockSlot* slots = rwLockSlots(l);
+		double deadline = timeoutMs < INFINITY ? monotonicMs() + std::max(timeoutMs, 0.0) : INFINITY;
+		int res = SHM_LOCK_OK;
+		for (;;) {
+			uint32_t w = l->writer.load(std::memory_order_seq_cst);
+			if (w == 0) {
+				// Register as reader
+				ShmRwLockSlot* slot = NULL;
+				uint32_t start = me % l->maxReaders;
+				for (uint32_t i = 0; i < l->maxReaders && slot == NULL; i++) {
+					ShmRwLockSlot* s = &slots[(start + i) % l->maxReaders];
+					uint32_t pid = s->pid.load(std::memory_order_relaxed);
+					if (pid == 0 && s->pid.compare_exchange_strong(pid, me, std::memory_order_seq_cst))
+						slot = s;
+				}
+				if (slot != NULL) {
+					setShmLockOwner(&slot->owner, me);
+					if (l->writer.load(std::memory_order_seq_cst) == 0)
+						return res;
+					// Writer came, let it go first
+					rwLockReleaseSlot(l, slot);
+					continue;
+				}
+				// No free slots, wait for other readers
+				w = 0;
+			} else if (isShmOwnerDead(w & SHM_LOCK_PID_MASK, &l->writerOwner)) {
+				// Writer died holding lock
+				if (l->writer.compare_exchange_strong(w, 0, std::memory_order_acquire)) {
+					res = SHM_LOCK_OWNER_DIED;
+					if (w & SHM_LOCK_WAITERS)
+						lockWake(&l->writer, INT_MAX);
+				}
+				continue;
+			}
+			if (timeoutMs <= 0)
+				return SHM_LOCK_BUSY;
+			double rem = lockRemainingMs(deadline);
+			if (rem < 0)
+				return SHM_LOCK_TIMED_OUT;
+			if (w == 0) {
+				lockSleep(&l->readersGen, l->readersGen.load(std::memory_order_relaxed), std::min(rem, 1.0));
+				continue;
+			}
+			if (!(w & SHM_LOCK_WAITERS)) {
+				if (!l->writer.compare_exchange_weak(w, w | SHM_LOCK_WAITERS, std::memory_order_relaxed))
+					continue;
+				w |= SHM_LOCK_WAITERS;
+			}
+			lockSleep(&l->writer, w, rem);
+		}
+	}
+
+	// Returns false if current process has no read lock
+	static bool rwLockReadUnlock(ShmRwLockHeader* l) {
+		uint32_t me = (uint32_t) getpid();
+		ShmRwLockSlot* slots = rwLockSlots(l);
+		uint32_t start = me % l->maxReaders;
+		for (uint32_t i = 0; i < l->maxReaders; i++) {
+			ShmRwLockSlot* s = &slots[(start + i) % l->maxReaders];
+			if (s->pid.load(std::memory_order_relaxed) == me) {
+				rwLockReleaseSlot(l, s);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Get mutex from buffer passed as argument, throws if it's not a valid mutex
+	static ShmMutexHeader* getMutexArg(Local<Value> val) {
+		char* data;
+		size_t length;
+		if (!getBufferData(val, &data, &length)) {
+			Nan::ThrowTypeError("Argument buf must be a Buffer");
+			return NULL;
+		}
+		ShmMutexHeader* m = reinterpret_cast<ShmMutexHeader*>(data);
+		if (length < sizeof(ShmMutexHeader) || m->magic != SHM_MUTEX_MAGIC || m->version != SHM_LOCK_VERSION) {
+			Nan::ThrowError("Buffer does not contain a mutex");
+			return NULL;
+		}
+		return m;
+	}
+
+	// Get reader-writer lock from buffer passed as argument, throws if it's not a valid lock
+	static ShmRwLockHeader* getRwLockArg(Local<Value> val) {
+		char* data;
+		size_t length;
+		if (!getBufferData(val, &data, &length)) {
+			Nan::ThrowTypeError("Argument buf must be a Buffer");
+			return NULL;
+		}
+		ShmRwLockHeader* l = reinterpret_cast<ShmRwLockHeader*>(data);
+		if (length < sizeof(ShmRwLockHeader) || l->magic != SHM_RWLOCK_MAGIC || l->version != SHM_LOCK_VERSION
+			|| l->maxReaders == 0 || length < rwLockSizeOfBytes(l->maxReaders)) {
+			Nan::ThrowError("Buffer does not contain a reader-writer lock");
+			return NULL;
+		}
+		return l;
+	}
+
+	// Returns ShmLockResult
+	static int lockByKind(char* data, int kind, double timeoutMs) {
+		switch (kind) {
+			case SHM_LOCK_READ:
+				return rwLockRead(reinterpret_cast<ShmRwLockHeader*>(data), timeoutMs);
+			case SHM_LOCK_WRITE:
+				return rwLockWrite(reinterpret_cast<ShmRwLockHeader*>(data), timeoutMs);
+			default: {
+				ShmMutexHeader* m = reinterpret_cast<ShmMutexHeader*>(data);
+				return lockShmWord(&m->word, &m->owner, timeoutMs);
+			}
+		}
+	}
+
+	class LockWorker : public Nan::AsyncWorker {
+	public:
+		LockWorker(Nan::Callback* callback, char* data, int kind, double timeoutMs)
+			: Nan::AsyncWorker(callback, "shm:lock"), data(data), kind(kind),
+			timeoutMs(timeoutMs), result(SHM_LOCK_OK),
+			mapping(pinShmMapping(data, kind == SHM_LOCK_MUTEX ? sizeof(ShmMutexHeader) : sizeof(ShmRwLockHeader))) {}
+
+		void Execute() {
+			result = lockByKind(data, kind, timeoutMs);
+			unpinShmMapping(mapping);
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			Local<Value> argv[] = {
+				Nan::Null(),
+				Nan::New(lockResultStr[result]).ToLocalChecked()
+			};
+			callback->Call(2, argv, async_resource);
+		}
+
+	private:
+		char* data;
+		int kind;
+		double timeoutMs;
+		int result;
+		void* mapping; // pinned, so detach doesn't unmap lock word while it's waited
+	};
+
+	NAN_METHOD(mutexSizeOf) {
+		info.GetReturnValue().Set(Nan::New<Number>(sizeof(ShmMutexHeader)));
+	}
+
+	NAN_METHOD(mutexInit) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		if (length < sizeof(ShmMutexHeader)) {
+			return Nan::ThrowRangeError("Buffer is too small for mutex");
+		}
+		ShmMutexHeader* m = reinterpret_cast<ShmMutexHeader*>(data);
+		m->word.store(0, std::memory_order_relaxed);
+		m->owner.pid.store(0, std::memory_order_relaxed);
+		m->version = SHM_LOCK_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		m->magic = SHM_MUTEX_MAGIC;
+	}
+
+	NAN_METHOD(rwLockSizeOf) {
+		uint32_t maxReaders = Nan::To<uint32_t>(info[0]).FromJust();
+		info.GetReturnValue().Set(Nan::New<Number>((double) rwLockSizeOfBytes(maxReaders)));
+	}
+
+	NAN_METHOD(rwLockInit) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		uint32_t maxReaders = Nan::To<uint32_t>(info[1]).FromJust();
+		if (maxReaders == 0) {
+			return Nan::ThrowRangeError("Max count of readers should be positive");
+		}
+		if (length < rwLockSizeOfBytes(maxReaders)) {
+			return Nan::ThrowRangeError("Buffer is too small for reader-writer lock");
+		}
+		ShmRwLockHeader* l = reinterpret_cast<ShmRwLockHeader*>(data);
+		l->maxReaders = maxReaders;
+		l->writer.store(0, std::memory_order_relaxed);
+		l->writerOwner.pid.store(0, std::memory_order_relaxed);
+		l->readersGen.store(0, std::memory_order_relaxed);
+		ShmRwLockSlot* slots = rwLockSlots(l);
+		for (uint32_t i = 0; i < maxReaders; i++) {
+			slots[i].pid.store(0, std::memory_order_relaxed);
+			slots[i].owner.pid.store(0, std::memory_order_relaxed);
+		}
+		l->version = SHM_LOCK_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		l->magic = SHM_RWLOCK_MAGIC;
+	}
+
+	NAN_METHOD(lockInfo) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		Local<Object> res = Nan::New<Object>();
+		ShmMutexHeader* m = reinterpret_cast<ShmMutexHeader*>(data);
+		ShmRwLockHeader* l = reinterpret_cast<ShmRwLockHeader*>(data);
+		if (length >= sizeof(ShmMutexHeader) && m->magic == SHM_MUTEX_MAGIC && m->version == SHM_LOCK_VERSION) {
+			Nan::Set(res, Nan::New("type").ToLocalChecked(), Nan::New("mutex").ToLocalChecked());
+			Nan::Set(res, Nan::New("owner").ToLocalChecked(),
+				Nan::New<Number>(m->word.load(std::memory_order_relaxed) & SHM_LOCK_PID_MASK));
+		} else if (length >= sizeof(ShmRwLockHeader) && l->magic == SHM_RWLOCK_MAGIC
+			&& l->version == SHM_LOCK_VERSION && length >= rwLockSizeOfBytes(l->maxReaders)) {
+			ShmRwLockSlot* slots = rwLockSlots(l);
+			uint32_t readers = 0;
+			for (uint32_t i = 0; i < l->maxReaders; i++) {
+				if (slots[i].pid.load(std::memory_order_relaxed) != 0)
+					readers++;
+			}
+			Nan::Set(res, Nan::New("type").ToLocalChecked(), Nan::New("rwlock").ToLocalChecked());
+			Nan::Set(res, Nan::New("owner").ToLocalChecked(),
+				Nan::New<Number>(l->writer.load(std::memory_order_relaxed) & SHM_LOCK_PID_MASK));
+			Nan::Set(res, Nan::New("readers").ToLocalChecked(), Nan::New<Number>(readers));
+			Nan::Set(res, Nan::New("maxReaders").ToLocalChecked(), Nan::New<Number>(l->maxReaders));
+		} else {
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(lock) {
+		Nan::HandleScope scope;
+		int kind = Nan::To<int32_t>(info[1]).FromJust();
+		char* data = kind == SHM_LOCK_MUTEX
+			? reinterpret_cast<char*>(getMutexArg(info[0]))
+			: reinterpret_cast<char*>(getRwLockArg(info[0]));
+		if (data == NULL)
+			return;
+		double timeoutMs = Nan::To<double>(info[2]).FromJust();
+		if (info[3]->IsFunction()) {
+			LockWorker* worker = new LockWorker(
+				new Nan::Callback(info[3].As<Function>()), data, kind, timeoutMs);
+			worker->SaveToPersistent("buf", info[0]);
+			Nan::AsyncQueueWorker(worker);
+		} else {
+			int res = lockByKind(data, kind, 0);
+			info.GetReturnValue().Set(Nan::New(lockResultStr[res]).ToLocalChecked());
+		}
+	}
+
+	NAN_METHOD(unlock) {
+		int kind = Nan::To<int32_t>(info[1]).FromJust();
+		bool res;
+		if (kind == SHM_LOCK_MUTEX) {
+			ShmMutexHeader* m = getMutexArg(info[0]);
+			if (m == NULL)
+				return;
+			res = unlockShmWord(&m->word, &m->owner, 1);
+		} else {
+			ShmRwLockHeader* l = getRwLockArg(info[0]);
+			if (l == NULL)
+				return;
+			res = kind == SHM_LOCK_READ ? rwLockReadUnlock(l) : unlockShmWord(&l->writer, &l->writerOwner, INT_MAX);
+		}
+		if (!res) {
+			return Nan::ThrowError("Lock is not held by this process");
+		}
+	}
+
+}
+}
@@ -0,0 +1,233 @@
+#include "node_shm.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+//-------------------------------
+
+// Anonymous shared memory (memfd) and passing of fds over Unix domain sockets.
+// Memfd has no name in /dev/shm and no System V key, so nothing leaks on crash:
+//  kernel frees memory when last fd and last mapping are closed in all processes.
+// Fds are passed with SCM_RIGHTS, receiver gets own fd of same file.
+
+#define SHM_FD_MESSAGE_BYTE 'F'
+
+namespace node {
+namespace node_shm {
+
+	using v8::Local;
+	using v8::Number;
+	using v8::Value;
+
+	int createMemfd(unsigned int flags) {
+	#if defined(__linux__) && defined(SYS_memfd_create)
+		// Name is shown in /proc/<pid>/fd and maps, as "/memfd:node-shm"
+		return syscall(SYS_memfd_create, "node-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING | flags);
+	#else
+		errno = ENOSYS;
+		return -1;
+	#endif
+	}
+
+	int getFdSeals(int fd) {
+	#ifdef __linux__
+		int seals = fcntl(fd, F_GET_SEALS);
+		// EINVAL: not memfd, sealing is not supported by file
+		if (seals == -1 && errno == EINVAL)
+			return 0;
+		return seals;
+	#else
+		return 0;
+	#endif
+	}
+
+	int addFdSeals(int fd, int seals) {
+	#ifdef __linux__
+		return fcntl(fd, F_ADD_SEALS, seals);
+	#else
+		errno = ENOSYS;
+		return -1;
+	#endif
+	}
+
+	// Milliseconds left until deadline, -1 for infinite timeout
+	static int getPollTimeout(int64_t deadline) {
+		if (deadline < 0)
+			return -1;
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		int64_t left = deadline - ((int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000);
+		return left > 0 ? (int) std::min(left, (int64_t) INT_MAX) : 0;
+	}
+
+	// Wait for event on socket, returns 0 or errno (ETIMEDOUT)
+	static int pollSocket(int sock, short events, int64_t deadline) {
+		struct pollfd pfd = { .fd=sock, .events=events, .revents=0 };
+		while (true) {
+			int res = poll(&pfd, 1, getPollTimeout(deadline));
+			if (res > 0)
+				return 0;
+			if (res == 0)
+				return ETIMEDOUT;
+			if (errno != EINTR)
+				return errno;
+		}
+	}
+
+	// Send fd as SCM_RIGHTS with 1 byte of data, socket can be blocking or non-blocking (libuv sets O_NONBLOCK)
+	// Doesn't wait, returns EAGAIN if send buffer of socket is full
+	static int sendFdMessage(int sock, int fd) {
+		char data = SHM_FD_MESSAGE_BYTE;
+		struct iovec iov = { .iov_base=&data, .iov_len=1 };
+		union {
+			char buf[CMSG_SPACE(sizeof(int))];
+			struct cmsghdr align;
+		} control;
+		memset(&control, 0, sizeof(control));
+		struct msghdr msg = {};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buf;
+		msg.msg_controllen = sizeof(control.buf);
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+		int flags = MSG_DONTWAIT;
+	#ifdef MSG_NOSIGNAL
+		flags |= MSG_NOSIGNAL;
+	#endif
+		while (true) {
+			if (sendmsg(sock, &msg, flags) == 1)
+				return 0;
+			if (errno == EINTR)
+				continue;
+			return errno == EWOULDBLOCK ? EAGAIN : errno;
+		}
+	}
+
+	// Receive fd sent by sendFdMessage(), waits up to timeoutMs (-1 for infinite)
+	// Returns fd (with close-on-exec) or -1 (err is set)
+	static int recvFdMessage(int sock, int timeoutMs, int& err) {
+		int64_t deadline = -1;
+		if (timeoutMs >= 0) {
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			deadline = (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000 + timeoutMs;
+		}
+		char data;
+		struct iovec iov = { .iov_base=&data, .iov_len=1 };
+		union {
+			char buf[CMSG_SPACE(sizeof(int))];
+			struct cmsghdr align;
+		} control;
+		// Don't block in recvmsg() on blocking socket, timeout is handled by poll()
+		int flags = MSG_DONTWAIT;
+	#ifdef MSG_CMSG_CLOEXEC
+		flags |= MSG_CMSG_CLOEXEC;
+	#endif
+		while (true) {
+			struct msghdr msg = {};
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_control = control.buf;
+			msg.msg_controllen = sizeof(control.buf);
+			ssize_t res = recvmsg(sock, &msg, flags);
+			if (res == 0) {
+				err = ECONNRESET; // closed by peer
+				return -1;
+			}
+			if (res > 0) {
+				struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+				if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS
+					|| (msg.msg_flags & MSG_CTRUNC)) {
+					err = EBADMSG; // data without fd, eg. written to socket by other code
+					return -1;
+				}
+				int fd;
+				memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+				err = 0;
+				return fd;
+			}
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				err = errno;
+				return -1;
+			}
+			err = pollSocket(sock, POLLIN, deadline);
+			if (err != 0)
+				return -1;
+		}
+	}
+
+	class RecvFdWorker : public Nan::AsyncWorker {
+	public:
+		RecvFdWorker(Nan::Callback* callback, int sock, int timeoutMs)
+			: Nan::AsyncWorker(callback, "shm:recvFd"), sock(sock), timeoutMs(timeoutMs), fd(-1) {}
+
+		void Execute() {
+			int err;
+			fd = recvFdMessage(sock, timeoutMs, err);
+			if (fd == -1)
+				SetErrorMessage(strerror(err));
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			Local<Value> argv[] = { Nan::Null(), Nan::New<Number>(fd) };
+			callback->Call(2, argv, async_resource);
+		}
+
+	private:
+		int sock;
+		int timeoutMs;
+		int fd;
+	};
+
+	NAN_METHOD(memfdSeals) {
+		Nan::HandleScope scope;
+		int fd = Nan::To<int32_t>(info[0]).FromMaybe(-1);
+		int seals = getFdSeals(fd);
+		if (seals == -1)
+			return Nan::ThrowError(strerror(errno));
+		info.GetReturnValue().Set(Nan::New<Number>(seals));
+	}
+
+	NAN_METHOD(sendFd) {
+		Nan::HandleScope scope;
+		int sock = Nan::To<int32_t>(info[0]).FromMaybe(-1);
+		int fd = Nan::To<int32_t>(info[1]).FromMaybe(-1);
+		if (sock < 0 || fd < 0)
+			return Nan::ThrowRangeError("Invalid file descriptor");
+		int err = sendFdMessage(sock, fd);
+		if (err != 0)
+			return Nan::ThrowError(strerror(err));
+	}
+
+	NAN_METHOD(recvFd) {
+		Nan::HandleScope scope;
+		int sock = Nan::To<int32_t>(info[0]).FromMaybe(-1);
+		int timeoutMs = Nan::To<int32_t>(info[1]).FromMaybe(-1);
+		if (sock < 0)
+			return Nan::ThrowRangeError("Invalid file descriptor");
+		if (info[2]->IsFunction()) {
+			Nan::AsyncQueueWorker(new RecvFdWorker(
+				new Nan::Callback(info[2].As<v8::Function>()), sock, timeoutMs));
+			return;
+		}
+		int err;
+		int fd = recvFdMessage(sock, timeoutMs, err);
+		if (fd == -1)
+			return Nan::ThrowError(strerror(err));
+		info.GetReturnValue().Set(Nan::New<Number>(fd));
+	}
+
+}
+}
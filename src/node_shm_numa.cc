@@ -0,0 +1,180 @@
+#include "node_shm.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+//-------------------------------
+
+// NUMA placement of shared memory.
+// Policy is set with mbind() right after mapping, before any page is touched,
+//  so pages are allocated on requested nodes on first fault (also in other processes,
+//  policy of tmpfs/System V object is shared).
+// Raw syscalls are used instead of libnuma, so there is no extra dependency.
+// On hosts without NUMA support (ENOSYS) or when syscalls are filtered (EPERM),
+//  policy is silently not applied, like on single-node host where it makes no difference.
+
+#define SHM_NUMA_MAX_NODES 1024
+#define SHM_NUMA_MOVE_PAGES_BATCH 4096
+
+// From <linux/mempolicy.h>
+#define SHM_MPOL_DEFAULT 0
+#define SHM_MPOL_PREFERRED 1
+#define SHM_MPOL_BIND 2
+#define SHM_MPOL_INTERLEAVE 3
+#define SHM_MPOL_LOCAL 4
+#define SHM_MPOL_MODE_MASK 0xff
+#define SHM_MPOL_F_ADDR (1 << 1)
+
+namespace node {
+namespace node_shm {
+
+	using v8::Array;
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	typedef unsigned long ShmNodeMask[SHM_NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+
+	// Online nodes from sysfs, eg. "0-1,3"; single node 0 if unknown
+	static std::vector<int> getOnlineNumaNodes() {
+		std::vector<int> nodes;
+	#ifdef __linux__
+		FILE* f = fopen("/sys/devices/system/node/online", "r");
+		if (f != NULL) {
+			int from, to;
+			while (fscanf(f, "%d", &from) == 1) {
+				to = from;
+				int c = fgetc(f);
+				if (c == '-') {
+					if (fscanf(f, "%d", &to) != 1)
+						break;
+					c = fgetc(f);
+				}
+				for (int node = from; node <= to && node < SHM_NUMA_MAX_NODES; node++)
+					nodes.push_back(node);
+				if (c != ',')
+					break;
+			}
+			fclose(f);
+		}
+	#endif
+		if (nodes.empty())
+			nodes.push_back(0);
+		return nodes;
+	}
+
+	static bool isNumaUnsupported(int err) {
+		return err == ENOSYS || err == EPERM;
+	}
+
+	int applyNumaPolicy(void* addr, size_t length, ShmNumaPolicy policy, const std::vector<int>& nodes) {
+		if (policy == SHMNUMA_DEFAULT)
+			return 0;
+	#ifdef __linux__
+		ShmNodeMask mask = {};
+		const size_t bitsPerWord = 8 * sizeof(unsigned long);
+		for (int node : nodes) {
+			if (node < 0 || node >= SHM_NUMA_MAX_NODES)
+				return EINVAL;
+			mask[node / bitsPerWord] |= 1UL << (node % bitsPerWord);
+		}
+		int mode = policy == SHMNUMA_INTERLEAVE ? SHM_MPOL_INTERLEAVE
+			: policy == SHMNUMA_BIND ? SHM_MPOL_BIND : SHM_MPOL_PREFERRED;
+		// maxnode is count of bits + 1, kernel ignores last one
+		long res = syscall(SYS_mbind, addr, length, mode, mask, SHM_NUMA_MAX_NODES + 1, 0);
+		if (res == -1 && !isNumaUnsupported(errno))
+			return errno;
+	#endif
+		return 0;
+	}
+
+	static const char* getNumaPolicyName(int mode) {
+		switch (mode & SHM_MPOL_MODE_MASK) {
+			case SHM_MPOL_DEFAULT: return "default";
+			case SHM_MPOL_PREFERRED: return "preferred";
+			case SHM_MPOL_BIND: return "bind";
+			case SHM_MPOL_INTERLEAVE: return "interleave";
+			case SHM_MPOL_LOCAL: return "local";
+			default: return "unknown";
+		}
+	}
+
+	Local<Object> newNumaInfo(void* addr, size_t length) {
+		std::vector<int> onlineNodes = getOnlineNumaNodes();
+		Local<Value> policy = Nan::Null();
+		std::vector<int> policyNodes;
+		std::map<int, double> residentPages;
+		bool residentKnown = false;
+		size_t pageSize = sysconf(_SC_PAGESIZE);
+
+	#ifdef __linux__
+		int mode;
+		ShmNodeMask mask = {};
+		if (syscall(SYS_get_mempolicy, &mode, mask, SHM_NUMA_MAX_NODES + 1, addr, SHM_MPOL_F_ADDR) == 0) {
+			policy = Nan::New(getNumaPolicyName(mode)).ToLocalChecked();
+			const size_t bitsPerWord = 8 * sizeof(unsigned long);
+			for (int node = 0; node < SHM_NUMA_MAX_NODES; node++) {
+				if (mask[node / bitsPerWord] & (1UL << (node % bitsPerWord)))
+					policyNodes.push_back(node);
+			}
+		}
+
+		// Only pages already faulted in have a node, others report -ENOENT
+		size_t pageCount = (length + pageSize - 1) / pageSize;
+		std::vector<void*> pages(std::min(pageCount, (size_t) SHM_NUMA_MOVE_PAGES_BATCH));
+		std::vector<int> status(pages.size());
+		char* start = reinterpret_cast<char*>(addr);
+		residentKnown = true;
+		for (size_t i = 0; i < pageCount; i += pages.size()) {
+			size_t batch = std::min(pages.size(), pageCount - i);
+			for (size_t j = 0; j < batch; j++)
+				pages[j] = start + (i + j) * pageSize;
+			if (syscall(SYS_move_pages, 0, batch, pages.data(), NULL, status.data(), 0) == -1) {
+				residentKnown = false;
+				break;
+			}
+			for (size_t j = 0; j < batch; j++) {
+				if (status[j] >= 0)
+					residentPages[status[j]] += 1;
+			}
+		}
+	#endif
+
+		Local<Object> res = Nan::New<Object>();
+		Local<Array> nodesArr = Nan::New<Array>(onlineNodes.size());
+		for (size_t i = 0; i < onlineNodes.size(); i++)
+			Nan::Set(nodesArr, i, Nan::New<Number>(onlineNodes[i]));
+		Local<Array> policyNodesArr = Nan::New<Array>(policyNodes.size());
+		for (size_t i = 0; i < policyNodes.size(); i++)
+			Nan::Set(policyNodesArr, i, Nan::New<Number>(policyNodes[i]));
+		Local<Value> resident = Nan::Null();
+		if (residentKnown) {
+			Local<Object> residentObj = Nan::New<Object>();
+			for (auto& it : residentPages)
+				Nan::Set(residentObj, it.first, Nan::New<Number>(it.second));
+			resident = residentObj;
+		}
+		Nan::Set(res, Nan::New("nodes").ToLocalChecked(), nodesArr);
+		Nan::Set(res, Nan::New("policy").ToLocalChecked(), policy);
+		Nan::Set(res, Nan::New("policyNodes").ToLocalChecked(), policyNodesArr);
+		Nan::Set(res, Nan::New("pageSize").ToLocalChecked(), Nan::New<Number>(pageSize));
+		Nan::Set(res, Nan::New("residentPages").ToLocalChecked(), resident);
+		return res;
+	}
+
+	NAN_METHOD(numaNodes) {
+		std::vector<int> nodes = getOnlineNumaNodes();
+		Local<Array> res = Nan::New<Array>(nodes.size());
+		for (size_t i = 0; i < nodes.size(); i++)
+			Nan::Set(res, i, Nan::New<Number>(nodes[i]));
+		info.GetReturnValue().Set(res);
+	}
+
+}
+}
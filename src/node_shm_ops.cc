@@ -0,0 +1,869 @@
+#include "node_shm.h"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
+
+//-------------------------------
+
+// Bulk kernels (sum, min, max, dot, argmax, scale, fill) over shared memory arrays.
+// Kernels work directly on mapped memory and are written with GCC/clang vector extensions,
+//  every kernel is compiled for several vector widths and the widest one supported
+//  by CPU is chosen at runtime: SSE2 (16 bytes), AVX2 (32 bytes), AVX-512 (64 bytes).
+// Large ranges are split to parts processed in parallel by native thread pool
+//  (calling thread also processes parts), memory bandwidth of one core is not enough.
+// Float sums are accumulated in element type inside blocks of SHM_OPS_BLOCK elements
+//  and blocks are summed in double, so Float32Array sums don't lose precision on 100M elements.
+// NaN elements are ignored by min, max and argmax.
+// BigInt64Array/BigUint64Array give BigInt results, sum, dot and scale wrap modulo 2^64
+//  like BigInt.asIntN(64, ...) (BigInt.asUintN for BigUint64Array).
+// Large copies use non-temporal (streaming) stores, so loading of big dataset
+//  doesn't evict from last level cache data of other processes.
+
+#define SHM_OPS_BLOCK 4096
+#define SHM_OPS_PARALLEL_MIN_BYTES (4 << 20)
+#define SHM_OPS_PART_MIN_BYTES (1 << 20)
+#define SHM_OPS_STREAM_MIN_BYTES (4 << 20)
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHM_OPS_X86 1
+#endif
+
+#define SHM_OPS_INLINE inline __attribute__((always_inline))
+
+namespace node {
+namespace node_shm {
+
+	using v8::Array;
+#if SHM_HAS_BIGINT64_ARRAY
+	using v8::BigInt;
+#endif
+	using v8::Function;
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	enum ShmOpsIsa {
+		SHMOPS_ISA_GENERIC = 0, // 16 bytes vectors, lowered by compiler for target (eg. NEON)
+		SHMOPS_ISA_SSE2,
+		SHMOPS_ISA_AVX2,
+		SHMOPS_ISA_AVX512,
+		SHMOPS_ISA_COUNT
+	};
+
+	static const char* const shmOpsIsaNames[SHMOPS_ISA_COUNT] = { "generic", "sse2", "avx2", "avx512" };
+
+	// Range of array processed by one thread
+	struct ShmOpsRange {
+		ShmOpsKind kind;
+		ShmBufferType type;
+		char* data;
+		char* data2; // second array of dot
+		size_t begin;
+		size_t end;
+		double arg; // factor of scale, value of fill
+		uint64_t arg64; // factor of scale, value of fill for BigInt64Array/BigUint64Array
+		bool stream; // non-temporal stores for copy
+		// Result
+		double value; // +-Infinity for min/max of empty range
+		uint64_t value64; // bits of sum, dot, min, max for BigInt64Array/BigUint64Array
+		int64_t index;
+	};
+
+	static inline bool opsIs64(ShmBufferType type) {
+		return type == SHMBT_BIGINT64 || type == SHMBT_BIGUINT64;
+	}
+
+	// Compare bits of elements of BigInt64Array/BigUint64Array
+	static inline bool opsLess64(ShmBufferType type, uint64_t a, uint64_t b) {
+		return type == SHMBT_BIGINT64 ? (int64_t) a < (int64_t) b : a < b;
+	}
+
+	//-------------------------------
+	// Kernels, always inlined into functions compiled for specific instruction set
+
+	template <typename T, int W>
+	struct ShmOpsVec {
+		typedef T V __attribute__((vector_size(W)));
+		// For unaligned loads
+		typedef T U __attribute__((vector_size(W), aligned(sizeof(T))));
+		typedef uint64_t Q __attribute__((vector_size(W)));
+		static const size_t lanes = W / sizeof(T);
+	};
+
+	// Unaligned load, macro to not pass vectors between functions (changes ABI without AVX)
+	#define SHM_OPS_LOAD(p) (*reinterpret_cast<const typename ShmOpsVec<T, W>::U*>(p))
+
+	template <typename T>
+	static SHM_OPS_INLINE bool opsIsFloat() {
+		return std::numeric_limits<T>::is_iec559;
+	}
+
+	template <typename T, int W>
+	static SHM_OPS_INLINE double opsSum(const T* p, size_t n) {
+		typedef typename ShmOpsVec<T, W>::V V;
+		const size_t L = ShmOpsVec<T, W>::lanes;
+		size_t i = 0;
+		if (!opsIsFloat<T>()) {
+			// Integer addition is associative, so compiler vectorizes it itself
+			int64_t acc = 0;
+			for (; i < n; i++)
+				acc += p[i];
+			return (double) acc;
+		}
+		double total = 0;
+		while (n - i >= 4 * L) {
+			V a0 = {}, a1 = {}, a2 = {}, a3 = {};
+			size_t blockEnd = i + std::min((n - i) / (4 * L) * (4 * L), (size_t) SHM_OPS_BLOCK);
+			for (; i < blockEnd; i += 4 * L) {
+				a0 += SHM_OPS_LOAD(p + i);
+				a1 += SHM_OPS_LOAD(p + i + L);
+				a2 += SHM_OPS_LOAD(p + i + 2 * L);
+				a3 += SHM_OPS_LOAD(p + i + 3 * L);
+			}
+			V a = (a0 + a1) + (a2 + a3);
+			for (size_t k = 0; k < L; k++)
+				total += a[k];
+		}
+		for (; i < n; i++)
+			total += p[i];
+		return total;
+	}
+
+	template <typename T, int W>
+	static SHM_OPS_INLINE double opsDot(const T* p, const T* q, size_t n) {
+		typedef typename ShmOpsVec<T, W>::V V;
+		const size_t L = ShmOpsVec<T, W>::lanes;
+		size_t i = 0;
+		if (!opsIsFloat<T>()) {
+			if (sizeof(T) <= 2) {
+				int64_t acc = 0;
+				for (; i < n; i++)
+					acc += (int64_t) p[i] * q[i];
+				return (double) acc;
+			}
+			double acc = 0;
+			for (; i < n; i++)
+				acc += (double) p[i] * q[i];
+			return acc;
+		}
+		double total = 0;
+		while (n - i >= 4 * L) {
+			V a0 = {}, a1 = {}, a2 = {}, a3 = {};
+			size_t blockEnd = i + std::min((n - i) / (4 * L) * (4 * L), (size_t) SHM_OPS_BLOCK);
+			for (; i < blockEnd; i += 4 * L) {
+				a0 += SHM_OPS_LOAD(p + i) * SHM_OPS_LOAD(q + i);
+				a1 += SHM_OPS_LOAD(p + i + L) * SHM_OPS_LOAD(q + i + L);
+				a2 += SHM_OPS_LOAD(p + i + 2 * L) * SHM_OPS_LOAD(q + i + 2 * L);
+				a3 += SHM_OPS_LOAD(p + i + 3 * L) * SHM_OPS_LOAD(q + i + 3 * L);
+			}
+			V a = (a0 + a1) + (a2 + a3);
+			for (size_t k = 0; k < L; k++)
+				total += a[k];
+		}
+		for (; i < n; i++)
+			total += (double) p[i] * q[i];
+		return total;
+	}
+
+	// Min if IsMax is false, n > 0
+	// For floats NaN is skipped (comparison with NaN is false), result is +-Infinity if all are NaN
+	template <typename T, int W, bool IsMax>
+	static SHM_OPS_INLINE T opsMinMax(const T* p, size_t n) {
+		typedef typename ShmOpsVec<T, W>::V V;
+		const size_t L = ShmOpsVec<T, W>::lanes;
+		const T init = opsIsFloat<T>()
+			? (IsMax ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity())
+			: (IsMax ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max());
+		T m = init;
+		size_t i = 0;
+		if (n >= 4 * L) {
+			V m0 = V{} + init, m1 = m0, m2 = m0, m3 = m0;
+			for (; n - i >= 4 * L; i += 4 * L) {
+				V x0 = SHM_OPS_LOAD(p + i), x1 = SHM_OPS_LOAD(p + i + L);
+				V x2 = SHM_OPS_LOAD(p + i + 2 * L), x3 = SHM_OPS_LOAD(p + i + 3 * L);
+				if (IsMax) {
+					m0 = x0 > m0 ? x0 : m0; m1 = x1 > m1 ? x1 : m1;
+					m2 = x2 > m2 ? x2 : m2; m3 = x3 > m3 ? x3 : m3;
+				} else {
+					m0 = x0 < m0 ? x0 : m0; m1 = x1 < m1 ? x1 : m1;
+					m2 = x2 < m2 ? x2 : m2; m3 = x3 < m3 ? x3 : m3;
+				}
+			}
+			if (IsMax) {
+				m0 = m1 > m0 ? m1 : m0; m2 = m3 > m2 ? m3 : m2; m0 = m2 > m0 ? m2 : m0;
+			} else {
+				m0 = m1 < m0 ? m1 : m0; m2 = m3 < m2 ? m3 : m2; m0 = m2 < m0 ? m2 : m0;
+			}
+			for (size_t k = 0; k < L; k++)
+				m = (IsMax ? m0[k] > m : m0[k] < m) ? m0[k] : m;
+		}
+		for (; i < n; i++)
+			m = (IsMax ? p[i] > m : p[i] < m) ? p[i] : m;
+		return m;
+	}
+
+	// Returns index of first element equal to value, or -1
+	template <typename T, int W>
+	static SHM_OPS_INLINE int64_t opsIndexOf(const T* p, size_t n, T value) {
+		typedef typename ShmOpsVec<T, W>::V V;
+		typedef typename ShmOpsVec<T, W>::Q Q;
+		const size_t L = ShmOpsVec<T, W>::lanes;
+		const V v = V{} + value;
+		size_t i = 0;
+		for (; n - i >= 4 * L; i += 4 * L) {
+			Q eq = (Q) ((SHM_OPS_LOAD(p + i) == v) | (SHM_OPS_LOAD(p + i + L) == v)
+				| (SHM_OPS_LOAD(p + i + 2 * L) == v) | (SHM_OPS_LOAD(p + i + 3 * L) == v));
+			bool found = false;
+			for (size_t k = 0; k < W / sizeof(uint64_t); k++)
+				found |= eq[k] != 0;
+			if (found)
+				break;
+		}
+		for (; i < n; i++) {
+			if (p[i] == value)
+				return i;
+		}
+		return -1;
+	}
+
+	// Returns index of first max element, or -1 if there are no elements except NaN
+	// Max is found for cache-resident blocks, and block is searched only if it raises max,
+	//  so memory is read once
+	template <typename T, int W>
+	static SHM_OPS_INLINE int64_t opsArgMax(const T* p, size_t n, double& maxValue) {
+		int64_t bestIndex = -1;
+		T best = T();
+		for (size_t b = 0; b < n; b += SHM_OPS_BLOCK) {
+			size_t blockLength = std::min(n - b, (size_t) SHM_OPS_BLOCK);
+			T m = opsMinMax<T, W, true>(p + b, blockLength);
+			if (bestIndex == -1 || m > best) {
+				int64_t index = opsIndexOf<T, W>(p + b, blockLength, m);
+				if (index != -1) {
+					best = m;
+					bestIndex = b + index;
+				}
+			}
+		}
+		maxValue = bestIndex == -1 ? -std::numeric_limits<double>::infinity() : (double) best;
+		return bestIndex;
+	}
+
+	// Conversion of number to element like assignment to typed array in JS
+	template <typename T, ShmBufferType BT>
+	static SHM_OPS_INLINE T opsToElement(double v) {
+		if (opsIsFloat<T>())
+			return (T) v;
+		if (BT == SHMBT_UINT8CLAMPED) {
+			if (!(v > 0))
+				return 0;
+			if (v >= 255)
+				return 255;
+			return (T) std::nearbyint(v);
+		}
+		if (!std::isfinite(v))
+			return 0;
+		// Wrap modulo 2^32, then truncate to size of element
+		return (T) (uint32_t) (int64_t) std::fmod(std::trunc(v), 4294967296.0);
+	}
+
+	template <typename T, ShmBufferType BT>
+	static SHM_OPS_INLINE void opsScale(T* p, size_t n, double factor) {
+		if (opsIsFloat<T>()) {
+			for (size_t i = 0; i < n; i++)
+				p[i] = (T) (p[i] * factor);
+		} else {
+			for (size_t i = 0; i < n; i++)
+				p[i] = opsToElement<T, BT>(p[i] * factor);
+		}
+	}
+
+	template <typename T, ShmBufferType BT>
+	static SHM_OPS_INLINE void opsFill(T* p, size_t n, double value) {
+		const T v = opsToElement<T, BT>(value);
+		for (size_t i = 0; i < n; i++)
+			p[i] = v;
+	}
+
+	template <typename T, int W, ShmBufferType BT>
+	static SHM_OPS_INLINE void opsRunTyped(ShmOpsRange& r) {
+		T* p = reinterpret_cast<T*>(r.data) + r.begin;
+		size_t n = r.end - r.begin;
+		switch (r.kind) {
+			case SHMOPS_SUM:
+				r.value = opsSum<T, W>(p, n);
+				break;
+			case SHMOPS_DOT:
+				r.value = opsDot<T, W>(p, reinterpret_cast<const T*>(r.data2) + r.begin, n);
+				break;
+			case SHMOPS_MIN:
+				r.value = n > 0 ? (double) opsMinMax<T, W, false>(p, n) : std::numeric_limits<double>::infinity();
+				break;
+			case SHMOPS_MAX:
+				r.value = n > 0 ? (double) opsMinMax<T, W, true>(p, n) : -std::numeric_limits<double>::infinity();
+				break;
+			case SHMOPS_ARGMAX:
+				r.index = opsArgMax<T, W>(p, n, r.value);
+				if (r.index != -1)
+					r.index += r.begin;
+				break;
+			case SHMOPS_SCALE:
+				opsScale<T, BT>(p, n, r.arg);
+				break;
+			case SHMOPS_FILL:
+				opsFill<T, BT>(p, n, r.arg);
+				break;
+			default:
+				break;
+		}
+	}
+
+	// BigInt64Array/BigUint64Array, additions and multiplications are done on unsigned bits,
+	//  so they wrap modulo 2^64 for both types
+	template <typename T, int W>
+	static SHM_OPS_INLINE void opsRunInt64(ShmOpsRange& r) {
+		T* p = reinterpret_cast<T*>(r.data) + r.begin;
+		uint64_t* u = reinterpret_cast<uint64_t*>(p);
+		size_t n = r.end - r.begin;
+		uint64_t acc = 0;
+		switch (r.kind) {
+			case SHMOPS_SUM:
+				for (size_t i = 0; i < n; i++)
+					acc += u[i];
+				r.value64 = acc;
+				break;
+			case SHMOPS_DOT: {
+				const uint64_t* q = reinterpret_cast<const uint64_t*>(r.data2) + r.begin;
+				for (size_t i = 0; i < n; i++)
+					acc += u[i] * q[i];
+				r.value64 = acc;
+				break;
+			}
+			case SHMOPS_MIN:
+				r.value = n > 0 ? 0 : std::numeric_limits<double>::infinity();
+				if (n > 0)
+					r.value64 = (uint64_t) opsMinMax<T, W, false>(p, n);
+				break;
+			case SHMOPS_MAX:
+				r.value = n > 0 ? 0 : -std::numeric_limits<double>::infinity();
+				if (n > 0)
+					r.value64 = (uint64_t) opsMinMax<T, W, true>(p, n);
+				break;
+			case SHMOPS_ARGMAX:
+				r.index = opsArgMax<T, W>(p, n, r.value);
+				if (r.index != -1)
+					r.index += r.begin;
+				break;
+			case SHMOPS_SCALE:
+				for (size_t i = 0; i < n; i++)
+					u[i] *= r.arg64;
+				break;
+			case SHMOPS_FILL:
+				for (size_t i = 0; i < n; i++)
+					u[i] = r.arg64;
+				break;
+			default:
+				break;
+		}
+	}
+
+	template <int W>
+	static SHM_OPS_INLINE void opsRunVec(ShmOpsRange& r) {
+		switch (r.type) {
+			case SHMBT_INT8: return opsRunTyped<int8_t, W, SHMBT_INT8>(r);
+			case SHMBT_BUFFER:
+			case SHMBT_UINT8: return opsRunTyped<uint8_t, W, SHMBT_UINT8>(r);
+			case SHMBT_UINT8CLAMPED: return opsRunTyped<uint8_t, W, SHMBT_UINT8CLAMPED>(r);
+			case SHMBT_INT16: return opsRunTyped<int16_t, W, SHMBT_INT16>(r);
+			case SHMBT_UINT16: return opsRunTyped<uint16_t, W, SHMBT_UINT16>(r);
+			case SHMBT_INT32: return opsRunTyped<int32_t, W, SHMBT_INT32>(r);
+			case SHMBT_UINT32: return opsRunTyped<uint32_t, W, SHMBT_UINT32>(r);
+			case SHMBT_FLOAT32: return opsRunTyped<float, W, SHMBT_FLOAT32>(r);
+			case SHMBT_FLOAT64: return opsRunTyped<double, W, SHMBT_FLOAT64>(r);
+			case SHMBT_BIGINT64: return opsRunInt64<int64_t, W>(r);
+			case SHMBT_BIGUINT64: return opsRunInt64<uint64_t, W>(r);
+			default: break;
+		}
+	}
+
+	static void opsRunGeneric(ShmOpsRange& r) {
+		opsRunVec<16>(r);
+	}
+
+#ifdef SHM_OPS_X86
+	__attribute__((target("avx2")))
+	static void opsRunAvx2(ShmOpsRange& r) {
+		opsRunVec<32>(r);
+	}
+
+	__attribute__((target("avx512f,avx512bw")))
+	static void opsRunAvx512(ShmOpsRange& r) {
+		opsRunVec<64>(r);
+	}
+#endif
+
+	//-------------------------------
+	// Copy of bytes, data is destination and data2 is source, ranges don't overlap
+	// Intrinsics can't be inlined into generic kernels, so every instruction set has own function
+
+	static void opsCopyGeneric(ShmOpsRange& r) {
+		memcpy(r.data + r.begin, r.data2 + r.begin, r.end - r.begin);
+	}
+
+#ifdef SHM_OPS_X86
+	// Destination is aligned to W bytes with memcpy of head
+	#define SHM_OPS_STREAM_COPY(W, LOAD, STREAM, VEC) \
+		char* dst = r.data + r.begin; \
+		const char* src = r.data2 + r.begin; \
+		size_t n = r.end - r.begin; \
+		if (!r.stream || n < 4 * W) \
+			return opsCopyGeneric(r); \
+		size_t head = (W - reinterpret_cast<uintptr_t>(dst) % W) % W; \
+		memcpy(dst, src, head); \
+		size_t i = head; \
+		for (; n - i >= 4 * W; i += 4 * W) { \
+			VEC v0 = LOAD((const VEC*) (src + i)); \
+			VEC v1 = LOAD((const VEC*) (src + i + W)); \
+			VEC v2 = LOAD((const VEC*) (src + i + 2 * W)); \
+			VEC v3 = LOAD((const VEC*) (src + i + 3 * W)); \
+			STREAM((VEC*) (dst + i), v0); \
+			STREAM((VEC*) (dst + i + W), v1); \
+			STREAM((VEC*) (dst + i + 2 * W), v2); \
+			STREAM((VEC*) (dst + i + 3 * W), v3); \
+		} \
+		memcpy(dst + i, src + i, n - i); \
+		/* Streaming stores are weakly ordered, make them visible before part is reported done */ \
+		_mm_sfence();
+
+	static void opsCopySse2(ShmOpsRange& r) {
+		SHM_OPS_STREAM_COPY(16, _mm_loadu_si128, _mm_stream_si128, __m128i)
+	}
+
+	__attribute__((target("avx2")))
+	static void opsCopyAvx2(ShmOpsRange& r) {
+		SHM_OPS_STREAM_COPY(32, _mm256_loadu_si256, _mm256_stream_si256, __m256i)
+	}
+
+	__attribute__((target("avx512f,avx512bw")))
+	static void opsCopyAvx512(ShmOpsRange& r) {
+		SHM_OPS_STREAM_COPY(64, _mm512_loadu_si512, _mm512_stream_si512, __m512i)
+	}
+#endif
+
+	typedef void (*ShmOpsRunFn)(ShmOpsRange& r);
+
+	static ShmOpsRunFn getOpsRunFn(ShmOpsIsa isa, ShmOpsKind kind) {
+		if (kind == SHMOPS_COPY) {
+			switch (isa) {
+			#ifdef SHM_OPS_X86
+				case SHMOPS_ISA_AVX512: return opsCopyAvx512;
+				case SHMOPS_ISA_AVX2: return opsCopyAvx2;
+				case SHMOPS_ISA_SSE2: return opsCopySse2;
+			#endif
+				default: return opsCopyGeneric;
+			}
+		}
+		switch (isa) {
+		#ifdef SHM_OPS_X86
+			case SHMOPS_ISA_AVX512: return opsRunAvx512;
+			case SHMOPS_ISA_AVX2: return opsRunAvx2;
+		#endif
+			default: return opsRunGeneric;
+		}
+	}
+
+	static ShmOpsIsa detectOpsIsa() {
+	#ifdef SHM_OPS_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+			return SHMOPS_ISA_AVX512;
+		if (__builtin_cpu_supports("avx2"))
+			return SHMOPS_ISA_AVX2;
+		return SHMOPS_ISA_SSE2;
+	#else
+		return SHMOPS_ISA_GENERIC;
+	#endif
+	}
+
+	static bool isOpsIsaSupported(ShmOpsIsa isa, ShmOpsIsa detected) {
+	#ifdef SHM_OPS_X86
+		return isa >= SHMOPS_ISA_SSE2 && isa <= detected;
+	#else
+		return isa == SHMOPS_ISA_GENERIC;
+	#endif
+	}
+
+	static const ShmOpsIsa opsIsaDetected = detectOpsIsa();
+	static std::atomic<int> opsIsa(opsIsaDetected);
+	static std::atomic<size_t> opsThreads(std::max(std::thread::hardware_concurrency(), 1u));
+
+	//-------------------------------
+	// Thread pool
+
+	class ShmOpsPool {
+	public:
+		// Calls fn(i) for every i in [0, count) using calling thread and up to `helpers` pool threads
+		void parallelFor(size_t count, size_t helpers, const std::function<void(size_t)>& fn) {
+			std::shared_ptr<Job> job = std::make_shared<Job>(count, fn);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				// Threads are started on demand and live until exit of process
+				for (; workers < helpers; workers++)
+					std::thread(&ShmOpsPool::work, this).detach();
+				for (size_t i = 0; i < helpers; i++)
+					jobs.push_back(job);
+			}
+			cv.notify_all();
+			job->run();
+			job->wait();
+		}
+
+	private:
+		struct Job {
+			Job(size_t count, const std::function<void(size_t)>& fn) : fn(fn), count(count), next(0), done(0) {}
+
+			// Helpers can take job after all its parts are done, then fn is not called
+			void run() {
+				size_t i;
+				while ((i = next.fetch_add(1)) < count) {
+					fn(i);
+					if (done.fetch_add(1) + 1 == count) {
+						std::lock_guard<std::mutex> lock(mutex);
+						cv.notify_all();
+					}
+				}
+			}
+
+			void wait() {
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [this] { return done.load() == count; });
+			}
+
+			std::function<void(size_t)> fn;
+			size_t count;
+			std::atomic<size_t> next;
+			std::atomic<size_t> done;
+			std::mutex mutex;
+			std::condition_variable cv;
+		};
+
+		void work() {
+			for (;;) {
+				std::shared_ptr<Job> job;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [this] { return !jobs.empty(); });
+					job = jobs.front();
+					jobs.pop_front();
+				}
+				job->run();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<std::shared_ptr<Job>> jobs;
+		size_t workers = 0;
+	};
+
+	// Never deleted, detached threads may still wait on it at exit
+	static ShmOpsPool* getOpsPool() {
+		static ShmOpsPool* pool = new ShmOpsPool();
+		return pool;
+	}
+
+	//-------------------------------
+
+	static void combineOpsRange(ShmOpsRange& r, const ShmOpsRange& part) {
+		const uint64_t* elements = reinterpret_cast<const uint64_t*>(r.data);
+		switch (r.kind) {
+			case SHMOPS_SUM:
+			case SHMOPS_DOT:
+				r.value += part.value;
+				r.value64 += part.value64;
+				break;
+			case SHMOPS_MIN:
+				if (!opsIs64(r.type))
+					r.value = std::min(r.value, part.value);
+				else if (!std::isinf(part.value) && (std::isinf(r.value) || opsLess64(r.type, part.value64, r.value64))) {
+					r.value = part.value;
+					r.value64 = part.value64;
+				}
+				break;
+			case SHMOPS_MAX:
+				if (!opsIs64(r.type))
+					r.value = std::max(r.value, part.value);
+				else if (!std::isinf(part.value) && (std::isinf(r.value) || opsLess64(r.type, r.value64, part.value64))) {
+					r.value = part.value;
+					r.value64 = part.value64;
+				}
+				break;
+			case SHMOPS_ARGMAX:
+				// Parts are ordered, so first max wins. 64-bit elements are compared themselves, not rounded to double
+				if (part.index != -1 && (r.index == -1 || (opsIs64(r.type)
+					? opsLess64(r.type, elements[r.index], elements[part.index])
+					: part.value > r.value))) {
+					r.value = part.value;
+					r.index = part.index;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	// Can be called in threadpool
+	static void runOps(ShmOpsRange& r) {
+		ShmOpsRunFn fn = getOpsRunFn((ShmOpsIsa) opsIsa.load(std::memory_order_relaxed), r.kind);
+		size_t elemSize = getSizeForShmBufferType(r.type);
+		size_t count = r.end - r.begin;
+		size_t bytes = count * elemSize;
+		size_t parts = 1;
+		if (r.kind == SHMOPS_COPY && r.data < r.data2 + bytes && r.data2 < r.data + bytes) {
+			// Views of same memory can overlap
+			memmove(r.data, r.data2, bytes);
+			return;
+		}
+		if (bytes >= SHM_OPS_PARALLEL_MIN_BYTES)
+			parts = std::min(opsThreads.load(std::memory_order_relaxed), bytes / SHM_OPS_PART_MIN_BYTES);
+		if (parts <= 1) {
+			fn(r);
+			return;
+		}
+
+		// Parts are aligned to cache line
+		size_t align = 64 / elemSize;
+		size_t partLength = ((count + parts - 1) / parts + align - 1) / align * align;
+		std::vector<ShmOpsRange> ranges;
+		for (size_t begin = r.begin; begin < r.end; begin += partLength) {
+			ShmOpsRange part = r;
+			part.begin = begin;
+			part.end = std::min(begin + partLength, r.end);
+			ranges.push_back(part);
+		}
+		getOpsPool()->parallelFor(ranges.size(), ranges.size() - 1, [&ranges, fn](size_t i) {
+			fn(ranges[i]);
+		});
+		// Result of first part is initial one, so min of positive elements isn't 0
+		r.value = ranges[0].value;
+		r.value64 = ranges[0].value64;
+		r.index = ranges[0].index;
+		for (size_t i = 1; i < ranges.size(); i++)
+			combineOpsRange(r, ranges[i]);
+	}
+
+	static Local<Value> getOpsResult(const ShmOpsRange& r) {
+	#if SHM_HAS_BIGINT64_ARRAY
+		if (opsIs64(r.type) && (r.kind == SHMOPS_SUM || r.kind == SHMOPS_DOT
+			|| ((r.kind == SHMOPS_MIN || r.kind == SHMOPS_MAX) && !std::isinf(r.value)))) {
+			if (r.type == SHMBT_BIGINT64)
+				return BigInt::New(v8::Isolate::GetCurrent(), (int64_t) r.value64);
+			return BigInt::NewFromUnsigned(v8::Isolate::GetCurrent(), r.value64);
+		}
+	#endif
+		switch (r.kind) {
+			case SHMOPS_ARGMAX:
+				return Nan::New<Number>((double) r.index);
+			case SHMOPS_SCALE:
+			case SHMOPS_FILL:
+				return Nan::Undefined();
+			case SHMOPS_COPY:
+				return Nan::New<Number>((double) (r.end - r.begin));
+			default:
+				return Nan::New<Number>(r.value);
+		}
+	}
+
+	// Type of typed array, Buffer is Uint8Array
+	static bool getOpsArrayType(Local<Value> val, ShmBufferType* type) {
+		if (val->IsFloat64Array()) *type = SHMBT_FLOAT64;
+		else if (val->IsFloat32Array()) *type = SHMBT_FLOAT32;
+		else if (val->IsInt32Array()) *type = SHMBT_INT32;
+		else if (val->IsUint32Array()) *type = SHMBT_UINT32;
+		else if (val->IsInt16Array()) *type = SHMBT_INT16;
+		else if (val->IsUint16Array()) *type = SHMBT_UINT16;
+		else if (val->IsInt8Array()) *type = SHMBT_INT8;
+		else if (val->IsUint8Array()) *type = SHMBT_UINT8;
+		else if (val->IsUint8ClampedArray()) *type = SHMBT_UINT8CLAMPED;
+	#if SHM_HAS_BIGINT64_ARRAY
+		else if (val->IsBigInt64Array()) *type = SHMBT_BIGINT64;
+		else if (val->IsBigUint64Array()) *type = SHMBT_BIGUINT64;
+	#endif
+		else return false;
+		return true;
+	}
+
+	class OpsWorker : public Nan::AsyncWorker {
+	public:
+		OpsWorker(Nan::Callback* callback, const ShmOpsRange& range)
+			: Nan::AsyncWorker(callback, "shm:ops"), range(range), mapping2(NULL) {
+			size_t size = getSizeForShmBufferType(range.type);
+			size_t offset = range.begin * size;
+			size_t length = (range.end - range.begin) * size;
+			mapping = pinShmMapping(range.data + offset, length);
+			if (range.kind == SHMOPS_DOT || range.kind == SHMOPS_COPY)
+				mapping2 = pinShmMapping(range.data2 + offset, length);
+		}
+
+		void Execute() {
+			runOps(range);
+			unpinShmMapping(mapping);
+			unpinShmMapping(mapping2);
+		}
+
+		void HandleOKCallback() {
+			Nan::HandleScope scope;
+			Local<Value> argv[] = { Nan::Null(), getOpsResult(range) };
+			callback->Call(2, argv, async_resource);
+		}
+
+	private:
+		ShmOpsRange range;
+		void* mapping; // pinned, so detach doesn't unmap arrays while they are used
+		void* mapping2; // of second array of dot, or source of copy
+	};
+
+	NAN_METHOD(opsRun) {
+		Nan::HandleScope scope;
+		ShmOpsRange r = ShmOpsRange();
+		int32_t kind = Nan::To<int32_t>(info[0]).FromJust();
+		if (kind < SHMOPS_SUM || kind > SHMOPS_FILL) {
+			return Nan::ThrowRangeError("Unknown operation");
+		}
+		r.kind = (ShmOpsKind) kind;
+		size_t length;
+		if (!getOpsArrayType(info[1], &r.type) || !getBufferData(info[1], &r.data, &length)) {
+			return Nan::ThrowTypeError("Argument array must be a Buffer or TypedArray except Float16Array");
+		}
+		size_t count = length / getSizeForShmBufferType(r.type);
+		double begin = Nan::To<double>(info[3]).FromJust();
+		double end = Nan::To<double>(info[4]).FromJust();
+		if (!(begin >= 0 && begin <= end && end <= count && begin == std::floor(begin) && end == std::floor(end))) {
+			return Nan::ThrowRangeError("Range is out of bounds");
+		}
+		r.begin = begin;
+		r.end = end;
+		if (r.kind == SHMOPS_DOT) {
+			ShmBufferType type2;
+			size_t length2;
+			if (!getOpsArrayType(info[2], &type2) || !getBufferData(info[2], &r.data2, &length2) || type2 != r.type) {
+				return Nan::ThrowTypeError("Arrays should have same type");
+			}
+			if (length2 / getSizeForShmBufferType(type2) < r.end) {
+				return Nan::ThrowRangeError("Range is out of bounds");
+			}
+		} else if (r.kind == SHMOPS_SCALE || r.kind == SHMOPS_FILL) {
+		#if SHM_HAS_BIGINT64_ARRAY
+			if (opsIs64(r.type)) {
+				// Like assignment to BigInt64Array, numbers are not converted
+				if (!info[2]->IsBigInt()) {
+					return Nan::ThrowTypeError("Argument value must be a BigInt for BigInt64Array and BigUint64Array");
+				}
+				r.arg64 = info[2].As<BigInt>()->Uint64Value();
+			} else
+		#endif
+			r.arg = Nan::To<double>(info[2]).FromJust();
+		}
+		r.index = -1;
+
+		if (info[5]->IsFunction()) {
+			// Keep arrays alive while running, mappings are pinned by worker
+			OpsWorker* worker = new OpsWorker(new Nan::Callback(info[5].As<Function>()), r);
+			worker->SaveToPersistent("array", info[1]);
+			worker->SaveToPersistent("array2", info[2]);
+			Nan::AsyncQueueWorker(worker);
+			return;
+		}
+		runOps(r);
+		info.GetReturnValue().Set(getOpsResult(r));
+	}
+
+	NAN_METHOD(copyBytes) {
+		Nan::HandleScope scope;
+		char* dst;
+		char* src;
+		size_t dstLength, srcLength;
+		if (!getBufferData(info[0], &dst, &dstLength)) {
+			return Nan::ThrowTypeError("Argument dst must be a Buffer or TypedArray");
+		}
+		if (!getBufferData(info[2], &src, &srcLength)) {
+			return Nan::ThrowTypeError("Argument src must be a Buffer or TypedArray");
+		}
+		double dstOffset = Nan::To<double>(info[1]).FromJust();
+		double srcOffset = Nan::To<double>(info[3]).FromJust();
+		double length = Nan::To<double>(info[4]).FromJust();
+		if (!(dstOffset >= 0 && srcOffset >= 0 && length >= 0
+			&& dstOffset + length <= dstLength && srcOffset + length <= srcLength)) {
+			return Nan::ThrowRangeError("Range is out of bounds");
+		}
+
+		ShmOpsRange r = ShmOpsRange();
+		r.kind = SHMOPS_COPY;
+		r.type = SHMBT_UINT8;
+		r.data = dst + (size_t) dstOffset;
+		r.data2 = src + (size_t) srcOffset;
+		r.begin = 0;
+		r.end = length;
+		r.stream = length >= SHM_OPS_STREAM_MIN_BYTES;
+
+		if (info[5]->IsFunction()) {
+			// Keep arrays alive while copying, mappings of both are pinned by worker
+			OpsWorker* worker = new OpsWorker(new Nan::Callback(info[5].As<Function>()), r);
+			worker->SaveToPersistent("dst", info[0]);
+			worker->SaveToPersistent("src", info[2]);
+			Nan::AsyncQueueWorker(worker);
+			return;
+		}
+		runOps(r);
+		info.GetReturnValue().Set(getOpsResult(r));
+	}
+
+	NAN_METHOD(opsConfigure) {
+		Nan::HandleScope scope;
+		if (info[0]->IsString()) {
+			std::string name = *Nan::Utf8String(info[0]);
+			int isa = name == "auto" ? opsIsaDetected : -1;
+			for (int i = 0; i < SHMOPS_ISA_COUNT; i++) {
+				if (name == shmOpsIsaNames[i] && isOpsIsaSupported((ShmOpsIsa) i, opsIsaDetected))
+					isa = i;
+			}
+			if (isa == -1) {
+				return Nan::ThrowRangeError(("Instruction set " + name + " is not supported").c_str());
+			}
+			opsIsa.store(isa);
+		}
+		if (info[1]->IsNumber()) {
+			double threads = Nan::To<double>(info[1]).FromJust();
+			if (!(threads >= 1 && threads <= 1024)) {
+				return Nan::ThrowRangeError("Threads should be 1 .. 1024");
+			}
+			opsThreads.store((size_t) threads);
+		}
+
+		Local<Object> res = Nan::New<Object>();
+		Local<Array> supported = Nan::New<Array>();
+		for (int i = 0; i < SHMOPS_ISA_COUNT; i++) {
+			if (isOpsIsaSupported((ShmOpsIsa) i, opsIsaDetected))
+				Nan::Set(supported, supported->Length(), Nan::New(shmOpsIsaNames[i]).ToLocalChecked());
+		}
+		Nan::Set(res, Nan::New("isa").ToLocalChecked(), Nan::New(shmOpsIsaNames[opsIsa.load()]).ToLocalChecked());
+		Nan::Set(res, Nan::New("supportedIsa").ToLocalChecked(), supported);
+		Nan::Set(res, Nan::New("threads").ToLocalChecked(), Nan::New<Number>((double) opsThreads.load()));
+		info.GetReturnValue().Set(res);
+	}
+
+}
+}
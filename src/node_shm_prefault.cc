@@ -0,0 +1,103 @@
+#include "node_shm.h"
+
+#include <atomic>
+#include <cstdint>
+
+//-------------------------------
+
+// Prefault, lock and advise range of shared memory in libuv threadpool.
+// Range is split to chunks by caller, so chunks are populated in parallel
+//  by several threads of threadpool.
+
+namespace node {
+namespace node_shm {
+
+	using v8::Function;
+	using v8::Local;
+	using v8::Value;
+
+	// Touch every page with atomic add of 0, so page is faulted in for write
+	//  without overwriting concurrent writes of other processes
+	static void touchPages(char* addr, size_t length, size_t pageSize) {
+		for (size_t off = 0; off < length; off += pageSize) {
+			reinterpret_cast<std::atomic<char>*>(addr + off)->fetch_add(0, std::memory_order_relaxed);
+		}
+	}
+
+	// Returns 0 on success, or -1 (see errno)
+	static int prefaultRange(char* addr, size_t length, int flags) {
+		ShmCounterTimer timer(SHMC_PREFAULT_NS);
+		addShmCounter(SHMC_PREFAULTS, 1);
+		addShmCounter(SHMC_PREFAULT_BYTES, length);
+		size_t pageSize = sysconf(_SC_PAGESIZE);
+		// madvise() and mlock() need address aligned to page
+		uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(pageSize - 1);
+		length += reinterpret_cast<uintptr_t>(addr) - start;
+		addr = reinterpret_cast<char*>(start);
+
+		if (flags & SHMPF_WILLNEED) {
+			if (madvise(addr, length, MADV_WILLNEED) == -1)
+				return -1;
+		}
+		if (flags & SHMPF_LOCK) {
+			// Also populates pages
+			if (mlock(addr, length) == -1)
+				return -1;
+		} else if (flags & SHMPF_POPULATE) {
+		#ifdef MADV_POPULATE_WRITE
+			if (madvise(addr, length, MADV_POPULATE_WRITE) == 0)
+				return 0;
+			if (errno != EINVAL) // EINVAL if not supported by kernel (< 5.14)
+				return -1;
+		#endif
+			touchPages(addr, length, pageSize);
+		}
+		return 0;
+	}
+
+	class PrefaultWorker : public Nan::AsyncWorker {
+	public:
+		PrefaultWorker(Nan::Callback* callback, char* addr, size_t length, int flags)
+			: Nan::AsyncWorker(callback, "shm:prefault"), addr(addr), length(length), flags(flags),
+			mapping(pinShmMapping(addr, length)) {}
+
+		void Execute() {
+			int res = prefaultRange(addr, length, flags);
+			int err = errno;
+			unpinShmMapping(mapping);
+			if (res == -1)
+				SetErrorMessage(strerror(err));
+		}
+
+	private:
+		char* addr;
+		size_t length;
+		int flags;
+		void* mapping; // pinned, so detach doesn't unmap range while it's populated
+	};
+
+	NAN_METHOD(prefault) {
+		Nan::HandleScope scope;
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument array must be a Buffer or TypedArray");
+		}
+		size_t byteOffset = Nan::To<double>(info[1]).FromJust();
+		size_t byteLength = Nan::To<double>(info[2]).FromJust();
+		int flags = Nan::To<int32_t>(info[3]).FromJust();
+		if (!info[4]->IsFunction()) {
+			return Nan::ThrowTypeError("Argument callback must be a function");
+		}
+		if (byteOffset > length || byteLength > length - byteOffset) {
+			return Nan::ThrowRangeError("Range is out of bounds");
+		}
+		// Keep array alive while prefaulting, mapping is pinned by worker
+		PrefaultWorker* worker = new PrefaultWorker(
+			new Nan::Callback(info[4].As<Function>()), data + byteOffset, byteLength, flags);
+		worker->SaveToPersistent("array", info[0]);
+		Nan::AsyncQueueWorker(worker);
+	}
+
+}
+}
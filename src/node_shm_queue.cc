@@ -0,0 +1,305 @@
+#include "node_shm.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+//-------------------------------
+
+// Bounded MPMC queue (D. Vyukov's algorithm) living inside shared memory buffer.
+// Every slot has sequence number, so producers and consumers only contend
+//  on CAS of enqueue/dequeue position, and never on slot data.
+// Layout:
+//  ShmQueueHeader (3 cache lines: params, enqueue pos, dequeue pos)
+//  slotCount * ShmQueueSlot (seq, length, data[slotSize]), aligned to 8 bytes
+
+#define SHM_QUEUE_MAGIC 0x51484d53 // "SMHQ"
+#define SHM_QUEUE_VERSION 1
+#define SHM_CACHE_LINE_SIZE 64
+
+namespace node {
+namespace node_shm {
+
+	using v8::Array;
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+		"std::atomic<uint64_t> should have no extra fields to be placed in shared memory");
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+		"std::atomic<uint64_t> should be lock-free to be used between processes");
+
+	struct ShmQueueHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotSize;
+		uint32_t slotCount;
+		uint64_t slotStride;
+		char pad0[SHM_CACHE_LINE_SIZE - 3 * sizeof(uint64_t)];
+		std::atomic<uint64_t> enqueuePos;
+		char pad1[SHM_CACHE_LINE_SIZE - sizeof(uint64_t)];
+		std::atomic<uint64_t> dequeuePos;
+		char pad2[SHM_CACHE_LINE_SIZE - sizeof(uint64_t)];
+	};
+
+	struct ShmQueueSlot {
+		std::atomic<uint64_t> seq;
+		uint32_t length;
+		uint32_t reserved;
+		char data[1];
+	};
+
+	#define SHM_QUEUE_SLOT_DATA_OFFSET offsetof(ShmQueueSlot, data)
+
+	static inline uint64_t queueSlotStride(uint32_t slotSize) {
+		uint64_t stride = SHM_QUEUE_SLOT_DATA_OFFSET + slotSize;
+		return (stride + 7) & ~((uint64_t) 7);
+	}
+
+	static inline uint64_t queueSizeOfBytes(uint32_t slotSize, uint32_t slotCount) {
+		return sizeof(ShmQueueHeader) + queueSlotStride(slotSize) * slotCount;
+	}
+
+	static inline bool isPowerOf2(uint32_t n) {
+		return n > 0 && (n & (n - 1)) == 0;
+	}
+
+	static inline ShmQueueSlot* queueSlot(ShmQueueHeader* q, uint64_t pos) {
+		char* slots = reinterpret_cast<char*>(q) + sizeof(ShmQueueHeader);
+		return reinterpret_cast<ShmQueueSlot*>(slots + (pos & (q->slotCount - 1)) * q->slotStride);
+	}
+
+	// Header is shared with other processes, so it's checked before slots are addressed by it:
+	//  stride should match slot size, and all slots should fit in buffer
+	static bool isValidQueue(const ShmQueueHeader* q, size_t length) {
+		if (length < sizeof(ShmQueueHeader) || q->magic != SHM_QUEUE_MAGIC || q->version != SHM_QUEUE_VERSION)
+			return false;
+		if (!isPowerOf2(q->slotCount) || q->slotStride != queueSlotStride(q->slotSize))
+			return false;
+		return q->slotCount <= (length - sizeof(ShmQueueHeader)) / q->slotStride;
+	}
+
+	// Get queue from buffer passed as argument, throws if it's not a valid queue
+	static ShmQueueHeader* getQueueArg(Local<Value> val) {
+		char* data;
+		size_t length;
+		if (!getBufferData(val, &data, &length)) {
+			Nan::ThrowTypeError("Argument buf must be a Buffer");
+			return NULL;
+		}
+		ShmQueueHeader* q = reinterpret_cast<ShmQueueHeader*>(data);
+		if (!isValidQueue(q, length)) {
+			Nan::ThrowError("Buffer does not contain a queue");
+			return NULL;
+		}
+		return q;
+	}
+
+	// Returns true if pushed, false if full
+	static bool queueTryPush(ShmQueueHeader* q, const char* src, uint32_t length) {
+		ShmQueueSlot* slot;
+		uint64_t pos = q->enqueuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			slot = queueSlot(q, pos);
+			uint64_t seq = slot->seq.load(std::memory_order_acquire);
+			int64_t diff = (int64_t) seq - (int64_t) pos;
+			if (diff == 0) {
+				if (q->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false; // full
+			} else {
+				pos = q->enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		memcpy(slot->data, src, length);
+		slot->length = length;
+		slot->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns length of message, -1 if empty, -2 if dst is too small, -3 if length in slot is corrupt
+	static int64_t queueTryPop(ShmQueueHeader* q, char* dst, size_t dstLength) {
+		ShmQueueSlot* slot;
+		uint32_t length;
+		uint64_t pos = q->dequeuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			slot = queueSlot(q, pos);
+			uint64_t seq = slot->seq.load(std::memory_order_acquire);
+			int64_t diff = (int64_t) seq - (int64_t) (pos + 1);
+			if (diff == 0) {
+				// Slot can't be rewritten by producer until it's dequeued at pos,
+				//  but length is read once, so peer which writes it anyway can't make copy overrun slot
+				length = slot->length;
+				if (length > q->slotSize)
+					return -3;
+				if (length > dstLength)
+					return -2;
+				if (q->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return -1; // empty
+			} else {
+				pos = q->dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+		memcpy(dst, slot->data, length);
+		slot->seq.store(pos + q->slotCount, std::memory_order_release);
+		return length;
+	}
+
+	NAN_METHOD(queueSizeOf) {
+		uint32_t slotSize = Nan::To<uint32_t>(info[0]).FromJust();
+		uint32_t slotCount = Nan::To<uint32_t>(info[1]).FromJust();
+		if (!isPowerOf2(slotCount)) {
+			return Nan::ThrowRangeError("Count of slots should be power of 2");
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(queueSizeOfBytes(slotSize, slotCount)));
+	}
+
+	NAN_METHOD(queueInit) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		uint32_t slotSize = Nan::To<uint32_t>(info[1]).FromJust();
+		uint32_t slotCount = Nan::To<uint32_t>(info[2]).FromJust();
+		if (!isPowerOf2(slotCount)) {
+			return Nan::ThrowRangeError("Count of slots should be power of 2");
+		}
+		if (length < queueSizeOfBytes(slotSize, slotCount)) {
+			return Nan::ThrowRangeError("Buffer is too small for queue");
+		}
+
+		ShmQueueHeader* q = reinterpret_cast<ShmQueueHeader*>(data);
+		q->slotSize = slotSize;
+		q->slotCount = slotCount;
+		q->slotStride = queueSlotStride(slotSize);
+		q->enqueuePos.store(0, std::memory_order_relaxed);
+		q->dequeuePos.store(0, std::memory_order_relaxed);
+		for (uint64_t i = 0; i < slotCount; i++) {
+			ShmQueueSlot* slot = queueSlot(q, i);
+			slot->length = 0;
+			slot->seq.store(i, std::memory_order_relaxed);
+		}
+		q->version = SHM_QUEUE_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		q->magic = SHM_QUEUE_MAGIC;
+	}
+
+	NAN_METHOD(queueInfo) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		ShmQueueHeader* q = reinterpret_cast<ShmQueueHeader*>(data);
+		if (!isValidQueue(q, length)) {
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		uint64_t enq = q->enqueuePos.load(std::memory_order_relaxed);
+		uint64_t deq = q->dequeuePos.load(std::memory_order_relaxed);
+		Local<Object> res = Nan::New<Object>();
+		Nan::Set(res, Nan::New("slotSize").ToLocalChecked(), Nan::New<Number>(q->slotSize));
+		Nan::Set(res, Nan::New("slotCount").ToLocalChecked(), Nan::New<Number>(q->slotCount));
+		Nan::Set(res, Nan::New("length").ToLocalChecked(), Nan::New<Number>(enq > deq ? enq - deq : 0));
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(queuePush) {
+		ShmQueueHeader* q = getQueueArg(info[0]);
+		if (q == NULL)
+			return;
+		char* src;
+		size_t srcLength;
+		if (!getBufferData(info[1], &src, &srcLength)) {
+			return Nan::ThrowTypeError("Argument src must be a Buffer or TypedArray");
+		}
+		if (srcLength > q->slotSize) {
+			return Nan::ThrowRangeError("Message is larger than slot size");
+		}
+		bool res = queueTryPush(q, src, srcLength);
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(queuePop) {
+		ShmQueueHeader* q = getQueueArg(info[0]);
+		if (q == NULL)
+			return;
+		char* dst;
+		size_t dstLength;
+		if (!getBufferData(info[1], &dst, &dstLength)) {
+			return Nan::ThrowTypeError("Argument dst must be a Buffer or TypedArray");
+		}
+		int64_t res = queueTryPop(q, dst, dstLength);
+		if (res == -3) {
+			return Nan::ThrowError("Buffer does not contain a queue");
+		}
+		if (res == -2) {
+			return Nan::ThrowRangeError("Destination is smaller than message");
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(res));
+	}
+
+	NAN_METHOD(queuePushBatch) {
+		ShmQueueHeader* q = getQueueArg(info[0]);
+		if (q == NULL)
+			return;
+		if (!info[1]->IsArray()) {
+			return Nan::ThrowTypeError("Argument srcs must be an array");
+		}
+		Local<Array> srcs = info[1].As<Array>();
+		uint32_t cnt = srcs->Length();
+		uint32_t pushed = 0;
+		for (; pushed < cnt; pushed++) {
+			Local<Value> el = Nan::Get(srcs, pushed).ToLocalChecked();
+			char* src;
+			size_t srcLength;
+			if (!getBufferData(el, &src, &srcLength)) {
+				return Nan::ThrowTypeError("Argument srcs must contain Buffers or TypedArrays");
+			}
+			if (srcLength > q->slotSize) {
+				return Nan::ThrowRangeError("Message is larger than slot size");
+			}
+			if (!queueTryPush(q, src, srcLength))
+				break;
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(pushed));
+	}
+
+	NAN_METHOD(queuePopBatch) {
+		ShmQueueHeader* q = getQueueArg(info[0]);
+		if (q == NULL)
+			return;
+		char* dst;
+		size_t dstLength;
+		if (!getBufferData(info[1], &dst, &dstLength)) {
+			return Nan::ThrowTypeError("Argument dst must be a Buffer or TypedArray");
+		}
+		uint32_t maxCount = Nan::To<uint32_t>(info[2]).FromJust();
+		uint32_t popped = 0;
+		size_t offset = 0;
+		for (; popped < maxCount && offset + sizeof(uint32_t) <= dstLength; popped++) {
+			int64_t res = queueTryPop(q, dst + offset + sizeof(uint32_t),
+				dstLength - offset - sizeof(uint32_t));
+			if (res == -3) {
+				return Nan::ThrowError("Buffer does not contain a queue");
+			}
+			if (res == -2 && popped == 0) {
+				return Nan::ThrowRangeError("Destination is smaller than message");
+			}
+			if (res < 0)
+				break; // empty, or no space left in dst for next message
+			uint32_t length = (uint32_t) res;
+			memcpy(dst + offset, &length, sizeof(length));
+			offset += sizeof(uint32_t) + length;
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(popped));
+	}
+
+}
+}
@@ -0,0 +1,190 @@
+#include "node_shm.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sched.h>
+
+//-------------------------------
+
+// Seqlock-protected region living inside shared memory buffer.
+// Writer makes sequence odd, copies data and makes sequence even again.
+// Reader copies data and retries if sequence was odd or has changed,
+//  so readers never block writer and consistent snapshot costs one memcpy.
+// Writers are serialized by robust lock word (see node_shm_lock.cc): writer which died
+//  while sequence was odd is taken over by next writer, readers fail until it publishes.
+// Layout:
+//  ShmSeqlockHeader (2 cache lines: params, sequence and lock word of writers)
+//  data[size]
+
+#define SHM_SEQLOCK_MAGIC 0x4b4c5153 // "SQLK"
+#define SHM_SEQLOCK_VERSION 2
+#define SHM_CACHE_LINE_SIZE 64
+#define SHM_SEQLOCK_SPINS_BEFORE_YIELD 64
+
+namespace node {
+namespace node_shm {
+
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+		"std::atomic<uint64_t> should be lock-free to be used between processes");
+
+	struct ShmSeqlockHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t size;
+		char pad0[SHM_CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+		std::atomic<uint64_t> seq;
+		std::atomic<uint32_t> writer; // pid of writer, 0 if unlocked
+		uint32_t reserved;
+		ShmLockOwner writerOwner;
+		char pad1[SHM_CACHE_LINE_SIZE - 2 * sizeof(uint64_t) - sizeof(ShmLockOwner)];
+	};
+
+	static inline char* seqlockData(ShmSeqlockHeader* l) {
+		return reinterpret_cast<char*>(l) + sizeof(ShmSeqlockHeader);
+	}
+
+	// Get seqlock region from buffer passed as argument, throws if it's not a valid region
+	static ShmSeqlockHeader* getSeqlockArg(Local<Value> val) {
+		char* data;
+		size_t length;
+		if (!getBufferData(val, &data, &length)) {
+			Nan::ThrowTypeError("Argument buf must be a Buffer");
+			return NULL;
+		}
+		ShmSeqlockHeader* l = reinterpret_cast<ShmSeqlockHeader*>(data);
+		if (length < sizeof(ShmSeqlockHeader) || l->magic != SHM_SEQLOCK_MAGIC
+			|| l->version != SHM_SEQLOCK_VERSION
+			|| length < sizeof(ShmSeqlockHeader) + l->size) {
+			Nan::ThrowError("Buffer does not contain a seqlock region");
+			return NULL;
+		}
+		return l;
+	}
+
+	// Returns new sequence
+	static uint64_t seqlockPublish(ShmSeqlockHeader* l, const char* src, size_t length) {
+		lockShmWord(&l->writer, &l->writerOwner, INFINITY);
+		uint64_t seq = l->seq.load(std::memory_order_relaxed);
+		// Odd sequence is left by writer which died, data is torn anyway
+		if ((seq & 1) == 0) {
+			seq++;
+			l->seq.store(seq, std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(seqlockData(l), src, length);
+		l->seq.store(seq + 1, std::memory_order_release);
+		unlockShmWord(&l->writer, &l->writerOwner, 1);
+		return seq + 1;
+	}
+
+	// Returns false if writer died while sequence was odd, else sequence of copied snapshot is set
+	static bool seqlockRead(ShmSeqlockHeader* l, char* dst, size_t length, uint64_t* seq) {
+		uint32_t spins = 0;
+		for (;;) {
+			uint64_t seq1 = l->seq.load(std::memory_order_acquire);
+			if ((seq1 & 1) == 0) {
+				memcpy(dst, seqlockData(l), length);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (l->seq.load(std::memory_order_relaxed) == seq1) {
+					*seq = seq1;
+					return true;
+				}
+			}
+			if (++spins % SHM_SEQLOCK_SPINS_BEFORE_YIELD == 0) {
+				if ((seq1 & 1) && isShmWordOwnerDead(&l->writer, &l->writerOwner)
+					&& l->seq.load(std::memory_order_relaxed) == seq1)
+					return false;
+				sched_yield();
+			}
+		}
+	}
+
+	NAN_METHOD(seqlockSizeOf) {
+		double size = Nan::To<double>(info[0]).FromJust();
+		info.GetReturnValue().Set(Nan::New<Number>(sizeof(ShmSeqlockHeader) + size));
+	}
+
+	NAN_METHOD(seqlockInit) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		uint64_t size = Nan::To<int64_t>(info[1]).FromJust();
+		if (length < sizeof(ShmSeqlockHeader) + size) {
+			return Nan::ThrowRangeError("Buffer is too small for seqlock region");
+		}
+
+		ShmSeqlockHeader* l = reinterpret_cast<ShmSeqlockHeader*>(data);
+		l->size = size;
+		l->seq.store(0, std::memory_order_relaxed);
+		l->writer.store(0, std::memory_order_relaxed);
+		l->writerOwner.pid.store(0, std::memory_order_relaxed);
+		memset(seqlockData(l), 0, size);
+		l->version = SHM_SEQLOCK_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		l->magic = SHM_SEQLOCK_MAGIC;
+	}
+
+	NAN_METHOD(seqlockInfo) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		ShmSeqlockHeader* l = reinterpret_cast<ShmSeqlockHeader*>(data);
+		if (length < sizeof(ShmSeqlockHeader) || l->magic != SHM_SEQLOCK_MAGIC
+			|| l->version != SHM_SEQLOCK_VERSION
+			|| length < sizeof(ShmSeqlockHeader) + l->size) {
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		uint64_t seq = l->seq.load(std::memory_order_acquire);
+		Local<Object> res = Nan::New<Object>();
+		Nan::Set(res, Nan::New("size").ToLocalChecked(), Nan::New<Number>((double) l->size));
+		Nan::Set(res, Nan::New("dataOffset").ToLocalChecked(), Nan::New<Number>(sizeof(ShmSeqlockHeader)));
+		Nan::Set(res, Nan::New("version").ToLocalChecked(), Nan::New<Number>((double) (seq >> 1)));
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(seqlockPublish) {
+		ShmSeqlockHeader* l = getSeqlockArg(info[0]);
+		if (l == NULL)
+			return;
+		char* src;
+		size_t srcLength;
+		if (!getBufferData(info[1], &src, &srcLength)) {
+			return Nan::ThrowTypeError("Argument src must be a Buffer or TypedArray");
+		}
+		if (srcLength > l->size) {
+			return Nan::ThrowRangeError("Source is larger than seqlock region");
+		}
+		uint64_t seq = seqlockPublish(l, src, srcLength);
+		info.GetReturnValue().Set(Nan::New<Number>((double) (seq >> 1)));
+	}
+
+	NAN_METHOD(seqlockRead) {
+		ShmSeqlockHeader* l = getSeqlockArg(info[0]);
+		if (l == NULL)
+			return;
+		char* dst;
+		size_t dstLength;
+		if (!getBufferData(info[1], &dst, &dstLength)) {
+			return Nan::ThrowTypeError("Argument dst must be a Buffer or TypedArray");
+		}
+		uint64_t seq;
+		if (!seqlockRead(l, dst, std::min((uint64_t) dstLength, l->size), &seq)) {
+			return Nan::ThrowError("Writer of seqlock region died, data is torn until next publish");
+		}
+		info.GetReturnValue().Set(Nan::New<Number>((double) (seq >> 1)));
+	}
+
+}
+}
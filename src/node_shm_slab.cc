@@ -0,0 +1,379 @@
+#include "node_shm.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+//-------------------------------
+
+// Slab allocator of variable-sized blocks living inside shared memory buffer.
+// Arena is split to slabs of equal size, every slab is bound to one size class
+//  (power of 2 from 16 bytes to slab size) when it's first needed.
+// Every size class has lock-free free list (Treiber stack with ABA tag)
+//  and bump pointer into current slab, so process crashed at any point
+//  can't leave allocator locked.
+// Slab is claimed by process with CAS of its state to "claiming by pid",
+//  if process dies before slab is activated, slab can be recovered.
+// Identity of claimer (pid namespace, start time) is recorded next to state,
+//  so slab claimed from other PID namespace or by process whose pid was reused isn't misjudged.
+// Layout:
+//  ShmSlabHeader (params, slab hint, size classes - one cache line per class)
+//  slabCount * uint32_t slab states
+//  slabCount * ShmLockOwner identities of claimers, aligned to 8 bytes
+//  arena (slabCount * slabSize), aligned to cache line
+
+#define SHM_SLAB_MAGIC 0x42414c53 // "SLAB"
+#define SHM_SLAB_VERSION 2
+#define SHM_CACHE_LINE_SIZE 64
+#define SHM_SLAB_MIN_BLOCK_SHIFT 4 // 16 bytes
+#define SHM_SLAB_MAX_CLASSES 32
+
+// Slab states
+#define SHM_SLAB_FREE 0
+#define SHM_SLAB_ACTIVE 0x80000000u
+#define SHM_SLAB_CLASS_MASK 0x1fu
+#define SHM_SLAB_PID_SHIFT 5
+
+namespace node {
+namespace node_shm {
+
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+		"std::atomic<uint32_t> should have no extra fields to be placed in shared memory");
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+		"std::atomic should be lock-free to be used between processes");
+
+	struct ShmSlabClass {
+		// Tag (high 32 bits) and 1-based index of first free block in units of min block (low 32 bits)
+		std::atomic<uint64_t> freeHead;
+		// 1-based index of current slab (high 32 bits) and index of next unused block in it (low 32 bits)
+		std::atomic<uint64_t> bump;
+		char pad[SHM_CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+	};
+
+	struct ShmSlabHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slabSize;
+		uint32_t slabCount;
+		uint32_t classCount;
+		uint32_t reserved;
+		uint64_t arenaOffset;
+		char pad0[SHM_CACHE_LINE_SIZE - 4 * sizeof(uint64_t)];
+		std::atomic<uint64_t> slabHint;
+		char pad1[SHM_CACHE_LINE_SIZE - sizeof(uint64_t)];
+		ShmSlabClass classes[SHM_SLAB_MAX_CLASSES];
+	};
+
+	static inline uint64_t slabOwnersOffset(uint32_t slabCount) {
+		uint64_t offset = sizeof(ShmSlabHeader) + (uint64_t) slabCount * sizeof(uint32_t);
+		return (offset + alignof(ShmLockOwner) - 1) & ~((uint64_t) alignof(ShmLockOwner) - 1);
+	}
+
+	static inline uint64_t slabArenaOffset(uint32_t slabCount) {
+		uint64_t offset = slabOwnersOffset(slabCount) + (uint64_t) slabCount * sizeof(ShmLockOwner);
+		return (offset + SHM_CACHE_LINE_SIZE - 1) & ~((uint64_t) SHM_CACHE_LINE_SIZE - 1);
+	}
+
+	static inline uint64_t slabSizeOfBytes(uint32_t slabSize, uint32_t slabCount) {
+		return slabArenaOffset(slabCount) + (uint64_t) slabSize * slabCount;
+	}
+
+	static inline uint32_t slabClassCount(uint32_t slabSize) {
+		uint32_t cnt = 1;
+		while (((uint64_t) 1 << (SHM_SLAB_MIN_BLOCK_SHIFT + cnt - 1)) < slabSize)
+			cnt++;
+		return cnt;
+	}
+
+	static inline bool isValidSlabSize(uint32_t slabSize) {
+		return slabSize >= (1u << SHM_SLAB_MIN_BLOCK_SHIFT) && (slabSize & (slabSize - 1)) == 0;
+	}
+
+	static inline std::atomic<uint32_t>* slabStates(ShmSlabHeader* h) {
+		return reinterpret_cast<std::atomic<uint32_t>*>(reinterpret_cast<char*>(h) + sizeof(ShmSlabHeader));
+	}
+
+	static inline ShmLockOwner* slabOwners(ShmSlabHeader* h) {
+		return reinterpret_cast<ShmLockOwner*>(reinterpret_cast<char*>(h) + slabOwnersOffset(h->slabCount));
+	}
+
+	static inline char* slabArena(ShmSlabHeader* h) {
+		return reinterpret_cast<char*>(h) + h->arenaOffset;
+	}
+
+	// Next free block is stored at start of free block
+	static inline std::atomic<uint32_t>* slabBlockNext(ShmSlabHeader* h, uint32_t ind) {
+		return reinterpret_cast<std::atomic<uint32_t>*>(
+			slabArena(h) + ((uint64_t) (ind - 1) << SHM_SLAB_MIN_BLOCK_SHIFT));
+	}
+
+	static inline bool isSlabClaimedByDeadProcess(ShmSlabHeader* h, uint32_t s, uint32_t state) {
+		if (state == SHM_SLAB_FREE || (state & SHM_SLAB_ACTIVE))
+			return false;
+		return isShmOwnerDead(state >> SHM_SLAB_PID_SHIFT, &slabOwners(h)[s]);
+	}
+
+	// Get slab allocator from buffer passed as argument, throws if it's not a valid allocator
+	static ShmSlabHeader* getSlabArg(Local<Value> val) {
+		char* data;
+		size_t length;
+		if (!getBufferData(val, &data, &length)) {
+			Nan::ThrowTypeError("Argument buf must be a Buffer");
+			return NULL;
+		}
+		ShmSlabHeader* h = reinterpret_cast<ShmSlabHeader*>(data);
+		if (length < sizeof(ShmSlabHeader) || h->magic != SHM_SLAB_MAGIC
+			|| h->version != SHM_SLAB_VERSION
+			|| length < slabSizeOfBytes(h->slabSize, h->slabCount)) {
+			Nan::ThrowError("Buffer does not contain a slab allocator");
+			return NULL;
+		}
+		return h;
+	}
+
+	// Returns index of claimed slab, or -1 if there are no free slabs
+	static int64_t slabClaim(ShmSlabHeader* h, uint32_t cls) {
+		std::atomic<uint32_t>* states = slabStates(h);
+		uint32_t pid = (uint32_t) getpid();
+		uint32_t claiming = (pid << SHM_SLAB_PID_SHIFT) | cls;
+		uint64_t start = h->slabHint.load(std::memory_order_relaxed);
+		for (uint64_t i = 0; i < h->slabCount; i++) {
+			uint32_t s = (start + i) % h->slabCount;
+			uint32_t state = SHM_SLAB_FREE;
+			if (states[s].load(std::memory_order_relaxed) == SHM_SLAB_FREE
+				&& states[s].compare_exchange_strong(state, claiming, std::memory_order_acq_rel)) {
+				setShmLockOwner(&slabOwners(h)[s], pid);
+				h->slabHint.store(s + 1, std::memory_order_relaxed);
+				return s;
+			}
+		}
+		return -1;
+	}
+
+	// Returns offset of block in buffer, or -1 if out of memory
+	static int64_t slabAllocBlock(ShmSlabHeader* h, uint32_t cls) {
+		ShmSlabClass* c = &h->classes[cls];
+		std::atomic<uint32_t>* states = slabStates(h);
+		uint64_t blockSize = (uint64_t) 1 << (SHM_SLAB_MIN_BLOCK_SHIFT + cls);
+		uint64_t blocksPerSlab = h->slabSize / blockSize;
+
+		// Pop from free list
+		uint64_t head = c->freeHead.load(std::memory_order_acquire);
+		while ((uint32_t) head != 0) {
+			uint32_t ind = (uint32_t) head;
+			// Block can be reused by other process, then CAS fails because of tag
+			uint32_t next = slabBlockNext(h, ind)->load(std::memory_order_relaxed);
+			uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+			if (c->freeHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel))
+				return h->arenaOffset + ((uint64_t) (ind - 1) << SHM_SLAB_MIN_BLOCK_SHIFT);
+		}
+
+		// Take next unused block of current slab
+		uint64_t bump = c->bump.load(std::memory_order_acquire);
+		for (;;) {
+			uint32_t slab = (uint32_t) (bump >> 32);
+			uint64_t next = (uint32_t) bump;
+			if (slab != 0 && next < blocksPerSlab) {
+				if (c->bump.compare_exchange_weak(bump, bump + 1, std::memory_order_acq_rel))
+					return h->arenaOffset + (uint64_t) (slab - 1) * h->slabSize + next * blockSize;
+				continue;
+			}
+			if (slab != 0) {
+				// Activate full slab before replacing, in case claimer has died
+				uint32_t state = states[slab - 1].load(std::memory_order_relaxed);
+				if (!(state & SHM_SLAB_ACTIVE)
+					&& states[slab - 1].compare_exchange_strong(state, SHM_SLAB_ACTIVE | cls, std::memory_order_acq_rel))
+					clearShmLockOwner(&slabOwners(h)[slab - 1]);
+			}
+			int64_t s = slabClaim(h, cls);
+			if (s == -1)
+				return -1;
+			uint64_t newBump = ((uint64_t) (s + 1) << 32) | 1;
+			if (c->bump.compare_exchange_strong(bump, newBump, std::memory_order_acq_rel)) {
+				uint32_t claiming = states[s].load(std::memory_order_relaxed);
+				// Slab could be activated already by other process which has filled it
+				if (!(claiming & SHM_SLAB_ACTIVE)
+					&& states[s].compare_exchange_strong(claiming, SHM_SLAB_ACTIVE | cls, std::memory_order_acq_rel))
+					clearShmLockOwner(&slabOwners(h)[s]);
+				return h->arenaOffset + (uint64_t) s * h->slabSize;
+			}
+			// Other process has replaced slab
+			clearShmLockOwner(&slabOwners(h)[s]);
+			states[s].store(SHM_SLAB_FREE, std::memory_order_release);
+		}
+	}
+
+	// Returns size class of allocated block, or -1 if offset is not a block
+	static int32_t slabBlockClass(ShmSlabHeader* h, uint64_t offset) {
+		if (offset < h->arenaOffset)
+			return -1;
+		uint64_t arenaPos = offset - h->arenaOffset;
+		uint64_t s = arenaPos / h->slabSize;
+		if (s >= h->slabCount)
+			return -1;
+		uint32_t state = slabStates(h)[s].load(std::memory_order_acquire);
+		if (state == SHM_SLAB_FREE)
+			return -1;
+		uint32_t cls = state & SHM_SLAB_CLASS_MASK;
+		if ((arenaPos - s * h->slabSize) & (((uint64_t) 1 << (SHM_SLAB_MIN_BLOCK_SHIFT + cls)) - 1))
+			return -1;
+		return cls;
+	}
+
+	static void slabFreeBlock(ShmSlabHeader* h, uint32_t cls, uint64_t offset) {
+		ShmSlabClass* c = &h->classes[cls];
+		uint32_t ind = (uint32_t) ((offset - h->arenaOffset) >> SHM_SLAB_MIN_BLOCK_SHIFT) + 1;
+		std::atomic<uint32_t>* next = slabBlockNext(h, ind);
+		uint64_t head = c->freeHead.load(std::memory_order_relaxed);
+		do {
+			next->store((uint32_t) head, std::memory_order_relaxed);
+		} while (!c->freeHead.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | ind,
+			std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	NAN_METHOD(slabSizeOf) {
+		uint32_t slabSize = Nan::To<uint32_t>(info[0]).FromJust();
+		uint32_t slabCount = Nan::To<uint32_t>(info[1]).FromJust();
+		if (!isValidSlabSize(slabSize)) {
+			return Nan::ThrowRangeError("Slab size should be power of 2 >= 16");
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(slabSizeOfBytes(slabSize, slabCount)));
+	}
+
+	NAN_METHOD(slabInit) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		uint32_t slabSize = Nan::To<uint32_t>(info[1]).FromJust();
+		uint32_t slabCount = Nan::To<uint32_t>(info[2]).FromJust();
+		if (!isValidSlabSize(slabSize)) {
+			return Nan::ThrowRangeError("Slab size should be power of 2 >= 16");
+		}
+		if (length < slabSizeOfBytes(slabSize, slabCount)) {
+			return Nan::ThrowRangeError("Buffer is too small for slab allocator");
+		}
+		if (((uint64_t) slabSize * slabCount) >> SHM_SLAB_MIN_BLOCK_SHIFT >= UINT32_MAX) {
+			return Nan::ThrowRangeError("Arena of slab allocator is too large");
+		}
+
+		ShmSlabHeader* h = reinterpret_cast<ShmSlabHeader*>(data);
+		h->slabSize = slabSize;
+		h->slabCount = slabCount;
+		h->classCount = slabClassCount(slabSize);
+		h->reserved = 0;
+		h->arenaOffset = slabArenaOffset(slabCount);
+		h->slabHint.store(0, std::memory_order_relaxed);
+		for (uint32_t i = 0; i < SHM_SLAB_MAX_CLASSES; i++) {
+			h->classes[i].freeHead.store(0, std::memory_order_relaxed);
+			h->classes[i].bump.store(0, std::memory_order_relaxed);
+		}
+		std::atomic<uint32_t>* states = slabStates(h);
+		ShmLockOwner* owners = slabOwners(h);
+		for (uint32_t s = 0; s < slabCount; s++) {
+			states[s].store(SHM_SLAB_FREE, std::memory_order_relaxed);
+			clearShmLockOwner(&owners[s]);
+		}
+		h->version = SHM_SLAB_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		h->magic = SHM_SLAB_MAGIC;
+	}
+
+	NAN_METHOD(slabInfo) {
+		char* data;
+		size_t length;
+		if (!getBufferData(info[0], &data, &length)) {
+			return Nan::ThrowTypeError("Argument buf must be a Buffer");
+		}
+		ShmSlabHeader* h = reinterpret_cast<ShmSlabHeader*>(data);
+		if (length < sizeof(ShmSlabHeader) || h->magic != SHM_SLAB_MAGIC
+			|| h->version != SHM_SLAB_VERSION
+			|| length < slabSizeOfBytes(h->slabSize, h->slabCount)) {
+			info.GetReturnValue().SetNull();
+			return;
+		}
+		std::atomic<uint32_t>* states = slabStates(h);
+		uint32_t usedSlabs = 0;
+		for (uint32_t s = 0; s < h->slabCount; s++) {
+			if (states[s].load(std::memory_order_relaxed) != SHM_SLAB_FREE)
+				usedSlabs++;
+		}
+		Local<Object> res = Nan::New<Object>();
+		Nan::Set(res, Nan::New("slabSize").ToLocalChecked(), Nan::New<Number>(h->slabSize));
+		Nan::Set(res, Nan::New("slabCount").ToLocalChecked(), Nan::New<Number>(h->slabCount));
+		Nan::Set(res, Nan::New("usedSlabs").ToLocalChecked(), Nan::New<Number>(usedSlabs));
+		Nan::Set(res, Nan::New("maxSize").ToLocalChecked(), Nan::New<Number>(h->slabSize));
+		info.GetReturnValue().Set(res);
+	}
+
+	NAN_METHOD(slabAlloc) {
+		ShmSlabHeader* h = getSlabArg(info[0]);
+		if (!h)
+			return;
+		double size = Nan::To<double>(info[1]).FromJust();
+		if (!(size >= 1 && size <= h->slabSize)) {
+			return Nan::ThrowRangeError("Size should be 1 .. slab size");
+		}
+		uint32_t cls = 0;
+		while (((uint64_t) 1 << (SHM_SLAB_MIN_BLOCK_SHIFT + cls)) < size)
+			cls++;
+		info.GetReturnValue().Set(Nan::New<Number>(slabAllocBlock(h, cls)));
+	}
+
+	NAN_METHOD(slabFree) {
+		ShmSlabHeader* h = getSlabArg(info[0]);
+		if (!h)
+			return;
+		uint64_t offset = Nan::To<int64_t>(info[1]).FromJust();
+		int32_t cls = slabBlockClass(h, offset);
+		if (cls == -1) {
+			return Nan::ThrowRangeError("Offset is not a block of slab allocator");
+		}
+		slabFreeBlock(h, cls, offset);
+	}
+
+	NAN_METHOD(slabBlockSize) {
+		ShmSlabHeader* h = getSlabArg(info[0]);
+		if (!h)
+			return;
+		uint64_t offset = Nan::To<int64_t>(info[1]).FromJust();
+		int32_t cls = slabBlockClass(h, offset);
+		if (cls == -1) {
+			return Nan::ThrowRangeError("Offset is not a block of slab allocator");
+		}
+		info.GetReturnValue().Set(Nan::New<Number>((uint64_t) 1 << (SHM_SLAB_MIN_BLOCK_SHIFT + cls)));
+	}
+
+	NAN_METHOD(slabRecover) {
+		ShmSlabHeader* h = getSlabArg(info[0]);
+		if (!h)
+			return;
+		std::atomic<uint32_t>* states = slabStates(h);
+		uint32_t recovered = 0;
+		for (uint32_t s = 0; s < h->slabCount; s++) {
+			uint32_t state = states[s].load(std::memory_order_acquire);
+			if (!isSlabClaimedByDeadProcess(h, s, state))
+				continue;
+			// Claimer died before activating slab. Only claimer could make it current slab of class,
+			//  and current slab is activated by other processes before being replaced.
+			uint32_t cls = state & SHM_SLAB_CLASS_MASK;
+			uint64_t bump = h->classes[cls].bump.load(std::memory_order_acquire);
+			uint32_t newState = (uint32_t) (bump >> 32) == s + 1 ? (SHM_SLAB_ACTIVE | cls) : SHM_SLAB_FREE;
+			if (states[s].compare_exchange_strong(state, newState, std::memory_order_acq_rel)) {
+				// Freed slab can be claimed again at once, its claimer overwrites identity itself
+				if (newState != SHM_SLAB_FREE)
+					clearShmLockOwner(&slabOwners(h)[s]);
+				recovered++;
+			}
+		}
+		info.GetReturnValue().Set(Nan::New<Number>(recovered));
+	}
+
+}
+}
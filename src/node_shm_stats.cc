@@ -0,0 +1,121 @@
+#include "node_shm.h"
+
+#include <cstdio>
+#include <cstring>
+
+//-------------------------------
+
+// Runtime instrumentation: counters of syscalls done by this process and residency of mappings.
+// Counters are relaxed atomics, because attaches, detaches and prefaults can run in threadpool,
+//  so cost of counting is one clock_gettime() (vDSO) and one atomic add per operation.
+
+#define SHM_MINCORE_BATCH 65536
+
+namespace node {
+namespace node_shm {
+
+	using v8::Local;
+	using v8::Number;
+	using v8::Object;
+	using v8::Value;
+
+	std::atomic<uint64_t> shmCounters[SHMC_COUNT];
+
+	static const char* const shmCounterNames[SHMC_COUNT] = {
+		"attaches",
+		"attachErrors",
+		"attachNs",
+		"mappingReuses",
+		"detaches",
+		"destroys",
+		"detachNs",
+		"prefaults",
+		"prefaultBytes",
+		"prefaultNs",
+		"flushes",
+		"flushNs",
+	};
+
+	int readPageStats(const std::vector<std::pair<uintptr_t, uintptr_t>>& ranges, std::vector<ShmPageStats>& stats) {
+		size_t sysPageSize = sysconf(_SC_PAGESIZE);
+		stats.assign(ranges.size(), ShmPageStats{0, 0});
+	#ifdef __linux__
+		// Ranges sorted by start, to find range of VMA with binary search
+		std::vector<size_t> order(ranges.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&ranges](size_t a, size_t b) {
+			return ranges[a].first < ranges[b].first;
+		});
+		FILE* f = fopen("/proc/self/smaps", "r");
+		if (f == NULL)
+			return errno;
+		char line[4096];
+		ShmPageStats* cur = NULL;
+		while (fgets(line, sizeof(line), f)) {
+			unsigned long start, end;
+			char fieldName[64];
+			unsigned long value;
+			if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+				// Mapping can be split to several VMAs, their stats are summed up
+				auto found = std::upper_bound(order.begin(), order.end(), start, [&ranges](uintptr_t addr, size_t ind) {
+					return addr < ranges[ind].first;
+				});
+				cur = NULL;
+				if (found != order.begin() && ranges[*(found - 1)].second > start)
+					cur = &stats[*(found - 1)];
+				else if (found != order.end() && ranges[*found].first < end)
+					cur = &stats[*found];
+			} else if (cur != NULL && sscanf(line, "%63[^:]: %lu", fieldName, &value) == 2) {
+				if (strcmp(fieldName, "KernelPageSize") == 0 && cur->pageSize == 0) {
+					cur->pageSize = value << 10;
+				} else if (strcmp(fieldName, "AnonHugePages") == 0
+					|| strcmp(fieldName, "ShmemPmdMapped") == 0
+					|| strcmp(fieldName, "FilePmdMapped") == 0) {
+					cur->transparentHugeBytes += value << 10;
+				}
+			}
+		}
+		fclose(f);
+	#endif
+		for (auto& s : stats) {
+			if (s.pageSize == 0)
+				s.pageSize = sysPageSize;
+		}
+		return 0;
+	}
+
+	int countResidentPages(void* addr, size_t length, size_t& resident) {
+		size_t pageSize = sysconf(_SC_PAGESIZE);
+		char* start = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(addr) & ~(pageSize - 1));
+		size_t pages = (reinterpret_cast<char*>(addr) + length - start + pageSize - 1) / pageSize;
+		resident = 0;
+		// Vector of mincore() is 1 byte per page, so huge mapping is checked in batches
+		std::vector<unsigned char> vec(std::min(pages, (size_t) SHM_MINCORE_BATCH));
+		for (size_t done = 0; done < pages; done += vec.size()) {
+			size_t cnt = std::min(pages - done, vec.size());
+		#ifdef __APPLE__
+			int res = mincore(start + done * pageSize, cnt * pageSize, reinterpret_cast<char*>(vec.data()));
+		#else
+			int res = mincore(start + done * pageSize, cnt * pageSize, vec.data());
+		#endif
+			if (res == -1)
+				return errno;
+			for (size_t i = 0; i < cnt; i++)
+				resident += vec[i] & 1;
+		}
+		return 0;
+	}
+
+	NAN_METHOD(counters) {
+		Nan::HandleScope scope;
+		Local<Object> res = Nan::New<Object>();
+		for (int i = 0; i < SHMC_COUNT; i++) {
+			double value = (double) shmCounters[i].load(std::memory_order_relaxed);
+			Nan::Set(res, Nan::New(shmCounterNames[i]).ToLocalChecked(), Nan::New<Number>(value));
+		}
+		info.GetReturnValue().Set(res);
+	}
+
+}
+}
@@ -0,0 +1,115 @@
+#include "node_shm.h"
+#include <mutex>
+
+//-------------------------------
+
+// Windows: mappings of page-aligned sub-ranges of POSIX objects and files, see mapWindow().
+// They are not attaches (have no meta), every window is separate mmap() owned by its view,
+//  so scan of object larger than address space or RAM keeps only few windows mapped and resident.
+
+namespace node {
+namespace node_shm {
+
+	using v8::Local;
+	using v8::Value;
+
+	struct ShmWindow {
+		void* addr; // aligned start of mapping
+		size_t size; // size of mapping
+	};
+
+	// Mapped windows by id, id is passed as hint to free callback of view,
+	//  so window unmapped by unmapWindow() is not confused with new window mapped at same address
+	static std::mutex shmWindowsMutex;
+	static std::unordered_map<uintptr_t, ShmWindow> shmWindows;
+	static uintptr_t shmWindowsLastId = 0;
+
+	char* mapShmWindow(int fd, size_t fileOffset, size_t length, size_t alignment, int mapFlags, bool willNeed,
+		void** hint) {
+		ShmCounterTimer timer(SHMC_ATTACH_NS);
+		size_t start = fileOffset & ~(alignment - 1);
+		size_t delta = fileOffset - start;
+		// hugetlbfs needs length aligned to huge page
+		size_t size = (delta + length + alignment - 1) & ~(alignment - 1);
+		void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, mapFlags, fd, (off_t) start);
+		if (addr == MAP_FAILED) {
+			addShmCounter(SHMC_ATTACH_ERRORS, 1);
+			return NULL;
+		}
+		if (willNeed)
+			madvise(addr, size, MADV_WILLNEED);
+		addShmCounter(SHMC_ATTACHES, 1);
+		std::lock_guard<std::mutex> lock(shmWindowsMutex);
+		uintptr_t id = ++shmWindowsLastId;
+		shmWindows[id] = ShmWindow{addr, size};
+		*hint = reinterpret_cast<void*>(id);
+		return static_cast<char*>(addr) + delta;
+	}
+
+	static void unmapShmWindow(const ShmWindow& window) {
+		ShmCounterTimer timer(SHMC_DETACH_NS);
+		munmap(window.addr, window.size);
+		addShmCounter(SHMC_DETACHES, 1);
+	}
+
+	// Can be called from any thread
+	void releaseShmWindow(char* /*data*/, void* hint) {
+		ShmWindow window;
+		{
+			std::lock_guard<std::mutex> lock(shmWindowsMutex);
+			auto it = shmWindows.find(reinterpret_cast<uintptr_t>(hint));
+			if (it == shmWindows.end())
+				return; // unmapped by unmapWindow()
+			window = it->second;
+			shmWindows.erase(it);
+		}
+		unmapShmWindow(window);
+	}
+
+	// Find window containing data of view, NULL if view is not window
+	static std::unordered_map<uintptr_t, ShmWindow>::iterator findShmWindow(Local<Value> val) {
+		char* data;
+		size_t length;
+		if (!getBufferData(val, &data, &length))
+			return shmWindows.end();
+		for (auto it = shmWindows.begin(); it != shmWindows.end(); ++it) {
+			char* addr = static_cast<char*>(it->second.addr);
+			if (data >= addr && data + length <= addr + it->second.size)
+				return it;
+		}
+		return shmWindows.end();
+	}
+
+	NAN_METHOD(unmapWindow) {
+		Nan::HandleScope scope;
+		ShmWindow window;
+		{
+			std::lock_guard<std::mutex> lock(shmWindowsMutex);
+			auto it = findShmWindow(info[0]);
+			if (it == shmWindows.end()) {
+				info.GetReturnValue().Set(Nan::False());
+				return;
+			}
+			window = it->second;
+			shmWindows.erase(it);
+		}
+		unmapShmWindow(window);
+		info.GetReturnValue().Set(Nan::True());
+	}
+
+	NAN_METHOD(discardWindow) {
+		Nan::HandleScope scope;
+		std::lock_guard<std::mutex> lock(shmWindowsMutex);
+		auto it = findShmWindow(info[0]);
+		if (it == shmWindows.end()) {
+			info.GetReturnValue().Set(Nan::False());
+			return;
+		}
+		// Pages of shared mapping are dropped only from this process, data stays in object
+		if (madvise(it->second.addr, it->second.size, MADV_DONTNEED) == -1)
+			return Nan::ThrowError(strerror(errno));
+		info.GetReturnValue().Set(Nan::True());
+	}
+
+}
+}
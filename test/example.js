@@ -1,10 +1,33 @@
 const cluster = require('cluster');
 const shm = require('../index.js');
 const assert = require('assert');
+const v8 = require('v8');
+const vm = require('vm');
+const childProcess = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const workerThreads = require('worker_threads');
 
 const key1 = 12345678;
 const unexistingKey = 1234567891;
 const posixKey = '/1234567';
+const queueKey = '/1234567_queue';
+const hugeKey = '/1234567_huge';
+const autoKey = '/1234567_auto';
+const slabKey = '/1234567_slab';
+const hashTableKey = '/1234567_ht';
+const seqlockKey = '/1234567_seqlock';
+const mutexKey = '/1234567_mutex';
+const rwLockKey = '/1234567_rwlock';
+const asyncKey = '/1234567_async';
+const resizeKey = '/1234567_resize';
+const legacyKey = '/1234567_legacy';
+const reapKey = '/1234567_reap';
+const workerKey = '/1234567_worker';
+const futexKey = '/1234567_futex';
+const prefaultKey = '/1234567_prefault';
+const fileKey = path.join(os.tmpdir(), 'node_shm_1234567.shm');
 
 let buf, arr;
 if (cluster.isMaster) {
@@ -25,20 +48,834 @@ if (cluster.isMaster) {
 	assert.equal(shm.getTotalSize(), 0);
 	assert.equal(shm.getTotalCreatedSize(), 0);
 
+	// Attach same segment twice, detach attaches one by one
+	const d = shm.create(10, 'Float32Array', key1);
+	const d2 = shm.get(key1, 'Float32Array');
+	assert.equal(shm.getTotalSize(), 2*10*4);
+	assert.equal(shm.detach(key1), 1);
+	assert.equal(shm.getTotalSize(), 10*4);
+	const d3 = shm.get(key1, 'Float32Array');
+	assert.equal(shm.getTotalSize(), 2*10*4);
+	assert.equal(shm.detach(key1), 1);
+	assert.equal(shm.detach(key1), 0);
+	assert.equal(shm.getTotalSize(), 0);
+	assert.equal(shm.getTotalCreatedSize(), 0);
+
+	// Detach counts attaches of this process, kernel counts its shared mapping once
+	shm.create(10, 'Float32Array', key1);
+	const attachChild = childProcess.spawn(process.execPath, ['-e', `
+		const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+		shm.get(${key1}, 'Float32Array');
+		setTimeout(() => {}, 60000);
+	`], { stdio: 'ignore' });
+	const waitArr = new Int32Array(new SharedArrayBuffer(4));
+	for (let i = 0; i < 1000 && shm.list().find((s) => s.type === 'sysv' && s.key === key1).nattch < 2; i++)
+		Atomics.wait(waitArr, 0, 0, 10);
+	shm.get(key1, 'Float32Array');
+	shm.get(key1, 'Float32Array');
+	assert.equal(shm.list().find((s) => s.type === 'sysv' && s.key === key1).nattch, 2);
+	assert.equal(shm.detach(key1), 3);
+	assert.equal(shm.detach(key1), 2);
+	assert.equal(shm.detach(key1), 1); // attach of child process is left
+	attachChild.kill();
+	assert.equal(shm.destroy(key1), true);
+	assert.equal(shm.getTotalSize(), 0);
+
 	// Assert that getting shm by unexisting key will fail
 	const c = shm.get(unexistingKey, 'Buffer');
 	assert(c === null);
 
+	// Test MPMC queue
+	const queue = shm.createQueue(queueKey, 16, 4);
+	assert.equal(shm.createQueue(queueKey, 16, 4), null);
+	assert(queue.push(Buffer.from('hello')));
+	assert.equal(queue.pushBatch([Buffer.from('a'), Buffer.from('bc'), Buffer.from('d'), Buffer.from('e')]), 3);
+	assert.equal(queue.length, 4);
+	const msg = Buffer.alloc(queue.slotSize);
+	assert.equal(queue.pop(msg), 5);
+	assert.equal(msg.toString('utf8', 0, 5), 'hello');
+	const batch = Buffer.alloc(64);
+	assert.equal(queue.popBatch(batch), 3);
+	assert.equal(batch.readUInt32LE(5), 2);
+	assert.equal(batch.toString('utf8', 9, 11), 'bc');
+	assert.equal(queue.pop(msg), -1);
+	// Header with stride or count of slots not matching object is rejected
+	const queueRaw = shm.get(queueKey, 'Buffer');
+	const queueStride = queueRaw.readBigUInt64LE(16);
+	queueRaw.writeBigUInt64LE(queueStride * 1024n, 16);
+	assert.throws(() => shm.openQueue(queueKey), /does not contain a queue/);
+	queueRaw.writeBigUInt64LE(queueStride, 16);
+	queueRaw.writeUInt32LE(1 << 30, 12);
+	assert.throws(() => shm.openQueue(queueKey), /does not contain a queue/);
+	queueRaw.writeUInt32LE(4, 12);
+	// Length of message larger than slot is rejected (5th message is in first slot, its length is at offset 200)
+	assert(queue.push(Buffer.from('x')));
+	queueRaw.writeUInt32LE(1 << 20, 200);
+	assert.throws(() => queue.pop(Buffer.alloc(1 << 21)), /does not contain a queue/);
+	const queue2 = shm.openQueue(queueKey);
+	assert.equal(queue2.slotSize, 16);
+	assert.equal(queue2.detach(), 1);
+	assert.equal(shm.detach(queueKey), 1);
+	assert.equal(queue.detach(true), 0);
+
+	// Test slab allocator
+	const slab = shm.createSlab(slabKey, 4 * 1024, { slabSize: 1024 });
+	assert.equal(slab.slabCount, 4);
+	assert.equal(slab.maxSize, 1024);
+	const off1 = slab.alloc(10);
+	const off2 = slab.alloc(16);
+	const off3 = slab.alloc(1000);
+	assert.equal(slab.usedSlabs, 2);
+	assert.equal(off2 - off1, 16);
+	assert.equal(slab.view(off1).length, 16);
+	assert.equal(slab.view(off3, 'Float64Array').length, 128);
+	slab.view(off2, 'Uint32Array', 2)[1] = 123;
+	const slab2 = shm.openSlab(slabKey);
+	assert.equal(slab2.view(off2, 'Uint32Array')[1], 123);
+	slab2.free(off2);
+	assert.equal(slab.alloc(5), off2);
+	assert.throws(() => slab.free(off1 + 1), RangeError);
+	assert.throws(() => slab.alloc(1025), RangeError);
+	assert.notEqual(slab.alloc(1000), null);
+	assert.notEqual(slab.alloc(1000), null);
+	assert.equal(slab.alloc(1000), null); // out of memory
+	assert.equal(slab.recover(), 0);
+	// Slab claimed by pid of other PID namespace isn't recovered
+	const slabState = 2176 + 3 * 4; // after header: slab states, then identities of claimers
+	const slabOwner = 2192 + 3 * 16;
+	const activeState = slab.buffer.readUInt32LE(slabState);
+	const slabDeadPid = childProcess.spawnSync(process.execPath, ['-e', '']).pid;
+	slab.buffer.writeUInt32LE(slabDeadPid * 32 + (activeState & 0x1f), slabState);
+	slab.buffer.writeUInt32LE(slabDeadPid, slabOwner);
+	slab.buffer.writeUInt32LE(slab.buffer.readUInt32LE(slabOwner + 4) + 1, slabOwner + 4);
+	assert.equal(slab.recover(), 0);
+	slab.buffer.writeUInt32LE(slab.buffer.readUInt32LE(slabOwner + 4) - 1, slabOwner + 4);
+	assert.equal(slab.recover(), 1);
+	slab.buffer.writeUInt32LE(activeState, slabState);
+	assert.equal(slab2.detach(), 1);
+	assert.equal(slab.detach(true), 0);
+
+	// Test hash table
+	const ht = shm.createHashTable(hashTableKey, 10, 8, 16);
+	assert.equal(ht.capacity, 16);
+	assert(ht.put(1, new Float64Array([1.5, 2.5])));
+	assert(ht.put(2n, new Float64Array([3.5, 4.5])));
+	assert(ht.put(Buffer.from(new BigUint64Array([3n]).buffer), Buffer.alloc(16, 7)));
+	assert.equal(ht.size, 3);
+	const htValue = new Float64Array(2);
+	assert(ht.get(2, htValue));
+	assert.deepEqual(Array.from(htValue), [3.5, 4.5]);
+	assert.equal(ht.get(3n)[15], 7);
+	assert.equal(ht.get(4), null);
+	assert(ht.put(1, new Float64Array([5.5, 6.5])));
+	assert.equal(ht.size, 3);
+	const ht2 = shm.openHashTable(hashTableKey);
+	assert.equal(new Float64Array(ht2.buffer.buffer, ht2.buffer.byteOffset + ht2.offsetOf(1), 2)[1], 6.5);
+	const htValues = new Float64Array(6);
+	const htFound = new Uint8Array(3);
+	assert.equal(ht2.getMany(new BigUint64Array([1n, 4n, 2n]), htValues, htFound), 2);
+	assert.deepEqual(Array.from(htFound), [1, 0, 1]);
+	assert.deepEqual(Array.from(htValues.subarray(4)), [3.5, 4.5]);
+	assert(ht2.delete(1));
+	assert(!ht2.delete(1));
+	assert.equal(ht.offsetOf(1), -1);
+	assert.equal(ht.size, 2);
+	for (let i = 10; i < 23; i++)
+		assert(ht.put(i, htValue));
+	assert(ht.put(1, htValue)); // reuses deleted bucket
+	assert(!ht.put(100, htValue)); // full
+	assert.throws(() => ht.put(Buffer.alloc(4), htValue), RangeError);
+	// Churn of distinct keys reuses tombstones, also when no bucket is empty
+	for (let i = 10; i < 23; i++)
+		assert(ht.delete(i));
+	for (let i = 1000; i < 3000; i++) {
+		assert(ht.put(i, htValue), 'put of key ' + i);
+		assert(ht.delete(i));
+	}
+	assert.equal(ht.size, 3);
+	// Bucket locked by writer which died is taken over, its key is deleted
+	const htDeadPid = Number(childProcess.execFileSync(process.execPath, ['-e', 'process.stdout.write(String(process.pid))']));
+	const htBucket = ht.offsetOf(2) - 32 - 8; // seq, tag, lock word, reserved, owner identity, key
+	ht.buffer.writeUInt32LE(ht.buffer.readUInt32LE(htBucket) + 1, htBucket);
+	ht.buffer.writeUInt32LE(htDeadPid, htBucket + 8);
+	assert.equal(ht.get(2), null);
+	assert.equal(ht.size, 2);
+	assert(ht.put(2, htValue));
+	assert.equal(ht.size, 3);
+	// Writer is identified by start time (identity of last writer is left after pid at offset 16 of bucket),
+	//  so live process which reused pid of writer doesn't keep bucket locked
+	const htSleeper = childProcess.spawn(process.execPath, ['-e', 'setTimeout(() => {}, 60000)']);
+	ht.buffer.writeUInt32LE(ht.buffer.readUInt32LE(htBucket) + 1, htBucket);
+	ht.buffer.writeUInt32LE(htSleeper.pid, htBucket + 8);
+	ht.buffer.writeUInt32LE(htSleeper.pid, htBucket + 16);
+	assert.equal(ht.get(2), null);
+	htSleeper.kill();
+	assert(ht.put(2, htValue));
+	assert.equal(ht2.detach(), 1);
+	assert.equal(ht.detach(true), 0);
+
+	// Test seqlock region
+	const seqlock = shm.createSeqlock(seqlockKey, 4096);
+	const seqlock2 = shm.openSeqlock(seqlockKey);
+	const snapshot = new Float64Array(512);
+	assert.equal(seqlock2.read(snapshot), 0);
+	assert.equal(seqlock.publish(new Float64Array(512).fill(1.25)), 1);
+	assert.equal(seqlock.publish(new Float64Array(512).fill(2.5)), 2);
+	assert.equal(seqlock2.read(snapshot), 2);
+	assert(snapshot.every((v) => v === 2.5));
+	assert.equal(seqlock2.version, 2);
+	assert.throws(() => seqlock.publish(new Float64Array(513)), RangeError);
+	// Writer which died during publish leaves sequence (offset 64) odd and its pid in lock word (offset 72)
+	const deadWriter = childProcess.spawnSync(process.execPath, ['-e', '']).pid;
+	seqlock.buffer.writeBigUInt64LE(seqlock.buffer.readBigUInt64LE(64) + 1n, 64);
+	seqlock.buffer.writeUInt32LE(deadWriter, 72);
+	assert.throws(() => seqlock2.read(snapshot), /Writer of seqlock region died/);
+	assert.equal(seqlock.publish(new Float64Array(512).fill(5)), 3);
+	assert.equal(seqlock2.read(snapshot), 3);
+	assert.equal(snapshot[511], 5);
+	assert.equal(seqlock.buffer.readUInt32LE(72), 0);
+	assert.equal(seqlock2.detach(), 1);
+	assert.equal(seqlock.detach(true), 0);
+
+	// Test resize of POSIX object and remap in other process
+	let resizable = shm.create(10, 'Float64Array', resizeKey);
+	resizable[9] = 1.5;
+	assert.equal(shm.refresh(resizeKey, 'Float64Array'), null);
+	resizable = shm.resize(resizeKey, 100000, 'Float64Array');
+	assert.equal(resizable.length, 100000);
+	assert.equal(resizable[9], 1.5);
+	assert.equal(shm.getTotalSize(), 100000*8+64);
+	childProcess.execFileSync(process.execPath, ['-e', `
+		const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+		shm.get('${resizeKey}');
+		const arr = shm.resize('${resizeKey}', 200, 'Float64Array', { chunked: true, chunkLength: 64 });
+		arr.set(199, 2.5);
+	`]);
+	resizable = shm.refresh(resizeKey, 'Float64Array');
+	assert.equal(resizable.length, 200);
+	assert.equal(resizable[199], 2.5);
+	assert.equal(shm.refresh(resizeKey, 'Float64Array'), null);
+	assert.equal(shm.destroy(resizeKey), true);
+	assert.equal(shm.getTotalSize(), 0);
+
+	// Test header of POSIX object: stored type, cache line aligned data
+	const typed = shm.create(100, 'Float32Array', resizeKey);
+	typed[99] = 0.5;
+	const typedInfo = shm.objectInfo(resizeKey);
+	assert.equal(typedInfo.typeKey, 'Float32Array');
+	assert.equal(typedInfo.count, 100);
+	assert.equal(typedInfo.layoutVersion, 1);
+	assert.equal(typedInfo.dataOffset, 64);
+	assert(typedInfo.createdAt instanceof Date);
+	const typedGet = shm.get(resizeKey);
+	assert(typedGet instanceof Float32Array);
+	assert.equal(typedGet[99], 0.5);
+	assert(shm.get(resizeKey, 'Buffer') instanceof Buffer);
+	assert.throws(() => shm.get(resizeKey, 'Int32Array'), TypeError);
+	assert.equal(shm.detach(resizeKey), 1);
+	assert.equal(shm.detach(resizeKey), 1);
+	assert.equal(shm.resize(resizeKey, 200).length, 200);
+	assert.equal(shm.objectInfo(resizeKey).count, 200);
+	assert.equal(shm.destroy(resizeKey), true);
+	// Creator was detached before, but created size is released on destroy
+	assert.equal(shm.getTotalCreatedSize(), 0);
+	// Objects created by older versions have only size before data
+	if (fs.existsSync('/dev/shm')) {
+		const legacy = Buffer.alloc(8 + 16);
+		legacy.writeBigUInt64LE(16n, 0);
+		legacy.writeDoubleLE(1.25, 8 + 8);
+		fs.writeFileSync('/dev' + '/shm' + legacyKey, legacy);
+		const legacyArr = shm.get(legacyKey, 'Float64Array');
+		assert.equal(legacyArr.length, 2);
+		assert.equal(legacyArr[1], 1.25);
+		assert.equal(shm.objectInfo(legacyKey).layoutVersion, 0);
+		assert.equal(shm.objectInfo(legacyKey).dataOffset, 8);
+		// Resize keeps plain size in legacy size word, as older versions read it
+		const legacyResized = shm.resize(legacyKey, 4, 'Float64Array');
+		assert.equal(legacyResized.length, 4);
+		assert.equal(legacyResized[1], 1.25);
+		const legacyFile = fs.readFileSync('/dev' + '/shm' + legacyKey);
+		assert.equal(legacyFile.length, 8 + 32);
+		assert.equal(legacyFile.readBigUInt64LE(0), 32n);
+		childProcess.execFileSync(process.execPath, ['-e', `
+			const assert = require('assert');
+			const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+			const arr = shm.get('${legacyKey}', 'Float64Array');
+			assert.equal(arr.length, 4);
+			assert.equal(arr[1], 1.25);
+			assert.equal(shm.objectInfo('${legacyKey}').layoutVersion, 0);
+		`]);
+		assert.equal(shm.destroy(legacyKey), true);
+		// Attach fails if size in header (at offset 16) exceeds size of object
+		shm.create(4, 'Float64Array', legacyKey);
+		assert.equal(shm.detach(legacyKey), 1);
+		const corruptFd = fs.openSync('/dev' + '/shm' + legacyKey, 'r+');
+		const corruptSize = Buffer.alloc(8);
+		corruptSize.writeBigUInt64LE(1n << 20n);
+		fs.writeSync(corruptFd, corruptSize, 0, 8, 16);
+		fs.closeSync(corruptFd);
+		assert.throws(() => shm.get(legacyKey, 'Float64Array'), /truncated/);
+		fs.writeFileSync('/dev' + '/shm' + legacyKey, Buffer.alloc(4));
+		assert.throws(() => shm.get(legacyKey), /truncated/);
+		assert.equal(shm.destroy(legacyKey), true);
+	}
+	assert.equal(shm.getTotalSize(), 0);
+
+	// Test windows: page-aligned mappings of parts of POSIX object, they are not attaches
+	const windowed = shm.create(300000, 'Float64Array', resizeKey);
+	windowed.forEach((_v, i) => windowed[i] = i);
+	assert.equal(shm.detach(resizeKey), 1);
+	const win = shm.mapWindow(resizeKey, 1000, 5000);
+	assert(win instanceof Float64Array);
+	assert.equal(win.length, 5000);
+	assert.equal(win.objectLength, 300000);
+	assert.equal(win[0], 1000);
+	win[1] = -1;
+	assert.equal(shm.mapWindow(resizeKey, 1001, 1, 'Float64Array', { populate: true })[0], -1);
+	assert.equal(shm.mapWindow(resizeKey, 8 * 1000, 8, 'Buffer').readDoubleLE(0), 1000);
+	const winTail = shm.mapWindow(resizeKey, 299990, 100, undefined, { willNeed: true });
+	assert.equal(winTail.length, 10);
+	assert.equal(winTail[9], 299999);
+	assert.throws(() => shm.mapWindow(resizeKey, 300000, 1), RangeError);
+	assert.throws(() => shm.mapWindow(resizeKey, 0, 1, 'Int32Array'), TypeError);
+	assert.equal(shm.mapWindow(legacyKey, 0, 1), null);
+	assert.equal(shm.getTotalSize(), 0);
+	assert.equal(shm.discardWindow(win), true);
+	assert.equal(win[0], 1000);
+	assert.equal(shm.unmapWindow(win), true);
+	assert.equal(shm.unmapWindow(win), false);
+	assert.equal(shm.discardWindow(new Float64Array(10)), false);
+	let windowsNext = 0;
+	for (const { offset, array } of shm.windows(resizeKey, { windowLength: 70000 })) {
+		assert.equal(offset, windowsNext);
+		assert.equal(array[0], offset);
+		windowsNext += array.length;
+	}
+	assert.equal(windowsNext, 300000);
+	const windowsLengths = [];
+	for (const { offset, array } of shm.windows(resizeKey, { offset: 10, length: 20, windowLength: 8 })) {
+		assert.equal(array[0], offset);
+		windowsLengths.push(array.length);
+	}
+	assert.deepEqual(windowsLengths, [8, 8, 4]);
+	for (const { array } of shm.windows(resizeKey, { windowLength: 100 })) {
+		assert.equal(array.length, 100);
+		break;
+	}
+	assert.deepEqual([...shm.windows(legacyKey)], []);
+	assert.equal(shm.destroy(resizeKey), true);
+
+	// Test robust mutex and reader-writer lock
+	const mutex = shm.createMutex(mutexKey);
+	const mutex2 = shm.openMutex(mutexKey);
+	assert.equal(mutex.tryLock(), 'ok');
+	assert.equal(mutex.owner, process.pid);
+	assert.equal(mutex2.tryLock(), 'busy');
+	mutex2.unlock();
+	assert.equal(mutex.owner, 0);
+	assert.throws(() => mutex.unlock(), /not held/);
+	const rwLock = shm.createRwLock(rwLockKey, 4);
+	assert.equal(rwLock.maxReaders, 4);
+	assert.equal(rwLock.tryReadLock(), 'ok');
+	assert.equal(rwLock.tryReadLock(), 'ok');
+	assert.equal(rwLock.readers, 2);
+	assert.equal(rwLock.tryWriteLock(), 'busy');
+	rwLock.readUnlock();
+	rwLock.readUnlock();
+	assert.equal(rwLock.tryWriteLock(), 'ok');
+	assert.equal(rwLock.tryReadLock(), 'busy');
+	rwLock.writeUnlock();
+	// Locks of dead process are taken over
+	childProcess.execFileSync(process.execPath, ['-e', `
+		const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+		shm.openMutex('${mutexKey}').tryLock();
+		shm.openRwLock('${rwLockKey}').tryWriteLock();
+	`]);
+	assert.notEqual(mutex.owner, 0);
+	assert.equal(mutex.tryLock(), 'owner-died');
+	mutex.unlock();
+	assert.equal(rwLock.tryReadLock(), 'owner-died');
+	rwLock.readUnlock();
+	// Owner is identified by pid, PID namespace and start time (recorded at offset 72 of mutex)
+	assert.equal(mutex.tryLock(), 'ok');
+	const mutexIdentity = Buffer.from(mutex.buffer.subarray(72, 88));
+	mutex.unlock();
+	const lockSleeper = childProcess.spawn(process.execPath, ['-e', 'setTimeout(() => {}, 60000)']);
+	const forgeMutexOwner = (pid, idPid, nsDelta) => {
+		mutexIdentity.copy(mutex.buffer, 72);
+		mutex.buffer.writeUInt32LE(idPid, 72);
+		mutex.buffer.writeUInt32LE(mutex.buffer.readUInt32LE(76) + nsDelta, 76);
+		mutex.buffer.writeUInt32LE(pid, 64);
+	};
+	// Live process with other start time reused pid of owner
+	forgeMutexOwner(lockSleeper.pid, lockSleeper.pid, 0);
+	assert.equal(mutex.tryLock(), 'owner-died');
+	mutex.unlock();
+	// Without identity only kill() is checked
+	forgeMutexOwner(lockSleeper.pid, 0, 0);
+	assert.equal(mutex.tryLock(), 'busy');
+	// Pid of other PID namespace can't be checked, lock is not taken over
+	const deadPid = childProcess.spawnSync(process.execPath, ['-e', '']).pid;
+	forgeMutexOwner(deadPid, deadPid, 1);
+	assert.equal(mutex.tryLock(), 'busy');
+	forgeMutexOwner(deadPid, deadPid, 0);
+	assert.equal(mutex.tryLock(), 'owner-died');
+	mutex.unlock();
+	lockSleeper.kill();
+	assert.throws(() => shm.openMutex(rwLockKey), /does not contain a mutex/);
+	// Mapping is pinned while lock is waited, so it can be detached meanwhile
+	assert.equal(mutex.tryLock(), 'ok');
+	const detachedWait = mutex2.lock(200);
+	assert.equal(mutex2.detach(), 1);
+	assert.equal(mutex.detach(true), 0);
+	detachedWait.then((res) => assert.equal(res, 'timed-out'));
+	assert.equal(rwLock.detach(true), 0);
+
+	// Test discovery and reaping of objects left by dead process
+	childProcess.execFileSync(process.execPath, ['-e', `
+		const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+		shm.create(10, 'Float64Array', '${reapKey}');
+	`]);
+	const reapable = shm.create(10, 'Float64Array', reapKey + '_live');
+	const listed = shm.list().filter((entry) => entry.type === 'posix' && entry.name.startsWith(reapKey));
+	assert.equal(listed.length, 2);
+	const orphan = listed.find((entry) => entry.name === reapKey);
+	assert.equal(orphan.size, 10*8);
+	assert.equal(orphan.lease, true);
+	assert.equal(orphan.ownerAlive, false);
+	assert.equal(orphan.attached, false);
+	assert(listed.find((entry) => entry.name === reapKey + '_live').attached);
+	// Lease (pid at offset 48, PID namespace at 52, heartbeat at 56) of owner from other namespace is not checked
+	const reapFd = fs.openSync('/dev' + '/shm' + reapKey, 'r+');
+	const reapLease = Buffer.alloc(16);
+	fs.readSync(reapFd, reapLease, 0, 16, 48);
+	const reapLeaseForeign = Buffer.from(reapLease);
+	reapLeaseForeign.writeUInt32LE(reapLease.readUInt32LE(4) + 1, 4);
+	fs.writeSync(reapFd, reapLeaseForeign, 0, 16, 48);
+	assert.equal(shm.list().find((entry) => entry.name === reapKey).ownerAlive, null);
+	assert.equal(shm.reap({ prefix: reapKey, dryRun: true }).length, 0);
+	// Process started after last heartbeat reused pid of owner
+	const reapSleeper = childProcess.spawn(process.execPath, ['-e', 'setTimeout(() => {}, 60000)']);
+	const reapLeaseReused = Buffer.from(reapLease);
+	reapLeaseReused.writeInt32LE(reapSleeper.pid, 0);
+	reapLeaseReused.writeBigInt64LE(BigInt(Date.now() - 60000), 8);
+	fs.writeSync(reapFd, reapLeaseReused, 0, 16, 48);
+	assert.equal(shm.list().find((entry) => entry.name === reapKey).ownerAlive, false);
+	reapLeaseReused.writeBigInt64LE(BigInt(Date.now() + 60000), 8);
+	fs.writeSync(reapFd, reapLeaseReused, 0, 16, 48);
+	assert.equal(shm.list().find((entry) => entry.name === reapKey).ownerAlive, true);
+	reapSleeper.kill();
+	fs.writeSync(reapFd, reapLease, 0, 16, 48);
+	fs.closeSync(reapFd);
+	// System V segments are reaped only on request
+	assert(shm.reap({ dryRun: true }).every((entry) => entry.type === 'posix'));
+	assert.equal(shm.reap({ prefix: reapKey, olderThan: 3600*1000 }).length, 0);
+	assert.deepEqual(shm.reap({ prefix: reapKey, dryRun: true }).map((entry) => entry.name), [reapKey]);
+	assert.deepEqual(shm.reap({ prefix: reapKey }).map((entry) => entry.name), [reapKey]);
+	assert.equal(shm.get(reapKey), null);
+	assert.equal(shm.heartbeat(reapKey + '_live'), 1);
+	assert(shm.heartbeat() >= 1);
+	assert.equal(shm.destroy(reapKey + '_live'), true);
+
+	// Test 64-bit integer types
+	const bigArr = shm.create(10, 'BigInt64Array', hugeKey);
+	assert(bigArr instanceof BigInt64Array);
+	bigArr[9] = -(1n << 62n);
+	assert.equal(bigArr[9], -(1n << 62n));
+	assert.equal(bigArr.byteLength, 10*8);
+	assert.equal(shm.destroy(hugeKey), true);
+	const bigUArr = shm.create(10, 'BigUint64Array');
+	assert(bigUArr instanceof BigUint64Array);
+	bigUArr[9] = (1n << 64n) - 1n;
+	assert.equal(bigUArr[9], (1n << 64n) - 1n);
+	assert.equal(shm.destroy(bigUArr.key), true);
+
+	// Test chunked array
+	const chunked = shm.create(10, 'Float64Array', hugeKey, '660', { chunked: true, chunkLength: 4 });
+	assert(chunked instanceof shm.ChunkedArray);
+	assert.deepEqual(chunked.chunks.map((chunk) => chunk.length), [4, 4, 2]);
+	assert.equal(chunked.length, 10);
+	assert.equal(chunked.byteLength, 10*8);
+	chunked.set(9, 1.5);
+	assert.equal(chunked.get(9), 1.5);
+	assert.equal(chunked.chunkFor(9)[9 % chunked.chunkLength], 1.5);
+	assert.equal(chunked.chunks[2][1], 1.5);
+	assert.equal(shm.destroy(hugeKey), true);
+	assert.throws(() => shm.create(shm.LengthMax + 1, 'Buffer', hugeKey), RangeError);
+
+	// Test huge pages (falls back to transparent huge pages if not available)
+	const hugeArr = shm.create(1000, 'Float64Array', hugeKey, '660', { hugePages: 'auto' });
+	assert.equal(hugeArr.length, 1000);
+	const hugeInfo = shm.pageInfo(hugeKey);
+	assert(hugeInfo.pageSize >= 4096);
+	assert.equal(typeof hugeInfo.hugetlb, 'boolean');
+	assert.equal(shm.destroy(hugeKey), true);
+	assert.equal(shm.pageInfo(hugeKey), null);
+	assert.throws(() => shm.create(1000, 'Float64Array', hugeKey, '660', { hugePages: '4KB' }));
+
+	// Test NUMA placement (single node on most hosts, policy is ignored without kernel support)
+	const numaArr = shm.create(4096, 'Float64Array', hugeKey, '660', { numa: 'interleave' });
+	numaArr.fill(1);
+	const numaInfo = shm.numaInfo(hugeKey);
+	assert(numaInfo.nodes.length >= 1);
+	if (numaInfo.policy !== null) {
+		assert.equal(numaInfo.policy, 'interleave');
+		assert.deepEqual(numaInfo.policyNodes, numaInfo.nodes);
+	}
+	if (numaInfo.residentPages !== null) {
+		const numaPages = Object.keys(numaInfo.residentPages).reduce((sum, node) => sum + numaInfo.residentPages[node], 0);
+		assert(numaPages * numaInfo.pageSize >= numaArr.byteLength);
+	}
+	assert.equal(shm.destroy(hugeKey), true);
+	assert.equal(shm.numaInfo(hugeKey), null);
+	assert.throws(() => shm.create(10, 'Buffer', hugeKey, '660', { numa: { bind: [numaInfo.nodes.length + 1024] } }), RangeError);
+	assert.throws(() => shm.create(10, 'Buffer', hugeKey, '660', { numa: 'nearest' }));
+
+	// Test bulk operations (on every supported instruction set, with parts split between threads)
+	const opsConfig = shm.ops.configure();
+	const opsArr = shm.create(1 << 20, 'Float64Array', hugeKey);
+	for (let i = 0; i < opsArr.length; i++)
+		opsArr[i] = (i * 7919) % 1000 - 500;
+	opsArr[12345] = NaN;
+	opsArr[777777] = 600;
+	let opsSum = 0;
+	for (let i = 0; i < opsArr.length; i++)
+		opsSum += opsArr[i] === opsArr[i] ? opsArr[i] * 2 : 0;
+	const opsBig = new BigInt64Array(1 << 20).fill(3n);
+	opsBig[5] = 2n ** 63n - 1n;
+	opsBig[900000] = -(2n ** 63n);
+	opsBig[100] = 2n ** 62n; // same double as next one
+	opsBig[600000] = 2n ** 62n + 1n;
+	const opsPositive = new Float64Array(1 << 20).fill(5);
+	for (const isa of opsConfig.supportedIsa) {
+		shm.ops.configure({ isa: isa, threads: 4 });
+		assert.equal(shm.ops.max(opsArr), 600);
+		assert.equal(shm.ops.min(opsArr), -500);
+		assert.equal(shm.ops.argmax(opsArr), 777777);
+		assert.equal(shm.ops.argmax(opsArr, 777778), 778321);
+		assert.equal(shm.ops.min(opsArr, 10, 10), Infinity);
+		assert.equal(shm.ops.sum(opsArr, 0, 12345), opsArr.subarray(0, 12345).reduce((a, b) => a + b, 0));
+		const ints = new Int8Array([100, -100, 7, 3]);
+		assert.equal(shm.ops.sum(ints), 10);
+		assert.equal(shm.ops.dot(ints, ints), 20058);
+		assert.deepEqual(Array.from(shm.ops.scale(ints.slice(), 1.5)), [-106, 106, 10, 4]);
+		assert.deepEqual(Array.from(shm.ops.scale(new Uint8ClampedArray([100, 3]), 2.5)), [250, 8]);
+		assert.equal(shm.ops.min(opsPositive), 5);
+		assert.equal(shm.ops.max(opsPositive.map((v) => -v)), -5);
+		assert.equal(shm.ops.min(opsBig), -(2n ** 63n));
+		assert.equal(shm.ops.max(opsBig), 2n ** 63n - 1n);
+		assert.equal(shm.ops.max(opsBig, 10, 10), -Infinity);
+		assert.equal(shm.ops.argmax(opsBig), 5);
+		assert.equal(shm.ops.argmax(opsBig, 6), 600000);
+		assert.equal(shm.ops.sum(opsBig), BigInt.asIntN(64, 3n * BigInt(opsBig.length - 4) + 2n ** 63n));
+		const bigU = new BigUint64Array([2n ** 64n - 1n, 2n, 3n]);
+		assert.equal(shm.ops.sum(bigU), 4n);
+		assert.equal(shm.ops.dot(bigU, bigU), 14n);
+		assert.deepEqual(Array.from(shm.ops.scale(bigU.slice(), 2n ** 63n)), [2n ** 63n, 0n, 2n ** 63n]);
+		assert.deepEqual(Array.from(shm.ops.fill(new BigInt64Array(2), -1n)), [-1n, -1n]);
+		assert.throws(() => shm.ops.fill(new BigInt64Array(2), 1), TypeError);
+	}
+	shm.ops.configure({ isa: 'auto', threads: opsConfig.threads });
+	shm.ops.scale(opsArr, 2);
+	shm.ops.fill(opsArr, 0, 12345, 12346);
+	assert.equal(shm.ops.sum(opsArr), opsSum);
+	const opsChunks = shm.get(hugeKey, 'Float64Array', { chunked: true, chunkLength: 100000 });
+	assert.equal(shm.ops.argmax(opsChunks), 777777);
+	assert.equal(shm.ops.dot(opsChunks, opsChunks, 5, 7), opsArr[5] * opsArr[5] + opsArr[6] * opsArr[6]);
+	assert.throws(() => shm.ops.sum(opsArr, 0, opsArr.length + 1), RangeError);
+	assert.throws(() => shm.ops.dot(opsArr, new Float32Array(10)), TypeError);
+	assert.throws(() => shm.ops.configure({ isa: 'mmx' }), RangeError);
+	// On copy, array is changed by tests of copy below
+	shm.ops.sumAsync(opsArr.slice()).then((res) => assert.equal(res, opsSum));
+	shm.ops.sumAsync(new BigInt64Array([1n, 2n ** 63n - 1n])).then((res) => assert.equal(res, -(2n ** 63n)));
+
+	// Test bulk copy (8MB, so non-temporal stores are used)
+	const copySrc = new Float64Array(opsArr.length - 3).map((_v, i) => i);
+	assert.equal(shm.copyIn(opsArr, 3, copySrc), copySrc.byteLength);
+	assert.equal(opsArr[3 + 777777], 777777);
+	const copyDst = Buffer.alloc(copySrc.byteLength + 1);
+	assert.equal(shm.copyOut(opsChunks, 3, copyDst.subarray(1)), copySrc.byteLength);
+	assert(copyDst.subarray(1).equals(Buffer.from(copySrc.buffer)));
+	assert.equal(shm.copyIn(opsChunks, 99999, new Float64Array([1, 2]).buffer), 16);
+	assert.equal(opsArr[100000], 2);
+	assert.throws(() => shm.copyIn(opsArr, 4, copySrc), RangeError);
+	shm.copyOutAsync(opsArr.slice(0, 10), 3, new Float64Array(2)).then((res) => assert.equal(res, 16));
+	shm.detach(hugeKey);
+	assert.equal(shm.destroy(hugeKey), true);
+	// Async operations pin mapping, so array can be detached meanwhile
+	const opsPinned = shm.create(1 << 20, 'Float64Array', hugeKey).fill(1);
+	const opsPinnedSum = shm.ops.sumAsync(opsPinned);
+	assert.equal(shm.detach(hugeKey, true), 0);
+	opsPinnedSum.then((res) => assert.equal(res, 1 << 20));
+	// Both sides of async copy are pinned
+	const copyPinnedDst = shm.create(1 << 20, 'Float64Array', hugeKey);
+	const copyPinnedSrc = shm.createAnonymous(1 << 20, 'Float64Array').fill(2);
+	const copyPinned = shm.copyInAsync(copyPinnedDst, 0, copyPinnedSrc);
+	assert.equal(shm.detach(hugeKey, true), 0);
+	assert.equal(shm.detachAnonymous(copyPinnedSrc), 0);
+	copyPinned.then((res) => assert.equal(res, 8 << 20));
+
+	// Test anonymous shared memory passed to child process over Unix domain socket
+	const anon = shm.createAnonymous(1000, 'Float64Array');
+	assert(anon instanceof Float64Array && anon.fd > 2);
+	assert.equal(shm.getTotalSize(), 1000*8+64);
+	assert.deepEqual(shm.getSeals(anon), []);
+	anon.fill(1.5);
+	assert.deepEqual(shm.seal(anon.fd), ['seal', 'shrink', 'grow', 'write']);
+	assert.equal(anon[999], 1.5);
+	anon[0] = 2; // copy-on-write after seal, not seen by child
+	assert.throws(() => shm.seal(anon, ['grow']), Error);
+	const anonChunks = shm.createAnonymous(100, 'Int32Array', { chunked: true, chunkLength: 30 });
+	assert(anonChunks instanceof shm.ChunkedArray && anonChunks.fd > 2);
+	assert.deepEqual(shm.seal(anonChunks, ['grow', 'shrink']), ['shrink', 'grow']);
+	assert.equal(shm.detachAnonymous(anonChunks), 0);
+	// All attaches of same memfd (by other fd too) are remapped before write seal
+	const anonSealed = shm.createAnonymous(10, 'Float64Array');
+	const anonSealed2 = shm.getAnonymous(fs.openSync('/proc/self/fd/' + anonSealed.fd, 'r+'));
+	anonSealed[0] = 4;
+	assert.equal(anonSealed2[0], 4);
+	assert.deepEqual(shm.seal(anonSealed, ['write']), ['write']);
+	assert.equal(anonSealed2[0], 4);
+	anonSealed2[0] = 5; // copy-on-write
+	assert.equal(anonSealed[0], 4);
+	assert.equal(shm.detachAnonymous(anonSealed2), 0);
+	assert.equal(shm.detachAnonymous(anonSealed), 0);
+	const anonChild = childProcess.spawn(process.execPath, ['-e', `
+		const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+		shm.recvFd(3, 5000).then(function(fd) {
+			const arr = shm.getAnonymous(fd);
+			arr[1] = 3;
+			const ok = arr instanceof Float64Array && arr.length === 1000 && arr[0] === 1.5
+				&& arr[999] === 1.5 && shm.getSeals(fd).indexOf('write') !== -1;
+			shm.detachAnonymous(fd);
+			process.exit(ok ? 0 : 1);
+		}, () => process.exit(2));
+	`], { stdio: ['ignore', 'inherit', 'inherit', 'pipe'] });
+	shm.sendFd(anonChild.stdio[3], anon);
+	assert.equal(shm.detachAnonymous(anon.fd), 0);
+	assert.equal(shm.detachAnonymous(anon.fd), -1);
+	anonChild.on('exit', function(code) {
+		assert.equal(code, 0);
+		anonChild.stdio[3].destroy();
+	});
+	// Send doesn't wait when socket buffer is full, and doesn't overtake pending writes
+	const fdSink = childProcess.spawn(process.execPath, ['-e', 'setTimeout(() => {}, 60000)'],
+		{ stdio: ['ignore', 'ignore', 'ignore', 'pipe'] });
+	const fdSinkAnon = shm.createAnonymous(1);
+	let fdSinkSent = 0;
+	assert.throws(() => {
+		for (; fdSinkSent < 100000; fdSinkSent++)
+			shm.sendFd(fdSink.stdio[3], fdSinkAnon);
+	}, /temporarily unavailable|Too many references/);
+	assert(fdSinkSent > 0);
+	fdSink.stdio[3].write('x');
+	assert.throws(() => shm.sendFd(fdSink.stdio[3], fdSinkAnon), /pending writes/);
+	fdSink.stdio[3].destroy();
+	fdSink.kill();
+	assert.equal(shm.detachAnonymous(fdSinkAnon), 0);
+	assert.rejects(shm.recvFd(-1), TypeError);
+
+	// Test shared memory backed by file, reopened like after restart
+	const fileArr = shm.createFile(fileKey, 1000, 'Float64Array');
+	assert(fileArr instanceof Float64Array);
+	assert.equal(shm.getTotalSize(), 1000*8+64);
+	assert.equal(shm.createFile(fileKey, 1000, 'Float64Array'), null);
+	fileArr[999] = 2.5;
+	const fileArr2 = shm.openFile(fileKey);
+	assert(fileArr2 instanceof Float64Array && fileArr2.length === 1000 && fileArr2[999] === 2.5);
+	assert.throws(() => shm.openFile(fileKey, 'Int32Array'), TypeError);
+	assert.equal(shm.mapWindow(fileKey, 998, 10, undefined, { file: true })[1], 2.5);
+	assert.throws(() => shm.markDirty(new Float64Array(10)), Error);
+	assert.equal(shm.closeFile(fileKey), 1);
+	assert.equal(shm.closeFile(fileKey, true), 0);
+	assert.equal(shm.openFile(fileKey), null);
+	assert.throws(() => shm.createFile(path.join(fileKey, 'missing', 'dir'), 10), Error);
+	assert.equal(shm.getTotalSize(), 0);
+
+	// Test futex wait/notify
+	const futexArr = new Int32Array(1);
+	assert.equal(shm.notify(futexArr, 0), 0);
+	shm.wait(futexArr, 0, 1).then((res) => assert.equal(res, 'not-equal'));
+	shm.wait(futexArr, 0, 0, 10).then((res) => assert.equal(res, 'timed-out'));
+
 	// Test using shm between 2 node processes
 	buf = shm.create(4096); //4KB, SYSV
 	assert.equal(shm.getTotalSize(), 4096);
 	arr = shm.create(10000, 'Float32Array', posixKey); //1M floats, POSIX
-	assert.equal(shm.getTotalSize(), 4096 + 10000*4+8); // extra 8 bytes for size of POSIX buffer (for 64bit system)
-	assert.equal(shm.getTotalCreatedSize(), 4096 + 10000*4+8);
+	assert.equal(shm.getTotalSize(), 4096 + 10000*4+64); // extra 64 bytes for header of POSIX object
+	assert.equal(shm.getTotalCreatedSize(), 4096 + 10000*4+64);
 	assert(arr && typeof arr.key === 'undefined');
+	// Test runtime stats and counters
+	const segments = shm.stats();
+	assert.equal(segments.length, 2);
+	const sysvStats = segments.find((segment) => segment.type === 'sysv');
+	assert.equal(sysvStats.key, buf.key);
+	assert.equal(sysvStats.nattch, 1);
+	assert.equal(sysvStats.creatorPid, process.pid);
+	const posixStats = segments.find((segment) => segment.type === 'posix');
+	assert.equal(posixStats.name, posixKey);
+	assert.equal(posixStats.size, 10000*4);
+	assert.equal(posixStats.creatorPid, process.pid);
+	assert(posixStats.createdAt instanceof Date);
+	assert(segments.every((segment) => segment.isOwner && segment.attaches === 1 && segment.residentPages <= segment.pages));
+	assert(shm.counters().attaches > 0);
+	const metrics = shm.prometheus();
+	assert(/^shm_attaches_total \d+$/m.test(metrics));
+	assert(metrics.includes(`shm_segment_nattch{type="sysv",segment="${buf.key}"} 1\n`));
+	assert(!shm.prometheus({ prefix: 'app', segments: false }).includes('app_segment_'));
 	//bigarr = shm.create(1000*1000*1000*1.5, 'Float32Array'); //6Gb
 	assert.equal(arr.length, 10000);
 	assert.equal(arr.byteLength, 4*10000);
+	shm.prefault(arr, { populate: true, willNeed: true }).then((res) => assert.equal(res, arr));
+	// Test that prefault makes pages resident, with create() and with lock
+	const prefaultStats = () => shm.stats().find((segment) => segment.name === prefaultKey);
+	const prefaultArr = shm.create(512 * 1024, 'Float64Array', prefaultKey); // 4MB
+	const residentBefore = prefaultStats().residentPages;
+	if (residentBefore !== null)
+		assert(residentBefore < prefaultStats().pages / 2);
+	shm.prefault(prefaultArr).then(function(res) {
+		assert.equal(res, prefaultArr);
+		const segment = prefaultStats();
+		if (segment.residentPages !== null)
+			assert.equal(segment.residentPages, segment.pages);
+		// mlock() can be denied by RLIMIT_MEMLOCK, then promise is rejected
+		return shm.prefault(prefaultArr, { lock: true }).then(
+			(locked) => assert.equal(locked, prefaultArr),
+			(err) => assert(/not permitted|allocate memory|Resource temporarily unavailable/.test(err.message), err.message));
+	}).then(function() {
+		assert.equal(shm.destroy(prefaultKey), true);
+		const created = shm.create(1024, 'Float64Array', prefaultKey, '660', { populate: true });
+		assert(created instanceof Promise);
+		return created;
+	}).then(function(created) {
+		assert(created instanceof Float64Array && created.length === 1024);
+		const segment = prefaultStats();
+		if (segment.residentPages !== null)
+			assert.equal(segment.residentPages, segment.pages);
+		assert.equal(shm.destroy(prefaultKey), true);
+		// Mapping is pinned while it's populated, so array can be detached meanwhile
+		const detached = shm.create(512 * 1024, 'Float64Array', prefaultKey);
+		const populated = shm.prefault(detached);
+		assert.equal(shm.destroy(prefaultKey), true);
+		return populated.then((res) => assert.equal(res, detached));
+	}).catch(function(err) {
+		console.error(err);
+		process.exit(1);
+	});
+	// Test detach by GC
+	v8.setFlagsFromString('--expose-gc');
+	const gc = vm.runInNewContext('gc');
+	(function() {
+		const autoArr = shm.create(1000, 'Float64Array', autoKey, '660', { autoDetach: true });
+		const autoChunks = shm.get(autoKey, 'Float64Array', { autoDetach: true, chunked: true, chunkLength: 300 });
+		autoArr[999] = 1.5;
+		assert.equal(autoChunks.get(999), 1.5);
+		assert(shm.pageInfo(autoKey) !== null);
+	})();
+	const autoDetachTimer = setInterval(function() {
+		gc();
+		if (shm.pageInfo(autoKey) === null) {
+			clearInterval(autoDetachTimer);
+			clearTimeout(autoDetachTimeout);
+			assert.equal(shm.destroy(autoKey), true);
+		}
+	}, 10);
+	const autoDetachTimeout = setTimeout(function() {
+		assert.fail('Views with autoDetach were not detached by GC');
+	}, 2000);
+
+	// Test async create/get/detach/destroy
+	shm.createAsync(1000, 'Float64Array', asyncKey).then(async function(asyncArr) {
+		assert(asyncArr instanceof Float64Array);
+		assert.equal(asyncArr.length, 1000);
+		assert.equal(await shm.createAsync(1000, 'Float64Array', asyncKey), null);
+		asyncArr[999] = 2.5;
+		const asyncArr2 = await shm.getAsync(asyncKey, 'Float64Array');
+		assert.equal(asyncArr2[999], 2.5);
+		assert.equal(await shm.detachAsync(asyncKey), 1);
+		assert.equal(await shm.destroyAsync(asyncKey), true);
+		assert.equal(await shm.getAsync(asyncKey), null);
+		const asyncSysv = await shm.createAsync(10, 'Int32Array');
+		assert(asyncSysv.key > 0);
+		assert.equal((await shm.getAsync(asyncSysv.key, 'Int32Array')).length, 10);
+		assert.equal(await shm.destroyAsync(asyncSysv.key), true);
+		assert.equal(await shm.detachAsync(asyncSysv.key), -1);
+		await assert.rejects(shm.createAsync(-1, 'Buffer', asyncKey), RangeError);
+		// Checkpoint writes only changed blocks of file
+		const fileChunks = shm.createFile(fileKey, 3 << 20, 'Uint8Array', '600', { chunked: true, chunkLength: 1 << 20 });
+		fileChunks.set(5, 1);
+		shm.markDirty(fileChunks, 5, 6);
+		assert.equal(await shm.checkpoint(fileKey), 1 << 20); // header and element 5 are in first block
+		assert.equal(await shm.checkpoint(fileKey), 0);
+		assert.equal(await shm.flush(fileChunks, 0, 10), 10);
+		// Mapping is pinned while it's written in threadpool, so file can be closed meanwhile
+		shm.markDirty(fileChunks, 1 << 20, (3 << 20) - 1);
+		const pinnedCheckpoint = shm.checkpoint(fileKey);
+		const pinnedFlush = shm.flush(fileChunks, 0, 3 << 20);
+		assert.equal(shm.closeFile(fileKey, true), 0);
+		assert.equal(await pinnedCheckpoint, (2 << 20) + 64); // last block ends with file
+		assert.equal(await pinnedFlush, 3 << 20);
+		const anonFlushed = shm.createAnonymous(1 << 20, 'Uint8Array');
+		const pinnedAnonFlush = shm.flush(anonFlushed, 0, 1 << 20);
+		assert.equal(shm.detachAnonymous(anonFlushed), 0);
+		assert.equal(await pinnedAnonFlush, 1 << 20);
+	}).catch(function(err) {
+		console.error(err);
+		process.exit(1);
+	});
+
+	// Test worker thread: it reuses mapping of main thread, its attaches are detached on its exit
+	const workerArr = shm.create(1024, 'Int32Array', workerKey);
+	workerArr[0] = 42;
+	const reusesBefore = shm.counters().mappingReuses;
+	const thread = new workerThreads.Worker(`
+		const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+		const { parentPort } = require('worker_threads');
+		const arr = shm.get('${workerKey}', 'Int32Array');
+		Atomics.store(arr, 1, arr[0] + 1);
+		parentPort.postMessage(shm.stats().find((segment) => segment.name === '${workerKey}').attaches);
+	`, { eval: true });
+	thread.on('message', function(attaches) {
+		assert.equal(attaches, 2); // main thread and worker
+	});
+	thread.on('exit', function(code) {
+		assert.equal(code, 0);
+		assert.equal(Atomics.load(workerArr, 1), 43);
+		assert(shm.counters().mappingReuses > reusesBefore);
+		assert.equal(shm.stats().find((segment) => segment.name === workerKey).attaches, 1);
+		assert.equal(shm.destroy(workerKey), true);
+	});
+
+	// Test futex between processes: wait of this process is woken by notify from child process
+	const futexShared = shm.create(2, 'Int32Array', futexKey);
+	const futexWait = shm.wait(futexShared, 0, 0, 10000);
+	const futexChild = childProcess.spawn(process.execPath, ['-e', `
+		const shm = require(${JSON.stringify(require.resolve('../index.js'))});
+		const arr = shm.get('${futexKey}', 'Int32Array');
+		// Waiter can be still on its way to futex in threadpool, so notify until it's woken
+		const sleep = new Int32Array(new SharedArrayBuffer(4));
+		const deadline = Date.now() + 5000;
+		let woken = 0;
+		while (woken === 0 && Date.now() < deadline) {
+			Atomics.wait(sleep, 0, 0, 1);
+			woken = shm.notify(arr, 0);
+		}
+		Atomics.store(arr, 1, woken);
+		shm.detach('${futexKey}');
+		process.exit(woken === 1 ? 0 : 1);
+	`], { stdio: 'inherit' });
+	futexChild.on('exit', function(code) {
+		assert.equal(code, 0);
+		futexWait.then(function(res) {
+			assert.equal(res, 'ok');
+			assert.equal(Atomics.load(futexShared, 1), 1);
+			// Mapping is pinned while futex is waited, so it can be detached meanwhile
+			const detachedWait = shm.wait(futexShared, 0, 0, 100);
+			assert.equal(shm.destroy(futexKey), true);
+			return detachedWait;
+		}).then((res) => assert.equal(res, 'timed-out'));
+	});
+
 	buf[0] = 1;
 	arr[0] = 10.0;
 	//bigarr[bigarr.length-1] = 6.66;
@@ -75,7 +912,7 @@ if (cluster.isMaster) {
 			arr = shm.get(data.arrKey, 'Float32Array');
 			assert.equal(shm.getTotalCreatedSize(), 0);
 			// actual size of POSIX object can be multiple of PAGE_SIZE = 4096, but not for all OS
-			assert(shm.getTotalSize() == 4096 + 40960 || shm.getTotalSize() == 4096 + 10000*4+8);
+			assert(shm.getTotalSize() == 4096 + 40960 || shm.getTotalSize() == 4096 + 10000*4+64);
 
 			//bigarr = shm.get(data.bigarrKey, 'Float32Array');
 			console.log('[Worker] Typeof buf:', buf.constructor.name,
@@ -108,6 +945,86 @@ function cleanup() {
 			console.log(`Destroyed POSIX shared memory object with name ${posixKey}`);
 		}
 	} catch(_e) {}
+	try {
+		if (shm.destroy(hugeKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${hugeKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(autoKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${autoKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(slabKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${slabKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(hashTableKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${hashTableKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(seqlockKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${seqlockKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(mutexKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${mutexKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(rwLockKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${rwLockKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(asyncKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${asyncKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(resizeKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${resizeKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(legacyKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${legacyKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(reapKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${reapKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(workerKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${workerKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.closeFile(fileKey, true) === 0) {
+			console.log(`Removed file ${fileKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(queueKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${queueKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(prefaultKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${prefaultKey}`);
+		}
+	} catch(_e) {}
+	try {
+		if (shm.destroy(futexKey)) {
+			console.log(`Destroyed POSIX shared memory object with name ${futexKey}`);
+		}
+	} catch(_e) {}
 	assert.equal(shm.getTotalSize(), 0);
 };
 
@@ -13,6 +13,10 @@ let pass2: shm.Shm<Uint32Array> | null = shm.create(1, 'Uint32Array');
 let pass3: shm.Shm<Float64Array> | null = shm.create(456, 'Float64Array', 1234);
 let pass4: shm.Shm<Float64Array> | null = shm.create(456, 'Float64Array', '/test');
 let pass5: shm.Shm<Float64Array> | null = shm.create(456, 'Float64Array', '/test', '660');
+let pass5h: shm.Shm<Float64Array> | null = shm.create(456, 'Float64Array', '/test', '660', { hugePages: 'auto' });
+// typings:expect-error
+shm.create(456, 'Float64Array', '/test', '660', { hugePages: '4KB' });
+let pass5p: Promise<shm.Shm<Float64Array> | null> = shm.create(456, 'Float64Array', '/test', '660', { populate: true, lock: true });
 
 // typings:expect-error
 let fail3: Buffer = shm.get(123);
@@ -22,6 +26,35 @@ if (pass3) pass3.key as number;
 // typings:expect-error
 let fail4: Float64Array = shm.get(456, 'Float64Array');
 let pass7: shm.Shm<Float64Array> | null = shm.get(456, 'Float64Array');
+let pass7b: shm.Shm<BigInt64Array> | null = shm.get(456, 'BigInt64Array');
+let pass7u: shm.Shm<BigUint64Array> | null = shm.create(456, 'BigUint64Array');
+let pass7p: Promise<shm.Shm<Float64Array> | null> = shm.get(456, 'Float64Array', { willNeed: true });
+let pass7c: shm.ChunkedArray<Float64Array> | null = shm.get(456, 'Float64Array', { chunked: true });
+let pass7d: Float64Array | null = shm.get(456, 'Float64Array', { autoDetach: true });
+let pass7r: shm.Shm<Float64Array> = shm.resize('/test', 1000, 'Float64Array');
+let pass7rc: shm.ChunkedArray<Float64Array> = shm.resize('/test', 1000, 'Float64Array', { chunked: true });
+let pass7f: shm.Shm<Float64Array> | null = shm.refresh('/test', 'Float64Array');
+let pass7i: shm.ObjectInfo = shm.objectInfo('/test');
+let pass7it: Date | null = pass7i.createdAt;
+let pass7w: Float32Array | null = shm.mapWindow('/test', 0, 1000, 'Float32Array', { willNeed: true });
+let pass7wl: number = shm.mapWindow('/test', 0, 1000)!.objectLength;
+let pass7wu: boolean = shm.unmapWindow(pass7w!) && shm.discardWindow(pass7w!);
+for (const w of shm.windows('/test', { typeKey: 'Float64Array', windowLength: 1 << 20 })) {
+	let pass7wo: number = w.offset;
+	let pass7wa: Float64Array = w.array;
+}
+let pass7a: Promise<shm.Shm<Float64Array> | null> = shm.createAsync(456, 'Float64Array', '/test');
+let pass7ag: Promise<shm.ChunkedArray<Float64Array> | null> = shm.getAsync(456, 'Float64Array', { chunked: true });
+let pass7ad: Promise<number> = shm.detachAsync('/test');
+let pass7ax: Promise<boolean> = shm.destroyAsync(456);
+let pass5d: Float32Array | null = shm.create(10, 'Float32Array', '/test', undefined, { autoDetach: true });
+let pass5c: shm.ChunkedArray<Float32Array> | null = shm.create(1e10, 'Float32Array', '/test', undefined, { chunked: true, chunkLength: 1 << 30 });
+if (pass5c) {
+    pass5c.chunkFor(1e9) as Float32Array;
+    pass5c.get(1e9) as number;
+    pass5c.set(1e9, 1.5);
+}
+shm.prefault(new Float64Array(1), { populate: true }) as Promise<Float64Array>;
 
 // typings:expect-error
 shm.detach();
@@ -38,3 +71,136 @@ shm.destroy('/test') as boolean;
 shm.detachAll() as number;
 shm.getTotalSize() as number;
 shm.LengthMax as number;
+
+let pageInfo: shm.PageInfo | null = shm.pageInfo(123);
+if (pageInfo) pageInfo.pageSize as number;
+let numaInfo: shm.NumaInfo | null = shm.numaInfo('/test');
+if (numaInfo && numaInfo.residentPages) numaInfo.residentPages[0] as number;
+let segmentStats: shm.SegmentStats[] = shm.stats();
+if (segmentStats[0].type === 'sysv') segmentStats[0].nattch as number | null;
+segmentStats[0].createdAt as Date | null;
+shm.counters().attachNs as number;
+shm.counters().mappingReuses as number;
+shm.prometheus() as string;
+shm.prometheus({ prefix: 'app_shm', segments: false }) as string;
+// typings:expect-error
+shm.prometheus('shm');
+let listed: shm.ListEntry[] = shm.list();
+if (listed[0].type === 'posix') listed[0].ownerAlive as boolean | null;
+shm.reap({ olderThan: 60000, dryRun: true, types: ['posix'], prefix: '/app_' }) as shm.ListEntry[];
+shm.heartbeat() as number;
+shm.heartbeat('/test') as number;
+// typings:expect-error
+shm.reap({ types: ['memfd'] });
+shm.create(456, 'Float64Array', '/test', '660', { numa: { bind: [0, 1] } });
+// typings:expect-error
+shm.create(456, 'Float64Array', '/test', '660', { numa: 'nearest' });
+
+let anon: Float64Array & { fd: number } = shm.createAnonymous(456, 'Float64Array');
+let anonChunks: shm.ChunkedArray<Int32Array> = shm.createAnonymous(456, 'Int32Array', { chunked: true });
+shm.seal(anon, ['write', 'grow']) as Array<'seal' | 'shrink' | 'grow' | 'write'>;
+// typings:expect-error
+shm.seal(anon.fd, ['read']);
+shm.sendFd(3, anon);
+shm.recvFd(3, 1000).then((fd) => shm.getAnonymous(fd, 'Float64Array')[0] as number);
+shm.detachAnonymous(anon.fd) as number;
+
+let file: shm.Shm<Float64Array> | null = shm.createFile('/tmp/data.shm', 456, 'Float64Array');
+let fileChunks: shm.ChunkedArray<Float64Array> | null = shm.openFile('/tmp/data.shm', 'Float64Array', { chunked: true });
+// typings:expect-error
+shm.createFile('/tmp/data.shm', 456, 'Float64Array', '660', { hugePages: 'auto' });
+if (file) {
+    shm.markDirty(file, 0, 10);
+    let flushed: Promise<number> = shm.flush(file);
+}
+let checkpointed: Promise<number> = shm.checkpoint('/tmp/data.shm');
+shm.closeFile('/tmp/data.shm', true) as number;
+
+// typings:expect-error
+shm.createQueue('/queue');
+let queue: shm.Queue | null = shm.createQueue('/queue', 64, 1024);
+if (queue) {
+    queue.push(Buffer.from('msg')) as boolean;
+    queue.pop(Buffer.alloc(queue.slotSize)) as number;
+    queue.pushBatch([Buffer.from('a'), new Uint8Array(2)]) as number;
+    queue.popBatch(Buffer.alloc(1024), 10) as number;
+}
+let queue2: shm.Queue | null = shm.openQueue('/queue');
+
+// typings:expect-error
+shm.createSlab('/slab');
+let slab: shm.Slab | null = shm.createSlab('/slab', 1024 * 1024, { slabSize: 4096 });
+if (slab) {
+    let offset: number | null = slab.alloc(100);
+    if (offset !== null) {
+        let slabBuf: Buffer = slab.view(offset);
+        let slabArr: Float64Array = slab.view(offset, 'Float64Array', 4);
+        slab.free(offset);
+    }
+    slab.recover() as number;
+}
+let slab2: shm.Slab | null = shm.openSlab('/slab');
+
+// typings:expect-error
+shm.createHashTable('/ht', 1024);
+let ht: shm.HashTable | null = shm.createHashTable('/ht', 1024, 8, 16);
+if (ht) {
+    ht.put(1, Buffer.alloc(16)) as boolean;
+    ht.put(2n, new Float64Array(2)) as boolean;
+    let htValue: Buffer | null = ht.get(1);
+    ht.get(Buffer.alloc(8), new Float64Array(2)) as boolean;
+    ht.offsetOf(1) as number;
+    ht.delete(1) as boolean;
+    ht.getMany(new BigUint64Array([1n, 2n]), new Float64Array(4), new Uint8Array(2)) as number;
+}
+let ht2: shm.HashTable | null = shm.openHashTable('/ht');
+
+// typings:expect-error
+shm.createSeqlock('/seqlock');
+let seqlock: shm.Seqlock | null = shm.createSeqlock('/seqlock', 4096);
+if (seqlock) {
+    seqlock.publish(new Float64Array(512)) as number;
+    seqlock.read(new Float64Array(512)) as number;
+    seqlock.version as number;
+}
+let seqlock2: shm.Seqlock | null = shm.openSeqlock('/seqlock');
+
+// typings:expect-error
+shm.createMutex();
+let mutex: shm.Mutex | null = shm.createMutex('/mutex');
+if (mutex) {
+    let lockRes: Promise<'ok' | 'owner-died' | 'timed-out'> = mutex.lock(100);
+    mutex.tryLock() as 'ok' | 'owner-died' | 'busy';
+    mutex.unlock();
+    mutex.owner as number;
+}
+let mutex2: shm.Mutex | null = shm.openMutex('/mutex');
+let rwLock: shm.RwLock | null = shm.createRwLock('/rwlock', 16);
+if (rwLock) {
+    let readRes: Promise<'ok' | 'owner-died' | 'timed-out'> = rwLock.readLock();
+    rwLock.readUnlock();
+    rwLock.tryWriteLock() as 'ok' | 'owner-died' | 'busy';
+    rwLock.writeUnlock();
+    rwLock.readers as number;
+}
+let rwLock2: shm.RwLock | null = shm.openRwLock('/rwlock');
+
+let futexArr = new Int32Array(1);
+// typings:expect-error
+shm.wait(futexArr);
+let waitRes: Promise<'ok' | 'not-equal' | 'timed-out'> = shm.wait(futexArr, 0, 0, 100);
+shm.notify(futexArr, 0) as number;
+
+shm.ops.sum(new Float64Array(10)) as number;
+shm.ops.argmax(new Float32Array(10), 2, 5) as number;
+let scaled: Float32Array = shm.ops.scale(new Float32Array(10), 2);
+let dotRes: Promise<number> = shm.ops.dotAsync(new Int16Array(4), new Int16Array(4));
+shm.ops.configure({ isa: 'avx2', threads: 4 }).supportedIsa as string[];
+shm.ops.sum(new BigInt64Array(10)) as bigint;
+let bigFilled: BigUint64Array = shm.ops.fill(new BigUint64Array(10), 1n);
+// typings:expect-error
+shm.ops.fill(new BigInt64Array(10), 1);
+shm.copyIn(new Float64Array(10), 2, new ArrayBuffer(16)) as number;
+let copied: Promise<number> = shm.copyOutAsync(new Float64Array(10), 0, Buffer.alloc(8));
+// typings:expect-error
+shm.copyIn(new Float64Array(10), 2, [1, 2]);